@@ -0,0 +1,39 @@
+# The SH2 library keeps the SHTP and SH2 state in file scope statics, one copy of the library serves one sensor. A second
+# sensor runs on a second copy: the same sources built again, every global symbol they define prefixed so both copies
+# link side by side. Shared by the component and the host tests.
+
+# Prefix of the secondary copy, bno085_sh2_secondary_ops (bno085_sh2_ops.c) binds the renamed entry points
+set(BNO085_SH2_SECONDARY_PREFIX bno085_sh2_secondary_)
+
+set(BNO085_SH2_RENAME_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/bno085_sh2_rename.cmake)
+
+
+# bno085_add_sh2_copy(<target> PREFIX <prefix> SOURCES <files...> INCLUDE_DIRS <dirs...> [COMPILE_OPTIONS <options...>])
+# Builds the SH2 sources as the static library <target> with the defined global symbols renamed to <prefix><symbol>.
+function(bno085_add_sh2_copy target)
+    cmake_parse_arguments(ARG "" "PREFIX" "SOURCES;INCLUDE_DIRS;COMPILE_OPTIONS" ${ARGN})
+
+    add_library(${target}_unprefixed STATIC ${ARG_SOURCES})
+    target_include_directories(${target}_unprefixed PRIVATE ${ARG_INCLUDE_DIRS})
+    target_compile_options(${target}_unprefixed PRIVATE ${ARG_COMPILE_OPTIONS})
+
+    set(archive ${CMAKE_CURRENT_BINARY_DIR}/${CMAKE_STATIC_LIBRARY_PREFIX}${target}${CMAKE_STATIC_LIBRARY_SUFFIX})
+    add_custom_command(
+        OUTPUT ${archive}
+        COMMAND ${CMAKE_COMMAND}
+            -DNM=${CMAKE_NM}
+            -DOBJCOPY=${CMAKE_OBJCOPY}
+            -DPREFIX=${ARG_PREFIX}
+            -DINPUT=$<TARGET_FILE:${target}_unprefixed>
+            -DOUTPUT=${archive}
+            -P ${BNO085_SH2_RENAME_SCRIPT}
+        DEPENDS ${target}_unprefixed ${BNO085_SH2_RENAME_SCRIPT}
+        COMMENT "Renaming the SH2 symbols of ${target} with ${ARG_PREFIX}"
+        VERBATIM
+    )
+    add_custom_target(${target}_rename DEPENDS ${archive})
+
+    add_library(${target} STATIC IMPORTED GLOBAL)
+    set_target_properties(${target} PROPERTIES IMPORTED_LOCATION ${archive})
+    add_dependencies(${target} ${target}_rename)
+endfunction()
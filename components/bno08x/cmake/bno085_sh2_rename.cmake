@@ -0,0 +1,32 @@
+# cmake -DNM=<nm> -DOBJCOPY=<objcopy> -DPREFIX=<prefix> -DINPUT=<archive> -DOUTPUT=<archive> -P bno085_sh2_rename.cmake
+# Copies INPUT to OUTPUT with every global symbol defined in INPUT renamed to <PREFIX><symbol>. The references to the
+# symbols defined elsewhere (libc) are left alone, so --prefix-symbols can't be used.
+
+execute_process(
+    COMMAND ${NM} -g --defined-only ${INPUT}
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to list the symbols of ${INPUT}")
+endif()
+
+# "<value> <type> <name>" lines, the member headers and blank lines are skipped
+string(REGEX MATCHALL "[0-9a-fA-F]+ [A-Za-z] [^\n]+" definitions "${symbols}")
+set(renames "")
+foreach(definition IN LISTS definitions)
+    string(REGEX REPLACE "^[0-9a-fA-F]+ [A-Za-z] " "" name "${definition}")
+    string(APPEND renames "${name} ${PREFIX}${name}\n")
+endforeach()
+if(renames STREQUAL "")
+    message(FATAL_ERROR "No symbol defined in ${INPUT}")
+endif()
+
+file(WRITE ${OUTPUT}.syms "${renames}")
+execute_process(
+    COMMAND ${OBJCOPY} --redefine-syms=${OUTPUT}.syms ${INPUT} ${OUTPUT}
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to rename the symbols of ${INPUT}")
+endif()
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "bno085_replay_hal.h"
+#include "bno085_shtp_log.h"
+
+
+static int replay_open(sh2_Hal_t *self) {
+    bno085_replay_hal_t * replay = (bno085_replay_hal_t *) self;
+
+    // Restart from the first record
+    if (fseek(replay->file, BNO085_SHTP_LOG_FILE_HEADER_SIZE, SEEK_SET) != 0) {
+        return -1;
+    }
+    replay->eof = false;
+
+    return 0;
+}
+
+
+static void replay_close(sh2_Hal_t *self) {
+    // nothing need to be done
+}
+
+
+static int replay_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us) {
+    bno085_replay_hal_t * replay = (bno085_replay_hal_t *) self;
+
+    while (!replay->eof) {
+        uint8_t record_header[BNO085_SHTP_LOG_RECORD_HEADER_SIZE];
+        if (fread(record_header, 1, sizeof(record_header), replay->file) != sizeof(record_header)) {
+            replay->eof = true;
+            break;
+        }
+
+        uint32_t record_t_us;
+        uint16_t record_len;
+        bno085_shtp_log_decode_record_header(record_header, &record_t_us, &record_len);
+
+        // Skip the packet if the SH2 buffer is too small, the same as the I2C and SPI HAL
+        if (record_len > len) {
+            fseek(replay->file, record_len, SEEK_CUR);
+            replay->skipped_count += 1;
+            continue;
+        }
+
+        if (fread(pBuffer, 1, record_len, replay->file) != record_len) {
+            replay->eof = true;
+            break;
+        }
+
+        replay->now_us = record_t_us;
+        replay->packet_count += 1;
+        *t_us = record_t_us;
+
+        return record_len;
+    }
+
+    return 0;
+}
+
+
+static int replay_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
+    // Commands from SH2 are accepted and dropped, the responses are part of the log
+    return len;
+}
+
+
+static uint32_t replay_get_time_us(sh2_Hal_t *self) {
+    bno085_replay_hal_t * replay = (bno085_replay_hal_t *) self;
+
+    if (replay->eof) {
+        replay->now_us += BNO085_REPLAY_IDLE_STEP_US;
+    }
+
+    return replay->now_us;
+}
+
+
+int bno085_replay_hal_init(bno085_replay_hal_t *replay, const char *path) {
+    memset(replay, 0, sizeof(bno085_replay_hal_t));
+
+    replay->file = fopen(path, "rb");
+    if (replay->file == NULL) {
+        return -1;
+    }
+
+    uint8_t file_header[BNO085_SHTP_LOG_FILE_HEADER_SIZE];
+    if (fread(file_header, 1, sizeof(file_header), replay->file) != sizeof(file_header) ||
+        !bno085_shtp_log_check_file_header(file_header)) {
+        fclose(replay->file);
+        replay->file = NULL;
+        return -1;
+    }
+
+    replay->_HAL.open = replay_open;
+    replay->_HAL.close = replay_close;
+    replay->_HAL.read = replay_read;
+    replay->_HAL.write = replay_write;
+    replay->_HAL.getTimeUs = replay_get_time_us;
+
+    return 0;
+}
+
+
+void bno085_replay_hal_deinit(bno085_replay_hal_t *replay) {
+    if (replay->file) {
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+}
+
+
+bool bno085_replay_hal_eof(const bno085_replay_hal_t *replay) {
+    return replay->eof;
+}
@@ -0,0 +1,51 @@
+#ifndef BNO085_REPLAY_HAL_H
+#define BNO085_REPLAY_HAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sh2_hal.h"
+
+/**
+ * Host (Linux) implementation of the SH2 HAL that replays a log recorded by the packet recorder
+ * (see bno085_shtp_log.h). Build with the sh2 sources and this file, no ESP-IDF dependency.
+ *
+ * Time is virtual: getTimeUs() follows the timestamp of the last replayed packet so the log runs as fast as the host
+ * can service it. Once the log is exhausted the clock advances by BNO085_REPLAY_IDLE_STEP_US per call so the SH2
+ * timeouts still expire.
+ */
+
+#ifndef BNO085_REPLAY_IDLE_STEP_US
+    #define BNO085_REPLAY_IDLE_STEP_US 1000
+#endif  // BNO085_REPLAY_IDLE_STEP_US
+
+
+typedef struct {
+    sh2_Hal_t _HAL;  // SH2 HAL interface -> Align the memory with the context structure allowing better type casting
+    FILE * file;
+    uint32_t now_us;
+    uint32_t packet_count;      // Number of packets replayed
+    uint32_t skipped_count;     // Number of packets dropped as the SH2 buffer is too small
+    bool eof;
+} bno085_replay_hal_t;
+
+
+/**
+ * @brief Open the log and populate the HAL functions.
+ *
+ * @return int 0 on success, -1 if the file can't be opened or is not a SHTP log.
+ */
+int bno085_replay_hal_init(bno085_replay_hal_t *replay, const char *path);
+
+/**
+ * @brief Close the log.
+ */
+void bno085_replay_hal_deinit(bno085_replay_hal_t *replay);
+
+/**
+ * @brief Whether every packet of the log is replayed.
+ */
+bool bno085_replay_hal_eof(const bno085_replay_hal_t *replay);
+
+#endif // BNO085_REPLAY_HAL_H
@@ -0,0 +1,433 @@
+#include <string.h>
+#include <math.h>
+
+#include "bno085_sim_hal.h"
+
+#define SHTP_HEADER_SIZE 4
+
+#define SHTP_CHANNEL_COMMAND 0
+#define SHTP_CHANNEL_EXECUTABLE 1
+#define SHTP_CHANNEL_CONTROL 2
+#define SHTP_CHANNEL_INPUT 3
+
+#define SH2_SET_FEATURE_COMMAND 0xFD
+#define SH2_GET_FEATURE_REQUEST 0xFE
+#define SH2_GET_FEATURE_RESPONSE 0xFC
+#define SH2_PRODUCT_ID_REQUEST 0xF9
+#define SH2_PRODUCT_ID_RESPONSE 0xF8
+#define SH2_BASE_TIMESTAMP_REPORT 0xFB
+#define SH2_EXECUTABLE_RESET 0x01
+#define SH2_EXECUTABLE_RESET_COMPLETE 0x01
+
+#define SH2_FEATURE_REPORT_SIZE 17
+#define SH2_PRODUCT_ID_RESPONSE_SIZE 16
+#define SH2_BASE_TIMESTAMP_REPORT_SIZE 5
+
+#define SIM_REPORT_ACCELEROMETER 0x01
+#define SIM_REPORT_GYROSCOPE_CALIBRATED 0x02
+#define SIM_REPORT_LINEAR_ACCELERATION 0x04
+#define SIM_REPORT_ROTATION_VECTOR 0x05
+#define SIM_REPORT_GAME_ROTATION_VECTOR 0x08
+#define SIM_REPORT_STABILITY_DETECTOR 0x1C
+
+#define SIM_REPORT_STATUS 0x03  // High accuracy, no delay
+#define SIM_ROTATION_VECTOR_ACCURACY_RAD 0.05f
+
+
+static void write_u16(uint8_t *out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+
+static void write_u32(uint8_t *out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+
+static uint32_t read_u32(const uint8_t *in) {
+    return (uint32_t) in[0] | ((uint32_t) in[1] << 8) | ((uint32_t) in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+
+static void write_q(uint8_t *out, float value, int q_point) {
+    float scaled = roundf(ldexpf(value, q_point));
+    if (scaled > INT16_MAX) scaled = INT16_MAX;
+    if (scaled < INT16_MIN) scaled = INT16_MIN;
+
+    write_u16(out, (uint16_t) (int16_t) scaled);
+}
+
+
+static void write_shtp_header(bno085_sim_hal_t *sim, uint8_t *out, uint16_t len, uint8_t channel) {
+    write_u16(out, len);
+    out[2] = channel;
+    out[3] = sim->channel_sequence[channel]++;
+}
+
+
+static void queue_packet(bno085_sim_hal_t *sim, uint8_t channel, const uint8_t *payload, uint16_t payload_len) {
+    if (sim->pending_count >= BNO085_SIM_MAX_PENDING_PACKETS) {
+        return;  // The host isn't reading, drop the response like the sensor would
+    }
+
+    uint32_t index = (sim->pending_head + sim->pending_count) % BNO085_SIM_MAX_PENDING_PACKETS;
+    uint8_t *packet = sim->pending_packets[index];
+    uint16_t len = SHTP_HEADER_SIZE + payload_len;
+
+    write_shtp_header(sim, packet, len, channel);
+    memcpy(packet + SHTP_HEADER_SIZE, payload, payload_len);
+    sim->pending_packet_len[index] = len;
+    sim->pending_count += 1;
+}
+
+
+static void queue_feature_response(bno085_sim_hal_t *sim, uint8_t report_id) {
+    uint8_t response[SH2_FEATURE_REPORT_SIZE] = {0};
+    response[0] = SH2_GET_FEATURE_RESPONSE;
+    response[1] = report_id;
+
+    if (report_id < BNO085_SIM_MAX_REPORT_ID) {
+        write_u32(&response[5], sim->reports[report_id].interval_us);
+    }
+
+    queue_packet(sim, SHTP_CHANNEL_CONTROL, response, sizeof(response));
+}
+
+
+uint8_t bno085_sim_report_length(uint8_t report_id) {
+    switch (report_id) {
+        case SIM_REPORT_ACCELEROMETER:
+        case SIM_REPORT_GYROSCOPE_CALIBRATED:
+        case SIM_REPORT_LINEAR_ACCELERATION:
+            return 10;
+        case SIM_REPORT_ROTATION_VECTOR:
+            return 14;
+        case SIM_REPORT_GAME_ROTATION_VECTOR:
+            return 12;
+        case SIM_REPORT_STABILITY_DETECTOR:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+
+static void encode_report(bno085_sim_hal_t *sim, uint8_t report_id, const bno085_sim_motion_t *motion, uint8_t *out) {
+    out[0] = report_id;
+    out[1] = sim->reports[report_id].sequence++;
+    out[2] = SIM_REPORT_STATUS;
+    out[3] = 0;
+
+    switch (report_id) {
+        case SIM_REPORT_ACCELEROMETER:
+            write_q(&out[4], motion->acceleration[0], 8);
+            write_q(&out[6], motion->acceleration[1], 8);
+            write_q(&out[8], motion->acceleration[2], 8);
+            break;
+        case SIM_REPORT_GYROSCOPE_CALIBRATED:
+            write_q(&out[4], motion->angular_velocity[0], 9);
+            write_q(&out[6], motion->angular_velocity[1], 9);
+            write_q(&out[8], motion->angular_velocity[2], 9);
+            break;
+        case SIM_REPORT_LINEAR_ACCELERATION:
+            write_q(&out[4], motion->linear_acceleration[0], 8);
+            write_q(&out[6], motion->linear_acceleration[1], 8);
+            write_q(&out[8], motion->linear_acceleration[2], 8);
+            break;
+        case SIM_REPORT_ROTATION_VECTOR:
+            write_q(&out[12], SIM_ROTATION_VECTOR_ACCURACY_RAD, 12);
+            // Fall through - the first fields are the same as the game rotation vector
+        case SIM_REPORT_GAME_ROTATION_VECTOR:
+            write_q(&out[4], motion->i, 14);
+            write_q(&out[6], motion->j, 14);
+            write_q(&out[8], motion->k, 14);
+            write_q(&out[10], motion->real, 14);
+            break;
+        case SIM_REPORT_STABILITY_DETECTOR:
+            write_u16(&out[4], motion->stability);
+            break;
+        default:
+            break;
+    }
+}
+
+
+static bool next_report_due_us(const bno085_sim_hal_t *sim, uint64_t *due_us) {
+    bool found = false;
+
+    for (int report_id = 0; report_id < BNO085_SIM_MAX_REPORT_ID; report_id++) {
+        const bno085_sim_report_t *report = &sim->reports[report_id];
+        if (report->interval_us == 0) {
+            continue;
+        }
+
+        if (!found || report->next_us < *due_us) {
+            *due_us = report->next_us;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+
+static void reset_state(bno085_sim_hal_t *sim) {
+    memset(sim->reports, 0, sizeof(sim->reports));
+    memset(sim->channel_sequence, 0, sizeof(sim->channel_sequence));
+    sim->pending_head = 0;
+    sim->pending_count = 0;
+}
+
+
+static int sim_open(sh2_Hal_t *self) {
+    bno085_sim_hal_t * sim = (bno085_sim_hal_t *) self;
+
+    reset_state(sim);
+
+    // Minimal advertisement followed by the reset notification, as sent by the sensor after boot
+    uint8_t advertisement[] = {0x00};
+    queue_packet(sim, SHTP_CHANNEL_COMMAND, advertisement, sizeof(advertisement));
+
+    uint8_t reset_complete[] = {SH2_EXECUTABLE_RESET_COMPLETE};
+    queue_packet(sim, SHTP_CHANNEL_EXECUTABLE, reset_complete, sizeof(reset_complete));
+
+    return 0;
+}
+
+
+static void sim_close(sh2_Hal_t *self) {
+    // nothing need to be done
+}
+
+
+static int sim_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us) {
+    bno085_sim_hal_t * sim = (bno085_sim_hal_t *) self;
+
+    switch (sim->fault) {
+        case BNO085_SIM_FAULT_READ_ERROR:
+            sim->read_error_count += 1;
+            return -1;
+        case BNO085_SIM_FAULT_STALL:
+        case BNO085_SIM_FAULT_LATCHED:
+            return 0;
+        default:
+            break;
+    }
+
+    // Responses first
+    if (sim->pending_count > 0) {
+        uint32_t index = sim->pending_head;
+        uint16_t packet_len = sim->pending_packet_len[index];
+
+        sim->pending_head = (sim->pending_head + 1) % BNO085_SIM_MAX_PENDING_PACKETS;
+        sim->pending_count -= 1;
+
+        if (packet_len > len) {
+            return 0;
+        }
+
+        memcpy(pBuffer, sim->pending_packets[index], packet_len);
+        *t_us = (uint32_t) sim->now_us;
+        return packet_len;
+    }
+
+    uint64_t due_us = 0;
+    if (!next_report_due_us(sim, &due_us)) {
+        return 0;
+    }
+
+    // Jump to the next report, the virtual clock never goes backward
+    if (due_us > sim->now_us) {
+        sim->now_us = due_us;
+    }
+
+    bno085_sim_motion_t motion;
+    sim->profile(sim->profile_arg, sim->now_us, &motion);
+
+    unsigned capacity = len < BNO085_SIM_MAX_PACKET_SIZE ? len : BNO085_SIM_MAX_PACKET_SIZE;
+    uint16_t packet_len = SHTP_HEADER_SIZE;
+
+    // Base timestamp: every report of the packet is sampled at the packet time
+    if (capacity < SHTP_HEADER_SIZE + SH2_BASE_TIMESTAMP_REPORT_SIZE) {
+        return 0;
+    }
+    pBuffer[packet_len] = SH2_BASE_TIMESTAMP_REPORT;
+    write_u32(&pBuffer[packet_len + 1], 0);
+    packet_len += SH2_BASE_TIMESTAMP_REPORT_SIZE;
+
+    uint32_t report_count = 0;
+    for (int report_id = 0; report_id < BNO085_SIM_MAX_REPORT_ID; report_id++) {
+        bno085_sim_report_t *report = &sim->reports[report_id];
+        if (report->interval_us == 0 || report->next_us > sim->now_us) {
+            continue;
+        }
+
+        uint8_t report_len = bno085_sim_report_length(report_id);
+        if (packet_len + report_len > capacity) {
+            break;  // The rest is sent in the next packet with the same timestamp
+        }
+
+        encode_report(sim, report_id, &motion, &pBuffer[packet_len]);
+        packet_len += report_len;
+        report->next_us += report->interval_us;
+        report_count += 1;
+    }
+
+    if (report_count == 0) {
+        return 0;
+    }
+
+    write_shtp_header(sim, pBuffer, packet_len, SHTP_CHANNEL_INPUT);
+    sim->packet_count += 1;
+    sim->report_count += report_count;
+    *t_us = (uint32_t) sim->now_us;
+
+    return packet_len;
+}
+
+
+static int sim_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
+    bno085_sim_hal_t * sim = (bno085_sim_hal_t *) self;
+
+    if (len <= SHTP_HEADER_SIZE) {
+        return len;
+    }
+
+    uint8_t channel = pBuffer[2];
+    const uint8_t *payload = pBuffer + SHTP_HEADER_SIZE;
+    unsigned payload_len = len - SHTP_HEADER_SIZE;
+
+    if (channel == SHTP_CHANNEL_EXECUTABLE && payload[0] == SH2_EXECUTABLE_RESET) {
+        // A latched sensor only comes back with the reset pin
+        if (sim->fault != BNO085_SIM_FAULT_LATCHED) {
+            sim->fault = BNO085_SIM_FAULT_NONE;
+            bno085_sim_hal_inject_reset(sim);
+        }
+    } else if (sim->fault != BNO085_SIM_FAULT_NONE) {
+        // Commands are lost while the sensor is faulty
+    } else if (channel == SHTP_CHANNEL_CONTROL) {
+        switch (payload[0]) {
+            case SH2_SET_FEATURE_COMMAND:
+                if (payload_len >= SH2_FEATURE_REPORT_SIZE) {
+                    uint8_t report_id = payload[1];
+                    if (report_id < BNO085_SIM_MAX_REPORT_ID && bno085_sim_report_length(report_id) > 0) {
+                        bno085_sim_report_t *report = &sim->reports[report_id];
+                        report->interval_us = read_u32(&payload[5]);
+                        report->next_us = sim->now_us + report->interval_us;
+                    }
+                    queue_feature_response(sim, report_id);
+                }
+                break;
+            case SH2_GET_FEATURE_REQUEST:
+                if (payload_len >= 2) {
+                    queue_feature_response(sim, payload[1]);
+                }
+                break;
+            case SH2_PRODUCT_ID_REQUEST:
+                {
+                    uint8_t response[SH2_PRODUCT_ID_RESPONSE_SIZE] = {0};
+                    response[0] = SH2_PRODUCT_ID_RESPONSE;
+                    response[2] = 3;  // Software version major
+                    queue_packet(sim, SHTP_CHANNEL_CONTROL, response, sizeof(response));
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return len;
+}
+
+
+static uint32_t sim_get_time_us(sh2_Hal_t *self) {
+    bno085_sim_hal_t * sim = (bno085_sim_hal_t *) self;
+
+    sim->now_us += BNO085_SIM_TIME_STEP_US;
+
+    return (uint32_t) sim->now_us;
+}
+
+
+void bno085_sim_hal_init(bno085_sim_hal_t *sim, bno085_sim_motion_profile_t profile, void *profile_arg) {
+    memset(sim, 0, sizeof(bno085_sim_hal_t));
+
+    sim->profile = profile ? profile : bno085_sim_profile_static;
+    sim->profile_arg = profile_arg;
+
+    sim->_HAL.open = sim_open;
+    sim->_HAL.close = sim_close;
+    sim->_HAL.read = sim_read;
+    sim->_HAL.write = sim_write;
+    sim->_HAL.getTimeUs = sim_get_time_us;
+}
+
+
+void bno085_sim_hal_inject_reset(bno085_sim_hal_t *sim) {
+    reset_state(sim);
+    sim->reset_count += 1;
+
+    uint8_t reset_complete[] = {SH2_EXECUTABLE_RESET_COMPLETE};
+    queue_packet(sim, SHTP_CHANNEL_EXECUTABLE, reset_complete, sizeof(reset_complete));
+}
+
+
+void bno085_sim_hal_inject_fault(bno085_sim_hal_t *sim, bno085_sim_fault_t fault) {
+    sim->fault = fault;
+}
+
+
+void bno085_sim_hal_hard_reset(bno085_sim_hal_t *sim) {
+    sim->fault = BNO085_SIM_FAULT_NONE;
+    bno085_sim_hal_inject_reset(sim);
+}
+
+
+void bno085_sim_profile_static(void *arg, uint64_t t_us, bno085_sim_motion_t *motion) {
+    memset(motion, 0, sizeof(bno085_sim_motion_t));
+
+    motion->real = 1.0f;
+    motion->acceleration[2] = 9.80665f;
+    motion->stability = 1;
+}
+
+
+void bno085_sim_profile_roll_sweep(void *arg, uint64_t t_us, bno085_sim_motion_t *motion) {
+    const bno085_sim_roll_sweep_t *sweep = (const bno085_sim_roll_sweep_t *) arg;
+
+    bno085_sim_profile_static(NULL, t_us, motion);
+
+    float t = t_us * 1e-6f;
+    float omega = 2.0f * (float) M_PI * sweep->frequency_hz;
+    float roll = sweep->amplitude_rad * sinf(omega * t);
+
+    motion->real = cosf(roll * 0.5f);
+    motion->i = sinf(roll * 0.5f);
+    motion->acceleration[1] = 9.80665f * sinf(roll);
+    motion->acceleration[2] = 9.80665f * cosf(roll);
+    motion->angular_velocity[0] = sweep->amplitude_rad * omega * cosf(omega * t);
+    motion->stability = 2;
+}
+
+
+void bno085_sim_profile_recoil(void *arg, uint64_t t_us, bno085_sim_motion_t *motion) {
+    const bno085_sim_recoil_t *recoil = (const bno085_sim_recoil_t *) arg;
+
+    bno085_sim_profile_static(NULL, t_us, motion);
+
+    if (recoil->period_us == 0 || recoil->pulse_us == 0) {
+        return;
+    }
+
+    uint32_t phase_us = t_us % recoil->period_us;
+    if (phase_us < recoil->pulse_us) {
+        float pulse = recoil->peak * sinf((float) M_PI * phase_us / recoil->pulse_us);
+        motion->linear_acceleration[0] = pulse;
+        motion->acceleration[0] = pulse;
+        motion->stability = 2;
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef BNO085_SIM_HAL_H
+#define BNO085_SIM_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sh2_hal.h"
+
+/**
+ * Host (Linux) implementation of the SH2 HAL simulating a BNO085. Reports are generated from a scripted motion profile
+ * and framed as SHTP input reports, so the real SH2 library and the driver callbacks can be loaded at rates and report
+ * mixes that are hard to reproduce on the bench. Build with the sh2 sources and this file, no ESP-IDF dependency.
+ *
+ * Supported: set/get feature commands, product ID request, reset (command or injected) and the input reports listed in
+ *  bno085_sim_report_length(). The advertisement sent on open is minimal (no TLVs). Faults can be injected to exercise
+ *  the driver recovery, see bno085_sim_fault_t.
+ *
+ * Time is virtual: a read jumps straight to the next due report, so the simulation runs as fast as the host can
+ * service it. getTimeUs() advances by BNO085_SIM_TIME_STEP_US per call so SH2 timeouts still expire.
+ */
+
+#ifndef BNO085_SIM_TIME_STEP_US
+    #define BNO085_SIM_TIME_STEP_US 10
+#endif  // BNO085_SIM_TIME_STEP_US
+
+#ifndef BNO085_SIM_MAX_PACKET_SIZE
+    #define BNO085_SIM_MAX_PACKET_SIZE 256  // Reports due at the same time are batched into packets up to this size
+#endif  // BNO085_SIM_MAX_PACKET_SIZE
+
+#define BNO085_SIM_MAX_PENDING_PACKETS 8
+#define BNO085_SIM_MAX_REPORT_ID 0x30
+
+
+typedef enum {
+    BNO085_SIM_FAULT_NONE = 0,
+    BNO085_SIM_FAULT_READ_ERROR,        // Reads fail, cleared by a soft reset command
+    BNO085_SIM_FAULT_STALL,             // Sensor stops responding, cleared by a soft reset command
+    BNO085_SIM_FAULT_LATCHED,           // Sensor stops responding and ignores the soft reset, cleared by bno085_sim_hal_hard_reset()
+} bno085_sim_fault_t;
+
+
+typedef struct {
+    float real, i, j, k;            // Orientation, used by the rotation vector and game rotation vector
+    float acceleration[3];          // m/s^2 including gravity, used by the accelerometer
+    float linear_acceleration[3];   // m/s^2 without gravity, used by the linear acceleration
+    float angular_velocity[3];      // rad/s, used by the calibrated gyroscope
+    uint16_t stability;             // Stability detector event (1: entered stable, 2: exited stable)
+} bno085_sim_motion_t;
+
+
+/**
+ * Motion profile evaluated for every generated report.
+ */
+typedef void (*bno085_sim_motion_profile_t)(void *arg, uint64_t t_us, bno085_sim_motion_t *motion);
+
+
+typedef struct {
+    uint32_t interval_us;           // 0 if disabled
+    uint64_t next_us;
+    uint8_t sequence;
+} bno085_sim_report_t;
+
+
+typedef struct {
+    sh2_Hal_t _HAL;  // SH2 HAL interface -> Align the memory with the context structure allowing better type casting
+    bno085_sim_motion_profile_t profile;
+    void * profile_arg;
+
+    uint64_t now_us;
+    uint8_t channel_sequence[6];
+    bno085_sim_report_t reports[BNO085_SIM_MAX_REPORT_ID];
+
+    // Responses waiting to be read, served before the input reports
+    uint8_t pending_packets[BNO085_SIM_MAX_PENDING_PACKETS][BNO085_SIM_MAX_PACKET_SIZE];
+    uint16_t pending_packet_len[BNO085_SIM_MAX_PENDING_PACKETS];
+    uint32_t pending_head;
+    uint32_t pending_count;
+
+    bno085_sim_fault_t fault;
+
+    // Statistics
+    uint32_t packet_count;          // Input report packets generated
+    uint32_t report_count;          // Input reports generated
+    uint32_t reset_count;
+    uint32_t read_error_count;      // Reads failed by an injected fault
+} bno085_sim_hal_t;
+
+
+typedef struct {
+    float amplitude_rad;
+    float frequency_hz;
+} bno085_sim_roll_sweep_t;
+
+
+typedef struct {
+    uint32_t period_us;             // Time between shots
+    uint32_t pulse_us;              // Duration of the impulse
+    float peak;                     // Peak acceleration on the x axis in m/s^2
+} bno085_sim_recoil_t;
+
+
+/**
+ * @brief Initialize the simulator and populate the HAL functions.
+ */
+void bno085_sim_hal_init(bno085_sim_hal_t *sim, bno085_sim_motion_profile_t profile, void *profile_arg);
+
+/**
+ * @brief Simulate a sensor reset: every report is disabled and a reset notification is queued. Use it to generate
+ *  reset storms in the middle of a stream.
+ */
+void bno085_sim_hal_inject_reset(bno085_sim_hal_t *sim);
+
+/**
+ * @brief Inject a fault, it stays active until cleared by the matching reset.
+ */
+void bno085_sim_hal_inject_fault(bno085_sim_hal_t *sim, bno085_sim_fault_t fault);
+
+/**
+ * @brief Simulate a pulse on the reset pin: clears any fault then resets the sensor.
+ */
+void bno085_sim_hal_hard_reset(bno085_sim_hal_t *sim);
+
+/**
+ * @brief Length of the input report generated by the simulator, 0 if the report is not supported.
+ */
+uint8_t bno085_sim_report_length(uint8_t report_id);
+
+/**
+ * @brief Device at rest, level, stable.
+ */
+void bno085_sim_profile_static(void *arg, uint64_t t_us, bno085_sim_motion_t *motion);
+
+/**
+ * @brief Sinusoidal roll around the x axis, arg is bno085_sim_roll_sweep_t.
+ */
+void bno085_sim_profile_roll_sweep(void *arg, uint64_t t_us, bno085_sim_motion_t *motion);
+
+/**
+ * @brief Level device with periodic half-sine recoil impulses along the x axis, arg is bno085_sim_recoil_t.
+ */
+void bno085_sim_profile_recoil(void *arg, uint64_t t_us, bno085_sim_motion_t *motion);
+
+#endif // BNO085_SIM_HAL_H
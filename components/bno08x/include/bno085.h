@@ -5,6 +5,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 #include "freertos/event_groups.h"
@@ -15,6 +16,15 @@
 #include "sh2.h"
 #include "sh2_SensorValue.h"
 
+#include "bno085_timebase.h"
+#include "bno085_sample_ring.h"
+#include "bno085_recovery.h"
+#include "bno085_euler.h"
+#include "bno085_i2c_reader.h"
+#include "bno085_spi_transfer.h"
+#include "bno085_report_descriptor.h"
+#include "bno085_sh2_ops.h"
+
 #ifndef BNO085_SENSOR_POLLER_TASK_PRIORITY
     #define BNO085_SENSOR_POLLER_TASK_PRIORITY 8  // Higher priority for interrupt driven task
 #endif  // BNO085_SENSOR_POLLER_TASK_PRIORITY
@@ -24,45 +34,159 @@
 #endif
 // #define BNO085_SENSOR_POLLER_PERIOD_MS 10
 
-#ifndef BNO085_EVENT_QUEUE_DEPTH
-    #define BNO085_EVENT_QUEUE_DEPTH 1
-#endif  // BNO085_EVENT_QUEUE_DEPTH
+#ifndef BNO085_SERVICE_BUDGET_PACKETS
+    #define BNO085_SERVICE_BUDGET_PACKETS 16  // Maximum number of packets serviced per wake-up while the interrupt stays asserted
+#endif  // BNO085_SERVICE_BUDGET_PACKETS
+
+#ifndef BNO085_INTERRUPT_TIMEOUT_MS
+    #define BNO085_INTERRUPT_TIMEOUT_MS 500
+#endif  // BNO085_INTERRUPT_TIMEOUT_MS
+
+#define BNO085_RECOVERY_POLL_PERIOD_MS 50
+
+#ifndef BNO085_MAX_SH2_INSTANCES
+    #define BNO085_MAX_SH2_INSTANCES (1 + BNO085_SH2_SECONDARY_INSTANCE)  // SH2 instances bound at a time, the default and the renamed copy when built
+#endif  // BNO085_MAX_SH2_INSTANCES
+
+#define BNO085_LATENCY_HISTOGRAM_BUCKETS 16  // Bucket n counts latencies in [2^n, 2^(n+1)) us, the last bucket holds everything above
+#define BNO085_JITTER_HISTOGRAM_BUCKETS 12   // Bucket 0 counts deviations below 32 us, bucket n in [2^(n+4), 2^(n+5)) us, the last bucket holds everything above
 
 
 #ifndef BNO085_USE_SOFTWARE_CONTROLLED_CS_PIN
     #define BNO085_USE_SOFTWARE_CONTROLLED_CS_PIN 0
 #endif  // BNO085_USE_SOFTWARE_CONTROLLED_CS_PIN
 
+#ifndef BNO085_USE_QUEUED_SPI_TRANSFER
+    #define BNO085_USE_QUEUED_SPI_TRANSFER 1  // Block on interrupt completed (DMA) SPI transfers instead of busy waiting. The SPI bus should be initialized with a DMA channel
+#endif  // BNO085_USE_QUEUED_SPI_TRANSFER
+
 
 #define DEG_TO_RAD(deg) ((deg) * M_PI / 180.0f)
 #define RAD_TO_DEG(rad) ((rad) * 180.0f / M_PI)
 
 
 typedef struct {
-    float real;
-    float i;
-    float j;
-    float k;
-} quaternion_t;
+    uint32_t seq;           // Sequence number assigned by the driver, increments by 1 for every sample of the report
+    int64_t timestamp_us;   // Time (esp_timer) when the sensor took the sample, mapped from the BNO085 timestamp
+    int64_t arrival_us;     // Time (esp_timer) when the sample is received by the driver
+    bool valid;             // False if received while the driver recovers from a sensor fault
+    sh2_SensorValue_t value;
+} bno085_sample_t;
+
+
+/**
+ * A consumer of a sensor report. Each subscriber keeps its own cursor into the shared sample ring and is woken up
+ * by a task notification (bits set with `eSetBits`) whenever a new sample is published. 
+ */
+typedef struct bno085_subscriber_s {
+    sh2_SensorId_t sensor_id;
+    uint32_t cursor;                    // Sequence number of the last consumed sample
+    uint32_t dropped;                   // Number of samples overwritten before the subscriber could read them
+    TaskHandle_t notify_task;           // Task to notify on new samples
+    uint32_t notify_bits;               // Notification bits to set on the task
+    int64_t last_timestamp_us;          // Sample time of the last consumed sample
+    int64_t last_arrival_us;            // Arrival time of the last consumed sample
+    struct bno085_subscriber_s * next;
+} bno085_subscriber_t;
+
+
+/**
+ * A client's request for a sensor report. The report manager runs the report at the fastest interval among the
+ * registered requests and only sends a set feature command when that effective interval changes.
+ */
+typedef struct bno085_report_request_s {
+    sh2_SensorId_t sensor_id;
+    uint32_t interval_ms;               // Interval needed by the client, 0 if the client doesn't need the report
+    struct bno085_report_request_s * next;
+} bno085_report_request_t;
+
+
+typedef struct {
+    uint32_t request_count;             // Number of request updates from the clients
+    uint32_t command_count;             // Number of set feature commands sent by the report manager
+} bno085_report_manager_stats_t;
 
 
 typedef struct {
-    sh2_SensorConfig_t config;
-    QueueHandle_t sensor_value_queue;
+    sh2_SensorConfig_t config;           // Last requested configuration, restored after a sensor reset
+    uint32_t applied_interval_us;        // Report interval of the last configuration accepted by SH2
+    uint32_t actual_report_interval_us;  // Report interval applied by the sensor, from the get feature response
+    uint32_t batch_interval_us;          // Batch interval applied whenever the report is enabled
+    bno085_timebase_t timebase;
+    bno085_sample_ring_t * sample_ring;
+    bno085_subscriber_t * subscriber_list;
+    bno085_report_request_t * request_list;
+    uint32_t interval_floor_ms;          // Slowest effective interval allowed while the report is requested, 0 for none
+    int64_t last_arrival_us;             // Arrival time of the previous report, for the jitter statistics
 } sensor_report_config_t;
 
 
+/**
+ * Called with every SHTP packet read from the sensor, including the 4 byte header, and the interrupt timestamp passed
+ * to SH2. Runs in the sensor poller task (or the caller of the SH2 API), keep it short. Encode with bno085_shtp_log.h
+ * to replay the traffic on the host.
+ */
+typedef void (*bno085_packet_recorder_cb_t)(void *arg, const uint8_t *packet, uint16_t len, uint32_t t_us);
+
+
 typedef struct {
+    uint32_t wakeup_count;               // Number of times the poller task is woken up by the interrupt
+    uint32_t packet_count;               // Number of SHTP packets received
+    uint32_t report_count;               // Number of sensor reports received
+    uint32_t max_reports_per_wakeup;     // Largest number of reports drained by a single wake-up
+    uint32_t latency_histogram[BNO085_LATENCY_HISTOGRAM_BUCKETS];  // Interrupt to decode latency of the reports
+} bno085_service_stats_t;
+
+
+typedef struct {
+    uint32_t report_count;               // Number of reports received
+    uint32_t decode_failure_count;       // Number of reports SH2 failed to decode
+    uint32_t dropped_count;              // Samples overwritten before a consumer could read them, summed over the consumers
+    uint32_t jitter_histogram[BNO085_JITTER_HISTOGRAM_BUCKETS];  // Deviation of the inter-arrival time from the report interval
+} bno085_sensor_stats_t;
+
+
+typedef struct {
+    bno085_service_stats_t service;
+    bno085_recovery_stats_t recovery;
+    uint32_t transport_error_count;      // Number of failed bus transactions
+    int64_t transport_error_us;          // Time spent in the failed bus transactions
+    bno085_sensor_stats_t sensor[SH2_MAX_SENSOR_EVENT_LEN];
+} bno085_stats_t;
+
+
+typedef struct bno085_ctx_s bno085_ctx_t;
+
+
+struct bno085_ctx_s {
     sh2_Hal_t _HAL; // SH2 HAL interface -> Align the memory with the context structure allowing better type casting
+    const bno085_sh2_ops_t *sh2;          // SH2 instance owned by the context
+    SemaphoreHandle_t sh2_lock;           // Held around every call into the SH2 instance, the library is not thread-safe
     TaskHandle_t sensor_poller_task_handle;
     sensor_report_config_t enabled_sensor_report_list[SH2_MAX_SENSOR_EVENT_LEN];
+    SemaphoreHandle_t subscriber_list_lock;
     EventGroupHandle_t sensor_event_control;
+    volatile uint32_t last_interrupt_us;  // Lower 32 bits of esp_timer at the last interrupt
+    volatile bool sleeping;               // Between bno085_enter_sleep() and bno085_wake_up(), no report is expected
+    bool hal_waits_for_interrupt;         // The transport blocks on the interrupt event inside the HAL (SPI)
+    int (*transport_read)(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us);
+    uint32_t reports_in_service;          // Reports received since the last wake-up, written by the poller task only
+    bno085_stats_t stats;
+    portMUX_TYPE stats_lock;              // Held while updating or copying the stats, keeps the snapshot consistent
+    SemaphoreHandle_t report_request_lock;
+    uint32_t report_request_defer_depth;  // Requests are only recorded while deferred, applied by bno085_apply_report_requests()
+    bno085_report_manager_stats_t report_manager_stats;
+
+    // Recovery, driven by the poller task
+    bno085_recovery_t recovery;           // Updated under stats_lock, the stats of the recovery are ctx->stats.recovery
+    esp_err_t (*soft_reset)(bno085_ctx_t *ctx);  // Transport soft reset, NULL if not supported. Must not wait for the sensor
+    esp_err_t (*hard_reset)(bno085_ctx_t *ctx);  // Hardware reset through reset_pin
 
     gpio_num_t interrupt_pin;
     gpio_num_t reset_pin;
     gpio_num_t boot_pin;
     gpio_num_t ps0_wake_pin;
-} bno085_ctx_t;
+};
 
 
 typedef struct {
@@ -70,6 +194,8 @@ typedef struct {
 
     // I2C specific attributes
     i2c_master_dev_handle_t dev_handle;
+    int64_t receive_start_us;            // Start of the last read transaction, to account the time lost on an error
+    bno085_i2c_reader_t reader;
 } bno085_i2c_ctx_t;
 
 
@@ -79,6 +205,8 @@ typedef struct {
     // SPI specific attributes
     spi_device_handle_t dev_handle;
     gpio_num_t spi_cs_pin;
+    volatile int64_t transfer_complete_us;  // Set by the SPI driver from the ISR when the queued transaction completes
+    bno085_spi_transfer_stats_t transfer_stats;
 } bno085_spi_ctx_t;
 
 
@@ -88,19 +216,34 @@ typedef struct {
  * @param ctx Pointer to the BNO085 context.
  * @param i2c_bus_handle I2C bus handle for communication.
  * @param interrupt_pin GPIO pin for the interrupt.
- * @return esp_err_t ESP_OK on success, error code otherwise.
+ * @param sh2_ops SH2 instance to run the sensor on, NULL for `bno085_sh2_default_ops`.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the SH2 instance is used by another sensor, error code
+ *  otherwise.
  */
-esp_err_t bno085_init_i2c(bno085_i2c_ctx_t *ctx, i2c_master_bus_handle_t i2c_bus_handle, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin);
+esp_err_t bno085_init_i2c(bno085_i2c_ctx_t *ctx, i2c_master_bus_handle_t i2c_bus_handle, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, const bno085_sh2_ops_t *sh2_ops);
 
 
 /**
- * @brief Initialize the BNO085 sensor using SPI communication
+ * @brief Get the I2C transfer counters, used to measure the read overhead per packet.
  */
-esp_err_t bno085_init_spi(bno085_spi_ctx_t *ctx, spi_host_device_t spi_host, gpio_num_t spi_cs_pin, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, gpio_num_t ps0_wake_pin);
+void bno085_i2c_get_transfer_stats(bno085_i2c_ctx_t *ctx, bno085_i2c_transfer_stats_t *stats);
 
 
 /**
- * @brief Put sensor in sleep state
+ * @brief Initialize the BNO085 sensor using SPI communication. `sh2_ops` is the SH2 instance to run the sensor on, NULL
+ *  for `bno085_sh2_default_ops`. A second sensor alongside the default one runs on `bno085_sh2_secondary_ops`.
+ */
+esp_err_t bno085_init_spi(bno085_spi_ctx_t *ctx, spi_host_device_t spi_host, gpio_num_t spi_cs_pin, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, gpio_num_t ps0_wake_pin, const bno085_sh2_ops_t *sh2_ops);
+
+
+/**
+ * @brief Get the SPI transfer counters, used to compare the CPU busy time per packet between the queued and polling transfers.
+ */
+void bno085_spi_get_transfer_stats(bno085_spi_ctx_t *ctx, bno085_spi_transfer_stats_t *stats);
+
+
+/**
+ * @brief Put sensor in sleep state. The stall detection is suspended until bno085_wake_up().
  */
 esp_err_t bno085_enter_sleep(bno085_ctx_t *ctx);
 
@@ -111,93 +254,333 @@ esp_err_t bno085_wake_up(bno085_ctx_t *ctx);
 
 
 /**
- * @brief Enable Game Rotation Vector Report
+ * @brief Enable a report with the set feature flags from its descriptor.
  *
  * @param ctx Pointer to the BNO085 context.
+ * @param sensor_id Sensor ID of the report.
  * @param interval_ms Interval in milliseconds for the report. Setting to 0 to disable.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the report has no descriptor, error code otherwise.
+ */
+esp_err_t bno085_enable_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t interval_ms);
+
+/**
+ * @brief Enable the report, e.g. bno085_enable_game_rotation_vector_report(). Setting the interval to 0 disables it.
+ */
+#define BNO085_REPORT_ENABLE_ACCESSOR(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) \
+    static inline esp_err_t bno085_enable_##name##_report(bno085_ctx_t *ctx, uint32_t interval_ms) { \
+        return bno085_enable_report(ctx, sensor_id, interval_ms); \
+    }
+BNO085_REPORT_DESCRIPTOR_TABLE(BNO085_REPORT_ENABLE_ACCESSOR)
+
+
+/**
+ * @brief Set the batch interval of a sensor report. The sensor buffers the reports in its FIFO and only raises the
+ *  interrupt once the batch interval expires, the whole batch is then drained in a single interrupt. The batch interval
+ *  is applied when the report is enabled, or immediately if the report is already enabled.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param sensor_id Sensor report ID.
+ * @param batch_interval_ms Batch interval in milliseconds. Setting to 0 to report immediately.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t bno085_enable_game_rotation_vector_report(bno085_ctx_t *ctx, uint32_t interval_ms);
+esp_err_t bno085_set_report_batch_interval(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t batch_interval_ms);
+
 
 /**
- * @brief Enable linear acceleration report
+ * @brief Register a report request with the report manager. The request starts with no interval (report not needed).
  *
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report. Setting to 0 to disable.
+ * @param request Request to register. The memory must remain valid for the lifetime of the driver.
+ * @param sensor_id Sensor report ID.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t bno085_enable_linear_acceleration_report(bno085_ctx_t *ctx, uint32_t interval_ms);
+esp_err_t bno085_register_report_request(bno085_ctx_t *ctx, bno085_report_request_t *request, sh2_SensorId_t sensor_id);
+
 
 /**
- * @brief Enable Rotation Vector Report
+ * @brief Update the interval needed by the client. The report runs at the fastest interval of all requests, and the
+ *  set feature command is only sent when that interval changes.
+ *
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report. Setting to 0 to disable.
+ * @param request Registered request.
+ * @param interval_ms Interval in milliseconds. Setting to 0 to release the report.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t bno085_enable_rotation_vector_report(bno085_ctx_t *ctx, uint32_t interval_ms);
+esp_err_t bno085_update_report_request(bno085_ctx_t *ctx, bno085_report_request_t *request, uint32_t interval_ms);
 
 
-/** 
- * @brief Enable stability detection and classification report
+/**
+ * @brief Slow down a requested report, e.g. while the device is at rest. The effective interval becomes the slower of
+ *  the fastest request and the floor. A report that is not requested stays disabled. Safe to call from any task, the
+ *  set feature command is serialized with the sensor poller through the SH2 lock.
  *
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report. Setting to 0 to disable.
+ * @param sensor_id Sensor report ID.
+ * @param interval_floor_ms Interval floor in milliseconds. Setting to 0 to run at the requested interval.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t bno085_enable_stability_classification_report(bno085_ctx_t *ctx, uint32_t interval_ms);
+esp_err_t bno085_set_report_interval_floor(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t interval_floor_ms);
 
 
-/** 
- * @brief Wait for significatn motion event report
+/**
+ * @brief Get the report interval of the last configuration accepted by SH2, i.e. the effective interval including the
+ *  floor. Use it to size the timeouts of the consumers.
+ *
+ * @return uint32_t Report interval in us, 0 if the report is disabled.
+ */
+uint32_t bno085_get_report_interval_us(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id);
+
+
+/**
+ * @brief Record the request updates without applying them, until the matching bno085_apply_report_requests(). Use it
+ *  around a group of updates (e.g. switching views) so a report released then requested again is left untouched.
  */
+void bno085_defer_report_requests(bno085_ctx_t *ctx);
 
-esp_err_t bno085_enable_stability_detector_report(bno085_ctx_t *ctx, uint32_t interval_ms);
 
 /**
- * @brief Wait for BNO085 game rotation vector roll and pitch values.
+ * @brief End a bno085_defer_report_requests() and apply the reports whose effective interval has changed.
+ */
+esp_err_t bno085_apply_report_requests(bno085_ctx_t *ctx);
+
+
+/**
+ * @brief Get the request and set feature command counters, the difference is the number of commands avoided.
+ */
+void bno085_get_report_manager_stats(bno085_ctx_t *ctx, bno085_report_manager_stats_t *stats);
+
+
+/**
+ * @brief Get a consistent snapshot of the driver statistics: service, recovery, transport errors and per sensor report
+ *  counters. The counters are updated in short critical sections, the stream is not interrupted.
+ */
+void bno085_get_stats(bno085_ctx_t *ctx, bno085_stats_t *stats);
+
+
+/**
+ * @brief Reset all driver statistics.
+ */
+void bno085_reset_stats(bno085_ctx_t *ctx);
+
+
+/**
+ * @brief Get the recovery state. Samples received outside BNO085_RECOVERY_IDLE are flagged invalid.
+ */
+bno085_recovery_state_t bno085_get_recovery_state(bno085_ctx_t *ctx);
+
+
+/**
+ * @brief Get the recovery counters and durations.
+ */
+void bno085_get_recovery_stats(bno085_ctx_t *ctx, bno085_recovery_stats_t *stats);
+
+
+/**
+ * @brief Get the wake-up, packet and report counters and the interrupt to decode latency histogram.
+ */
+void bno085_get_service_stats(bno085_ctx_t *ctx, bno085_service_stats_t *stats);
+
+
+/**
+ * @brief Reset the service counters.
+ */
+void bno085_reset_service_stats(bno085_ctx_t *ctx);
+
+
+/**
+ * @brief Estimate a percentile of the interrupt to decode latency from the histogram.
+ *
+ * @param stats Pointer to the service stats.
+ * @param percentile Percentile between 0 and 100.
+ * @return uint32_t Upper bound of the histogram bucket holding the percentile in us, 0 if no report is received.
+ */
+uint32_t bno085_get_service_latency_percentile_us(const bno085_service_stats_t *stats, uint32_t percentile);
+
+/**
+ * @brief Bucket of a latency in a BNO085_LATENCY_HISTOGRAM_BUCKETS log2 histogram, for the clients keeping their own.
+ */
+uint32_t bno085_latency_histogram_bucket(int64_t latency_us);
+
+/**
+ * @brief Estimate a percentile from a log2 latency histogram of BNO085_LATENCY_HISTOGRAM_BUCKETS buckets.
+ *
+ * @param histogram Bucket counts, filled with bno085_latency_histogram_bucket().
+ * @param percentile Percentile between 0 and 100.
+ * @return uint32_t Upper bound of the histogram bucket holding the percentile in us, 0 if the histogram is empty.
+ */
+uint32_t bno085_latency_histogram_percentile_us(const uint32_t *histogram, uint32_t percentile);
+
+/**
+ * @brief Wait for BNO085 game rotation vector roll and pitch values. Only the latest sample since the last call is decoded.
  *
  * @param ctx Pointer to the BNO085 context.
+ * @param subscriber Subscriber of the game rotation vector report.
  * @param roll Pointer to store the roll value.
  * @param pitch Pointer to store the pitch value.
  * @param block_wait Whether to block wait for the values.
- * @return esp_err_t ESP_OK on success, error code otherwise.
+ * @return esp_err_t ESP_OK on success, the error of bno085_wait_for_report() otherwise.
  */
-esp_err_t bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_ctx_t *ctx, float *roll, float *pitch, float *yaw, bool block_wait);
+esp_err_t bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, float *roll, float *pitch, float *yaw, bool block_wait);
 
 /**
  * @brief Wait for linear acceleration report
  *
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report.
- * @return esp_err_t ESP_OK on success, error code otherwise.
+ * @param subscriber Subscriber of the linear acceleration report.
+ * @return esp_err_t ESP_OK on success, the error of bno085_wait_for_report() otherwise.
  */
-esp_err_t bno085_wait_for_linear_acceleration_report(bno085_ctx_t *ctx, float *x, float *y, float *z, bool block_wait);
+esp_err_t bno085_wait_for_linear_acceleration_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, float *x, float *y, float *z, bool block_wait);
 
 
 /**
  * @brief Wait for stability classification report
  *
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report.
- * @return esp_err_t ESP_OK on success, error code otherwise.
+ * @param subscriber Subscriber of the stability classifier report.
+ * @return esp_err_t ESP_OK on success, the error of bno085_wait_for_report() otherwise.
  */
-esp_err_t bno085_wait_for_stability_classification_report(bno085_ctx_t *ctx, uint8_t * classification, bool block_wait);
+esp_err_t bno085_wait_for_stability_classification_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, uint8_t * classification, bool block_wait);
 
 
 /**
  * @brief Wait for rotation vector roll pitch pan
  * @param ctx Pointer to the BNO085 context.
- * @param interval_ms Interval in milliseconds for the report.
- * @return esp_err_t ESP_OK on success, error code otherwise.
+ * @param subscriber Subscriber of the rotation vector report.
+ * @return esp_err_t ESP_OK on success, the error of bno085_wait_for_report() otherwise.
  */
-esp_err_t bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_ctx_t * ctx, float *roll, float *pitch, float *yaw, float *accuracy, bool block_wait);
+esp_err_t bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_ctx_t * ctx, bno085_subscriber_t *subscriber, float *roll, float *pitch, float *yaw, float *accuracy, bool block_wait);
 
 
 /** 
  * @brief Wait for stability detector report
  * @param ctx Pointer to the BNO085 context.
+ * @param subscriber Subscriber of the stability detector report.
+ * @return esp_err_t ESP_OK on success, the error of bno085_wait_for_report() otherwise.
+ */
+esp_err_t bno085_wait_for_stability_detector_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, uint16_t *stability, bool block_wait);
+
+
+/**
+ * @brief Wait for the latest sample of the subscribed report. Older samples since the last call are skipped.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param subscriber Subscriber of the report.
+ * @param sample Pointer to store the decoded sample.
+ * @param block_wait Whether to block wait for the sample.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the sample was taken while the driver recovers from a
+ *  sensor fault, ESP_FAIL if no sample is available.
+ */
+esp_err_t bno085_wait_for_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, bno085_sample_t *sample, bool block_wait);
+
+/**
+ * @brief Wait for the latest value of the report, e.g. bno085_read_gravity(). The subscriber must be subscribed to the
+ *  report's sensor ID. Returns the error of bno085_wait_for_report(), ESP_ERR_INVALID_ARG if the sample is of another
+ *  report.
+ */
+#define BNO085_REPORT_READ_ACCESSOR(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) \
+    static inline esp_err_t bno085_read_##name(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, type *value, bool block_wait) { \
+        bno085_sample_t sample; \
+        esp_err_t err = bno085_wait_for_report(ctx, subscriber, &sample, block_wait); \
+        if (err != ESP_OK) { \
+            return err; \
+        } \
+        return bno085_get_##name##_value(&sample.value, value) ? ESP_OK : ESP_ERR_INVALID_ARG; \
+    }
+BNO085_REPORT_DESCRIPTOR_TABLE(BNO085_REPORT_READ_ACCESSOR)
+
+
+/**
+ * @brief Get the sequence number of the latest sample of a sensor report. Use it to initialize the cursor of
+ *  `bno085_read_samples()` to skip samples received before the consumer starts.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param sensor_id Sensor report ID.
+ * @return uint32_t Sequence number of the latest sample, 0 if no sample is received.
+ */
+uint32_t bno085_get_sample_cursor(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id);
+
+
+/**
+ * @brief Read all samples of a sensor report received after the cursor, without blocking.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param sensor_id Sensor report ID.
+ * @param cursor Sequence number of the last consumed sample. Updated to the last sample read on return.
+ * @param samples Buffer to store the samples, in the order of arrival.
+ * @param max_samples Number of samples the buffer can hold.
+ * @param dropped Optional. Incremented by the number of samples overwritten before the consumer could read them.
+ * @return size_t Number of samples copied to the buffer.
+ */
+size_t bno085_read_samples(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t *cursor, bno085_sample_t *samples, size_t max_samples, uint32_t *dropped);
+
+
+/**
+ * @brief Subscribe to a sensor report. The subscriber starts from the latest sample, and the task is notified 
+ *  with `notify_bits` every time a new sample is published. A task consuming multiple reports shall use distinct bits
+ *  for each subscriber.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param subscriber Subscriber to register. The memory must remain valid until unsubscribed.
+ * @param sensor_id Sensor report ID.
+ * @param notify_task Task to notify. Set to NULL to use the calling task.
+ * @param notify_bits Task notification bits.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t bno085_subscribe(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, sh2_SensorId_t sensor_id, TaskHandle_t notify_task, uint32_t notify_bits);
+
+
+/**
+ * @brief Remove the subscriber from the report.
+ */
+esp_err_t bno085_unsubscribe(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber);
+
+
+/**
+ * @brief Move the subscriber cursor to the latest sample, discarding all pending samples.
+ */
+void bno085_subscriber_flush(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber);
+
+
+/**
+ * @brief Read all pending samples of the subscriber. If no sample is pending, block up to `wait_ticks` for the
+ *  notification from the driver. 
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param subscriber Subscriber to read from.
+ * @param samples Buffer to store the samples, in the order of arrival.
+ * @param max_samples Number of samples the buffer can hold.
+ * @param wait_ticks Maximum time to wait for the sample, the notifications of other subscribers of the task don't extend it.
+ * @return size_t Number of samples copied to the buffer.
+ */
+size_t bno085_subscriber_read(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, bno085_sample_t *samples, size_t max_samples, TickType_t wait_ticks);
+
+
+/**
+ * @brief Get the age of the last sample consumed by the subscriber, i.e. the time elapsed since the sensor took the sample.
+ *
+ * @return int64_t Age in us, -1 if the subscriber has not consumed a sample yet.
+ */
+int64_t bno085_subscriber_get_sample_age_us(bno085_subscriber_t *subscriber);
+
+
+/**
+ * @brief Get the estimated skew between the BNO085 clock and esp_timer, measured on a periodic report.
+ *
+ * @param ctx Pointer to the BNO085 context.
+ * @param sensor_id Sensor report ID.
+ * @param skew_ppm Pointer to store the skew in ppm. Positive when the sensor clock runs slower.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if not enough samples are collected.
+ */
+esp_err_t bno085_get_timebase_skew_ppm(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, float *skew_ppm);
+
+
+/**
+ * @brief Install the packet recorder. Can be called before the sensor is initialized to capture the start up traffic.
+ *
+ * @param recorder_cb Recorder callback, NULL to stop recording.
+ * @param arg Argument passed to the callback.
  */
-esp_err_t bno085_wait_for_stability_detector_report(bno085_ctx_t *ctx, uint16_t *stability, bool block_wait);
+void bno085_set_packet_recorder(bno085_packet_recorder_cb_t recorder_cb, void *arg);
 
 
 #endif // BNO085_H
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef BNO085_EULER_H
+#define BNO085_EULER_H
+
+
+typedef struct {
+    float real;
+    float i;
+    float j;
+    float k;
+} quaternion_t;
+
+
+/**
+ * @brief Convert a quaternion to roll, pitch and yaw (rad) in single precision. The quaternion is normalized once and
+ *  the subexpressions are shared between the angles.
+ *
+ * @param q Pointer to the quaternion, does not need to be normalized.
+ * @param roll Pointer to store the roll, NULL to skip.
+ * @param pitch Pointer to store the pitch, NULL to skip.
+ * @param yaw Pointer to store the yaw, NULL to skip.
+ */
+void quaternion_to_euler_f32(const quaternion_t *q, float *roll, float *pitch, float *yaw);
+
+
+#endif  // BNO085_EULER_H
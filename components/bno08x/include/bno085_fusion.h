@@ -0,0 +1,84 @@
+#ifndef BNO085_FUSION_H
+#define BNO085_FUSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifndef BNO085_FUSION_FIXED_POINT
+    #define BNO085_FUSION_FIXED_POINT 0  // 1 to run the filter in Q4.28 integer arithmetic, for targets without an FPU
+#endif  // BNO085_FUSION_FIXED_POINT
+
+#ifndef BNO085_FUSION_DEFAULT_BETA
+    #define BNO085_FUSION_DEFAULT_BETA 0.033f  // Gradient descent gain in rad/s, about the gyroscope noise of the BNO085
+#endif  // BNO085_FUSION_DEFAULT_BETA
+
+#ifndef BNO085_FUSION_MAX_GYRO_GAP_US
+    #define BNO085_FUSION_MAX_GYRO_GAP_US 100000  // Longer gaps between gyroscope samples (reset, rate change) restart the integration
+#endif  // BNO085_FUSION_MAX_GYRO_GAP_US
+
+
+#if BNO085_FUSION_FIXED_POINT
+typedef int32_t bno085_fusion_scalar_t;  // Q4.28
+#else
+typedef float bno085_fusion_scalar_t;
+#endif  // BNO085_FUSION_FIXED_POINT
+
+
+typedef struct {
+    float beta;                         // Gradient descent gain, higher corrects the gyroscope drift faster but passes more accelerometer noise
+    uint32_t output_interval_us;        // Interval of the roll/pitch output, 0 to output on every gyroscope sample
+} bno085_fusion_config_t;
+
+
+/**
+ * Madgwick gradient descent filter fusing the gyroscope and accelerometer reports into roll and pitch, independent of
+ * the fusion running on the BNO085. The gyroscope drives the update rate, the latest accelerometer sample corrects the
+ * drift. Yaw is not observable without a magnetometer and drifts freely.
+ *
+ * The filter is free of ESP-IDF dependencies so it can be replayed against recorded reports on the host.
+ */
+typedef struct {
+    bno085_fusion_config_t config;
+    bno085_fusion_scalar_t q[4];        // Orientation quaternion w, x, y, z
+    bno085_fusion_scalar_t a[3];        // Latest accelerometer sample, normalized
+    bool accel_valid;
+    bool aligned;                       // Quaternion initialized from the accelerometer
+    int64_t last_gyro_us;
+    int64_t next_output_us;
+    uint32_t update_count;
+    uint32_t output_count;
+} bno085_fusion_t;
+
+
+/**
+ * @brief Initialize the filter. The orientation is aligned to gravity on the first accelerometer sample.
+ */
+void bno085_fusion_init(bno085_fusion_t *fusion, const bno085_fusion_config_t *config);
+
+/**
+ * @brief Restart the filter, e.g. after a sensor reset. The configuration is kept.
+ */
+void bno085_fusion_reset(bno085_fusion_t *fusion);
+
+/**
+ * @brief Feed an accelerometer sample (m/s^2, gravity included).
+ */
+void bno085_fusion_update_accelerometer(bno085_fusion_t *fusion, int64_t timestamp_us, float x, float y, float z);
+
+/**
+ * @brief Feed a gyroscope sample (rad/s) and advance the orientation.
+ *
+ * @param fusion Filter.
+ * @param timestamp_us Sample time, used for the integration step.
+ * @param x, y, z Angular rate.
+ * @return true when an output is due according to `output_interval_us`.
+ */
+bool bno085_fusion_update_gyroscope(bno085_fusion_t *fusion, int64_t timestamp_us, float x, float y, float z);
+
+/**
+ * @brief Get roll and pitch, with the same convention as the rotation vector reports of the driver.
+ */
+void bno085_fusion_get_roll_pitch(const bno085_fusion_t *fusion, float *roll, float *pitch);
+
+#endif // BNO085_FUSION_H
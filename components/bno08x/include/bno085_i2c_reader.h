@@ -0,0 +1,74 @@
+#ifndef BNO085_I2C_READER_H
+#define BNO085_I2C_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The read strategy is free of ESP-IDF dependencies so it can be tested on the host against a mocked bus.
+
+#ifndef BNO085_I2C_MIN_SPECULATIVE_READ_SIZE
+    #define BNO085_I2C_MIN_SPECULATIVE_READ_SIZE 16  // Smallest single transaction read and the read size until packets are seen, the header and a short report
+#endif  // BNO085_I2C_MIN_SPECULATIVE_READ_SIZE
+
+#ifndef BNO085_I2C_MAX_SPECULATIVE_READ_SIZE
+    #define BNO085_I2C_MAX_SPECULATIVE_READ_SIZE 64  // Largest single transaction read, bigger packets (command responses) are rare and take two
+#endif  // BNO085_I2C_MAX_SPECULATIVE_READ_SIZE
+
+#ifndef BNO085_I2C_SPECULATIVE_WINDOW
+    #define BNO085_I2C_SPECULATIVE_WINDOW 8  // Last packets the read size is chosen after, covers the period of the report mix
+#endif  // BNO085_I2C_SPECULATIVE_WINDOW
+
+#ifndef BNO085_I2C_TRANSACTION_COST_BYTES
+    #define BNO085_I2C_TRANSACTION_COST_BYTES 12  // Cost of a follow-up transaction in bytes of bus time: the repeated header, START, address and STOP, and the driver set up
+#endif  // BNO085_I2C_TRANSACTION_COST_BYTES
+
+
+typedef struct {
+    uint32_t packet_count;               // Number of SHTP packets received
+    uint32_t transaction_count;          // Number of I2C read transactions
+    uint32_t byte_count;                 // Number of bytes clocked over the bus
+    uint32_t wasted_byte_count;          // Bytes read beyond the packet end or repeated continuation headers
+} bno085_i2c_transfer_stats_t;
+
+
+/**
+ * @brief One I2C read transaction of `size` bytes.
+ *
+ * @return int 0 on success, non-zero if the transaction failed.
+ */
+typedef int (*bno085_i2c_receive_t)(void *arg, uint8_t *buffer, size_t size);
+
+
+/**
+ * Reads SHTP packets in one speculative transaction, with a follow-up transaction for the remainder only when the
+ * packet is bigger. Every read transaction starts with the SHTP header, so the packet length is known after the first
+ * one.
+ *
+ * The sensor reports come in a repeating mix (e.g. 3 packets of game rotation vector and gyroscope, then one with the
+ * accelerometer as well), sizing after the last packet alone would read every change of size in two transactions. The
+ * read size is chosen among the sizes of the last packets, as the one that would have cost them the least bus time:
+ * the bytes read past the smaller packets against a follow-up transaction for the bigger ones.
+ */
+typedef struct {
+    uint16_t speculative_read_size;      // Bytes read in the first transaction
+    uint16_t window_sizes[BNO085_I2C_SPECULATIVE_WINDOW];  // Sizes of the last packets, 0 for none yet
+    uint16_t window_idx;
+    bno085_i2c_transfer_stats_t transfer_stats;
+} bno085_i2c_reader_t;
+
+
+void bno085_i2c_reader_init(bno085_i2c_reader_t *reader);
+
+/**
+ * @brief Read one SHTP packet.
+ *
+ * @param reader Reader state.
+ * @param receive Bus transaction.
+ * @param arg Argument passed to `receive`.
+ * @param buffer Buffer to store the packet, including the header.
+ * @param len Size of the buffer.
+ * @return int Packet length, 0 if no packet is pending or it doesn't fit the buffer, -1 if a transaction failed.
+ */
+int bno085_i2c_reader_read(bno085_i2c_reader_t *reader, bno085_i2c_receive_t receive, void *arg, uint8_t *buffer, unsigned len);
+
+#endif // BNO085_I2C_READER_H
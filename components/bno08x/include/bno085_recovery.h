@@ -0,0 +1,154 @@
+#ifndef BNO085_RECOVERY_H
+#define BNO085_RECOVERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifndef BNO085_RECOVERY_RESET_TIMEOUT_MS
+    #define BNO085_RECOVERY_RESET_TIMEOUT_MS 1000  // Time allowed for the sensor to report the reset before escalating
+#endif  // BNO085_RECOVERY_RESET_TIMEOUT_MS
+
+#ifndef BNO085_RECOVERY_SOFT_RESET_ATTEMPTS
+    #define BNO085_RECOVERY_SOFT_RESET_ATTEMPTS 2  // Soft resets tried before the hardware reset
+#endif  // BNO085_RECOVERY_SOFT_RESET_ATTEMPTS
+
+#ifndef BNO085_STALL_TIMEOUT_MS
+    #define BNO085_STALL_TIMEOUT_MS 1000  // Shortest silence with reports enabled treated as a stalled sensor
+#endif  // BNO085_STALL_TIMEOUT_MS
+
+#ifndef BNO085_STALL_INTERVAL_FACTOR
+    #define BNO085_STALL_INTERVAL_FACTOR 4  // Report intervals without any packet before the sensor is considered stalled
+#endif  // BNO085_STALL_INTERVAL_FACTOR
+
+
+typedef enum {
+    BNO085_RECOVERY_IDLE = 0,           // Normal operation
+    BNO085_RECOVERY_REQUESTED,          // A fault is detected, the poller task picks the next reset to try
+    BNO085_RECOVERY_SOFT_RESET,         // Soft reset sent, waiting for the sensor to report the reset
+    BNO085_RECOVERY_HARD_RESET,         // Reset pin toggled, waiting for the sensor to report the reset
+    BNO085_RECOVERY_RECONFIGURE,        // Sensor is back, the report configs are re-sent
+} bno085_recovery_state_t;
+
+
+typedef struct {
+    uint32_t fault_count;                // Number of faults reported (transport errors and stalls)
+    uint32_t stall_count;                // Number of faults detected as the sensor going silent with reports enabled
+    uint32_t unexpected_reset_count;     // Number of resets not requested by the driver
+    uint32_t soft_reset_count;
+    uint32_t hard_reset_count;
+    uint32_t recovery_count;             // Number of completed recoveries
+    int64_t last_recovery_us;            // Time from the fault to the restored configs of the last recovery
+    int64_t max_recovery_us;
+    int64_t total_recovery_us;
+    int64_t soft_reset_us;               // Time from the soft resets to the sensor reporting the reset (or giving up)
+    int64_t hard_reset_us;               // Time from the hardware resets to the sensor reporting the reset (or giving up)
+} bno085_recovery_stats_t;
+
+
+/**
+ * Next step of the recovery for the driver to carry out.
+ */
+typedef enum {
+    BNO085_RECOVERY_ACTION_NONE = 0,    // Nothing to do, wait for the sensor
+    BNO085_RECOVERY_ACTION_SOFT_RESET,  // Send the soft reset, report a failure with bno085_recovery_reset_failed()
+    BNO085_RECOVERY_ACTION_HARD_RESET,  // Pulse the reset pin, report a failure with bno085_recovery_reset_failed()
+    BNO085_RECOVERY_ACTION_NO_RESET,    // No way to reset the sensor, waiting for it to come back
+    BNO085_RECOVERY_ACTION_ESCALATE,    // The sensor did not report the reset in time, the next step tries the next reset
+    BNO085_RECOVERY_ACTION_RECONFIGURE, // Re-send the report configs, then call bno085_recovery_finish()
+} bno085_recovery_action_t;
+
+
+/**
+ * Recovery state machine of the driver, free of ESP-IDF dependencies. Faults (transport errors, stalls) start a
+ * recovery that escalates from soft resets to the hardware reset until the sensor reports a reset, then the report
+ * configs are restored. Time is passed in by the caller. The calls must be serialized by the caller, which also guards
+ * `stats` for its readers.
+ */
+typedef struct {
+    volatile bno085_recovery_state_t state;
+    uint32_t attempt;                   // Resets tried in the current recovery
+    int64_t start_us;                   // Time of the fault
+    int64_t deadline_us;                // Time the sensor has to report the reset by
+    int64_t reset_start_us;             // Time of the last reset
+    int64_t last_activity_us;           // Time of the last packet, the stall timer
+    bno085_recovery_stats_t *stats;
+} bno085_recovery_t;
+
+
+/**
+ * @brief Initialize the state machine, idle.
+ *
+ * @param recovery State machine.
+ * @param stats Statistics updated by the state machine.
+ * @param now_us Current time, starts the stall timer.
+ */
+void bno085_recovery_init(bno085_recovery_t *recovery, bno085_recovery_stats_t *stats, int64_t now_us);
+
+
+/**
+ * @brief Report a fault.
+ *
+ * @return true if a recovery is started, false if one is already in progress.
+ */
+bool bno085_recovery_request(bno085_recovery_t *recovery, int64_t now_us);
+
+
+/**
+ * @brief Restart the stall timer: a packet is received, or no packet is expected.
+ */
+void bno085_recovery_kick(bno085_recovery_t *recovery, int64_t now_us);
+
+
+/**
+ * @brief Start a recovery if nothing is received for `timeout_us` while idle.
+ *
+ * @return true if a stall is detected and a recovery started.
+ */
+bool bno085_recovery_check_stall(bno085_recovery_t *recovery, int64_t now_us, int64_t timeout_us);
+
+
+/**
+ * @brief Stall timeout for the enabled reports: BNO085_STALL_INTERVAL_FACTOR times the shortest period between
+ *  packets, not less than BNO085_STALL_TIMEOUT_MS.
+ *
+ * @param shortest_period_us Shortest report (or batch) interval of the enabled reports.
+ */
+int64_t bno085_recovery_stall_timeout_us(uint32_t shortest_period_us);
+
+
+/**
+ * @brief Advance the recovery, to be called periodically while not idle.
+ *
+ * @param recovery State machine.
+ * @param now_us Current time.
+ * @param soft_reset_available The transport can send a soft reset.
+ * @param hard_reset_available A reset pin is connected.
+ * @return bno085_recovery_action_t Step for the caller to carry out.
+ */
+bno085_recovery_action_t bno085_recovery_step(bno085_recovery_t *recovery, int64_t now_us, bool soft_reset_available, bool hard_reset_available);
+
+
+/**
+ * @brief The reset returned by bno085_recovery_step() could not be sent, the next step tries again.
+ */
+void bno085_recovery_reset_failed(bno085_recovery_t *recovery);
+
+
+/**
+ * @brief The sensor reported a reset, the report configs must be restored.
+ *
+ * @return true if the reset is not part of a recovery (e.g. brown-out, watchdog of the sensor).
+ */
+bool bno085_recovery_on_reset(bno085_recovery_t *recovery, int64_t now_us);
+
+
+/**
+ * @brief The report configs are restored, back to normal operation.
+ *
+ * @return int64_t Duration of the recovery.
+ */
+int64_t bno085_recovery_finish(bno085_recovery_t *recovery, int64_t now_us);
+
+
+#endif  // BNO085_RECOVERY_H
@@ -0,0 +1,75 @@
+#ifndef BNO085_REPORT_DESCRIPTOR_H
+#define BNO085_REPORT_DESCRIPTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sh2.h"
+#include "sh2_SensorValue.h"
+
+// The descriptors are free of ESP-IDF dependencies so every row of the table can be checked on the host.
+
+
+/**
+ * Report descriptor table, one row per supported report:
+ *  X(name, sensor ID, sh2_SensorValue_t union member, value type, wakeup, always on, change sensitivity)
+ *
+ * The set feature flags, `bno085_enable_<name>_report()`, the typed `bno085_read_<name>()` accessors and the
+ * `bno085_get_<name>_value()` they read through are generated from this table. Supporting another report only takes a
+ * new row.
+ */
+#define BNO085_REPORT_DESCRIPTOR_TABLE(X) \
+    X(game_rotation_vector,     SH2_GAME_ROTATION_VECTOR,   gameRotationVector,     sh2_RotationVector_t,       false, false, false) \
+    X(rotation_vector,          SH2_ROTATION_VECTOR,        rotationVector,         sh2_RotationVectorWAcc_t,   false, false, false) \
+    X(accelerometer,            SH2_ACCELEROMETER,          accelerometer,          sh2_Accelerometer_t,        false, false, false) \
+    X(linear_acceleration,      SH2_LINEAR_ACCELERATION,    linearAcceleration,     sh2_Accelerometer_t,        false, true,  false) \
+    X(gravity,                  SH2_GRAVITY,                gravity,                sh2_Accelerometer_t,        false, false, false) \
+    X(gyroscope,                SH2_GYROSCOPE_CALIBRATED,   gyroscope,              sh2_Gyroscope_t,            false, false, false) \
+    X(raw_gyroscope,            SH2_RAW_GYROSCOPE,          rawGyroscope,           sh2_RawGyroscope_t,         false, false, false) \
+    X(tap_detector,             SH2_TAP_DETECTOR,           tapDetector,            sh2_TapDetector_t,          false, false, false) \
+    X(stability_classification, SH2_STABILITY_CLASSIFIER,   stabilityClassifier,    sh2_StabilityClassifier_t,  false, false, false) \
+    X(stability_detector,       SH2_STABILITY_DETECTOR,     stabilityDetector,      sh2_StabilityDetector_t,    true,  true,  true)
+
+
+typedef struct {
+    const char * name;
+    sh2_SensorId_t sensor_id;
+    bool wakeup;                        // Report even while the host sleeps
+    bool always_on;                     // Keep reporting while the sensor hub sleeps
+    bool change_sensitivity;            // Report on change rather than periodically
+} bno085_report_descriptor_t;
+
+
+/**
+ * @brief Get the descriptor of a report.
+ *
+ * @return Pointer to the descriptor, NULL if the report is not in BNO085_REPORT_DESCRIPTOR_TABLE.
+ */
+const bno085_report_descriptor_t * bno085_get_report_descriptor(sh2_SensorId_t sensor_id);
+
+/**
+ * @brief Make the set feature configuration of a report from its descriptor.
+ *
+ * @param descriptor Descriptor of the report.
+ * @param interval_us Report interval, 0 to disable the report.
+ * @param batch_interval_us Batch interval, 0 to report without batching.
+ * @param config Pointer to store the configuration.
+ */
+void bno085_report_descriptor_get_config(const bno085_report_descriptor_t *descriptor, uint32_t interval_us, uint32_t batch_interval_us, sh2_SensorConfig_t *config);
+
+/**
+ * @brief Get the typed value of a decoded sample, e.g. bno085_get_gravity_value().
+ *
+ * @return bool False if the sample is of another report.
+ */
+#define BNO085_REPORT_VALUE_ACCESSOR(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) \
+    static inline bool bno085_get_##name##_value(const sh2_SensorValue_t *sample_value, type *value) { \
+        if (sample_value->sensorId != (sensor_id)) { \
+            return false; \
+        } \
+        *value = sample_value->un.member; \
+        return true; \
+    }
+BNO085_REPORT_DESCRIPTOR_TABLE(BNO085_REPORT_VALUE_ACCESSOR)
+
+#endif // BNO085_REPORT_DESCRIPTOR_H
@@ -0,0 +1,63 @@
+#ifndef BNO085_SAMPLE_RING_H
+#define BNO085_SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sh2.h"
+
+// The ring is free of ESP-IDF dependencies so the producer and consumers can be load tested with threads on the host.
+
+#ifndef BNO085_SAMPLE_RING_DEPTH
+    #define BNO085_SAMPLE_RING_DEPTH 32  // Number of samples retained per sensor report, must be a power of 2
+#endif  // BNO085_SAMPLE_RING_DEPTH
+
+#if (BNO085_SAMPLE_RING_DEPTH & (BNO085_SAMPLE_RING_DEPTH - 1)) != 0
+    #error "BNO085_SAMPLE_RING_DEPTH must be a power of 2"
+#endif
+
+
+typedef struct {
+    uint32_t seq;
+    int64_t timestamp_us;
+    int64_t arrival_us;
+    bool valid;
+    sh2_SensorEvent_t event;    // Raw event as received, only the first `event.len` bytes of the report are stored
+} bno085_sample_slot_t;
+
+
+/**
+ * Single producer (sensor poller task), multiple consumer ring of the raw sensor events. Consumers keep their own cursor
+ * (sequence number of the last consumed sample) and read the ring without locking. Events are decoded on read, so the
+ * poller task doesn't spend time on samples nobody reads.
+ */
+typedef struct {
+    bno085_sample_slot_t slots[BNO085_SAMPLE_RING_DEPTH];
+    uint32_t head;          // Sequence number of the latest published sample
+} bno085_sample_ring_t;
+
+
+/**
+ * @brief Publish a sample, overwriting the oldest one. Must be called from one task only.
+ */
+void bno085_sample_ring_push(bno085_sample_ring_t *ring, const sh2_SensorEvent_t *event, int64_t timestamp_us, int64_t arrival_us, bool valid);
+
+/**
+ * @brief Get the sequence number of the latest published sample, 0 if no sample is published.
+ */
+uint32_t bno085_sample_ring_get_head(const bno085_sample_ring_t *ring);
+
+/**
+ * @brief Copy the samples published after the cursor, oldest first, and advance the cursor.
+ *
+ * @param ring Ring to read.
+ * @param cursor Sequence number of the last consumed sample.
+ * @param slots Buffer to store the copies.
+ * @param max_slots Size of the buffer.
+ * @param lost Incremented by the number of samples overwritten before they could be copied.
+ * @return size_t Number of samples copied, 0 once the cursor reaches the head.
+ */
+size_t bno085_sample_ring_read(const bno085_sample_ring_t *ring, uint32_t *cursor, bno085_sample_slot_t *slots, size_t max_slots, uint32_t *lost);
+
+#endif // BNO085_SAMPLE_RING_H
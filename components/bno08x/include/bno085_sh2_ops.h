@@ -0,0 +1,38 @@
+#ifndef BNO085_SH2_OPS_H
+#define BNO085_SH2_OPS_H
+
+#include "sh2.h"
+
+// The instance tables are free of ESP-IDF dependencies so two sensors can be run on the simulator on the host.
+
+#ifndef BNO085_SH2_SECONDARY_INSTANCE
+    #define BNO085_SH2_SECONDARY_INSTANCE 0  // Set by the build when it links the renamed copy of the SH2 library, see cmake/bno085_sh2_copy.cmake
+#endif  // BNO085_SH2_SECONDARY_INSTANCE
+
+
+/**
+ * SH2 library entry points used by the driver. The vendor library keeps the SHTP and SH2 state in file scope statics,
+ * so one copy of the library backs one sensor, and a second context on the same table is rejected rather than taking
+ * over the state of the first. `bno085_sh2_default_ops` binds the library linked with the component. When the SH2
+ * sources are present the build also links a second copy, its symbols renamed, bound by `bno085_sh2_secondary_ops`:
+ * the second sensor runs on it.
+ */
+typedef struct {
+    int (*open)(sh2_Hal_t *pHal, sh2_EventCallback_t *eventCallback, void *eventCookie);
+    void (*close)(void);
+    void (*service)(void);
+    int (*set_sensor_callback)(sh2_SensorCallback_t *callback, void *cookie);
+    int (*get_prod_ids)(sh2_ProductIds_t *prodIds);
+    int (*set_sensor_config)(sh2_SensorId_t sensorId, const sh2_SensorConfig_t *pConfig);
+    int (*dev_sleep)(void);
+    int (*dev_on)(void);
+} bno085_sh2_ops_t;
+
+
+extern const bno085_sh2_ops_t bno085_sh2_default_ops;
+
+#if BNO085_SH2_SECONDARY_INSTANCE
+extern const bno085_sh2_ops_t bno085_sh2_secondary_ops;
+#endif  // BNO085_SH2_SECONDARY_INSTANCE
+
+#endif // BNO085_SH2_OPS_H
@@ -0,0 +1,48 @@
+#ifndef BNO085_SHTP_LOG_H
+#define BNO085_SHTP_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Compact binary log of raw SHTP packets, shared by the packet recorder (target) and the replay HAL (host).
+ *
+ * File header (8 bytes): "SHTPLOG" followed by the format version.
+ * Record: timestamp in us (uint32, little endian), packet length (uint16, little endian), then the packet bytes
+ *  including the 4 byte SHTP header.
+ */
+
+#define BNO085_SHTP_LOG_MAGIC "SHTPLOG"
+#define BNO085_SHTP_LOG_VERSION 1
+#define BNO085_SHTP_LOG_FILE_HEADER_SIZE 8
+#define BNO085_SHTP_LOG_RECORD_HEADER_SIZE 6
+
+
+static inline void bno085_shtp_log_encode_file_header(uint8_t *out) {
+    memcpy(out, BNO085_SHTP_LOG_MAGIC, 7);
+    out[7] = BNO085_SHTP_LOG_VERSION;
+}
+
+
+static inline bool bno085_shtp_log_check_file_header(const uint8_t *in) {
+    return memcmp(in, BNO085_SHTP_LOG_MAGIC, 7) == 0 && in[7] == BNO085_SHTP_LOG_VERSION;
+}
+
+
+static inline void bno085_shtp_log_encode_record_header(uint8_t *out, uint32_t t_us, uint16_t len) {
+    out[0] = t_us & 0xFF;
+    out[1] = (t_us >> 8) & 0xFF;
+    out[2] = (t_us >> 16) & 0xFF;
+    out[3] = (t_us >> 24) & 0xFF;
+    out[4] = len & 0xFF;
+    out[5] = (len >> 8) & 0xFF;
+}
+
+
+static inline void bno085_shtp_log_decode_record_header(const uint8_t *in, uint32_t *t_us, uint16_t *len) {
+    *t_us = (uint32_t) in[0] | ((uint32_t) in[1] << 8) | ((uint32_t) in[2] << 16) | ((uint32_t) in[3] << 24);
+    *len = (uint16_t) in[4] | ((uint16_t) in[5] << 8);
+}
+
+#endif // BNO085_SHTP_LOG_H
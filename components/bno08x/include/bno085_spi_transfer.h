@@ -0,0 +1,37 @@
+#ifndef BNO085_SPI_TRANSFER_H
+#define BNO085_SPI_TRANSFER_H
+
+#include <stdint.h>
+
+// The transfer accounting is free of ESP-IDF dependencies so the queued and polling transfers can be compared on the
+// host against a fake SPI driver.
+
+
+typedef struct {
+    uint32_t packet_count;               // Number of SHTP packets received
+    uint32_t transaction_count;          // Number of SPI transactions
+    uint32_t byte_count;                 // Number of bytes clocked over the bus
+    uint64_t busy_us;                    // Time the CPU spent issuing and waiting on the transactions (not blocked)
+    uint64_t transfer_us;                // Time the transactions took on the bus
+} bno085_spi_transfer_stats_t;
+
+
+/**
+ * @brief Account a queued (interrupt completed) transaction. The CPU is busy while queuing it and from the completion
+ *  until the result is collected, the task is blocked in between.
+ *
+ * @param stats Counters to update.
+ * @param byte_count Bytes clocked over the bus.
+ * @param start_us Time the transaction is issued.
+ * @param queued_us Time the transaction is queued to the driver.
+ * @param complete_us Time the driver completed the transaction, from the post transaction callback.
+ * @param end_us Time the result is collected.
+ */
+void bno085_spi_transfer_account_queued(bno085_spi_transfer_stats_t *stats, uint32_t byte_count, int64_t start_us, int64_t queued_us, int64_t complete_us, int64_t end_us);
+
+/**
+ * @brief Account a polling transaction, the CPU is busy for the whole transfer.
+ */
+void bno085_spi_transfer_account_polling(bno085_spi_transfer_stats_t *stats, uint32_t byte_count, int64_t start_us, int64_t end_us);
+
+#endif // BNO085_SPI_TRANSFER_H
@@ -0,0 +1,89 @@
+#ifndef BNO085_TIMEBASE_H
+#define BNO085_TIMEBASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifndef BNO085_TIMEBASE_WINDOW_US
+    #define BNO085_TIMEBASE_WINDOW_US 2000000  // Sensor time covered by each skew measurement
+#endif  // BNO085_TIMEBASE_WINDOW_US
+
+#ifndef BNO085_TIMEBASE_MAX_SKEW_PPM
+    #define BNO085_TIMEBASE_MAX_SKEW_PPM 50000  // Measurements beyond this are treated as discontinuities (missed reports, rate change)
+#endif  // BNO085_TIMEBASE_MAX_SKEW_PPM
+
+#ifndef BNO085_TIMEBASE_SKEW_FILTER_GAIN
+    #define BNO085_TIMEBASE_SKEW_FILTER_GAIN 0.125f
+#endif  // BNO085_TIMEBASE_SKEW_FILTER_GAIN
+
+
+/**
+ * Estimates the rate difference between the BNO085 oscillator and the host clock (esp_timer) for a periodic report.
+ * 
+ * The sensor emits a periodic report exactly every report interval as counted by its own oscillator, so the report
+ * sequence number multiplied by the interval gives a pure sensor timeline. Comparing it against the host timestamps
+ * over a long window gives the skew, which is then used to correct the sensor-side offsets (delay and batch age) that
+ * SH2 adds to the host interrupt timestamp.
+ */
+typedef struct {
+    bool window_started;
+    bool skew_valid;
+    uint8_t last_sequence;
+    int64_t sensor_us;          // Accumulated sensor time, in the sensor clock
+    int64_t window_sensor_us;   // Sensor time at the start of the measurement window
+    int64_t window_host_us;     // Host time at the start of the measurement window
+    float skew_ppm;             // Positive when the sensor clock runs slower than the host clock
+} bno085_timebase_t;
+
+
+/**
+ * @brief Reset the estimator, e.g. after a sensor reset or a report interval change.
+ */
+void bno085_timebase_reset(bno085_timebase_t *timebase);
+
+
+/**
+ * @brief Feed a sample of a periodic report to the estimator.
+ *
+ * @param timebase Estimator.
+ * @param sequence SH2 report sequence number (8 bit, increments on every report).
+ * @param interval_us Report interval applied by the sensor.
+ * @param host_us Sample timestamp in the host clock.
+ */
+void bno085_timebase_update(bno085_timebase_t *timebase, uint8_t sequence, uint32_t interval_us, int64_t host_us);
+
+
+/**
+ * @brief Correct the sensor-side offset of a timestamp for the estimated skew.
+ *
+ * @param timebase Estimator.
+ * @param anchor_us Host time of the interrupt the sample was delivered with.
+ * @param timestamp_us Host time of the sample as reported by SH2 (anchor + offset measured by the sensor clock).
+ * @return int64_t Corrected timestamp in the host clock.
+ */
+int64_t bno085_timebase_correct(const bno085_timebase_t *timebase, int64_t anchor_us, int64_t timestamp_us);
+
+
+/**
+ * @brief Reconstruct a 64 bit host timestamp from a timestamp that only shares the lower 32 bits with the host clock.
+ *
+ * @param reference_us 64 bit host time close to the timestamp (within ±35 minutes).
+ * @param timestamp_us Timestamp with valid lower 32 bits.
+ * @return int64_t 64 bit host timestamp.
+ */
+int64_t bno085_timebase_extend(int64_t reference_us, uint64_t timestamp_us);
+
+
+/**
+ * @brief Time elapsed since the sensor took a sample.
+ *
+ * @param now_us Host time.
+ * @param arrival_us Host time the sample was received, 0 if no sample is received yet.
+ * @param timestamp_us Host time the sensor took the sample.
+ * @return int64_t Age of the sample, -1 if no sample is received yet.
+ */
+int64_t bno085_timebase_sample_age_us(int64_t now_us, int64_t arrival_us, int64_t timestamp_us);
+
+
+#endif  // BNO085_TIMEBASE_H
@@ -1,9 +1,11 @@
 #include <math.h>
+#include <stdlib.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_task.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "driver/gpio.h"
 
 #include "bno085.h"
@@ -13,10 +15,21 @@
 
 #define TAG "BNO085"
 
+typedef struct {
+    bno085_packet_recorder_cb_t cb;
+    void *arg;
+} packet_recorder_t;
+
+// Swapped and read as a pair under packet_recorder_lock, the callback never sees the argument of another recorder
+static packet_recorder_t packet_recorder = {NULL, NULL};
+static portMUX_TYPE packet_recorder_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// SH2 instances bound to a context, a library copy can only serve one sensor
+static const bno085_sh2_ops_t *sh2_instances[BNO085_MAX_SH2_INSTANCES];
+static portMUX_TYPE sh2_instance_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // Forward declaration
-float q_to_roll_sf(float dqw, float dqx, float dqy, float dqz);
-float q_to_pitch_sf(float dqw, float dqx, float dqy, float dqz);
-float q_to_yaw_sf(float dqw, float dqx, float dqy, float dqz);
+static esp_err_t enable_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, sh2_SensorConfig_t *config);
 
 static inline esp_err_t create_sensor_event_group(bno085_ctx_t *ctx) {
     // If not created, then create the event group. This function may be called before the `bno085_init()`. 
@@ -32,10 +45,23 @@ static inline esp_err_t create_sensor_event_group(bno085_ctx_t *ctx) {
 
 
 esp_err_t _bno085_wait_for_interrupt(bno085_ctx_t *ctx) {
-    if (xEventGroupWaitBits(ctx->sensor_event_control, SENSOR_INTERRUPT_EVENT_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(500)) == pdTRUE) {
-        return ESP_OK;
+    if (ctx->interrupt_pin == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // The asserted (low) interrupt line is the condition, the event bit only wakes the task. The bit is set late by the
+    // timer task (event bits set from ISR are deferred) and may belong to an interrupt already serviced, so a stale bit
+    // only costs another check of the line.
+    TickType_t timeout_ticks = pdMS_TO_TICKS(BNO085_INTERRUPT_TIMEOUT_MS);
+    TickType_t start_tick = xTaskGetTickCount();
+    while (gpio_get_level(ctx->interrupt_pin) != 0) {
+        TickType_t elapsed_ticks = xTaskGetTickCount() - start_tick;
+        if (elapsed_ticks >= timeout_ticks) {
+            return ESP_ERR_TIMEOUT;
+        }
+        xEventGroupWaitBits(ctx->sensor_event_control, SENSOR_INTERRUPT_EVENT_BIT, pdTRUE, pdTRUE, timeout_ticks - elapsed_ticks);
     }
-    return ESP_ERR_TIMEOUT;
+    return ESP_OK;
 }
 
 uint32_t get_time_us(sh2_Hal_t *self) {
@@ -45,6 +71,16 @@ uint32_t get_time_us(sh2_Hal_t *self) {
 }
 
 
+uint32_t _bno085_get_interrupt_time_us(bno085_ctx_t *ctx) {
+    // SH2 timestamps the reports relative to the interrupt. Without interrupt the read time is the best estimate.
+    if (ctx->interrupt_pin == GPIO_NUM_NC) {
+        return get_time_us((sh2_Hal_t *) ctx);
+    }
+
+    return ctx->last_interrupt_us;
+}
+
+
 void _bno085_disable_interrupt(bno085_ctx_t *ctx) {
     ESP_ERROR_CHECK(create_sensor_event_group(ctx));
 
@@ -69,24 +105,66 @@ static void sh2_sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
     // Cast cookie back to the context
     bno085_ctx_t * ctx = (bno085_ctx_t *) cookie;
 
-    // Decode event into the value
-    sh2_SensorValue_t sensor_value;
-    if (sh2_decodeSensorEvent(&sensor_value, event) == SH2_ERR) {
-        ESP_LOGI(TAG, "sh2_decodeSensorEventd failed");
+    // The report ID is the sensor ID. The event is decoded by the consumers on read.
+    sh2_SensorId_t sensor_id = event->reportId;
+    if (sensor_id >= SH2_MAX_SENSOR_EVENT_LEN || event->len < 2) {
+        ESP_LOGW(TAG, "Malformed sensor event, report ID 0x%02x", sensor_id);
         return;
     }
 
-    // Read sensor type and send it to the corresponding 
-    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_value.sensorId];
-    if (target_report_config->sensor_value_queue == NULL) {
-        ESP_LOGE(TAG, "Sensor value queue is not initialized for sensor ID %d", sensor_value.sensorId);
+    // Nobody subscribes to this sensor
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+    if (target_report_config->sample_ring == NULL) {
         return;
     }
 
-    // Send it to the corresponding queue
-    // ESP_LOGI(TAG, "Event Received %p", sensor_value.sensorId);
+    // Map the sensor timestamp to esp_timer. SH2 only tracks the lower 32 bits of the host clock.
+    int64_t arrival_us = esp_timer_get_time();
+    int64_t anchor_us = bno085_timebase_extend(arrival_us, _bno085_get_interrupt_time_us(ctx));
+    int64_t timestamp_us = bno085_timebase_extend(arrival_us, event->timestamp_uS);
+
+    // Only periodic reports advance at a fixed rate in the sensor clock
+    bool periodic = !target_report_config->config.changeSensitivityEnabled;
+    uint32_t interval_us = target_report_config->actual_report_interval_us ? target_report_config->actual_report_interval_us : target_report_config->config.reportInterval_us;
+    if (periodic) {
+        bno085_timebase_update(&target_report_config->timebase, event->report[1], interval_us, timestamp_us);
+    }
+    timestamp_us = bno085_timebase_correct(&target_report_config->timebase, anchor_us, timestamp_us);
+
+    ctx->reports_in_service += 1;
 
-    xQueueOverwrite(target_report_config->sensor_value_queue, &sensor_value);
+    // Interrupt to decode latency
+    uint32_t latency_bucket = bno085_latency_histogram_bucket(arrival_us - anchor_us);
+
+    // Inter-arrival jitter of the periodic reports
+    int32_t jitter_bucket = -1;
+    if (periodic && interval_us != 0 && target_report_config->last_arrival_us != 0) {
+        int64_t deviation_us = llabs(arrival_us - target_report_config->last_arrival_us - interval_us);
+        jitter_bucket = 0;
+        while (jitter_bucket < BNO085_JITTER_HISTOGRAM_BUCKETS - 1 && deviation_us >= (32ll << jitter_bucket)) {
+            jitter_bucket += 1;
+        }
+    }
+    target_report_config->last_arrival_us = arrival_us;
+
+    portENTER_CRITICAL(&ctx->stats_lock);
+    ctx->stats.service.latency_histogram[latency_bucket] += 1;
+    ctx->stats.sensor[sensor_id].report_count += 1;
+    if (jitter_bucket >= 0) {
+        ctx->stats.sensor[sensor_id].jitter_histogram[jitter_bucket] += 1;
+    }
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
+    // Store the sample once, shared by all subscribers
+    // ESP_LOGI(TAG, "Event Received %p", sensor_id);
+    bno085_sample_ring_push(target_report_config->sample_ring, event, timestamp_us, arrival_us, ctx->recovery.state == BNO085_RECOVERY_IDLE);
+
+    // Wake up subscribers
+    xSemaphoreTake(ctx->subscriber_list_lock, portMAX_DELAY);
+    for (bno085_subscriber_t *subscriber = target_report_config->subscriber_list; subscriber != NULL; subscriber = subscriber->next) {
+        xTaskNotify(subscriber->notify_task, subscriber->notify_bits, eSetBits);
+    }
+    xSemaphoreGive(ctx->subscriber_list_lock);
 }
 
 
@@ -98,28 +176,229 @@ void IRAM_ATTR bno085_interrupt_handler(void *arg) {
 
     // Allow the consumer to unblock
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    if (xEventGroupSetBitsFromISR(ctx->sensor_event_control, SENSOR_INTERRUPT_EVENT_BIT, &xHigherPriorityTaskWoken) != pdFAIL) {
-        // Yield a context switch if needed
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+    // Timestamp the interrupt, SH2 uses it as the time reference of the packet
+    ctx->last_interrupt_us = esp_timer_get_time() & 0xFFFFFFFFul;
+
+    // Wake the poller task directly. The event group is only signalled for transports waiting on the interrupt
+    // inside the HAL, as setting event bits from ISR is deferred to the timer task. Those check the line itself.
+    if (ctx->sensor_poller_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(ctx->sensor_poller_task_handle, &xHigherPriorityTaskWoken);
+    }
+    if (ctx->hal_waits_for_interrupt) {
+        xEventGroupSetBitsFromISR(ctx->sensor_event_control, SENSOR_INTERRUPT_EVENT_BIT, &xHigherPriorityTaskWoken);
+    }
+
+    // Yield a context switch if needed
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+
+static int hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us) {
+    bno085_ctx_t * ctx = (bno085_ctx_t *) self;
+
+    int packet_size = ctx->transport_read(self, pBuffer, len, t_us);
+    if (packet_size > 0) {
+        portENTER_CRITICAL(&ctx->stats_lock);
+        ctx->stats.service.packet_count += 1;
+        bno085_recovery_kick(&ctx->recovery, esp_timer_get_time());
+        portEXIT_CRITICAL(&ctx->stats_lock);
+
+        // Take a local copy as the recorder can be replaced from another task, call it outside of the lock
+        portENTER_CRITICAL(&packet_recorder_lock);
+        packet_recorder_t recorder = packet_recorder;
+        portEXIT_CRITICAL(&packet_recorder_lock);
+        if (recorder.cb) {
+            recorder.cb(recorder.arg, pBuffer, packet_size, *t_us);
+        }
+    }
+
+    return packet_size;
+}
+
+
+void bno085_set_packet_recorder(bno085_packet_recorder_cb_t recorder_cb, void *arg) {
+    // Kept outside the context to capture the traffic of sh2_open(), therefore shared by all the sensors. Record with a
+    // single sensor running to get a replayable capture.
+    portENTER_CRITICAL(&packet_recorder_lock);
+    packet_recorder.cb = recorder_cb;
+    packet_recorder.arg = arg;
+    portEXIT_CRITICAL(&packet_recorder_lock);
+}
+
+void _bno085_request_recovery(bno085_ctx_t *ctx) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    bool started = bno085_recovery_request(&ctx->recovery, esp_timer_get_time());
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
+    // Let the poller run the recovery, the caller may be the HAL inside sh2_service()
+    if (started && ctx->sensor_poller_task_handle != NULL) {
+        xTaskNotifyGive(ctx->sensor_poller_task_handle);
+    }
+}
+
+
+esp_err_t _bno085_hard_reset(bno085_ctx_t *ctx) {
+    if (ctx->reset_pin == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // The sensor reports the reset once it boots, no need to wait here
+    gpio_set_level(ctx->reset_pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(BNO085_HARD_RESET_DELAY_MS));
+    gpio_set_level(ctx->reset_pin, 1);
+
+    return ESP_OK;
+}
+
+
+static void finish_recovery(bno085_ctx_t *ctx) {
+    // Restore the saved configurations
+    for (uint8_t i = 0; i < SH2_MAX_SENSOR_EVENT_LEN; i += 1) {
+        if (ctx->enabled_sensor_report_list[i].config.reportInterval_us != 0) {
+            ESP_LOGI(TAG, "Re-enabling report for sensor ID %d with interval %lu us", i, ctx->enabled_sensor_report_list[i].config.reportInterval_us);
+            if (enable_report(ctx, i, &ctx->enabled_sensor_report_list[i].config) != ESP_OK) {
+                // Try again on the next round
+                ESP_LOGW(TAG, "Failed to re-enable report for sensor ID %d", i);
+                return;
+            }
+            ctx->enabled_sensor_report_list[i].applied_interval_us = ctx->enabled_sensor_report_list[i].config.reportInterval_us;
+        }
+    }
+
+    portENTER_CRITICAL(&ctx->stats_lock);
+    int64_t recovery_us = bno085_recovery_finish(&ctx->recovery, esp_timer_get_time());
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
+    ESP_LOGI(TAG, "BNO085 recovered in %lld us", recovery_us);
+}
+
+
+static void run_recovery(bno085_ctx_t *ctx) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    bno085_recovery_action_t action = bno085_recovery_step(&ctx->recovery, esp_timer_get_time(), ctx->soft_reset != NULL, ctx->reset_pin != GPIO_NUM_NC);
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
+    // The resets are sent outside of the stats lock, under the SH2 lock as they share the transport with the SH2 calls
+    esp_err_t err = ESP_OK;
+    switch (action) {
+        case BNO085_RECOVERY_ACTION_SOFT_RESET:
+            ESP_LOGW(TAG, "Recovery attempt %lu: soft reset", ctx->recovery.attempt);
+            xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+            err = ctx->soft_reset(ctx);
+            xSemaphoreGive(ctx->sh2_lock);
+            break;
+        case BNO085_RECOVERY_ACTION_HARD_RESET:
+            ESP_LOGW(TAG, "Recovery attempt %lu: hard reset", ctx->recovery.attempt);
+            xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+            err = ctx->hard_reset(ctx);
+            xSemaphoreGive(ctx->sh2_lock);
+            break;
+        case BNO085_RECOVERY_ACTION_NO_RESET:
+            ESP_LOGW(TAG, "Recovery attempt %lu: no reset available", ctx->recovery.attempt);
+            break;
+        case BNO085_RECOVERY_ACTION_ESCALATE:
+            ESP_LOGW(TAG, "No reset reported by the sensor, escalating");
+            break;
+        case BNO085_RECOVERY_ACTION_RECONFIGURE:
+            finish_recovery(ctx);
+            break;
+        default:
+            break;
+    }
+
+    if (err != ESP_OK) {
+        portENTER_CRITICAL(&ctx->stats_lock);
+        bno085_recovery_reset_failed(&ctx->recovery);
+        portEXIT_CRITICAL(&ctx->stats_lock);
+    }
+}
+
+
+/**
+ * @brief Start a recovery if the sensor stays silent with reports enabled. A stalled sensor keeps the interrupt line
+ *  high, so no transport error is ever seen. A sleeping sensor and the reports sent on change only are silent by design.
+ */
+static void check_stall(bno085_ctx_t *ctx) {
+    // Shortest time between packets of the enabled reports, batched reports arrive once per batch
+    uint32_t shortest_period_us = UINT32_MAX;
+    for (uint8_t i = 0; i < SH2_MAX_SENSOR_EVENT_LEN && !ctx->sleeping; i += 1) {
+        const sensor_report_config_t *report_config = &ctx->enabled_sensor_report_list[i];
+        if (report_config->applied_interval_us != 0 && !report_config->config.changeSensitivityEnabled) {
+            uint32_t batch_interval_us = report_config->config.batchInterval_us;
+            uint32_t period_us = batch_interval_us > report_config->applied_interval_us ? batch_interval_us : report_config->applied_interval_us;
+            shortest_period_us = period_us < shortest_period_us ? period_us : shortest_period_us;
+        }
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&ctx->stats_lock);
+    bool stalled = false;
+    if (shortest_period_us == UINT32_MAX) {
+        // Nothing expected
+        bno085_recovery_kick(&ctx->recovery, now_us);
+    }
+    else {
+        stalled = bno085_recovery_check_stall(&ctx->recovery, now_us, bno085_recovery_stall_timeout_us(shortest_period_us));
+    }
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
+    if (stalled) {
+        ESP_LOGW(TAG, "No packet received for %lld us with reports enabled, recovering", now_us - ctx->recovery.last_activity_us);
     }
 }
 
+
 void sensor_poller_task(void *self) {
     bno085_ctx_t *ctx = (bno085_ctx_t *) self;
 
     ESP_ERROR_CHECK(create_sensor_event_group(ctx));
 
     while (1) {
-        // Wait until the interrupt happens
-        if (_bno085_wait_for_interrupt(ctx) == ESP_OK) {
-            sh2_service();
+        // Wait until the interrupt happens, recovery needs to be polled for the reset timeout
+        TickType_t wait_ticks = ctx->recovery.state == BNO085_RECOVERY_IDLE ? pdMS_TO_TICKS(BNO085_INTERRUPT_TIMEOUT_MS) : pdMS_TO_TICKS(BNO085_RECOVERY_POLL_PERIOD_MS);
+        if (ulTaskNotifyTake(pdTRUE, wait_ticks) > 0) {
+            ctx->reports_in_service = 0;
+            xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+            ctx->sh2->service();
+            xSemaphoreGive(ctx->sh2_lock);
+
+            // Keep servicing while the interrupt stays asserted (more packets pending, or the sensor flushing a batch)
+            // rather than paying for another interrupt and context switch per packet
+            for (uint32_t packet = 1; packet < BNO085_SERVICE_BUDGET_PACKETS; packet += 1) {
+                if (ctx->interrupt_pin == GPIO_NUM_NC || gpio_get_level(ctx->interrupt_pin) != 0) {
+                    break;
+                }
+                // Released between the packets so a report request from another task is not held for the whole burst
+                xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+                ctx->sh2->service();
+                xSemaphoreGive(ctx->sh2_lock);
+            }
+
+            portENTER_CRITICAL(&ctx->stats_lock);
+            ctx->stats.service.wakeup_count += 1;
+            ctx->stats.service.report_count += ctx->reports_in_service;
+            if (ctx->reports_in_service > ctx->stats.service.max_reports_per_wakeup) {
+                ctx->stats.service.max_reports_per_wakeup = ctx->reports_in_service;
+            }
+            portEXIT_CRITICAL(&ctx->stats_lock);
+        }
+
+        if (ctx->recovery.state == BNO085_RECOVERY_IDLE) {
+            check_stall(ctx);
+        }
+        if (ctx->recovery.state != BNO085_RECOVERY_IDLE) {
+            run_recovery(ctx);
         }
     }
 }
 
 
-esp_err_t sh2_enable_report(sh2_SensorId_t sensor_id, sh2_SensorConfig_t *config) {
-    int status = sh2_setSensorConfig(sensor_id, config);
+static esp_err_t enable_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, sh2_SensorConfig_t *config) {
+    // Called from the report manager in the requesting task and from the recovery in the poller task
+    xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+    int status = ctx->sh2->set_sensor_config(sensor_id, config);
+    xSemaphoreGive(ctx->sh2_lock);
 
     if (status != SH2_OK) {
         return ESP_FAIL;
@@ -135,16 +414,25 @@ static void sh2_event_callback(void *cookie, sh2_AsyncEvent_t *pEvent) {
     // If we see a reset, set a flag so that sensors will be reconfigured.
     switch (pEvent->eventId) {
         case SH2_RESET: {
-            ESP_LOGW(TAG, "BNO085 Reset Unexpectly");
-        
-            // Go over saved configurations
+            // Sensor timeline restarts
             for (uint8_t i = 0; i < SH2_MAX_SENSOR_EVENT_LEN; i += 1) {
-                // Re-enable reports
-                if (ctx->enabled_sensor_report_list[i].config.reportInterval_us != 0) {
-                    ESP_LOGI(TAG, "Re-enabling report for sensor ID %d with interval %d us", i, ctx->enabled_sensor_report_list[i].config.reportInterval_us);
-                    sh2_enable_report(i, &ctx->enabled_sensor_report_list[i].config);
-                }
+                bno085_timebase_reset(&ctx->enabled_sensor_report_list[i].timebase);
+            }
+
+            // The reset at sh2_open() happens before the poller is started, nothing to restore
+            if (ctx->sensor_poller_task_handle == NULL) {
+                break;
             }
+
+            portENTER_CRITICAL(&ctx->stats_lock);
+            bool unexpected = bno085_recovery_on_reset(&ctx->recovery, esp_timer_get_time());
+            portEXIT_CRITICAL(&ctx->stats_lock);
+            if (unexpected) {
+                ESP_LOGW(TAG, "BNO085 Reset Unexpectly");
+            }
+
+            // Re-enable the reports from the poller task, outside the SH2 callback
+            xTaskNotifyGive(ctx->sensor_poller_task_handle);
             break;
         }
         case SH2_SHTP_EVENT: {
@@ -153,6 +441,13 @@ static void sh2_event_callback(void *cookie, sh2_AsyncEvent_t *pEvent) {
         }
         case SH2_GET_FEATURE_RESP: {
             ESP_LOGI(TAG, "EventHandler Sensor Config, %d", pEvent->sh2SensorConfigResp.sensorId);
+
+            // Record the interval actually applied by the sensor, which may differ from the requested one
+            sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[pEvent->sh2SensorConfigResp.sensorId];
+            if (target_report_config->actual_report_interval_us != pEvent->sh2SensorConfigResp.sensorConfig.reportInterval_us) {
+                target_report_config->actual_report_interval_us = pEvent->sh2SensorConfigResp.sensorConfig.reportInterval_us;
+                bno085_timebase_reset(&target_report_config->timebase);
+            }
             break;
         }
         default: {
@@ -177,9 +472,35 @@ esp_err_t _bno085_ctx_init(bno085_ctx_t *ctx, gpio_num_t interrupt_pin, gpio_num
     ctx->boot_pin = boot_pin;
     ctx->ps0_wake_pin = ps0_wake_pin;
 
+    portMUX_INITIALIZE(&ctx->stats_lock);
+    bno085_recovery_init(&ctx->recovery, &ctx->stats.recovery, esp_timer_get_time());
+
     // Create sensor event group if not created before
     ESP_ERROR_CHECK(create_sensor_event_group(ctx));
 
+    // Create lock to protect the subscriber list
+    ctx->subscriber_list_lock = xSemaphoreCreateMutex();
+    if (ctx->subscriber_list_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create subscriber_list_lock");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ctx->hard_reset = _bno085_hard_reset;
+
+    // Create lock to protect the report requests
+    ctx->report_request_lock = xSemaphoreCreateMutex();
+    if (ctx->report_request_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create report_request_lock");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Create lock to serialize the calls into SH2
+    ctx->sh2_lock = xSemaphoreCreateMutex();
+    if (ctx->sh2_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create sh2_lock");
+        return ESP_ERR_NO_MEM;
+    }
+
     // Configure interrupt
     if (ctx->interrupt_pin != GPIO_NUM_NC) {
         gpio_config_t io_conf = {
@@ -249,30 +570,93 @@ esp_err_t _bno085_ctx_init(bno085_ctx_t *ctx, gpio_num_t interrupt_pin, gpio_num
 }
 
 
-esp_err_t _bno085_sh2_init(bno085_ctx_t *ctx) {
+static esp_err_t claim_sh2_instance(bno085_ctx_t *ctx, const bno085_sh2_ops_t *sh2_ops) {
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&sh2_instance_lock);
+    for (int i = 0; i < BNO085_MAX_SH2_INSTANCES; i += 1) {
+        if (sh2_instances[i] == sh2_ops) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+    }
+    if (ret != ESP_ERR_INVALID_STATE) {
+        for (int i = 0; i < BNO085_MAX_SH2_INSTANCES; i += 1) {
+            if (sh2_instances[i] == NULL) {
+                sh2_instances[i] = sh2_ops;
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&sh2_instance_lock);
+
+    if (ret == ESP_OK) {
+        ctx->sh2 = sh2_ops;
+    }
+    return ret;
+}
+
+
+static void release_sh2_instance(bno085_ctx_t *ctx) {
+    portENTER_CRITICAL(&sh2_instance_lock);
+    for (int i = 0; i < BNO085_MAX_SH2_INSTANCES; i += 1) {
+        if (sh2_instances[i] == ctx->sh2) {
+            sh2_instances[i] = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&sh2_instance_lock);
+    ctx->sh2 = NULL;
+}
+
+
+esp_err_t _bno085_sh2_init(bno085_ctx_t *ctx, const bno085_sh2_ops_t *sh2_ops) {
+    // The SH2 callbacks carry the context as cookie, the library instance is the only state shared with another sensor
+    esp_err_t ret = claim_sh2_instance(ctx, sh2_ops != NULL ? sh2_ops : &bno085_sh2_default_ops);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "SH2 instance already used by another sensor");
+        return ret;
+    }
+    else if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No free SH2 instance slot, increase BNO085_MAX_SH2_INSTANCES");
+        return ret;
+    }
+
     ctx->_HAL.getTimeUs = get_time_us;
 
+    // Route the transport read through the driver to count the packets
+    ctx->transport_read = ctx->_HAL.read;
+    ctx->_HAL.read = hal_read;
+
     // Assume other HAL functions are already assigned
     // Open SH2 interface
+    // Held until the poller task is created, it starts servicing right away
+    xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
     int status;
-    status = sh2_open((sh2_Hal_t *) ctx, sh2_event_callback, (void *) ctx);
+    status = ctx->sh2->open((sh2_Hal_t *) ctx, sh2_event_callback, (void *) ctx);
     if (status != SH2_OK) {
         ESP_LOGE(TAG, "Failed to run sh2_open(): %d", status);
+        xSemaphoreGive(ctx->sh2_lock);
+        release_sh2_instance(ctx);
         return ESP_FAIL;
     }
 
+    // From here on a failure closes SH2 and frees the instance slot, so the init can be retried
     sh2_ProductIds_t prodIds;
     memset(&prodIds, 0, sizeof(prodIds));
-    status = sh2_getProdIds(&prodIds);
+    status = ctx->sh2->get_prod_ids(&prodIds);
     if (status != SH2_OK) {
-        return ESP_FAIL;
+        ESP_LOGE(TAG, "Failed to read the product IDs: %d", status);
+        goto close_sh2;
     }
     ESP_LOGI(TAG, "ProdIds Read");
 
 
     // Register sensor callback
-    if (sh2_setSensorCallback(sh2_sensor_callback, (void *) ctx)) {
-        return ESP_FAIL;
+    status = ctx->sh2->set_sensor_callback(sh2_sensor_callback, (void *) ctx);
+    if (status != SH2_OK) {
+        ESP_LOGE(TAG, "Failed to register the sensor callback: %d", status);
+        goto close_sh2;
     }
 
     // Create task to process event
@@ -286,10 +670,34 @@ esp_err_t _bno085_sh2_init(bno085_ctx_t *ctx) {
     );
     if (rtos_return != pdPASS) {
         ESP_LOGE(TAG, "Failed to allocate memory for sensor_poller");
-        return ESP_FAIL;
+        goto close_sh2;
     }
+    xSemaphoreGive(ctx->sh2_lock);
 
     return ESP_OK;
+
+close_sh2:
+    ctx->sh2->close();
+    xSemaphoreGive(ctx->sh2_lock);
+    release_sh2_instance(ctx);
+    return ESP_FAIL;
+}
+
+
+static bno085_sample_ring_t * get_sample_ring(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id) {
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+
+    // Create sample ring if not created already
+    xSemaphoreTake(ctx->subscriber_list_lock, portMAX_DELAY);
+    if (target_report_config->sample_ring == NULL) {
+        target_report_config->sample_ring = heap_caps_calloc(1, sizeof(bno085_sample_ring_t), MALLOC_CAP_DEFAULT);
+        if (target_report_config->sample_ring == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate sample ring for sensor report");
+        }
+    }
+    xSemaphoreGive(ctx->subscriber_list_lock);
+
+    return target_report_config->sample_ring;
 }
 
 
@@ -297,28 +705,34 @@ esp_err_t bno085_configure_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, s
     // look for a slot to save the config
     sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
 
-    // Create queue if not created already
-    if (target_report_config->sensor_value_queue == NULL) {
-        target_report_config->sensor_value_queue = xQueueCreate(BNO085_EVENT_QUEUE_DEPTH, sizeof(sh2_SensorValue_t));
-        if (target_report_config->sensor_value_queue == NULL) {
-            ESP_LOGE(TAG, "Failed to create queue for sensor report");
-            return ESP_FAIL;
-        }
+    if (get_sample_ring(ctx, sensor_id) == NULL) {
+        return ESP_ERR_NO_MEM;
     }
 
     // Copy the configuration to the target report config
     memcpy(&target_report_config->config, config, sizeof(sh2_SensorConfig_t));
 
     // Enable report at the sensor
-    return sh2_enable_report(sensor_id, &target_report_config->config);
+    esp_err_t ret = enable_report(ctx, sensor_id, &target_report_config->config);
+    if (ret == ESP_OK) {
+        target_report_config->applied_interval_us = config->reportInterval_us;
+    }
+
+    return ret;
 }
 
 
 
 esp_err_t bno085_enter_sleep(bno085_ctx_t *ctx) {
-    int ret = sh2_devSleep();
+    // Suspend the stall detection first, the reports stop as soon as the command is sent
+    ctx->sleeping = true;
+
+    xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+    int ret = ctx->sh2->dev_sleep();
+    xSemaphoreGive(ctx->sh2_lock);
     if (ret != SH2_OK) {
         ESP_LOGE(TAG, "Failed to put sensor in sleep mode: %d", ret);
+        ctx->sleeping = false;
         return ESP_FAIL;
     }
     return ESP_OK;
@@ -326,337 +740,382 @@ esp_err_t bno085_enter_sleep(bno085_ctx_t *ctx) {
 
 
 esp_err_t bno085_wake_up(bno085_ctx_t *ctx) {
-    int ret = sh2_devOn();
+    xSemaphoreTake(ctx->sh2_lock, portMAX_DELAY);
+    int ret = ctx->sh2->dev_on();
+    xSemaphoreGive(ctx->sh2_lock);
     if (ret != SH2_OK) {
         ESP_LOGE(TAG, "Failed to wake up the sensor: %d", ret);
         return ESP_FAIL;
     }
+
+    // Resume the stall detection from now, the last packet dates from before the sleep
+    portENTER_CRITICAL(&ctx->stats_lock);
+    bno085_recovery_kick(&ctx->recovery, esp_timer_get_time());
+    ctx->sleeping = false;
+    portEXIT_CRITICAL(&ctx->stats_lock);
+
     return ESP_OK;
 }
 
 
-esp_err_t bno085_enable_game_rotation_vector_report(bno085_ctx_t *ctx, uint32_t interval_ms) {
-    sh2_SensorConfig_t config = {
-        .changeSensitivityEnabled = false,
-        .wakeupEnabled = false,
-        .changeSensitivityRelative = false,
-        .alwaysOnEnabled = false,
-        .changeSensitivity = 0,
-        .batchInterval_us = 0,
-        .sensorSpecific = 0,
-    };
+esp_err_t bno085_enable_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t interval_ms) {
+    const bno085_report_descriptor_t * descriptor = bno085_get_report_descriptor(sensor_id);
+    if (descriptor == NULL) {
+        ESP_LOGE(TAG, "Sensor ID %d is not supported", sensor_id);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
-    config.reportInterval_us = interval_ms * 1000;
+    sh2_SensorConfig_t config;
+    bno085_report_descriptor_get_config(descriptor, interval_ms * 1000, ctx->enabled_sensor_report_list[sensor_id].batch_interval_us, &config);
 
-    return bno085_configure_report(ctx, SH2_GAME_ROTATION_VECTOR, &config);
+    return bno085_configure_report(ctx, sensor_id, &config);
 }
 
 
-esp_err_t bno085_enable_linear_acceleration_report(bno085_ctx_t *ctx, uint32_t interval_ms) {
-    sh2_SensorConfig_t config = {
-        .changeSensitivityEnabled = false,
-        .wakeupEnabled = false,
-        .changeSensitivityRelative = false,
-        .alwaysOnEnabled = true,
-        .changeSensitivity = 0,
-        .batchInterval_us = 0,
-        .sensorSpecific = 0,
-    };
+esp_err_t bno085_set_report_batch_interval(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t batch_interval_ms) {
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+    target_report_config->batch_interval_us = batch_interval_ms * 1000;
 
-    config.reportInterval_us = interval_ms * 1000;
+    // Apply to the running report, otherwise the batch interval is picked up when the report is enabled
+    if (target_report_config->config.reportInterval_us != 0 && 
+        target_report_config->config.batchInterval_us != target_report_config->batch_interval_us) {
+        target_report_config->config.batchInterval_us = target_report_config->batch_interval_us;
+        return enable_report(ctx, sensor_id, &target_report_config->config);
+    }
 
-    return bno085_configure_report(ctx, SH2_LINEAR_ACCELERATION, &config);
+    return ESP_OK;
 }
 
-esp_err_t bno085_enable_stability_classification_report(bno085_ctx_t *ctx, uint32_t interval_ms) {
-    sh2_SensorConfig_t config = {
-        .changeSensitivityEnabled = false,
-        .wakeupEnabled = false,
-        .changeSensitivityRelative = false,
-        .alwaysOnEnabled = false,
-        .changeSensitivity = 0,
-        .batchInterval_us = 0,
-        .sensorSpecific = 0,
-    };
 
-    config.reportInterval_us = interval_ms * 1000;
+bno085_recovery_state_t bno085_get_recovery_state(bno085_ctx_t *ctx) {
+    return ctx->recovery.state;
+}
 
-    return bno085_configure_report(ctx, SH2_STABILITY_CLASSIFIER, &config);
+
+void bno085_get_recovery_stats(bno085_ctx_t *ctx, bno085_recovery_stats_t *stats) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    memcpy(stats, &ctx->stats.recovery, sizeof(bno085_recovery_stats_t));
+    portEXIT_CRITICAL(&ctx->stats_lock);
 }
 
-esp_err_t bno085_enable_rotation_vector_report(bno085_ctx_t *ctx, uint32_t interval_ms) {
-    sh2_SensorConfig_t config = {
-        .changeSensitivityEnabled = false,
-        .wakeupEnabled = false,
-        .changeSensitivityRelative = false,
-        .alwaysOnEnabled = false,
-        .changeSensitivity = 0,
-        .batchInterval_us = 0,
-        .sensorSpecific = 0,
-    };
 
-    config.reportInterval_us = interval_ms * 1000;
+void bno085_get_service_stats(bno085_ctx_t *ctx, bno085_service_stats_t *stats) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    memcpy(stats, &ctx->stats.service, sizeof(bno085_service_stats_t));
+    portEXIT_CRITICAL(&ctx->stats_lock);
+}
+
 
-    return bno085_configure_report(ctx, SH2_ROTATION_VECTOR, &config);
+void bno085_reset_service_stats(bno085_ctx_t *ctx) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    memset(&ctx->stats.service, 0, sizeof(bno085_service_stats_t));
+    portEXIT_CRITICAL(&ctx->stats_lock);
 }
 
 
-esp_err_t bno085_enable_stability_detector_report(bno085_ctx_t *ctx, uint32_t interval_ms) {
-    sh2_SensorConfig_t config = {   
-        .changeSensitivityEnabled = true,
-        .wakeupEnabled = true,
-        .changeSensitivityRelative = false,
-        .alwaysOnEnabled = true,
-        .changeSensitivity = 0,
-        .batchInterval_us = 0,
-        .sensorSpecific = 0,
-    };
+void bno085_get_stats(bno085_ctx_t *ctx, bno085_stats_t *stats) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    memcpy(stats, &ctx->stats, sizeof(bno085_stats_t));
+    portEXIT_CRITICAL(&ctx->stats_lock);
+}
 
-    config.reportInterval_us = interval_ms * 1000;
-    return bno085_configure_report(ctx, SH2_STABILITY_DETECTOR, &config);
+
+void bno085_reset_stats(bno085_ctx_t *ctx) {
+    portENTER_CRITICAL(&ctx->stats_lock);
+    memset(&ctx->stats, 0, sizeof(bno085_stats_t));
+    portEXIT_CRITICAL(&ctx->stats_lock);
 }
 
 
-esp_err_t bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_ctx_t *ctx, float *roll, float *pitch, float *yaw, bool block_wait) {
-    TickType_t wait_ticks;
-    if (block_wait) {
-        wait_ticks = portMAX_DELAY;
-    }
-    else {
-        wait_ticks = 0;
-    }
+void _bno085_record_transport_error(bno085_ctx_t *ctx, int64_t start_us) {
+    int64_t error_us = esp_timer_get_time() - start_us;
 
-    sh2_SensorValue_t sensor_value;
+    portENTER_CRITICAL(&ctx->stats_lock);
+    ctx->stats.transport_error_count += 1;
+    ctx->stats.transport_error_us += error_us;
+    portEXIT_CRITICAL(&ctx->stats_lock);
+}
 
-    // Wait for the queue from the corresponding report
-    if (xQueueReceive(ctx->enabled_sensor_report_list[SH2_GAME_ROTATION_VECTOR].sensor_value_queue, &sensor_value, wait_ticks) != pdPASS) {
-        // ESP_LOGE(TAG, "Failed to receive game rotation vector report");
-        return ESP_FAIL;
+
+uint32_t bno085_latency_histogram_bucket(int64_t latency_us) {
+    uint32_t bucket = 0;
+    while (bucket < BNO085_LATENCY_HISTOGRAM_BUCKETS - 1 && latency_us >= (2ll << bucket)) {
+        bucket += 1;
     }
+    return bucket;
+}
 
-    // Decode sensor event
-    if (sensor_value.sensorId == SH2_GAME_ROTATION_VECTOR) {
-        if (roll) {
-            *roll = q_to_roll_sf(
-                sensor_value.un.gameRotationVector.real,
-                sensor_value.un.gameRotationVector.i,
-                sensor_value.un.gameRotationVector.j,
-                sensor_value.un.gameRotationVector.k
-            );
-        }
 
-        if (pitch) {
-            *pitch = q_to_pitch_sf(
-                sensor_value.un.gameRotationVector.real,
-                sensor_value.un.gameRotationVector.i,
-                sensor_value.un.gameRotationVector.j,
-                sensor_value.un.gameRotationVector.k
-            );
-        }
+uint32_t bno085_get_service_latency_percentile_us(const bno085_service_stats_t *stats, uint32_t percentile) {
+    return bno085_latency_histogram_percentile_us(stats->latency_histogram, percentile);
+}
 
-        if (yaw) {
-            *yaw = q_to_yaw_sf(
-                sensor_value.un.gameRotationVector.real,
-                sensor_value.un.gameRotationVector.i,
-                sensor_value.un.gameRotationVector.j,
-                sensor_value.un.gameRotationVector.k
-            );
-        }
 
-        return ESP_OK;
+uint32_t bno085_latency_histogram_percentile_us(const uint32_t *histogram, uint32_t percentile) {
+    uint64_t total = 0;
+    for (int i = 0; i < BNO085_LATENCY_HISTOGRAM_BUCKETS; i += 1) {
+        total += histogram[i];
+    }
+    if (total == 0) {
+        return 0;
     }
 
-    return ESP_FAIL;
+    // Walk the buckets until the rank is covered
+    uint64_t rank = (total * percentile + 99) / 100;
+    uint64_t count = 0;
+    for (int i = 0; i < BNO085_LATENCY_HISTOGRAM_BUCKETS; i += 1) {
+        count += histogram[i];
+        if (count >= rank && count > 0) {
+            return 2ul << i;
+        }
+    }
+
+    return 2ul << (BNO085_LATENCY_HISTOGRAM_BUCKETS - 1);
 }
 
-esp_err_t bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_ctx_t * ctx, float * roll, float * pitch, float * yaw, float * accuracy, bool block_wait) {
-    TickType_t wait_ticks;
-    if (block_wait) {
-        wait_ticks = portMAX_DELAY;
+
+esp_err_t bno085_wait_for_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, bno085_sample_t *sample, bool block_wait) {
+    // Only the latest sample is of interest, skip the older ones
+    uint32_t head = bno085_get_sample_cursor(ctx, subscriber->sensor_id);
+    if (head - subscriber->cursor > 1) {
+        subscriber->cursor = head - 1;
     }
-    else {
-        wait_ticks = 0;
+
+    if (bno085_subscriber_read(ctx, subscriber, sample, 1, block_wait ? portMAX_DELAY : 0) != 1) {
+        return ESP_FAIL;
     }
 
-    sh2_SensorValue_t sensor_value;
+    // Don't hand out samples taken while the sensor is being recovered
+    if (!sample->valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    // Wait for the queue from the corresponding report
-    if (xQueueReceive(ctx->enabled_sensor_report_list[SH2_ROTATION_VECTOR].sensor_value_queue, &sensor_value, wait_ticks) != pdPASS) {
-        // ESP_LOGE(TAG, "Failed to receive game rotation vector report");
-        return ESP_FAIL;
+    return ESP_OK;
+}
+
+
+esp_err_t bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, float *roll, float *pitch, float *yaw, bool block_wait) {
+    sh2_RotationVector_t value;
+    esp_err_t err = bno085_read_game_rotation_vector(ctx, subscriber, &value, block_wait);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    // Decode sensor envent
-    if (sensor_value.sensorId == SH2_ROTATION_VECTOR) {
-        if (roll) {
-            *roll = q_to_roll_sf(
-                sensor_value.un.rotationVector.real, 
-                sensor_value.un.rotationVector.i, 
-                sensor_value.un.rotationVector.j, 
-                sensor_value.un.rotationVector.k
-            );
-        }
+    quaternion_t q = {
+        .real = value.real,
+        .i = value.i,
+        .j = value.j,
+        .k = value.k,
+    };
+    quaternion_to_euler_f32(&q, roll, pitch, yaw);
 
-        if (pitch) {
-            *pitch = q_to_pitch_sf(
-                sensor_value.un.rotationVector.real, 
-                sensor_value.un.rotationVector.i, 
-                sensor_value.un.rotationVector.j, 
-                sensor_value.un.rotationVector.k
-            );
-        }
+    return ESP_OK;
+}
 
-        if (yaw) {
-            *yaw = q_to_yaw_sf(
-                sensor_value.un.rotationVector.real, 
-                sensor_value.un.rotationVector.i, 
-                sensor_value.un.rotationVector.j, 
-                sensor_value.un.rotationVector.k
-            );
-        }
 
-        if (accuracy) {
-            *accuracy = sensor_value.un.rotationVector.accuracy;
-        }
+esp_err_t bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_ctx_t * ctx, bno085_subscriber_t *subscriber, float * roll, float * pitch, float * yaw, float * accuracy, bool block_wait) {
+    sh2_RotationVectorWAcc_t value;
+    esp_err_t err = bno085_read_rotation_vector(ctx, subscriber, &value, block_wait);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    quaternion_t q = {
+        .real = value.real,
+        .i = value.i,
+        .j = value.j,
+        .k = value.k,
+    };
+    quaternion_to_euler_f32(&q, roll, pitch, yaw);
 
-        return ESP_OK;
+    if (accuracy) {
+        *accuracy = value.accuracy;
     }
 
-    return ESP_FAIL;
+    return ESP_OK;
 }
 
-esp_err_t bno085_wait_for_linear_acceleration_report(bno085_ctx_t *ctx, float *x, float *y, float *z, bool block_wait) {
-    TickType_t wait_ticks;
-    if (block_wait) {
-        wait_ticks = portMAX_DELAY;
-    }
-    else {
-        wait_ticks = 0;
+
+esp_err_t bno085_wait_for_linear_acceleration_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, float *x, float *y, float *z, bool block_wait) {
+    sh2_Accelerometer_t value;
+    esp_err_t err = bno085_read_linear_acceleration(ctx, subscriber, &value, block_wait);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    sh2_SensorValue_t sensor_value;
+    *x = value.x;
+    *y = value.y;
+    *z = value.z;
 
-    // Wait for the queue from the corresponding report
-    if (xQueueReceive(ctx->enabled_sensor_report_list[SH2_LINEAR_ACCELERATION].sensor_value_queue, &sensor_value, wait_ticks) != pdPASS) {
-        // ESP_LOGE(TAG, "Failed to receive linear acceleration report");
-        return ESP_FAIL;
+    return ESP_OK;
+}
+
+
+esp_err_t bno085_wait_for_stability_classification_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, uint8_t * classification, bool block_wait) {
+    sh2_StabilityClassifier_t value;
+    esp_err_t err = bno085_read_stability_classification(ctx, subscriber, &value, block_wait);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    // Decode sensor event
-    if (sensor_value.sensorId == SH2_LINEAR_ACCELERATION) {
-        *x = sensor_value.un.linearAcceleration.x;
-        *y = sensor_value.un.linearAcceleration.y;
-        *z = sensor_value.un.linearAcceleration.z;
+    *classification = value.classification;
+    return ESP_OK;
+}
+
 
-        return ESP_OK;
+esp_err_t bno085_wait_for_stability_detector_report(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, uint16_t *stability, bool block_wait) {
+    sh2_StabilityDetector_t value;
+    esp_err_t err = bno085_read_stability_detector(ctx, subscriber, &value, block_wait);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    return ESP_FAIL;
+    *stability = value.stability;
+    return ESP_OK;
 }
 
 
-esp_err_t bno085_wait_for_stability_classification_report(bno085_ctx_t *ctx, uint8_t * classification, bool block_wait) {
-    TickType_t wait_ticks;
-    if (block_wait) {
-        wait_ticks = portMAX_DELAY;
+uint32_t bno085_get_sample_cursor(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id) {
+    bno085_sample_ring_t *ring = ctx->enabled_sensor_report_list[sensor_id].sample_ring;
+    if (ring == NULL) {
+        return 0;
     }
-    else {
-        wait_ticks = 0;
+
+    return bno085_sample_ring_get_head(ring);
+}
+
+
+size_t bno085_read_samples(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t *cursor, bno085_sample_t *samples, size_t max_samples, uint32_t *dropped) {
+    bno085_sample_ring_t *ring = ctx->enabled_sensor_report_list[sensor_id].sample_ring;
+    if (ring == NULL) {
+        return 0;
     }
 
-    sh2_SensorValue_t sensor_value;
+    uint32_t lost = 0;
+    size_t count = 0;
+    uint32_t decode_failures = 0;
+    bno085_sample_slot_t slot;
+    while (count < max_samples && bno085_sample_ring_read(ring, cursor, &slot, 1, &lost) == 1) {
+        bno085_sample_t *sample = &samples[count];
+
+        // Decode the private copy, once per sample read
+        if (sh2_decodeSensorEvent(&sample->value, &slot.event) == SH2_ERR) {
+            decode_failures += 1;
+            continue;
+        }
 
-    // Wait for the queue from the corresponding report
-    if (xQueueReceive(ctx->enabled_sensor_report_list[SH2_STABILITY_CLASSIFIER].sensor_value_queue, &sensor_value, wait_ticks) != pdPASS) {
-        // ESP_LOGE(TAG, "Failed to receive stability classification report");
-        return ESP_FAIL;
+        sample->seq = slot.seq;
+        sample->timestamp_us = slot.timestamp_us;
+        sample->arrival_us = slot.arrival_us;
+        sample->valid = slot.valid;
+        count += 1;
     }
 
-    // Decode sensor event
-    if (sensor_value.sensorId == SH2_STABILITY_CLASSIFIER) {
-        *classification = sensor_value.un.stabilityClassifier.classification;
-        return ESP_OK;
+    if (dropped) {
+        *dropped += lost;
     }
 
-    return ESP_FAIL;
+    if (lost > 0 || decode_failures > 0) {
+        portENTER_CRITICAL(&ctx->stats_lock);
+        ctx->stats.sensor[sensor_id].dropped_count += lost;
+        ctx->stats.sensor[sensor_id].decode_failure_count += decode_failures;
+        portEXIT_CRITICAL(&ctx->stats_lock);
+    }
+
+    return count;
 }
 
 
-esp_err_t bno085_wait_for_stability_detector_report(bno085_ctx_t *ctx, uint16_t *stability, bool block_wait) {
-    TickType_t wait_ticks;
-    if (block_wait) {
-        wait_ticks = portMAX_DELAY;
+esp_err_t bno085_subscribe(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, sh2_SensorId_t sensor_id, TaskHandle_t notify_task, uint32_t notify_bits) {
+    if (subscriber == NULL || sensor_id >= SH2_MAX_SENSOR_EVENT_LEN) {
+        return ESP_ERR_INVALID_ARG;
     }
-    else {
-        wait_ticks = 0;
+
+    if (get_sample_ring(ctx, sensor_id) == NULL) {
+        return ESP_ERR_NO_MEM;
     }
 
-    sh2_SensorValue_t sensor_value;
+    subscriber->sensor_id = sensor_id;
+    subscriber->cursor = bno085_get_sample_cursor(ctx, sensor_id);
+    subscriber->dropped = 0;
+    subscriber->notify_task = notify_task ? notify_task : xTaskGetCurrentTaskHandle();
+    subscriber->notify_bits = notify_bits;
+    subscriber->last_timestamp_us = 0;
+    subscriber->last_arrival_us = 0;
 
-    // Wait for the queue from the corresponding report
-    if (xQueueReceive(ctx->enabled_sensor_report_list[SH2_STABILITY_DETECTOR].sensor_value_queue, &sensor_value, wait_ticks) != pdPASS) {
-        // ESP_LOGE(TAG, "Failed to receive stability detector report");
-        return ESP_FAIL;
-    }
+    // Add to the head of the list
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+    xSemaphoreTake(ctx->subscriber_list_lock, portMAX_DELAY);
+    subscriber->next = target_report_config->subscriber_list;
+    target_report_config->subscriber_list = subscriber;
+    xSemaphoreGive(ctx->subscriber_list_lock);
+
+    return ESP_OK;
+}
+
+
+esp_err_t bno085_unsubscribe(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber) {
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[subscriber->sensor_id];
 
-    // Decode sensor event
-    if (sensor_value.sensorId == SH2_STABILITY_DETECTOR) {
-        *stability = sensor_value.un.stabilityDetector.stability;
-        return ESP_OK;
+    xSemaphoreTake(ctx->subscriber_list_lock, portMAX_DELAY);
+    for (bno085_subscriber_t **node = &target_report_config->subscriber_list; *node != NULL; node = &(*node)->next) {
+        if (*node == subscriber) {
+            *node = subscriber->next;
+            subscriber->next = NULL;
+            ret = ESP_OK;
+            break;
+        }
     }
+    xSemaphoreGive(ctx->subscriber_list_lock);
 
-    return ESP_FAIL;
+    return ret;
 }
 
 
-float q_to_roll_sf(float dqw, float dqx, float dqy, float dqz) {
-    float norm = sqrt(dqw*dqw + dqx*dqx + dqy*dqy + dqz*dqz);
-	dqw = dqw/norm;
-	dqx = dqx/norm;
-	dqy = dqy/norm;
-	dqz = dqz/norm;
+void bno085_subscriber_flush(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber) {
+    subscriber->cursor = bno085_get_sample_cursor(ctx, subscriber->sensor_id);
+}
 
-	float ysqr = dqy * dqy;
 
-	// roll (x-axis rotation)
-	float t0 = +2.0 * (dqw * dqx + dqy * dqz);
-	float t1 = +1.0 - 2.0 * (dqx * dqx + ysqr);
-	float roll = atan2(t0, t1);
+size_t bno085_subscriber_read(bno085_ctx_t *ctx, bno085_subscriber_t *subscriber, bno085_sample_t *samples, size_t max_samples, TickType_t wait_ticks) {
+    size_t count = bno085_read_samples(ctx, subscriber->sensor_id, &subscriber->cursor, samples, max_samples, &subscriber->dropped);
 
-	return (roll);
-}
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+    while (count == 0 && wait_ticks > 0) {
+        // Only clear the bits owned by this subscriber, leaving other subscribers of the same task untouched
+        if (xTaskNotifyWait(0, subscriber->notify_bits, NULL, wait_ticks) != pdTRUE) {
+            break;
+        }
+        count = bno085_read_samples(ctx, subscriber->sensor_id, &subscriber->cursor, samples, max_samples, &subscriber->dropped);
 
+        // Woken up by the bits of another subscriber of the task, only wait for the rest of the timeout
+        if (count == 0 && xTaskCheckForTimeOut(&timeout, &wait_ticks) == pdTRUE) {
+            break;
+        }
+    }
 
-float q_to_pitch_sf(float dqw, float dqx, float dqy, float dqz) {
-	float norm = sqrt(dqw*dqw + dqx*dqx + dqy*dqy + dqz*dqz);
-	dqw = dqw/norm;
-	dqx = dqx/norm;
-	dqy = dqy/norm;
-	dqz = dqz/norm;
+    if (count > 0) {
+        subscriber->last_timestamp_us = samples[count - 1].timestamp_us;
+        subscriber->last_arrival_us = samples[count - 1].arrival_us;
+    }
 
-	//float ysqr = dqy * dqy;
+    return count;
+}
 
-	// pitch (y-axis rotation)
-	float t2 = +2.0 * (dqw * dqy - dqz * dqx);
-	t2 = t2 > 1.0 ? 1.0 : t2;
-	t2 = t2 < -1.0 ? -1.0 : t2;
-	float pitch = asin(t2);
 
-	return (pitch);
+int64_t bno085_subscriber_get_sample_age_us(bno085_subscriber_t *subscriber) {
+    return bno085_timebase_sample_age_us(esp_timer_get_time(), subscriber->last_arrival_us, subscriber->last_timestamp_us);
 }
-float q_to_yaw_sf(float dqw, float dqx, float dqy, float dqz) {
-    float norm = sqrt(dqw*dqw + dqx*dqx + dqy*dqy + dqz*dqz);
-	dqw = dqw/norm;
-	dqx = dqx/norm;
-	dqy = dqy/norm;
-	dqz = dqz/norm;
 
-	float ysqr = dqy * dqy;
 
-	// yaw (z-axis rotation)
-	float t3 = +2.0 * (dqw * dqz + dqx * dqy);
-	float t4 = +1.0 - 2.0 * (ysqr + dqz * dqz);
-	float yaw = atan2(t3, t4);
+esp_err_t bno085_get_timebase_skew_ppm(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, float *skew_ppm) {
+    bno085_timebase_t * timebase = &ctx->enabled_sensor_report_list[sensor_id].timebase;
+    if (!timebase->skew_valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-	return (yaw);
-}
\ No newline at end of file
+    *skew_ppm = timebase->skew_ppm;
+    return ESP_OK;
+}
@@ -0,0 +1,38 @@
+#include <math.h>
+
+#include "bno085_euler.h"
+
+
+void quaternion_to_euler_f32(const quaternion_t *q, float *roll, float *pitch, float *yaw) {
+    // Normalize once, stay in single precision as the FPU only supports float
+    float norm_sqr = q->real * q->real + q->i * q->i + q->j * q->j + q->k * q->k;
+    float inv_norm = 1.0f / sqrtf(norm_sqr);
+    float w = q->real * inv_norm;
+    float x = q->i * inv_norm;
+    float y = q->j * inv_norm;
+    float z = q->k * inv_norm;
+
+    float ysqr = y * y;
+
+    // roll (x-axis rotation)
+    if (roll) {
+        float t0 = 2.0f * (w * x + y * z);
+        float t1 = 1.0f - 2.0f * (x * x + ysqr);
+        *roll = atan2f(t0, t1);
+    }
+
+    // pitch (y-axis rotation)
+    if (pitch) {
+        float t2 = 2.0f * (w * y - z * x);
+        t2 = t2 > 1.0f ? 1.0f : t2;
+        t2 = t2 < -1.0f ? -1.0f : t2;
+        *pitch = asinf(t2);
+    }
+
+    // yaw (z-axis rotation)
+    if (yaw) {
+        float t3 = 2.0f * (w * z + x * y);
+        float t4 = 1.0f - 2.0f * (ysqr + z * z);
+        *yaw = atan2f(t3, t4);
+    }
+}
@@ -0,0 +1,283 @@
+#include <math.h>
+#include <string.h>
+
+#include "bno085_fusion.h"
+
+
+#if BNO085_FUSION_FIXED_POINT
+
+#define Q 28
+#define ONE ((int32_t) 1 << Q)
+
+
+static inline int32_t to_fixed(float value, int shift) {
+    return (int32_t) (value * (float) ((int32_t) 1 << shift));
+}
+
+
+static inline float to_float(int32_t value) {
+    return (float) value / (float) ONE;
+}
+
+
+static inline int64_t mul(int64_t a, int64_t b) {
+    return (a * b) >> Q;
+}
+
+
+static uint32_t isqrt64(uint64_t value) {
+    // Digit by digit square root, no division or floating point
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t) result;
+}
+
+
+static void set_quaternion(bno085_fusion_t *fusion, float w, float x, float y, float z) {
+    fusion->q[0] = to_fixed(w, Q);
+    fusion->q[1] = to_fixed(x, Q);
+    fusion->q[2] = to_fixed(y, Q);
+    fusion->q[3] = to_fixed(z, Q);
+}
+
+
+static void get_quaternion(const bno085_fusion_t *fusion, float *q) {
+    for (int i = 0; i < 4; i += 1) {
+        q[i] = to_float(fusion->q[i]);
+    }
+}
+
+
+static bool set_accelerometer(bno085_fusion_t *fusion, float x, float y, float z) {
+    // Q16 keeps the squares within 64 bits
+    int64_t a[3] = {to_fixed(x, 16), to_fixed(y, 16), to_fixed(z, 16)};
+    uint32_t norm = isqrt64(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    if (norm == 0) {
+        return false;
+    }
+
+    for (int i = 0; i < 3; i += 1) {
+        fusion->a[i] = (int32_t) ((a[i] << Q) / norm);
+    }
+    return true;
+}
+
+
+static void step(bno085_fusion_t *fusion, float gx, float gy, float gz, uint32_t dt_us) {
+    int64_t q0 = fusion->q[0], q1 = fusion->q[1], q2 = fusion->q[2], q3 = fusion->q[3];
+
+    // Rotation over the step, rate in Q20 times the step in us
+    int64_t tx = ((int64_t) to_fixed(gx, 20) * dt_us << (Q - 20)) / 1000000;
+    int64_t ty = ((int64_t) to_fixed(gy, 20) * dt_us << (Q - 20)) / 1000000;
+    int64_t tz = ((int64_t) to_fixed(gz, 20) * dt_us << (Q - 20)) / 1000000;
+
+    // Gyroscope integration, half the quaternion product q * (0, t)
+    int64_t d0 = (-mul(q1, tx) - mul(q2, ty) - mul(q3, tz)) >> 1;
+    int64_t d1 = ( mul(q0, tx) + mul(q2, tz) - mul(q3, ty)) >> 1;
+    int64_t d2 = ( mul(q0, ty) - mul(q1, tz) + mul(q3, tx)) >> 1;
+    int64_t d3 = ( mul(q0, tz) + mul(q1, ty) - mul(q2, tx)) >> 1;
+
+    if (fusion->accel_valid) {
+        int64_t ax = fusion->a[0], ay = fusion->a[1], az = fusion->a[2];
+        int64_t q0q0 = mul(q0, q0), q1q1 = mul(q1, q1), q2q2 = mul(q2, q2), q3q3 = mul(q3, q3);
+
+        // Gradient of the gravity objective, scaled by 1/4 to stay in range, only the direction is used
+        int64_t s0 = mul(q0, q2q2) + mul(q2, ax) / 2 + mul(q0, q1q1) - mul(q1, ay) / 2;
+        int64_t s1 = mul(q1, q3q3) - mul(q3, ax) / 2 + mul(q0q0, q1) - mul(q0, ay) / 2 - q1 + 2 * mul(q1, q1q1) + 2 * mul(q1, q2q2) + mul(q1, az);
+        int64_t s2 = mul(q0q0, q2) + mul(q0, ax) / 2 + mul(q2, q3q3) - mul(q3, ay) / 2 - q2 + 2 * mul(q2, q1q1) + 2 * mul(q2, q2q2) + mul(q2, az);
+        int64_t s3 = mul(q1q1, q3) - mul(q1, ax) / 2 + mul(q2q2, q3) - mul(q2, ay) / 2;
+
+        // Normalize in Q26 so the sum of the squares fits
+        s0 >>= 2; s1 >>= 2; s2 >>= 2; s3 >>= 2;
+        uint32_t norm = isqrt64((uint64_t) (s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3));
+        if (norm != 0) {
+            int64_t beta_dt = (int64_t) to_fixed(fusion->config.beta, Q) * dt_us / 1000000;
+            d0 -= mul(beta_dt, (s0 << Q) / norm);
+            d1 -= mul(beta_dt, (s1 << Q) / norm);
+            d2 -= mul(beta_dt, (s2 << Q) / norm);
+            d3 -= mul(beta_dt, (s3 << Q) / norm);
+        }
+    }
+
+    q0 += d0;
+    q1 += d1;
+    q2 += d2;
+    q3 += d3;
+
+    uint32_t norm = isqrt64((uint64_t) (q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3));
+    if (norm == 0) {
+        return;
+    }
+    fusion->q[0] = (int32_t) ((q0 << Q) / norm);
+    fusion->q[1] = (int32_t) ((q1 << Q) / norm);
+    fusion->q[2] = (int32_t) ((q2 << Q) / norm);
+    fusion->q[3] = (int32_t) ((q3 << Q) / norm);
+}
+
+#else
+
+static void set_quaternion(bno085_fusion_t *fusion, float w, float x, float y, float z) {
+    fusion->q[0] = w;
+    fusion->q[1] = x;
+    fusion->q[2] = y;
+    fusion->q[3] = z;
+}
+
+
+static void get_quaternion(const bno085_fusion_t *fusion, float *q) {
+    memcpy(q, fusion->q, 4 * sizeof(float));
+}
+
+
+static bool set_accelerometer(bno085_fusion_t *fusion, float x, float y, float z) {
+    float norm_sqr = x * x + y * y + z * z;
+    if (norm_sqr == 0.0f) {
+        return false;
+    }
+
+    float inv_norm = 1.0f / sqrtf(norm_sqr);
+    fusion->a[0] = x * inv_norm;
+    fusion->a[1] = y * inv_norm;
+    fusion->a[2] = z * inv_norm;
+    return true;
+}
+
+
+static void step(bno085_fusion_t *fusion, float gx, float gy, float gz, uint32_t dt_us) {
+    float q0 = fusion->q[0], q1 = fusion->q[1], q2 = fusion->q[2], q3 = fusion->q[3];
+    float dt = dt_us * 1e-6f;
+
+    // Gyroscope integration, half the quaternion product q * (0, g)
+    float d0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float d1 = 0.5f * ( q0 * gx + q2 * gz - q3 * gy);
+    float d2 = 0.5f * ( q0 * gy - q1 * gz + q3 * gx);
+    float d3 = 0.5f * ( q0 * gz + q1 * gy - q2 * gx);
+
+    if (fusion->accel_valid) {
+        float ax = fusion->a[0], ay = fusion->a[1], az = fusion->a[2];
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        // Gradient of the gravity objective, scaled by 1/4 as only the direction is used
+        float s0 = q0 * q2q2 + 0.5f * q2 * ax + q0 * q1q1 - 0.5f * q1 * ay;
+        float s1 = q1 * q3q3 - 0.5f * q3 * ax + q0q0 * q1 - 0.5f * q0 * ay - q1 + 2.0f * q1 * q1q1 + 2.0f * q1 * q2q2 + q1 * az;
+        float s2 = q0q0 * q2 + 0.5f * q0 * ax + q2 * q3q3 - 0.5f * q3 * ay - q2 + 2.0f * q2 * q1q1 + 2.0f * q2 * q2q2 + q2 * az;
+        float s3 = q1q1 * q3 - 0.5f * q1 * ax + q2q2 * q3 - 0.5f * q2 * ay;
+
+        float norm_sqr = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (norm_sqr > 0.0f) {
+            float gain = fusion->config.beta / sqrtf(norm_sqr);
+            d0 -= gain * s0;
+            d1 -= gain * s1;
+            d2 -= gain * s2;
+            d3 -= gain * s3;
+        }
+    }
+
+    q0 += d0 * dt;
+    q1 += d1 * dt;
+    q2 += d2 * dt;
+    q3 += d3 * dt;
+
+    float inv_norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    fusion->q[0] = q0 * inv_norm;
+    fusion->q[1] = q1 * inv_norm;
+    fusion->q[2] = q2 * inv_norm;
+    fusion->q[3] = q3 * inv_norm;
+}
+
+#endif  // BNO085_FUSION_FIXED_POINT
+
+
+void bno085_fusion_init(bno085_fusion_t *fusion, const bno085_fusion_config_t *config) {
+    memset(fusion, 0, sizeof(bno085_fusion_t));
+    memcpy(&fusion->config, config, sizeof(bno085_fusion_config_t));
+    bno085_fusion_reset(fusion);
+}
+
+
+void bno085_fusion_reset(bno085_fusion_t *fusion) {
+    set_quaternion(fusion, 1.0f, 0.0f, 0.0f, 0.0f);
+    fusion->accel_valid = false;
+    fusion->aligned = false;
+    fusion->last_gyro_us = 0;
+    fusion->next_output_us = 0;
+}
+
+
+void bno085_fusion_update_accelerometer(bno085_fusion_t *fusion, int64_t timestamp_us, float x, float y, float z) {
+    // Free fall carries no gravity reference
+    fusion->accel_valid = set_accelerometer(fusion, x, y, z);
+    if (!fusion->accel_valid || fusion->aligned) {
+        return;
+    }
+
+    // Start from the orientation given by gravity rather than converging from level
+    float half_roll = 0.5f * atan2f(y, z);
+    float half_pitch = 0.5f * atan2f(-x, sqrtf(y * y + z * z));
+    float cr = cosf(half_roll), sr = sinf(half_roll);
+    float cp = cosf(half_pitch), sp = sinf(half_pitch);
+    set_quaternion(fusion, cr * cp, sr * cp, cr * sp, -sr * sp);
+    fusion->aligned = true;
+}
+
+
+bool bno085_fusion_update_gyroscope(bno085_fusion_t *fusion, int64_t timestamp_us, float x, float y, float z) {
+    int64_t dt_us = timestamp_us - fusion->last_gyro_us;
+    bool restart = fusion->last_gyro_us == 0 || dt_us <= 0 || dt_us > BNO085_FUSION_MAX_GYRO_GAP_US;
+    fusion->last_gyro_us = timestamp_us;
+
+    if (restart) {
+        fusion->next_output_us = timestamp_us;
+        return false;
+    }
+
+    step(fusion, x, y, z, (uint32_t) dt_us);
+    fusion->update_count += 1;
+
+    if (timestamp_us < fusion->next_output_us) {
+        return false;
+    }
+
+    // Keep the output cadence, but don't try to catch up after a stall
+    fusion->next_output_us += fusion->config.output_interval_us;
+    if (fusion->next_output_us <= timestamp_us) {
+        fusion->next_output_us = timestamp_us + fusion->config.output_interval_us;
+    }
+    fusion->output_count += 1;
+
+    return true;
+}
+
+
+void bno085_fusion_get_roll_pitch(const bno085_fusion_t *fusion, float *roll, float *pitch) {
+    float q[4];
+    get_quaternion(fusion, q);
+    float w = q[0], x = q[1], y = q[2], z = q[3];
+
+    if (roll) {
+        *roll = atan2f(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+    }
+
+    if (pitch) {
+        float t = 2.0f * (w * y - z * x);
+        t = t > 1.0f ? 1.0f : t;
+        t = t < -1.0f ? -1.0f : t;
+        *pitch = asinf(t);
+    }
+}
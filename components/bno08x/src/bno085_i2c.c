@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -7,6 +9,7 @@
 
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 
 #include "sh2_err.h"
 
@@ -22,13 +25,18 @@ int bno085_hal_i2c_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_
 int bno085_hal_i2c_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len);
 
 
-int i2c_soft_reset(bno085_i2c_ctx_t *ctx) {
-    ESP_LOGI(TAG, "Sending soft reset to BNO085");
+static esp_err_t i2c_send_soft_reset(bno085_ctx_t *ctx) {
     // Send softreset packet
     uint8_t softreset_pkt[] = {5, 0, 1, 0, 1};
+    return i2c_master_transmit(((bno085_i2c_ctx_t *) ctx)->dev_handle, softreset_pkt, sizeof(softreset_pkt), BNO085_I2C_WRITE_TIMEOUT_MS);
+}
+
+
+int i2c_soft_reset(bno085_i2c_ctx_t *ctx) {
+    ESP_LOGI(TAG, "Sending soft reset to BNO085");
     int attempts = 5;
     for (; attempts >= 0; attempts -= 1) {
-        if (i2c_master_transmit(ctx->dev_handle, softreset_pkt, sizeof(softreset_pkt), BNO085_I2C_WRITE_TIMEOUT_MS) == ESP_OK) {
+        if (i2c_send_soft_reset(&ctx->parent) == ESP_OK) {
             break;
         }
         ESP_LOGI(TAG, "Failed to send soft reset, will retry %d", attempts);
@@ -72,44 +80,36 @@ void bno085_hal_i2c_close(sh2_Hal_t *self) {
 }
 
 
+static int i2c_receive(void *arg, uint8_t *buffer, size_t size) {
+    bno085_i2c_ctx_t * ctx = (bno085_i2c_ctx_t *) arg;
+
+    ctx->receive_start_us = esp_timer_get_time();
+    esp_err_t err = i2c_master_receive(ctx->dev_handle, buffer, size, BNO085_I2C_WRITE_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read packet: %s", esp_err_to_name(err));
+        return -1;
+    }
+    return 0;
+}
+
+
 int bno085_hal_i2c_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us) {
     // ESP_LOGI(TAG, "i2c_read() called with len: %d", len);
-    esp_err_t err;
 
     // Cast self back to the context object
     bno085_i2c_ctx_t * ctx = (bno085_i2c_ctx_t *) self;
 
-    // Read header (4 bytes)
-    uint8_t headers[4];
-    err = i2c_master_receive(ctx->dev_handle, headers, 4, BNO085_I2C_WRITE_TIMEOUT_MS);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read headers: %s", esp_err_to_name(err));
-        
-        // Send a soft reset
-        i2c_soft_reset(ctx);
-        return 0;
-    }
+    // Reports are timestamped relative to the interrupt
+    *t_us = _bno085_get_interrupt_time_us(&ctx->parent);
 
-    uint16_t packet_size = ((uint16_t)headers[0] + ((uint16_t)headers[1] << 8)) & ~0x8000;
+    int packet_size = bno085_i2c_reader_read(&ctx->reader, i2c_receive, ctx, pBuffer, len);
+    if (packet_size < 0) {
+        _bno085_record_transport_error(&ctx->parent, ctx->receive_start_us);
 
-    // Check the buffer size
-    if (len < packet_size) {
+        // Reset from the poller task rather than stalling the read
+        _bno085_request_recovery(&ctx->parent);
         return 0;
     }
-    else if (packet_size > 0) {
-        // Read remaining packet
-        err = i2c_master_receive(ctx->dev_handle, pBuffer, packet_size, BNO085_I2C_WRITE_TIMEOUT_MS);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to read packet: %s", esp_err_to_name(err));
-        
-            // Send a soft reset
-            i2c_soft_reset(ctx); 
-            return 0;
-        }
-    }
-    else {
-        // ESP_LOGW(TAG, "No data");
-    }
 
     return packet_size;
 }
@@ -123,9 +123,11 @@ int bno085_hal_i2c_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
     // Cast self back to the context object
     bno085_i2c_ctx_t * ctx = (bno085_i2c_ctx_t *) self;
 
+    int64_t start_us = esp_timer_get_time();
     err = i2c_master_transmit(ctx->dev_handle, pBuffer, len, BNO085_I2C_WRITE_TIMEOUT_MS);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to write data: %s", esp_err_to_name(err));
+        _bno085_record_transport_error(&ctx->parent, start_us);
         return 0;
     }
 
@@ -138,7 +140,7 @@ int bno085_hal_i2c_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
     return len;
 }
 
-esp_err_t bno085_init_i2c(bno085_i2c_ctx_t *ctx, i2c_master_bus_handle_t i2c_bus_handle, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin) {
+esp_err_t bno085_init_i2c(bno085_i2c_ctx_t *ctx, i2c_master_bus_handle_t i2c_bus_handle, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, const bno085_sh2_ops_t *sh2_ops) {
     // Initialize configuration
     ESP_RETURN_ON_ERROR(_bno085_ctx_init(&ctx->parent, interrupt_pin, reset_pin, boot_pin, GPIO_NUM_NC), TAG, "Failed to initialize ctx object");
 
@@ -168,14 +170,22 @@ esp_err_t bno085_init_i2c(bno085_i2c_ctx_t *ctx, i2c_master_bus_handle_t i2c_bus
     ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_bus_handle, &dev_cfg, &ctx->dev_handle));
 
 
+    bno085_i2c_reader_init(&ctx->reader);
+
     // Assign HAL functions
     ctx->parent._HAL.open = bno085_hal_i2c_open;
     ctx->parent._HAL.close = bno085_hal_i2c_close;
     ctx->parent._HAL.read = bno085_hal_i2c_read;
     ctx->parent._HAL.write = bno085_hal_i2c_write;
+    ctx->parent.soft_reset = i2c_send_soft_reset;
     
     // Initialize SH2
-    ESP_RETURN_ON_ERROR(_bno085_sh2_init(&ctx->parent), TAG, "Failed to initialize SH2 Interface");
+    ESP_RETURN_ON_ERROR(_bno085_sh2_init(&ctx->parent, sh2_ops), TAG, "Failed to initialize SH2 Interface");
 
     return ESP_OK;
 }
+
+
+void bno085_i2c_get_transfer_stats(bno085_i2c_ctx_t *ctx, bno085_i2c_transfer_stats_t *stats) {
+    memcpy(stats, &ctx->reader.transfer_stats, sizeof(bno085_i2c_transfer_stats_t));
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "bno085_i2c_reader.h"
+
+#define SHTP_HEADER_SIZE 4
+
+
+static uint16_t clamp_read_size(uint16_t size) {
+    if (size < BNO085_I2C_MIN_SPECULATIVE_READ_SIZE) {
+        return BNO085_I2C_MIN_SPECULATIVE_READ_SIZE;
+    }
+    if (size > BNO085_I2C_MAX_SPECULATIVE_READ_SIZE) {
+        return BNO085_I2C_MAX_SPECULATIVE_READ_SIZE;
+    }
+    return size;
+}
+
+
+/**
+ * @brief The read size among the sizes of the window that would have cost its packets the least bus time.
+ */
+static uint16_t choose_read_size(const bno085_i2c_reader_t *reader) {
+    uint16_t best_size = BNO085_I2C_MIN_SPECULATIVE_READ_SIZE;
+    uint32_t best_cost = UINT32_MAX;
+
+    for (int candidate = 0; candidate < BNO085_I2C_SPECULATIVE_WINDOW; candidate += 1) {
+        if (reader->window_sizes[candidate] == 0) {
+            continue;
+        }
+        uint16_t size = clamp_read_size(reader->window_sizes[candidate]);
+
+        uint32_t cost = 0;
+        for (int idx = 0; idx < BNO085_I2C_SPECULATIVE_WINDOW; idx += 1) {
+            uint16_t packet_size = reader->window_sizes[idx];
+            if (packet_size == 0) {
+                continue;
+            }
+            cost += packet_size <= size ? size - packet_size : BNO085_I2C_TRANSACTION_COST_BYTES + packet_size - size;
+        }
+
+        // The smaller size on a tie
+        if (cost < best_cost || (cost == best_cost && size < best_size)) {
+            best_cost = cost;
+            best_size = size;
+        }
+    }
+
+    return best_size;
+}
+
+
+void bno085_i2c_reader_init(bno085_i2c_reader_t *reader) {
+    reader->speculative_read_size = BNO085_I2C_MIN_SPECULATIVE_READ_SIZE;
+    memset(reader->window_sizes, 0, sizeof(reader->window_sizes));
+    reader->window_idx = 0;
+    memset(&reader->transfer_stats, 0, sizeof(bno085_i2c_transfer_stats_t));
+}
+
+
+int bno085_i2c_reader_read(bno085_i2c_reader_t *reader, bno085_i2c_receive_t receive, void *arg, uint8_t *buffer, unsigned len) {
+    bno085_i2c_transfer_stats_t *stats = &reader->transfer_stats;
+
+    // Speculatively read the whole packet in one transaction
+    unsigned read_size = reader->speculative_read_size;
+    if (read_size > len) {
+        read_size = len;
+    }
+
+    if (receive(arg, buffer, read_size) != 0) {
+        return -1;
+    }
+    stats->transaction_count += 1;
+    stats->byte_count += read_size;
+
+    uint16_t packet_size = ((uint16_t)buffer[0] + ((uint16_t)buffer[1] << 8)) & ~0x8000;
+
+    if (packet_size == 0) {
+        stats->wasted_byte_count += read_size;
+        return 0;
+    }
+
+    // Check the buffer size
+    if (len < packet_size) {
+        return 0;
+    }
+
+    if (packet_size <= read_size) {
+        stats->wasted_byte_count += read_size - packet_size;
+    }
+    else {
+        // Read the remainder. The continuation transfer repeats the 4 byte header, let it land on the tail of the
+        // previous read and restore the bytes afterwards.
+        unsigned remaining_size = packet_size - read_size;
+        uint8_t * continuation = buffer + read_size - SHTP_HEADER_SIZE;
+        uint8_t saved[SHTP_HEADER_SIZE];
+        memcpy(saved, continuation, SHTP_HEADER_SIZE);
+
+        int err = receive(arg, continuation, remaining_size + SHTP_HEADER_SIZE);
+        memcpy(continuation, saved, SHTP_HEADER_SIZE);
+        if (err != 0) {
+            return -1;
+        }
+        stats->transaction_count += 1;
+        stats->byte_count += remaining_size + SHTP_HEADER_SIZE;
+        stats->wasted_byte_count += SHTP_HEADER_SIZE;
+    }
+
+    stats->packet_count += 1;
+
+    reader->window_sizes[reader->window_idx] = packet_size;
+    reader->window_idx = (reader->window_idx + 1) % BNO085_I2C_SPECULATIVE_WINDOW;
+    reader->speculative_read_size = choose_read_size(reader);
+
+    return packet_size;
+}
@@ -16,10 +16,14 @@ typedef enum {
 
 
 esp_err_t _bno085_ctx_init(bno085_ctx_t *ctx, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, gpio_num_t ps0_wake_pin);
-esp_err_t _bno085_sh2_init(bno085_ctx_t *ctx);
+esp_err_t _bno085_sh2_init(bno085_ctx_t *ctx, const bno085_sh2_ops_t *sh2_ops);
 
 void _bno085_disable_interrupt(bno085_ctx_t *ctx);
 void _bno085_enable_interrupt(bno085_ctx_t *ctx);
 esp_err_t _bno085_wait_for_interrupt(bno085_ctx_t *ctx);
+uint32_t _bno085_get_interrupt_time_us(bno085_ctx_t *ctx);
+void _bno085_request_recovery(bno085_ctx_t *ctx);
+esp_err_t _bno085_hard_reset(bno085_ctx_t *ctx);
+void _bno085_record_transport_error(bno085_ctx_t *ctx, int64_t start_us);
 
 #endif // BNO085_PRIVATE_H_
\ No newline at end of file
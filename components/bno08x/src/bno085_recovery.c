@@ -0,0 +1,134 @@
+#include <string.h>
+
+#include "bno085_recovery.h"
+
+
+void bno085_recovery_init(bno085_recovery_t *recovery, bno085_recovery_stats_t *stats, int64_t now_us) {
+    memset(recovery, 0, sizeof(bno085_recovery_t));
+    recovery->stats = stats;
+    recovery->last_activity_us = now_us;
+}
+
+
+bool bno085_recovery_request(bno085_recovery_t *recovery, int64_t now_us) {
+    // Faults while a reset is in progress are expected, the reset timeout handles the escalation
+    if (recovery->state != BNO085_RECOVERY_IDLE) {
+        return false;
+    }
+
+    recovery->stats->fault_count += 1;
+    recovery->start_us = now_us;
+    recovery->attempt = 0;
+    recovery->state = BNO085_RECOVERY_REQUESTED;
+    return true;
+}
+
+
+void bno085_recovery_kick(bno085_recovery_t *recovery, int64_t now_us) {
+    recovery->last_activity_us = now_us;
+}
+
+
+bool bno085_recovery_check_stall(bno085_recovery_t *recovery, int64_t now_us, int64_t timeout_us) {
+    if (recovery->state != BNO085_RECOVERY_IDLE || now_us - recovery->last_activity_us < timeout_us) {
+        return false;
+    }
+
+    recovery->stats->stall_count += 1;
+    return bno085_recovery_request(recovery, now_us);
+}
+
+
+int64_t bno085_recovery_stall_timeout_us(uint32_t shortest_period_us) {
+    int64_t timeout_us = (int64_t) shortest_period_us * BNO085_STALL_INTERVAL_FACTOR;
+    return timeout_us > BNO085_STALL_TIMEOUT_MS * 1000ll ? timeout_us : BNO085_STALL_TIMEOUT_MS * 1000ll;
+}
+
+
+static void record_reset_time(bno085_recovery_t *recovery, int64_t now_us) {
+    if (recovery->state == BNO085_RECOVERY_SOFT_RESET) {
+        recovery->stats->soft_reset_us += now_us - recovery->reset_start_us;
+    }
+    else if (recovery->state == BNO085_RECOVERY_HARD_RESET) {
+        recovery->stats->hard_reset_us += now_us - recovery->reset_start_us;
+    }
+}
+
+
+bno085_recovery_action_t bno085_recovery_step(bno085_recovery_t *recovery, int64_t now_us, bool soft_reset_available, bool hard_reset_available) {
+    switch (recovery->state) {
+        case BNO085_RECOVERY_REQUESTED: {
+            // Escalate from soft reset to hardware reset
+            recovery->deadline_us = now_us + BNO085_RECOVERY_RESET_TIMEOUT_MS * 1000ll;
+            recovery->reset_start_us = now_us;
+            bool use_soft_reset = soft_reset_available &&
+                (recovery->attempt < BNO085_RECOVERY_SOFT_RESET_ATTEMPTS || !hard_reset_available);
+            recovery->attempt += 1;
+
+            if (use_soft_reset) {
+                recovery->stats->soft_reset_count += 1;
+                recovery->state = BNO085_RECOVERY_SOFT_RESET;
+                return BNO085_RECOVERY_ACTION_SOFT_RESET;
+            }
+            if (hard_reset_available) {
+                recovery->stats->hard_reset_count += 1;
+                recovery->state = BNO085_RECOVERY_HARD_RESET;
+                return BNO085_RECOVERY_ACTION_HARD_RESET;
+            }
+
+            // Nothing to reset the sensor with, wait for it to come back
+            recovery->state = BNO085_RECOVERY_SOFT_RESET;
+            return BNO085_RECOVERY_ACTION_NO_RESET;
+        }
+        case BNO085_RECOVERY_SOFT_RESET:
+        case BNO085_RECOVERY_HARD_RESET: {
+            if (now_us > recovery->deadline_us) {
+                record_reset_time(recovery, now_us);
+                recovery->state = BNO085_RECOVERY_REQUESTED;
+                return BNO085_RECOVERY_ACTION_ESCALATE;
+            }
+            return BNO085_RECOVERY_ACTION_NONE;
+        }
+        case BNO085_RECOVERY_RECONFIGURE:
+            return BNO085_RECOVERY_ACTION_RECONFIGURE;
+        default:
+            return BNO085_RECOVERY_ACTION_NONE;
+    }
+}
+
+
+void bno085_recovery_reset_failed(bno085_recovery_t *recovery) {
+    recovery->state = BNO085_RECOVERY_REQUESTED;
+}
+
+
+bool bno085_recovery_on_reset(bno085_recovery_t *recovery, int64_t now_us) {
+    bool unexpected = recovery->state == BNO085_RECOVERY_IDLE;
+
+    if (unexpected) {
+        recovery->stats->unexpected_reset_count += 1;
+        recovery->start_us = now_us;
+    }
+    else {
+        record_reset_time(recovery, now_us);
+    }
+
+    recovery->state = BNO085_RECOVERY_RECONFIGURE;
+    return unexpected;
+}
+
+
+int64_t bno085_recovery_finish(bno085_recovery_t *recovery, int64_t now_us) {
+    int64_t recovery_us = now_us - recovery->start_us;
+
+    recovery->stats->recovery_count += 1;
+    recovery->stats->last_recovery_us = recovery_us;
+    recovery->stats->total_recovery_us += recovery_us;
+    if (recovery_us > recovery->stats->max_recovery_us) {
+        recovery->stats->max_recovery_us = recovery_us;
+    }
+
+    recovery->state = BNO085_RECOVERY_IDLE;
+    recovery->last_activity_us = now_us;
+    return recovery_us;
+}
@@ -0,0 +1,39 @@
+#include <string.h>
+
+#include "bno085_report_descriptor.h"
+
+
+#define BNO085_REPORT_DESCRIPTOR(name_, sensor_id_, member_, type_, wakeup_, always_on_, change_sensitivity_) \
+    [sensor_id_] = { \
+        .name = #name_, \
+        .sensor_id = sensor_id_, \
+        .wakeup = wakeup_, \
+        .always_on = always_on_, \
+        .change_sensitivity = change_sensitivity_, \
+    },
+
+static const bno085_report_descriptor_t report_descriptors[SH2_MAX_SENSOR_EVENT_LEN] = {
+    BNO085_REPORT_DESCRIPTOR_TABLE(BNO085_REPORT_DESCRIPTOR)
+};
+
+
+const bno085_report_descriptor_t * bno085_get_report_descriptor(sh2_SensorId_t sensor_id) {
+    if (sensor_id >= SH2_MAX_SENSOR_EVENT_LEN || report_descriptors[sensor_id].name == NULL) {
+        return NULL;
+    }
+
+    return &report_descriptors[sensor_id];
+}
+
+
+void bno085_report_descriptor_get_config(const bno085_report_descriptor_t *descriptor, uint32_t interval_us, uint32_t batch_interval_us, sh2_SensorConfig_t *config) {
+    memset(config, 0, sizeof(sh2_SensorConfig_t));
+    config->changeSensitivityEnabled = descriptor->change_sensitivity;
+    config->wakeupEnabled = descriptor->wakeup;
+    config->changeSensitivityRelative = false;
+    config->alwaysOnEnabled = descriptor->always_on;
+    config->changeSensitivity = 0;
+    config->reportInterval_us = interval_us;
+    config->batchInterval_us = batch_interval_us;
+    config->sensorSpecific = 0;
+}
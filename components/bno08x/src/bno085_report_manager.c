@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "bno085.h"
+#include "bno085_private.h"
+
+
+#define TAG "BNO085ReportManager"
+
+
+static uint32_t get_effective_interval_ms(sensor_report_config_t *report_config) {
+    uint32_t effective_interval_ms = 0;
+
+    for (bno085_report_request_t *request = report_config->request_list; request != NULL; request = request->next) {
+        if (request->interval_ms != 0 && (effective_interval_ms == 0 || request->interval_ms < effective_interval_ms)) {
+            effective_interval_ms = request->interval_ms;
+        }
+    }
+
+    if (effective_interval_ms != 0 && effective_interval_ms < report_config->interval_floor_ms) {
+        effective_interval_ms = report_config->interval_floor_ms;
+    }
+
+    return effective_interval_ms;
+}
+
+
+// Must be called with report_request_lock held
+static esp_err_t apply_report(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id) {
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+    uint32_t effective_interval_ms = get_effective_interval_ms(target_report_config);
+
+    // Compare against the interval SH2 accepted, a failed command is sent again on the next update
+    if (target_report_config->applied_interval_us == effective_interval_ms * 1000) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Sensor ID %d effective interval %lu ms", sensor_id, effective_interval_ms);
+    ctx->report_manager_stats.command_count += 1;
+
+    return bno085_enable_report(ctx, sensor_id, effective_interval_ms);
+}
+
+
+esp_err_t bno085_register_report_request(bno085_ctx_t *ctx, bno085_report_request_t *request, sh2_SensorId_t sensor_id) {
+    if (request == NULL || sensor_id >= SH2_MAX_SENSOR_EVENT_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    request->sensor_id = sensor_id;
+    request->interval_ms = 0;
+
+    // Add to the head of the list
+    sensor_report_config_t * target_report_config = &ctx->enabled_sensor_report_list[sensor_id];
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    request->next = target_report_config->request_list;
+    target_report_config->request_list = request;
+    xSemaphoreGive(ctx->report_request_lock);
+
+    return ESP_OK;
+}
+
+
+esp_err_t bno085_update_report_request(bno085_ctx_t *ctx, bno085_report_request_t *request, uint32_t interval_ms) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    request->interval_ms = interval_ms;
+    ctx->report_manager_stats.request_count += 1;
+
+    if (ctx->report_request_defer_depth == 0) {
+        ret = apply_report(ctx, request->sensor_id);
+    }
+    xSemaphoreGive(ctx->report_request_lock);
+
+    return ret;
+}
+
+
+esp_err_t bno085_set_report_interval_floor(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id, uint32_t interval_floor_ms) {
+    if (sensor_id >= SH2_MAX_SENSOR_EVENT_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    ctx->enabled_sensor_report_list[sensor_id].interval_floor_ms = interval_floor_ms;
+
+    if (ctx->report_request_defer_depth == 0) {
+        ret = apply_report(ctx, sensor_id);
+    }
+    xSemaphoreGive(ctx->report_request_lock);
+
+    return ret;
+}
+
+
+uint32_t bno085_get_report_interval_us(bno085_ctx_t *ctx, sh2_SensorId_t sensor_id) {
+    if (sensor_id >= SH2_MAX_SENSOR_EVENT_LEN) {
+        return 0;
+    }
+
+    // Written by the report manager and the recovery, a single word read
+    return ctx->enabled_sensor_report_list[sensor_id].applied_interval_us;
+}
+
+
+void bno085_defer_report_requests(bno085_ctx_t *ctx) {
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    ctx->report_request_defer_depth += 1;
+    xSemaphoreGive(ctx->report_request_lock);
+}
+
+
+esp_err_t bno085_apply_report_requests(bno085_ctx_t *ctx) {
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    if (ctx->report_request_defer_depth > 0) {
+        ctx->report_request_defer_depth -= 1;
+    }
+
+    if (ctx->report_request_defer_depth == 0) {
+        for (sh2_SensorId_t sensor_id = 0; sensor_id < SH2_MAX_SENSOR_EVENT_LEN; sensor_id += 1) {
+            if (ctx->enabled_sensor_report_list[sensor_id].request_list == NULL) {
+                continue;
+            }
+
+            esp_err_t apply_ret = apply_report(ctx, sensor_id);
+            if (apply_ret != ESP_OK) {
+                ret = apply_ret;
+            }
+        }
+    }
+    xSemaphoreGive(ctx->report_request_lock);
+
+    return ret;
+}
+
+
+void bno085_get_report_manager_stats(bno085_ctx_t *ctx, bno085_report_manager_stats_t *stats) {
+    xSemaphoreTake(ctx->report_request_lock, portMAX_DELAY);
+    memcpy(stats, &ctx->report_manager_stats, sizeof(bno085_report_manager_stats_t));
+    xSemaphoreGive(ctx->report_request_lock);
+}
@@ -0,0 +1,74 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "bno085_sample_ring.h"
+
+
+static void copy_sensor_event(sh2_SensorEvent_t *dst, const sh2_SensorEvent_t *src) {
+    // Skip the unused tail of the report. The length is clamped since a reader may see a torn event.
+    uint8_t len = src->len < SH2_MAX_SENSOR_EVENT_LEN ? src->len : SH2_MAX_SENSOR_EVENT_LEN;
+    memcpy(dst, src, offsetof(sh2_SensorEvent_t, report) + len);
+}
+
+
+void bno085_sample_ring_push(bno085_sample_ring_t *ring, const sh2_SensorEvent_t *event, int64_t timestamp_us, int64_t arrival_us, bool valid) {
+    // Only the sensor poller task writes to the ring, therefore the head can be read without synchronization
+    uint32_t seq = ring->head + 1;
+    bno085_sample_slot_t *slot = &ring->slots[seq & (BNO085_SAMPLE_RING_DEPTH - 1)];
+
+    // Claim the slot first so readers still copying the previous sample in this slot can detect the overwrite
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    slot->timestamp_us = timestamp_us;
+    slot->arrival_us = arrival_us;
+    slot->valid = valid;
+    copy_sensor_event(&slot->event, event);
+
+    // Publish
+    __atomic_store_n(&ring->head, seq, __ATOMIC_RELEASE);
+}
+
+
+uint32_t bno085_sample_ring_get_head(const bno085_sample_ring_t *ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+
+size_t bno085_sample_ring_read(const bno085_sample_ring_t *ring, uint32_t *cursor, bno085_sample_slot_t *slots, size_t max_slots, uint32_t *lost) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    // Samples older than the ring depth are already overwritten, skip to the oldest sample available
+    uint32_t pending = head - *cursor;
+    if (pending > BNO085_SAMPLE_RING_DEPTH) {
+        *lost += pending - BNO085_SAMPLE_RING_DEPTH;
+        *cursor = head - BNO085_SAMPLE_RING_DEPTH;
+    }
+
+    size_t count = 0;
+    while (count < max_slots && *cursor != head) {
+        uint32_t seq = *cursor + 1;
+        const bno085_sample_slot_t *slot = &ring->slots[seq & (BNO085_SAMPLE_RING_DEPTH - 1)];
+        bno085_sample_slot_t *copy = &slots[count];
+
+        // Copy the slot, then confirm the writer didn't claim the slot in the meantime
+        uint32_t seq_before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        copy->timestamp_us = slot->timestamp_us;
+        copy->arrival_us = slot->arrival_us;
+        copy->valid = slot->valid;
+        copy_sensor_event(&copy->event, &slot->event);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        uint32_t seq_after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        *cursor = seq;
+
+        if (seq_before != seq || seq_after != seq) {
+            *lost += 1;
+            continue;
+        }
+
+        copy->seq = seq;
+        count += 1;
+    }
+
+    return count;
+}
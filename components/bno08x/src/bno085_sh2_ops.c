@@ -0,0 +1,47 @@
+#include "bno085_sh2_ops.h"
+
+
+const bno085_sh2_ops_t bno085_sh2_default_ops = {
+    .open = sh2_open,
+    .close = sh2_close,
+    .service = sh2_service,
+    .set_sensor_callback = sh2_setSensorCallback,
+    .get_prod_ids = sh2_getProdIds,
+    .set_sensor_config = sh2_setSensorConfig,
+    .dev_sleep = sh2_devSleep,
+    .dev_on = sh2_devOn,
+};
+
+
+#if BNO085_SH2_SECONDARY_INSTANCE
+
+#ifndef BNO085_SH2_SECONDARY_PREFIX
+    #error "BNO085_SH2_SECONDARY_PREFIX must be the prefix of the renamed SH2 copy"
+#endif
+
+#define SECONDARY_NAME_(prefix, name) prefix##name
+#define SECONDARY_NAME(prefix, name) SECONDARY_NAME_(prefix, name)
+#define SECONDARY(name) SECONDARY_NAME(BNO085_SH2_SECONDARY_PREFIX, name)
+
+// Entry points of the renamed copy, same signatures as in sh2.h
+int SECONDARY(sh2_open)(sh2_Hal_t *pHal, sh2_EventCallback_t *eventCallback, void *eventCookie);
+void SECONDARY(sh2_close)(void);
+void SECONDARY(sh2_service)(void);
+int SECONDARY(sh2_setSensorCallback)(sh2_SensorCallback_t *callback, void *cookie);
+int SECONDARY(sh2_getProdIds)(sh2_ProductIds_t *prodIds);
+int SECONDARY(sh2_setSensorConfig)(sh2_SensorId_t sensorId, const sh2_SensorConfig_t *pConfig);
+int SECONDARY(sh2_devSleep)(void);
+int SECONDARY(sh2_devOn)(void);
+
+const bno085_sh2_ops_t bno085_sh2_secondary_ops = {
+    .open = SECONDARY(sh2_open),
+    .close = SECONDARY(sh2_close),
+    .service = SECONDARY(sh2_service),
+    .set_sensor_callback = SECONDARY(sh2_setSensorCallback),
+    .get_prod_ids = SECONDARY(sh2_getProdIds),
+    .set_sensor_config = SECONDARY(sh2_setSensorConfig),
+    .dev_sleep = SECONDARY(sh2_devSleep),
+    .dev_on = SECONDARY(sh2_devOn),
+};
+
+#endif  // BNO085_SH2_SECONDARY_INSTANCE
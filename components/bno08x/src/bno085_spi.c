@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -6,6 +8,7 @@
 
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 
 #define TAG "BNO085_SPI"
 
@@ -16,6 +19,50 @@ int bno085_hal_spi_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_
 int bno085_hal_spi_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len);
 
 
+#if BNO085_USE_QUEUED_SPI_TRANSFER
+static void IRAM_ATTR spi_transfer_complete_cb(spi_transaction_t *transaction) {
+    bno085_spi_ctx_t * ctx = (bno085_spi_ctx_t *) transaction->user;
+    ctx->transfer_complete_us = esp_timer_get_time();
+}
+#endif  // BNO085_USE_QUEUED_SPI_TRANSFER
+
+
+static esp_err_t spi_transfer(bno085_spi_ctx_t *ctx, spi_transaction_t *transaction) {
+    esp_err_t err;
+    int64_t start_us = esp_timer_get_time();
+
+#if BNO085_USE_QUEUED_SPI_TRANSFER
+    // Queue the transaction and block until the SPI driver signals the completion from the ISR. The CPU is only busy
+    // while queuing and after the completion.
+    transaction->user = ctx;
+    err = spi_device_queue_trans(ctx->dev_handle, transaction, portMAX_DELAY);
+    if (err != ESP_OK) {
+        _bno085_record_transport_error(&ctx->parent, start_us);
+        return err;
+    }
+    int64_t queued_us = esp_timer_get_time();
+
+    spi_transaction_t * result;
+    err = spi_device_get_trans_result(ctx->dev_handle, &result, portMAX_DELAY);
+    int64_t end_us = esp_timer_get_time();
+
+    bno085_spi_transfer_account_queued(&ctx->transfer_stats, transaction->length / 8, start_us, queued_us, ctx->transfer_complete_us, end_us);
+#else
+    // Busy wait for the whole transfer
+    err = spi_device_polling_transmit(ctx->dev_handle, transaction);
+    int64_t end_us = esp_timer_get_time();
+
+    bno085_spi_transfer_account_polling(&ctx->transfer_stats, transaction->length / 8, start_us, end_us);
+#endif  // BNO085_USE_QUEUED_SPI_TRANSFER
+
+    if (err != ESP_OK) {
+        _bno085_record_transport_error(&ctx->parent, start_us);
+    }
+
+    return err;
+}
+
+
 void bno085_spi_hard_reset(bno085_ctx_t *ctx) {
     if (ctx->reset_pin != GPIO_NUM_NC) {
         // Make sure the BOOTN, PS0/WAKE is high before and after the reset
@@ -66,6 +113,17 @@ void bno085_spi_hard_reset(bno085_ctx_t *ctx) {
     }
 }
 
+static esp_err_t spi_hard_reset(bno085_ctx_t *ctx) {
+    if (ctx->reset_pin == GPIO_NUM_NC) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // PS0/WAKE and BOOTN need to be held during the reset to stay in SPI mode
+    bno085_spi_hard_reset(ctx);
+    return ESP_OK;
+}
+
+
 int bno085_hal_spi_open(sh2_Hal_t *self) {
     bno085_spi_hard_reset((bno085_ctx_t *) self);
 
@@ -92,6 +150,9 @@ int bno085_hal_spi_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_
         gpio_set_level(ctx->parent.ps0_wake_pin, 1);
     }
 
+    // Reports are timestamped relative to the interrupt
+    *t_us = _bno085_get_interrupt_time_us(&ctx->parent);
+
 #if BNO085_USE_SOFTWARE_CONTROLLED_CS_PIN
     // Assert chip select for full duplex transfer
     gpio_set_level(((bno085_spi_ctx_t *) ctx)->spi_cs_pin, 0);  // assert CS
@@ -111,7 +172,7 @@ int bno085_hal_spi_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_
         .flags = 0,
     };
 
-    err = spi_device_polling_transmit(ctx->dev_handle, &transaction);
+    err = spi_transfer(ctx, &transaction);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read headers: %s", esp_err_to_name(err));
         return 0;
@@ -134,11 +195,14 @@ int bno085_hal_spi_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_
         transaction.rx_buffer = pBuffer;
         transaction.rxlength = packet_size * 8; // in bits
 
-        err = spi_device_polling_transmit(ctx->dev_handle, &transaction);
+        err = spi_transfer(ctx, &transaction);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Failed to read packet: %s", esp_err_to_name(err));
             packet_size = 0;
         }
+        else {
+            ctx->transfer_stats.packet_count += 1;
+        }
 
         // ESP_LOGI(TAG, "spi_read() read %d bytes", packet_size);
         // for (int i = 0; i < packet_size; i++) {
@@ -166,9 +230,11 @@ int bno085_hal_spi_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
         gpio_set_level(ctx->parent.ps0_wake_pin, 0);
     }
 
+    int64_t start_us = esp_timer_get_time();
     if (_bno085_wait_for_interrupt((bno085_ctx_t *) self) != ESP_OK) {
         ESP_LOGW(TAG, "spi_write() timeout waiting for interrupt");
-        bno085_spi_hard_reset((bno085_ctx_t *) self);
+        _bno085_record_transport_error((bno085_ctx_t *) self, start_us);
+        _bno085_request_recovery((bno085_ctx_t *) self);
         return 0;
     }
 
@@ -197,7 +263,7 @@ int bno085_hal_spi_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
         .flags = 0,
     };
 
-    err = spi_device_polling_transmit(ctx->dev_handle, &transaction);
+    err = spi_transfer(ctx, &transaction);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to write data: %s", esp_err_to_name(err));
         len = 0;
@@ -211,7 +277,7 @@ int bno085_hal_spi_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
     return len;
 }
 
-esp_err_t bno085_init_spi(bno085_spi_ctx_t *ctx, spi_host_device_t spi_host, gpio_num_t spi_cs_pin, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, gpio_num_t ps0_wake_pin)
+esp_err_t bno085_init_spi(bno085_spi_ctx_t *ctx, spi_host_device_t spi_host, gpio_num_t spi_cs_pin, gpio_num_t interrupt_pin, gpio_num_t reset_pin, gpio_num_t boot_pin, gpio_num_t ps0_wake_pin, const bno085_sh2_ops_t *sh2_ops)
 {
     // Initialize configuration
     ESP_RETURN_ON_ERROR(_bno085_ctx_init(&ctx->parent, interrupt_pin, reset_pin, boot_pin, ps0_wake_pin), TAG, "Failed to initialize ctx object");
@@ -243,19 +309,33 @@ esp_err_t bno085_init_spi(bno085_spi_ctx_t *ctx, spi_host_device_t spi_host, gpi
 #endif  // BNO085_USE_SOFTWARE_CONTROLLED_CS_PIN
         .queue_size = 1,
         .mode = 0x3,    // CPOL=1, CPHA=1, MODE=SPI_MODE3
+#if BNO085_USE_QUEUED_SPI_TRANSFER
+        .post_cb = spi_transfer_complete_cb,
+#endif  // BNO085_USE_QUEUED_SPI_TRANSFER
     };
 
     // Initialize the slave device
     ESP_RETURN_ON_ERROR(spi_bus_add_device(spi_host, &dev_cfg, &ctx->dev_handle), TAG, "Failed to initialize SPI slave device");
 
+    memset(&ctx->transfer_stats, 0, sizeof(bno085_spi_transfer_stats_t));
+
+    // The SPI read and write wait for the interrupt inside the HAL
+    ctx->parent.hal_waits_for_interrupt = true;
+
     // Assign HAL functions
     ctx->parent._HAL.open = bno085_hal_spi_open;
     ctx->parent._HAL.close = bno085_hal_spi_close;
     ctx->parent._HAL.read = bno085_hal_spi_read;
     ctx->parent._HAL.write = bno085_hal_spi_write;
+    ctx->parent.hard_reset = spi_hard_reset;
 
     // Initialize SH2
-    ESP_RETURN_ON_ERROR(_bno085_sh2_init(&ctx->parent), TAG, "Failed to initialize SH2 Interface");
+    ESP_RETURN_ON_ERROR(_bno085_sh2_init(&ctx->parent, sh2_ops), TAG, "Failed to initialize SH2 Interface");
 
     return ESP_OK;
 }
+
+
+void bno085_spi_get_transfer_stats(bno085_spi_ctx_t *ctx, bno085_spi_transfer_stats_t *stats) {
+    memcpy(stats, &ctx->transfer_stats, sizeof(bno085_spi_transfer_stats_t));
+}
@@ -0,0 +1,22 @@
+#include "bno085_spi_transfer.h"
+
+
+void bno085_spi_transfer_account_queued(bno085_spi_transfer_stats_t *stats, uint32_t byte_count, int64_t start_us, int64_t queued_us, int64_t complete_us, int64_t end_us) {
+    // The completion is stamped from the ISR, keep it within the transaction in case of a stale stamp
+    if (complete_us < queued_us || complete_us > end_us) {
+        complete_us = end_us;
+    }
+
+    stats->busy_us += (queued_us - start_us) + (end_us - complete_us);
+    stats->transfer_us += complete_us - queued_us;
+    stats->transaction_count += 1;
+    stats->byte_count += byte_count;
+}
+
+
+void bno085_spi_transfer_account_polling(bno085_spi_transfer_stats_t *stats, uint32_t byte_count, int64_t start_us, int64_t end_us) {
+    stats->busy_us += end_us - start_us;
+    stats->transfer_us += end_us - start_us;
+    stats->transaction_count += 1;
+    stats->byte_count += byte_count;
+}
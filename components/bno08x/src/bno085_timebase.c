@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "bno085_timebase.h"
+
+
+void bno085_timebase_reset(bno085_timebase_t *timebase) {
+    memset(timebase, 0, sizeof(bno085_timebase_t));
+}
+
+
+void bno085_timebase_update(bno085_timebase_t *timebase, uint8_t sequence, uint32_t interval_us, int64_t host_us) {
+    if (interval_us == 0) {
+        return;
+    }
+
+    if (!timebase->window_started) {
+        timebase->window_started = true;
+        timebase->last_sequence = sequence;
+        timebase->sensor_us = 0;
+        timebase->window_sensor_us = 0;
+        timebase->window_host_us = host_us;
+        return;
+    }
+
+    // Missing reports still advance the sensor timeline
+    uint8_t delta_sequence = sequence - timebase->last_sequence;
+    if (delta_sequence == 0) {
+        return;
+    }
+    timebase->last_sequence = sequence;
+    timebase->sensor_us += (int64_t) delta_sequence * interval_us;
+
+    int64_t elapsed_sensor_us = timebase->sensor_us - timebase->window_sensor_us;
+    if (elapsed_sensor_us < BNO085_TIMEBASE_WINDOW_US) {
+        return;
+    }
+
+    int64_t elapsed_host_us = host_us - timebase->window_host_us;
+    float skew_ppm = (float) (elapsed_host_us - elapsed_sensor_us) * 1e6f / (float) elapsed_sensor_us;
+
+    // Start the next window from here
+    timebase->window_sensor_us = timebase->sensor_us;
+    timebase->window_host_us = host_us;
+
+    if (skew_ppm > BNO085_TIMEBASE_MAX_SKEW_PPM || skew_ppm < -BNO085_TIMEBASE_MAX_SKEW_PPM) {
+        return;
+    }
+
+    if (timebase->skew_valid) {
+        timebase->skew_ppm += (skew_ppm - timebase->skew_ppm) * BNO085_TIMEBASE_SKEW_FILTER_GAIN;
+    }
+    else {
+        timebase->skew_ppm = skew_ppm;
+        timebase->skew_valid = true;
+    }
+}
+
+
+int64_t bno085_timebase_correct(const bno085_timebase_t *timebase, int64_t anchor_us, int64_t timestamp_us) {
+    if (!timebase->skew_valid || anchor_us == 0) {
+        return timestamp_us;
+    }
+
+    // Only the offset is measured by the sensor clock, the anchor is already in the host clock
+    int64_t offset_us = timestamp_us - anchor_us;
+    return anchor_us + offset_us + (int64_t) ((float) offset_us * timebase->skew_ppm * 1e-6f);
+}
+
+
+int64_t bno085_timebase_extend(int64_t reference_us, uint64_t timestamp_us) {
+    int32_t delta_us = (int32_t) ((uint32_t) reference_us - (uint32_t) timestamp_us);
+    return reference_us - delta_us;
+}
+
+
+int64_t bno085_timebase_sample_age_us(int64_t now_us, int64_t arrival_us, int64_t timestamp_us) {
+    // Nothing to age until a sample arrives, don't report the time since boot
+    if (arrival_us == 0) {
+        return -1;
+    }
+
+    return now_us - timestamp_us;
+}
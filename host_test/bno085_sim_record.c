@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bno085_sim_hal.h"
+#include "bno085_shtp_log.h"
+
+/**
+ * Records the packets of the simulator to a SHTP log, in the same format as the packet recorder on the device, so the
+ * replay tests have a capture with a known motion. Drives the simulator HAL directly, without SH2.
+ *
+ *   bno085_sim_record <output> [duration_s]
+ *
+ * Roll sweep of 30 deg at 0.5 Hz with the game rotation vector and the calibrated gyroscope at 400 Hz and the
+ * accelerometer at 100 Hz, the inputs of the fusion running on the device and of bno085_fusion.
+ */
+
+#define SHTP_HEADER_SIZE 4
+#define SHTP_CHANNEL_CONTROL 2
+#define SH2_SET_FEATURE_COMMAND 0xFD
+#define SH2_FEATURE_REPORT_SIZE 17
+
+
+static FILE *output;
+static uint32_t packet_count;
+
+
+static void write_record(const uint8_t *packet, uint16_t len, uint32_t t_us) {
+    uint8_t header[BNO085_SHTP_LOG_RECORD_HEADER_SIZE];
+    bno085_shtp_log_encode_record_header(header, t_us, len);
+    fwrite(header, 1, sizeof(header), output);
+    fwrite(packet, 1, len, output);
+    packet_count += 1;
+}
+
+
+static void drain(bno085_sim_hal_t *sim) {
+    // Responses are served before the input reports
+    while (sim->pending_count > 0) {
+        uint8_t packet[BNO085_SIM_MAX_PACKET_SIZE];
+        uint32_t t_us;
+        int len = sim->_HAL.read(&sim->_HAL, packet, sizeof(packet), &t_us);
+        if (len > 0) {
+            write_record(packet, (uint16_t) len, t_us);
+        }
+    }
+}
+
+
+static void set_feature(bno085_sim_hal_t *sim, uint8_t report_id, uint32_t interval_us) {
+    uint8_t packet[SHTP_HEADER_SIZE + SH2_FEATURE_REPORT_SIZE] = {0};
+    packet[0] = sizeof(packet);
+    packet[2] = SHTP_CHANNEL_CONTROL;
+    packet[SHTP_HEADER_SIZE] = SH2_SET_FEATURE_COMMAND;
+    packet[SHTP_HEADER_SIZE + 1] = report_id;
+    for (int i = 0; i < 4; i += 1) {
+        packet[SHTP_HEADER_SIZE + 5 + i] = (interval_us >> (8 * i)) & 0xFF;
+    }
+    sim->_HAL.write(&sim->_HAL, packet, sizeof(packet));
+    drain(sim);
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <output> [duration_s]\n", argv[0]);
+        return 2;
+    }
+    uint64_t duration_us = (argc > 2 ? strtoull(argv[2], NULL, 10) : 4) * 1000000ull;
+
+    output = fopen(argv[1], "wb");
+    if (output == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    uint8_t file_header[BNO085_SHTP_LOG_FILE_HEADER_SIZE];
+    bno085_shtp_log_encode_file_header(file_header);
+    fwrite(file_header, 1, sizeof(file_header), output);
+
+    static bno085_sim_hal_t sim;
+    bno085_sim_roll_sweep_t sweep = {.amplitude_rad = 0.5235988f, .frequency_hz = 0.5f};
+    bno085_sim_hal_init(&sim, bno085_sim_profile_roll_sweep, &sweep);
+
+    // Advertisement and reset notification
+    sim._HAL.open(&sim._HAL);
+    drain(&sim);
+
+    set_feature(&sim, 0x08, 2500);   // Game rotation vector
+    set_feature(&sim, 0x01, 10000);  // Accelerometer
+    set_feature(&sim, 0x02, 2500);   // Calibrated gyroscope
+
+    uint64_t start_us = sim.now_us;
+    while (sim.now_us - start_us < duration_us) {
+        uint8_t packet[BNO085_SIM_MAX_PACKET_SIZE];
+        uint32_t t_us;
+        int len = sim._HAL.read(&sim._HAL, packet, sizeof(packet), &t_us);
+        if (len <= 0) {
+            break;
+        }
+        write_record(packet, (uint16_t) len, t_us);
+    }
+
+    fclose(output);
+    printf("%lu packets, %lu reports\n", (unsigned long) packet_count, (unsigned long) sim.report_count);
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_replay_hal.h"
+#include "bno085_sample_ring.h"
+
+/**
+ * Replays a capture through the replay HAL and the SH2 library, then runs its events through the two ways the driver
+ * handles them and compares the time spent:
+ *
+ *   eager  decode every event in the sensor callback, copy the value into the queue of the sensor and out of it again
+ *   lazy   store the raw event in the sample ring of the sensor only if subscribed, decode it when the consumer reads
+ *
+ * Once with only the game rotation vector subscribed (the level), once with every report of the capture subscribed.
+ * The lazily decoded values must match the eager ones.
+ *
+ *   test_bno085_decode_replay <capture>
+ */
+
+#define MAX_EVENTS 65536
+#define MAX_REPORT_ID 0x30
+#define BENCHMARK_PASSES 200
+#define READ_BATCH 8                    // Samples read per wake-up of the consumer
+
+
+static sh2_SensorEvent_t events[MAX_EVENTS];
+static size_t event_count;
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    if (event_count < MAX_EVENTS) {
+        events[event_count++] = *event;
+    }
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+}
+
+
+typedef struct {
+    bool subscribed[MAX_REPORT_ID];
+    uint32_t decode_count;
+    uint32_t sample_count;
+    double checksum;
+} run_t;
+
+
+static double value_checksum(const sh2_SensorValue_t *value) {
+    switch (value->sensorId) {
+        case SH2_ACCELEROMETER:
+            return value->un.accelerometer.x + value->un.accelerometer.y + value->un.accelerometer.z;
+        case SH2_GYROSCOPE_CALIBRATED:
+            return value->un.gyroscope.x + value->un.gyroscope.y + value->un.gyroscope.z;
+        case SH2_LINEAR_ACCELERATION:
+            return value->un.linearAcceleration.x + value->un.linearAcceleration.y + value->un.linearAcceleration.z;
+        case SH2_GAME_ROTATION_VECTOR:
+            return value->un.gameRotationVector.real + value->un.gameRotationVector.i + value->un.gameRotationVector.j +
+                   value->un.gameRotationVector.k;
+        default:
+            return value->sequence;
+    }
+}
+
+
+/**
+ * Decode in the callback, one queue per sensor holding the latest value (xQueueOverwrite), read by the consumer.
+ */
+static void run_eager(run_t *run) {
+    static sh2_SensorValue_t queue[MAX_REPORT_ID];
+
+    for (size_t idx = 0; idx < event_count; idx += 1) {
+        sh2_SensorValue_t value;
+        if (sh2_decodeSensorEvent(&value, &events[idx]) != SH2_OK) {
+            continue;
+        }
+        run->decode_count += 1;
+
+        uint8_t report_id = events[idx].reportId;
+        if (report_id >= MAX_REPORT_ID || !run->subscribed[report_id]) {
+            continue;
+        }
+        memcpy(&queue[report_id], &value, sizeof(value));
+
+        // The consumer takes the value out of the queue
+        sh2_SensorValue_t received;
+        memcpy(&received, &queue[report_id], sizeof(received));
+        run->checksum += value_checksum(&received);
+        run->sample_count += 1;
+    }
+}
+
+
+/**
+ * Store the raw events of the subscribed sensors, decode them on read.
+ */
+static void run_lazy(run_t *run) {
+    static bno085_sample_ring_t rings[MAX_REPORT_ID];
+    static uint32_t cursors[MAX_REPORT_ID];
+
+    // The rings are kept from the previous pass, the consumers start at the head as bno085_subscribe() does
+    for (int report_id = 0; report_id < MAX_REPORT_ID; report_id += 1) {
+        cursors[report_id] = bno085_sample_ring_get_head(&rings[report_id]);
+    }
+
+    for (size_t idx = 0; idx < event_count; idx += 1) {
+        uint8_t report_id = events[idx].reportId;
+        if (report_id >= MAX_REPORT_ID || !run->subscribed[report_id]) {
+            continue;
+        }
+        bno085_sample_ring_push(&rings[report_id], &events[idx], (int64_t) events[idx].timestamp_uS, (int64_t) events[idx].timestamp_uS, true);
+
+        // The consumer reads at every sample here, the ring is never behind by more than one
+        uint32_t lost = 0;
+        bno085_sample_slot_t slots[READ_BATCH];
+        size_t count = bno085_sample_ring_read(&rings[report_id], &cursors[report_id], slots, READ_BATCH, &lost);
+        for (size_t i = 0; i < count; i += 1) {
+            sh2_SensorValue_t value;
+            if (sh2_decodeSensorEvent(&value, &slots[i].event) != SH2_OK) {
+                continue;
+            }
+            run->decode_count += 1;
+            run->checksum += value_checksum(&value);
+            run->sample_count += 1;
+        }
+        TEST_CHECK(lost == 0);
+    }
+}
+
+
+static double benchmark(void (*run_fn)(run_t *), run_t *result) {
+    int64_t start_ns = test_time_ns();
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass += 1) {
+        run_t run;
+        memcpy(&run, result, sizeof(run));
+        run.decode_count = 0;
+        run.sample_count = 0;
+        run.checksum = 0;
+        run_fn(&run);
+        if (pass == 0) {
+            memcpy(result, &run, sizeof(run));
+        }
+    }
+    return (double) (test_time_ns() - start_ns) / ((double) BENCHMARK_PASSES * event_count);
+}
+
+
+static void compare(const char *name, const bool *subscribed) {
+    run_t eager = {0}, lazy = {0};
+    memcpy(eager.subscribed, subscribed, sizeof(eager.subscribed));
+    memcpy(lazy.subscribed, subscribed, sizeof(lazy.subscribed));
+
+    double eager_ns = benchmark(run_eager, &eager);
+    double lazy_ns = benchmark(run_lazy, &lazy);
+
+    printf("%s: %lu events, %lu read. eager %lu decodes %.1f ns per event, lazy %lu decodes %.1f ns per event\n", name,
+           (unsigned long) event_count, (unsigned long) lazy.sample_count, (unsigned long) eager.decode_count, eager_ns,
+           (unsigned long) lazy.decode_count, lazy_ns);
+
+    // Same samples and values either way, only the subscribed ones are decoded lazily
+    TEST_CHECK(lazy.sample_count == eager.sample_count);
+    TEST_CHECK(lazy.checksum == eager.checksum);
+    TEST_CHECK(lazy.decode_count == lazy.sample_count);
+    TEST_CHECK(eager.decode_count == event_count);
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture>\n", argv[0]);
+        return 2;
+    }
+
+    static bno085_replay_hal_t replay;
+    TEST_CHECK(bno085_replay_hal_init(&replay, argv[1]) == 0);
+    if (test_failure_count > 0) {
+        return TEST_RESULT();
+    }
+
+    TEST_CHECK(sh2_open(&replay._HAL, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+    for (uint32_t i = 0; i < 10000000 && !bno085_replay_hal_eof(&replay); i += 1) {
+        sh2_service();
+    }
+    TEST_CHECK(bno085_replay_hal_eof(&replay));
+    sh2_close();
+    bno085_replay_hal_deinit(&replay);
+
+    TEST_CHECK(event_count > 0 && event_count < MAX_EVENTS);
+
+    bool subscribed[MAX_REPORT_ID] = {false};
+    subscribed[SH2_GAME_ROTATION_VECTOR] = true;
+    compare("game rotation vector subscribed", subscribed);
+
+    for (size_t idx = 0; idx < event_count; idx += 1) {
+        if (events[idx].reportId < MAX_REPORT_ID) {
+            subscribed[events[idx].reportId] = true;
+        }
+    }
+    compare("all subscribed", subscribed);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,257 @@
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_sim_hal.h"
+#include "bno085_sample_ring.h"
+#include "bno085_sh2_ops.h"
+#include "bno085_euler.h"
+
+/**
+ * Two sensors on one device, each simulated by its own bno085_sim_hal_t and run on its own SH2 instance: the default
+ * library and the renamed copy. One thread per sensor services its instance, as the poller task of each context does,
+ * and publishes the game rotation vector in the sample ring of its context. The consumer reads both rings, removes the
+ * mounting roll of each sensor and averages the two roll estimates of the same instant.
+ *
+ * The sensors are mounted with different rolls, so a sample delivered to the wrong context or an SH2 state shared by
+ * the two instances shows up in the combined estimate and in the sample counts of the contexts.
+ */
+
+#define SENSOR_COUNT 2
+#define REPORT_INTERVAL_US 2500
+#define DURATION_US 4000000
+#define SWEEP_AMPLITUDE_RAD 0.5f
+#define SWEEP_FREQUENCY_HZ 0.5f
+#define MAX_COMBINED_ERROR_RAD 1e-3     // Report quantization (Q14) and the float conversion
+#define MAX_PENDING 64
+#define READ_BATCH 8
+
+
+typedef struct {
+    float mounting_roll_rad;
+} mounting_t;
+
+
+typedef struct {
+    int64_t timestamp_us;
+    float roll;
+} estimate_t;
+
+
+typedef struct {
+    const bno085_sh2_ops_t *sh2;
+    bno085_sim_hal_t sim;
+    mounting_t mounting;
+    bno085_sample_ring_t ring;
+    uint32_t callback_count;            // Events received through the cookie of this context
+    uint32_t consumer_cursor;           // Read by the service thread to hold off while the consumer is behind
+    volatile bool done;
+
+    // Consumer side
+    uint32_t cursor;
+    uint32_t lost;
+    estimate_t pending[MAX_PENDING];
+    size_t pending_count;
+    uint32_t sample_count;
+} context_t;
+
+
+static context_t contexts[SENSOR_COUNT];
+
+
+static void profile_mounted_sweep(void *arg, uint64_t t_us, bno085_sim_motion_t *motion) {
+    const mounting_t *mounting = (const mounting_t *) arg;
+    bno085_sim_profile_static(NULL, t_us, motion);
+
+    float roll = SWEEP_AMPLITUDE_RAD * sinf(2.0f * (float) M_PI * SWEEP_FREQUENCY_HZ * t_us * 1e-6f) + mounting->mounting_roll_rad;
+    motion->real = cosf(roll * 0.5f);
+    motion->i = sinf(roll * 0.5f);
+}
+
+
+static double true_roll(int64_t t_us) {
+    return SWEEP_AMPLITUDE_RAD * sin(2.0 * M_PI * SWEEP_FREQUENCY_HZ * t_us * 1e-6);
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+}
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    context_t *ctx = (context_t *) cookie;
+    if (event->reportId != SH2_GAME_ROTATION_VECTOR) {
+        return;
+    }
+    ctx->callback_count += 1;
+    bno085_sample_ring_push(&ctx->ring, event, (int64_t) event->timestamp_uS, (int64_t) ctx->sim.now_us, true);
+}
+
+
+static void * service_thread(void *arg) {
+    context_t *ctx = (context_t *) arg;
+
+    while (ctx->sim.now_us < DURATION_US) {
+        // The test checks every sample is combined, hold off rather than let the ring overwrite the unread ones
+        while (bno085_sample_ring_get_head(&ctx->ring) - __atomic_load_n(&ctx->consumer_cursor, __ATOMIC_ACQUIRE) > BNO085_SAMPLE_RING_DEPTH / 2) {
+            sched_yield();
+        }
+        ctx->sh2->service();
+    }
+
+    __atomic_store_n(&ctx->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+
+static bool open_sensor(context_t *ctx, const bno085_sh2_ops_t *sh2, float mounting_roll_rad) {
+    memset(ctx, 0, sizeof(context_t));
+    ctx->sh2 = sh2;
+    ctx->mounting.mounting_roll_rad = mounting_roll_rad;
+    bno085_sim_hal_init(&ctx->sim, profile_mounted_sweep, &ctx->mounting);
+
+    if (sh2->open(&ctx->sim._HAL, event_callback, ctx) != SH2_OK || sh2->set_sensor_callback(sensor_callback, ctx) != SH2_OK) {
+        return false;
+    }
+
+    sh2_ProductIds_t prod_ids;
+    sh2_SensorConfig_t config = {.reportInterval_us = REPORT_INTERVAL_US};
+    return sh2->get_prod_ids(&prod_ids) == SH2_OK && sh2->set_sensor_config(SH2_GAME_ROTATION_VECTOR, &config) == SH2_OK;
+}
+
+
+/**
+ * Read the new samples of a sensor, corrected for its mounting.
+ */
+static void read_sensor(context_t *ctx) {
+    bno085_sample_slot_t slots[READ_BATCH];
+    size_t count;
+    while (ctx->pending_count + READ_BATCH <= MAX_PENDING &&
+           (count = bno085_sample_ring_read(&ctx->ring, &ctx->cursor, slots, READ_BATCH, &ctx->lost)) > 0) {
+        for (size_t i = 0; i < count; i += 1) {
+            sh2_SensorValue_t value;
+            if (sh2_decodeSensorEvent(&value, &slots[i].event) != SH2_OK) {
+                continue;
+            }
+            quaternion_t q = {
+                .real = value.un.gameRotationVector.real,
+                .i = value.un.gameRotationVector.i,
+                .j = value.un.gameRotationVector.j,
+                .k = value.un.gameRotationVector.k,
+            };
+            float roll;
+            quaternion_to_euler_f32(&q, &roll, NULL, NULL);
+
+            estimate_t *estimate = &ctx->pending[ctx->pending_count++];
+            estimate->timestamp_us = slots[i].timestamp_us;
+            estimate->roll = roll - ctx->mounting.mounting_roll_rad;
+            ctx->sample_count += 1;
+        }
+        __atomic_store_n(&ctx->consumer_cursor, ctx->cursor, __ATOMIC_RELEASE);
+    }
+}
+
+
+static void pop_estimate(context_t *ctx) {
+    ctx->pending_count -= 1;
+    memmove(ctx->pending, ctx->pending + 1, ctx->pending_count * sizeof(estimate_t));
+}
+
+
+static void test_dual_sensor(void) {
+    TEST_CHECK(open_sensor(&contexts[0], &bno085_sh2_default_ops, 0.0f));
+    TEST_CHECK(open_sensor(&contexts[1], &bno085_sh2_secondary_ops, 0.3f));
+    if (test_failure_count > 0) {
+        return;
+    }
+
+    pthread_t threads[SENSOR_COUNT];
+    for (int i = 0; i < SENSOR_COUNT; i += 1) {
+        pthread_create(&threads[i], NULL, service_thread, &contexts[i]);
+    }
+
+    // Combine the estimates of the same instant as they arrive
+    uint32_t combined_count = 0;
+    uint32_t unmatched_count = 0;
+    double max_error = 0.0;
+    bool running = true;
+    while (running) {
+        running = !__atomic_load_n(&contexts[0].done, __ATOMIC_ACQUIRE) || !__atomic_load_n(&contexts[1].done, __ATOMIC_ACQUIRE);
+        read_sensor(&contexts[0]);
+        read_sensor(&contexts[1]);
+
+        while (contexts[0].pending_count > 0 && contexts[1].pending_count > 0) {
+            const estimate_t *a = &contexts[0].pending[0];
+            const estimate_t *b = &contexts[1].pending[0];
+            if (llabs(a->timestamp_us - b->timestamp_us) <= REPORT_INTERVAL_US / 2) {
+                double combined = 0.5 * (a->roll + b->roll);
+                double error = fabs(combined - true_roll((a->timestamp_us + b->timestamp_us) / 2));
+                max_error = error > max_error ? error : max_error;
+                combined_count += 1;
+                pop_estimate(&contexts[0]);
+                pop_estimate(&contexts[1]);
+            }
+            else {
+                // Only one sensor reported at this instant
+                pop_estimate(a->timestamp_us < b->timestamp_us ? &contexts[0] : &contexts[1]);
+                unmatched_count += 1;
+            }
+        }
+
+        if (running) {
+            sched_yield();
+        }
+    }
+
+    for (int i = 0; i < SENSOR_COUNT; i += 1) {
+        pthread_join(threads[i], NULL);
+    }
+
+    printf("dual sensor: %lu and %lu samples, %lu combined, %lu unmatched, max combined roll error %.2e rad, lost %lu and %lu\n",
+           (unsigned long) contexts[0].sample_count, (unsigned long) contexts[1].sample_count, (unsigned long) combined_count,
+           (unsigned long) unmatched_count, max_error, (unsigned long) contexts[0].lost, (unsigned long) contexts[1].lost);
+
+    // Each context receives the whole stream of its own simulator, and only that
+    for (int i = 0; i < SENSOR_COUNT; i += 1) {
+        TEST_CHECK(contexts[i].callback_count == contexts[i].sim.report_count);
+        TEST_CHECK(contexts[i].callback_count > 0.95 * DURATION_US / REPORT_INTERVAL_US);
+        TEST_CHECK(contexts[i].sample_count == contexts[i].callback_count);
+        TEST_CHECK(contexts[i].lost == 0);
+    }
+
+    // Both streams combine sample for sample, the mounting roll of each is removed
+    TEST_CHECK(combined_count > 0.95 * DURATION_US / REPORT_INTERVAL_US);
+    TEST_CHECK(unmatched_count <= 2);
+    TEST_CHECK(max_error < MAX_COMBINED_ERROR_RAD);
+}
+
+
+static void test_close_one(void) {
+    // The instances keep their state apart: closing one leaves the other running
+    uint32_t callback_count[SENSOR_COUNT] = {contexts[0].callback_count, contexts[1].callback_count};
+    contexts[0].sh2->close();
+    for (int i = 0; i < 100; i += 1) {
+        contexts[1].sh2->service();
+    }
+    TEST_CHECK(contexts[0].callback_count == callback_count[0]);
+    TEST_CHECK(contexts[1].callback_count == callback_count[1] + 100);
+    contexts[1].sh2->close();
+}
+
+
+int main(void) {
+    TEST_CHECK(&bno085_sh2_default_ops != &bno085_sh2_secondary_ops);
+    TEST_CHECK(bno085_sh2_default_ops.open != bno085_sh2_secondary_ops.open);
+    TEST_CHECK(bno085_sh2_default_ops.service != bno085_sh2_secondary_ops.service);
+
+    test_dual_sensor();
+    test_close_one();
+
+    return TEST_RESULT();
+}
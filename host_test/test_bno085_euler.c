@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_euler.h"
+
+/**
+ * quaternion_to_euler_f32() against a double precision reference over the full sphere, and its speed against the
+ * three separate conversions it replaced (renormalizing in double, double libm).
+ */
+
+#define GRID_STEPS 360                  // Per angle, 1 deg on roll and yaw, 0.5 deg on pitch
+#define RANDOM_COUNT 1000000
+#define GIMBAL_LOCK_MARGIN_RAD 0.01745  // Roll and yaw are checked apart only 1 deg or more away from +-90 deg of pitch
+#define POLE_MARGIN_RAD 1.0e-3          // At the poles roll and yaw are made from two rounding errors, any rotation goes
+#define ANGLE_MAX_ERROR 2.5e-5          // Roll and yaw, the float rounding grows as cos(pitch) shrinks
+#define PITCH_MAX_ERROR 1.0e-3          // asin near +-1 amplifies the float rounding of its argument
+#define ROTATION_MAX_ERROR 5.0e-4       // Rotation of the returned angles against the quaternion, up to 1 mrad from the poles
+#define BENCHMARK_COUNT 4096
+#define BENCHMARK_ROUNDS 2000
+
+
+typedef struct {
+    double roll;
+    double pitch;
+    double yaw;
+} euler_t;
+
+
+static double wrap_difference(double a, double b) {
+    double d = fmod(a - b + M_PI, 2.0 * M_PI);
+    if (d < 0) {
+        d += 2.0 * M_PI;
+    }
+    return fabs(d - M_PI);
+}
+
+
+static void reference_euler(const quaternion_t *q, euler_t *euler) {
+    double norm = sqrt((double) q->real * q->real + (double) q->i * q->i + (double) q->j * q->j + (double) q->k * q->k);
+    double w = q->real / norm, x = q->i / norm, y = q->j / norm, z = q->k / norm;
+    euler->roll = atan2(2.0 * (w * x + y * z), 1.0 - 2.0 * (x * x + y * y));
+    euler->pitch = asin(fmax(-1.0, fmin(1.0, 2.0 * (w * y - z * x))));
+    euler->yaw = atan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z));
+}
+
+
+static void euler_to_quaternion(double roll, double pitch, double yaw, double *q) {
+    double cr = cos(roll * 0.5), sr = sin(roll * 0.5);
+    double cp = cos(pitch * 0.5), sp = sin(pitch * 0.5);
+    double cy = cos(yaw * 0.5), sy = sin(yaw * 0.5);
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+
+/**
+ * @brief Angle of the rotation between the quaternion and the one made from the angles, independent of the gimbal lock.
+ */
+static double rotation_error(const quaternion_t *q, float roll, float pitch, float yaw) {
+    double r[4];
+    euler_to_quaternion(roll, pitch, yaw, r);
+    double norm = sqrt((double) q->real * q->real + (double) q->i * q->i + (double) q->j * q->j + (double) q->k * q->k);
+    double dot = fabs((q->real * r[0] + q->i * r[1] + q->j * r[2] + q->k * r[3]) / norm);
+    return 2.0 * acos(fmin(1.0, dot));
+}
+
+
+typedef struct {
+    uint32_t count;
+    double roll;
+    double pitch;
+    double yaw;
+    double rotation;
+} errors_t;
+
+
+static void check(const quaternion_t *q, errors_t *errors) {
+    euler_t expected;
+    reference_euler(q, &expected);
+    float roll, pitch, yaw;
+    quaternion_to_euler_f32(q, &roll, &pitch, &yaw);
+
+    errors->count += 1;
+    errors->pitch = fmax(errors->pitch, fabs(pitch - expected.pitch));
+    if (fabs(expected.pitch) < M_PI_2 - POLE_MARGIN_RAD) {
+        errors->rotation = fmax(errors->rotation, rotation_error(q, roll, pitch, yaw));
+    }
+    if (fabs(expected.pitch) < M_PI_2 - GIMBAL_LOCK_MARGIN_RAD) {
+        errors->roll = fmax(errors->roll, wrap_difference(roll, expected.roll));
+        errors->yaw = fmax(errors->yaw, wrap_difference(yaw, expected.yaw));
+    }
+
+    // Each angle alone is the same as all three
+    float single;
+    quaternion_to_euler_f32(q, &single, NULL, NULL);
+    TEST_CHECK(single == roll);
+    quaternion_to_euler_f32(q, NULL, &single, NULL);
+    TEST_CHECK(single == pitch);
+    quaternion_to_euler_f32(q, NULL, NULL, &single);
+    TEST_CHECK(single == yaw);
+}
+
+
+static void report(const char *name, const errors_t *errors) {
+    printf("%s: %lu quaternions, max error roll %.3g yaw %.3g pitch %.3g rotation %.3g rad\n", name, (unsigned long) errors->count,
+           errors->roll, errors->yaw, errors->pitch, errors->rotation);
+    TEST_CHECK(errors->roll <= ANGLE_MAX_ERROR);
+    TEST_CHECK(errors->yaw <= ANGLE_MAX_ERROR);
+    TEST_CHECK(errors->pitch <= PITCH_MAX_ERROR);
+    TEST_CHECK(errors->rotation <= ROTATION_MAX_ERROR);
+}
+
+
+static void test_grid(void) {
+    // Every orientation on an angle grid, including the poles, at the scale of a unit quaternion and off it
+    errors_t errors = {0};
+    const float scales[] = {1.0f, 0.999f, 1.001f, 0.5f};
+    for (int r = 0; r <= GRID_STEPS; r += 1) {
+        for (int p = 0; p <= GRID_STEPS; p += 1) {
+            for (int y = 0; y <= GRID_STEPS; y += 8) {
+                double q[4];
+                euler_to_quaternion(-M_PI + 2.0 * M_PI * r / GRID_STEPS, -M_PI_2 + M_PI * p / GRID_STEPS,
+                                    -M_PI + 2.0 * M_PI * y / GRID_STEPS, q);
+                float scale = scales[(r + p + y) % 4];
+                quaternion_t quaternion = {scale * (float) q[0], scale * (float) q[1], scale * (float) q[2], scale * (float) q[3]};
+                check(&quaternion, &errors);
+            }
+        }
+    }
+    report("grid", &errors);
+}
+
+
+static void test_random(void) {
+    // Uniform over the rotations (normalized gaussian 4-vectors), q and -q
+    errors_t errors = {0};
+    srand(1);
+    for (int i = 0; i < RANDOM_COUNT; i += 1) {
+        double v[4];
+        for (int n = 0; n < 4; n += 2) {
+            double u1 = (rand() + 1.0) / ((double) RAND_MAX + 2.0), u2 = rand() / ((double) RAND_MAX + 1.0);
+            v[n] = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+            v[n + 1] = sqrt(-2.0 * log(u1)) * sin(2.0 * M_PI * u2);
+        }
+        double norm = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+        float sign = (i & 1) ? -1.0f : 1.0f;
+        quaternion_t q = {sign * (float) (v[0] / norm), sign * (float) (v[1] / norm), sign * (float) (v[2] / norm), sign * (float) (v[3] / norm)};
+        check(&q, &errors);
+    }
+    report("random", &errors);
+}
+
+
+/**
+ * The conversion before quaternion_to_euler_f32(), one function per angle, each renormalizing in double.
+ */
+static float legacy_roll(float dqw, float dqx, float dqy, float dqz) {
+    float norm = sqrt(dqw * dqw + dqx * dqx + dqy * dqy + dqz * dqz);
+    dqw = dqw / norm;
+    dqx = dqx / norm;
+    dqy = dqy / norm;
+    dqz = dqz / norm;
+    float ysqr = dqy * dqy;
+    float t0 = +2.0 * (dqw * dqx + dqy * dqz);
+    float t1 = +1.0 - 2.0 * (dqx * dqx + ysqr);
+    return atan2(t0, t1);
+}
+
+
+static float legacy_pitch(float dqw, float dqx, float dqy, float dqz) {
+    float norm = sqrt(dqw * dqw + dqx * dqx + dqy * dqy + dqz * dqz);
+    dqw = dqw / norm;
+    dqx = dqx / norm;
+    dqy = dqy / norm;
+    dqz = dqz / norm;
+    float t2 = +2.0 * (dqw * dqy - dqz * dqx);
+    t2 = t2 > 1.0 ? 1.0 : t2;
+    t2 = t2 < -1.0 ? -1.0 : t2;
+    return asin(t2);
+}
+
+
+static float legacy_yaw(float dqw, float dqx, float dqy, float dqz) {
+    float norm = sqrt(dqw * dqw + dqx * dqx + dqy * dqy + dqz * dqz);
+    dqw = dqw / norm;
+    dqx = dqx / norm;
+    dqy = dqy / norm;
+    dqz = dqz / norm;
+    float ysqr = dqy * dqy;
+    float t3 = +2.0 * (dqw * dqz + dqx * dqy);
+    float t4 = +1.0 - 2.0 * (ysqr + dqz * dqz);
+    return atan2(t3, t4);
+}
+
+
+static void benchmark(void) {
+    static quaternion_t inputs[BENCHMARK_COUNT];
+    for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+        double q[4];
+        euler_to_quaternion(0.001 * i, 0.0003 * i - 0.6, 0.0015 * i - 3.0, q);
+        inputs[i] = (quaternion_t) {(float) q[0], (float) q[1], (float) q[2], (float) q[3]};
+    }
+
+    volatile float sink = 0;
+    int64_t start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            const quaternion_t *q = &inputs[i];
+            sink += legacy_roll(q->real, q->i, q->j, q->k) + legacy_pitch(q->real, q->i, q->j, q->k) + legacy_yaw(q->real, q->i, q->j, q->k);
+        }
+    }
+    double legacy_ns = (double) (test_time_ns() - start_ns) / ((double) BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+
+    start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            float roll, pitch, yaw;
+            quaternion_to_euler_f32(&inputs[i], &roll, &pitch, &yaw);
+            sink += roll + pitch + yaw;
+        }
+    }
+    double fused_ns = (double) (test_time_ns() - start_ns) / ((double) BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+    (void) sink;
+
+    printf("roll, pitch and yaw: %.1f ns per quaternion fused, %.1f ns as three double precision conversions\n", fused_ns, legacy_ns);
+}
+
+
+int main(void) {
+    test_grid();
+    test_random();
+    benchmark();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_replay_hal.h"
+#include "bno085_fusion.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Replays a capture through the replay HAL and the SH2 library, feeds the gyroscope and accelerometer reports to
+ * bno085_fusion, and compares its roll and pitch against the game rotation vector of the same capture. Then runs the
+ * filter over the recorded inputs again to measure the cost of an update. Built once per arithmetic, see
+ * BNO085_FUSION_FIXED_POINT.
+ *
+ *   test_bno085_fusion_replay <capture> [max_error_deg]
+ *
+ * The capture needs the calibrated gyroscope, the accelerometer and the game rotation vector, like the checked-in roll
+ * sweep (see bno085_sim_record.c).
+ */
+
+#define MAX_SAMPLES 65536
+#define WARMUP_US 500000                // Not compared until the filter had time to settle
+#define BENCHMARK_PASSES 200
+
+#if BNO085_FUSION_FIXED_POINT
+    #define ARITHMETIC "Q4.28"
+#else
+    #define ARITHMETIC "float"
+#endif  // BNO085_FUSION_FIXED_POINT
+
+
+typedef struct {
+    uint8_t report_id;
+    int64_t timestamp_us;
+    float value[4];
+} sample_t;
+
+
+static sample_t samples[MAX_SAMPLES];
+static size_t sample_count;
+static uint32_t decode_failures;
+
+
+/**
+ * @brief Cycle counter where the host has one, ns otherwise.
+ */
+static inline uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t) test_time_ns();
+#endif
+}
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    sh2_SensorValue_t value;
+    if (sh2_decodeSensorEvent(&value, event) != SH2_OK) {
+        decode_failures += 1;
+        return;
+    }
+    if (sample_count >= MAX_SAMPLES) {
+        return;
+    }
+
+    sample_t *sample = &samples[sample_count];
+    sample->report_id = event->reportId;
+    sample->timestamp_us = (int64_t) event->timestamp_uS;
+
+    switch (event->reportId) {
+        case SH2_ACCELEROMETER:
+            sample->value[0] = value.un.accelerometer.x;
+            sample->value[1] = value.un.accelerometer.y;
+            sample->value[2] = value.un.accelerometer.z;
+            break;
+        case SH2_GYROSCOPE_CALIBRATED:
+            sample->value[0] = value.un.gyroscope.x;
+            sample->value[1] = value.un.gyroscope.y;
+            sample->value[2] = value.un.gyroscope.z;
+            break;
+        case SH2_GAME_ROTATION_VECTOR:
+            sample->value[0] = value.un.gameRotationVector.real;
+            sample->value[1] = value.un.gameRotationVector.i;
+            sample->value[2] = value.un.gameRotationVector.j;
+            sample->value[3] = value.un.gameRotationVector.k;
+            break;
+        default:
+            return;
+    }
+    sample_count += 1;
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+}
+
+
+static float wrap_angle(float angle) {
+    while (angle > (float) M_PI) angle -= 2.0f * (float) M_PI;
+    while (angle < -(float) M_PI) angle += 2.0f * (float) M_PI;
+    return angle;
+}
+
+
+/**
+ * Fusion against the game rotation vector, at every game rotation vector sample after the warm-up.
+ */
+static void check_accuracy(const bno085_fusion_config_t *config, float max_error_deg) {
+    bno085_fusion_t fusion;
+    bno085_fusion_init(&fusion, config);
+
+    int64_t start_us = -1;
+    uint32_t compare_count = 0;
+    double sum_sqr_error = 0;
+    float max_roll_error = 0, max_pitch_error = 0;
+
+    for (size_t idx = 0; idx < sample_count; idx += 1) {
+        const sample_t *sample = &samples[idx];
+        if (start_us < 0) {
+            start_us = sample->timestamp_us;
+        }
+
+        if (sample->report_id == SH2_ACCELEROMETER) {
+            bno085_fusion_update_accelerometer(&fusion, sample->timestamp_us, sample->value[0], sample->value[1], sample->value[2]);
+        }
+        else if (sample->report_id == SH2_GYROSCOPE_CALIBRATED) {
+            bno085_fusion_update_gyroscope(&fusion, sample->timestamp_us, sample->value[0], sample->value[1], sample->value[2]);
+        }
+        else if (sample->report_id == SH2_GAME_ROTATION_VECTOR && sample->timestamp_us - start_us >= WARMUP_US && fusion.aligned) {
+            float w = sample->value[0], x = sample->value[1], y = sample->value[2], z = sample->value[3];
+            float reference_roll = atan2f(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+            float reference_pitch = asinf(fmaxf(-1.0f, fminf(1.0f, 2.0f * (w * y - z * x))));
+
+            float roll, pitch;
+            bno085_fusion_get_roll_pitch(&fusion, &roll, &pitch);
+            float roll_error = fabsf(wrap_angle(roll - reference_roll));
+            float pitch_error = fabsf(pitch - reference_pitch);
+
+            max_roll_error = fmaxf(max_roll_error, roll_error);
+            max_pitch_error = fmaxf(max_pitch_error, pitch_error);
+            sum_sqr_error += roll_error * roll_error;
+            compare_count += 1;
+        }
+    }
+
+    float rms_roll_error = compare_count > 0 ? (float) sqrt(sum_sqr_error / compare_count) : 0.0f;
+    printf("%s: %lu updates, %lu compared to the game rotation vector, roll error rms %.3f deg max %.3f deg, pitch error max %.3f deg\n",
+           ARITHMETIC, (unsigned long) fusion.update_count, (unsigned long) compare_count, rms_roll_error * 180.0f / (float) M_PI,
+           max_roll_error * 180.0f / (float) M_PI, max_pitch_error * 180.0f / (float) M_PI);
+
+    TEST_CHECK(fusion.update_count > 0);
+    TEST_CHECK(compare_count > 0);
+    TEST_CHECK(max_roll_error * 180.0f / (float) M_PI < max_error_deg);
+    TEST_CHECK(max_pitch_error * 180.0f / (float) M_PI < max_error_deg);
+}
+
+
+/**
+ * Cost of the updates alone, over the recorded inputs without the comparison.
+ */
+static void benchmark(const bno085_fusion_config_t *config) {
+    bno085_fusion_t fusion;
+    uint64_t gyro_cycles = 0, accel_cycles = 0;
+    uint32_t gyro_count = 0, accel_count = 0;
+    int64_t start_ns = test_time_ns();
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass += 1) {
+        bno085_fusion_init(&fusion, config);
+
+        for (size_t idx = 0; idx < sample_count; idx += 1) {
+            const sample_t *sample = &samples[idx];
+            if (sample->report_id == SH2_ACCELEROMETER) {
+                uint64_t start = read_cycles();
+                bno085_fusion_update_accelerometer(&fusion, sample->timestamp_us, sample->value[0], sample->value[1], sample->value[2]);
+                accel_cycles += read_cycles() - start;
+                accel_count += 1;
+            }
+            else if (sample->report_id == SH2_GYROSCOPE_CALIBRATED) {
+                uint64_t start = read_cycles();
+                bno085_fusion_update_gyroscope(&fusion, sample->timestamp_us, sample->value[0], sample->value[1], sample->value[2]);
+                gyro_cycles += read_cycles() - start;
+                gyro_count += 1;
+            }
+        }
+    }
+
+    int64_t elapsed_ns = test_time_ns() - start_ns;
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "TSC cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("%s: %.1f %s per gyroscope update, %.1f %s per accelerometer update, %.1f ns per sample overall\n", ARITHMETIC,
+           gyro_count ? (double) gyro_cycles / gyro_count : 0.0, unit, accel_count ? (double) accel_cycles / accel_count : 0.0, unit,
+           (double) elapsed_ns / (gyro_count + accel_count + 1));
+    TEST_CHECK(gyro_count > 0);
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture> [max_error_deg]\n", argv[0]);
+        return 2;
+    }
+    float max_error_deg = argc > 2 ? strtof(argv[2], NULL) : 1.0f;
+
+    static bno085_replay_hal_t replay;
+    TEST_CHECK(bno085_replay_hal_init(&replay, argv[1]) == 0);
+    if (test_failure_count > 0) {
+        return TEST_RESULT();
+    }
+
+    TEST_CHECK(sh2_open(&replay._HAL, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+    for (uint32_t i = 0; i < 10000000 && !bno085_replay_hal_eof(&replay); i += 1) {
+        sh2_service();
+    }
+    TEST_CHECK(bno085_replay_hal_eof(&replay));
+    sh2_close();
+    bno085_replay_hal_deinit(&replay);
+
+    TEST_CHECK(decode_failures == 0);
+    TEST_CHECK(sample_count < MAX_SAMPLES);
+    printf("%lu samples replayed\n", (unsigned long) sample_count);
+
+    bno085_fusion_config_t config = {
+        .beta = BNO085_FUSION_DEFAULT_BETA,
+        .output_interval_us = 0,
+    };
+    check_accuracy(&config, max_error_deg);
+    benchmark(&config);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_i2c_reader.h"
+#include "bno085_shtp_log.h"
+
+/**
+ * Speculative I2C reads against a mocked `i2c_master_receive`, serving the SHTP packets of a capture the way the
+ * BNO085 does: every read transaction starts with a header, a read shorter than the packet leaves the rest to the next
+ * transaction behind a continuation header, a read longer than the packet is padded. The packets must come out
+ * unchanged, in little more than half the transactions of the header-then-packet reads the driver used before and in
+ * less bus time. The reader takes a second transaction where that costs less than reading past the smaller packets.
+ *
+ *   test_bno085_i2c_reader [capture]
+ *
+ * A synthetic stream of the reports of a recoil capture is read first, then the capture if given.
+ */
+
+#define SHTP_HEADER_SIZE 4
+#define SHTP_CONTINUATION_BIT 0x8000
+#define MAX_PACKET_SIZE 1024
+#define MAX_PACKETS 16384
+#define SH2_BUFFER_SIZE 384             // SH2_HAL_MAX_TRANSFER_IN, the size the SH2 library passes to the HAL read
+#define I2C_CLOCK_HZ 400000
+#define I2C_TRANSACTION_OVERHEAD_BITS 20    // START, address and ACK, STOP and the bus free time
+#define MAX_TRANSACTION_RATIO 0.65      // Against the header-then-packet reads
+#define MAX_BUS_TIME_RATIO 0.9
+
+
+typedef struct {
+    uint8_t data[MAX_PACKET_SIZE];
+    uint16_t len;
+} packet_t;
+
+
+static packet_t packets[MAX_PACKETS];
+static size_t packet_count;
+
+
+/**
+ * Mocked device, see the file comment.
+ */
+typedef struct {
+    size_t packet_idx;                  // Packet being read
+    uint16_t offset;                    // Payload bytes of the packet already read
+    uint32_t transaction_count;
+    uint32_t byte_count;
+    int32_t fail_at_transaction;        // Fail this transaction, -1 for never
+} mock_bus_t;
+
+
+static int mock_receive(void *arg, uint8_t *buffer, size_t size) {
+    mock_bus_t *bus = (mock_bus_t *) arg;
+    if ((int32_t) bus->transaction_count == bus->fail_at_transaction) {
+        bus->fail_at_transaction = -1;
+        return -1;
+    }
+    bus->transaction_count += 1;
+    bus->byte_count += size;
+    memset(buffer, 0, size);
+
+    if (bus->packet_idx >= packet_count || size < SHTP_HEADER_SIZE) {
+        return 0;
+    }
+
+    const packet_t *packet = &packets[bus->packet_idx];
+    uint16_t remaining = packet->len - SHTP_HEADER_SIZE - bus->offset;
+    memcpy(buffer, packet->data, SHTP_HEADER_SIZE);
+    if (bus->offset > 0) {
+        uint16_t continuation_len = (remaining + SHTP_HEADER_SIZE) | SHTP_CONTINUATION_BIT;
+        buffer[0] = continuation_len & 0xFF;
+        buffer[1] = continuation_len >> 8;
+    }
+
+    size_t copy = size - SHTP_HEADER_SIZE < remaining ? size - SHTP_HEADER_SIZE : remaining;
+    memcpy(buffer + SHTP_HEADER_SIZE, packet->data + SHTP_HEADER_SIZE + bus->offset, copy);
+    bus->offset += copy;
+    if (bus->offset == packet->len - SHTP_HEADER_SIZE) {
+        bus->packet_idx += 1;
+        bus->offset = 0;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief The reads before the speculative reader: the header alone, then the whole packet again.
+ */
+static int legacy_read(mock_bus_t *bus, uint8_t *buffer, unsigned len) {
+    uint8_t header[SHTP_HEADER_SIZE];
+    if (mock_receive(bus, header, SHTP_HEADER_SIZE) != 0) {
+        return -1;
+    }
+    uint16_t packet_size = ((uint16_t) header[0] + ((uint16_t) header[1] << 8)) & ~SHTP_CONTINUATION_BIT;
+    if (packet_size == 0 || len < packet_size) {
+        return 0;
+    }
+    return mock_receive(bus, buffer, packet_size) == 0 ? packet_size : -1;
+}
+
+
+static void add_packet(const uint8_t *data, uint16_t len) {
+    if (packet_count < MAX_PACKETS && len <= MAX_PACKET_SIZE) {
+        memcpy(packets[packet_count].data, data, len);
+        packets[packet_count].len = len;
+        packet_count += 1;
+    }
+}
+
+
+static bool load_capture(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint8_t file_header[BNO085_SHTP_LOG_FILE_HEADER_SIZE];
+    bool valid = fread(file_header, 1, sizeof(file_header), file) == sizeof(file_header) && bno085_shtp_log_check_file_header(file_header);
+
+    uint8_t record_header[BNO085_SHTP_LOG_RECORD_HEADER_SIZE];
+    while (valid && fread(record_header, 1, sizeof(record_header), file) == sizeof(record_header)) {
+        uint32_t t_us;
+        uint16_t len;
+        bno085_shtp_log_decode_record_header(record_header, &t_us, &len);
+
+        uint8_t data[MAX_PACKET_SIZE];
+        if (len > sizeof(data) || fread(data, 1, len, file) != len) {
+            valid = false;
+            break;
+        }
+        if (len > SHTP_HEADER_SIZE) {
+            add_packet(data, len);
+        }
+    }
+
+    fclose(file);
+    return valid && packet_count > 0;
+}
+
+
+static void add_synthetic_packet(uint8_t channel, uint16_t len) {
+    static uint8_t sequence[6];
+    uint8_t data[MAX_PACKET_SIZE];
+    data[0] = len & 0xFF;
+    data[1] = len >> 8;
+    data[2] = channel;
+    data[3] = sequence[channel]++;
+    for (uint16_t n = SHTP_HEADER_SIZE; n < len; n += 1) {
+        data[n] = (uint8_t) rand();
+    }
+    add_packet(data, len);
+}
+
+
+static void make_synthetic_stream(void) {
+    // The report mix of a recoil capture: linear acceleration at 400 Hz, the game rotation vector at 50 Hz, the
+    // stability classifier at 10 Hz, after the command responses of the start up (product IDs, FRS records). Now and
+    // then the poller falls behind and two periods come in one packet.
+    srand(1);
+    add_synthetic_packet(2, 84);
+    add_synthetic_packet(2, 276);
+    add_synthetic_packet(2, 20);
+
+    for (int period = 0; period < 4000; period += 1) {
+        uint16_t len = SHTP_HEADER_SIZE + 5 + 10;
+        len += period % 8 == 0 ? 12 : 0;
+        len += period % 40 == 0 ? 6 : 0;
+        if (rand() % 100 < 2) {
+            len += 5 + 10;
+            period += 1;
+        }
+        add_synthetic_packet(3, len);
+    }
+}
+
+
+static uint32_t read_all(mock_bus_t *bus, bno085_i2c_reader_t *reader) {
+    uint32_t mismatch_count = 0;
+    for (size_t idx = 0; idx < packet_count; idx += 1) {
+        uint8_t buffer[SH2_BUFFER_SIZE];
+        int len = reader ? bno085_i2c_reader_read(reader, mock_receive, bus, buffer, sizeof(buffer)) : legacy_read(bus, buffer, sizeof(buffer));
+        if (len != packets[idx].len || memcmp(buffer, packets[idx].data, len) != 0) {
+            mismatch_count += 1;
+        }
+    }
+    return mismatch_count;
+}
+
+
+static double bus_time_us(const mock_bus_t *bus) {
+    return ((double) bus->transaction_count * I2C_TRANSACTION_OVERHEAD_BITS + (double) bus->byte_count * 9) * 1e6 / I2C_CLOCK_HZ;
+}
+
+
+static void test_stream(const char *name) {
+    mock_bus_t legacy_bus = {.fail_at_transaction = -1};
+    TEST_CHECK(read_all(&legacy_bus, NULL) == 0);
+    TEST_CHECK(legacy_bus.packet_idx == packet_count);
+
+    mock_bus_t bus = {.fail_at_transaction = -1};
+    bno085_i2c_reader_t reader;
+    bno085_i2c_reader_init(&reader);
+    uint32_t mismatch_count = read_all(&bus, &reader);
+    TEST_CHECK(mismatch_count == 0);
+    TEST_CHECK(bus.packet_idx == packet_count);
+
+    // The counters agree with the bus
+    const bno085_i2c_transfer_stats_t *stats = &reader.transfer_stats;
+    TEST_CHECK(stats->packet_count == packet_count);
+    TEST_CHECK(stats->transaction_count == bus.transaction_count);
+    TEST_CHECK(stats->byte_count == bus.byte_count);
+    uint64_t packet_bytes = 0;
+    for (size_t idx = 0; idx < packet_count; idx += 1) {
+        packet_bytes += packets[idx].len;
+    }
+    TEST_CHECK(stats->byte_count - stats->wasted_byte_count == packet_bytes);
+
+    double ratio = (double) bus.transaction_count / legacy_bus.transaction_count;
+    printf("%s: %lu packets, header then packet %lu transactions %lu bytes %.1f us of bus per packet, speculative %lu transactions %lu bytes (%lu wasted) %.1f us of bus per packet\n",
+           name, (unsigned long) packet_count, (unsigned long) legacy_bus.transaction_count, (unsigned long) legacy_bus.byte_count,
+           bus_time_us(&legacy_bus) / packet_count, (unsigned long) bus.transaction_count, (unsigned long) bus.byte_count,
+           (unsigned long) stats->wasted_byte_count, bus_time_us(&bus) / packet_count);
+    TEST_CHECK(ratio <= MAX_TRANSACTION_RATIO);
+    TEST_CHECK(bus_time_us(&bus) < MAX_BUS_TIME_RATIO * bus_time_us(&legacy_bus));
+}
+
+
+static void test_edge_cases(void) {
+    uint8_t data[300];
+    memset(data, 0xA5, sizeof(data));
+    packet_count = 0;
+
+    // Sized after the first packet, grows past the largest read for the odd command response, then back
+    uint16_t lens[] = {21, 21, 280, 21, 19, 21};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i += 1) {
+        data[0] = lens[i] & 0xFF;
+        data[1] = lens[i] >> 8;
+        data[3] = (uint8_t) i;
+        add_packet(data, lens[i]);
+    }
+
+    mock_bus_t bus = {.fail_at_transaction = -1};
+    bno085_i2c_reader_t reader;
+    bno085_i2c_reader_init(&reader);
+    uint32_t expected_transactions[] = {2, 1, 2, 1, 1, 1};
+    for (size_t i = 0; i < packet_count; i += 1) {
+        uint32_t before = bus.transaction_count;
+        uint8_t buffer[SH2_BUFFER_SIZE];
+        TEST_CHECK(bno085_i2c_reader_read(&reader, mock_receive, &bus, buffer, sizeof(buffer)) == packets[i].len);
+        TEST_CHECK(memcmp(buffer, packets[i].data, packets[i].len) == 0);
+        TEST_CHECK(bus.transaction_count - before == expected_transactions[i]);
+    }
+
+    // Nothing pending
+    uint8_t buffer[SH2_BUFFER_SIZE];
+    TEST_CHECK(bno085_i2c_reader_read(&reader, mock_receive, &bus, buffer, sizeof(buffer)) == 0);
+    TEST_CHECK(reader.transfer_stats.packet_count == packet_count);
+
+    // A failed transaction is reported, in the first and in the continuation read
+    bus = (mock_bus_t) {.fail_at_transaction = 0};
+    bno085_i2c_reader_init(&reader);
+    TEST_CHECK(bno085_i2c_reader_read(&reader, mock_receive, &bus, buffer, sizeof(buffer)) == -1);
+    bus = (mock_bus_t) {.packet_idx = 2, .fail_at_transaction = 1};
+    TEST_CHECK(bno085_i2c_reader_read(&reader, mock_receive, &bus, buffer, sizeof(buffer)) == -1);
+    TEST_CHECK(reader.transfer_stats.packet_count == 0);
+
+    // Too big for the buffer
+    bus = (mock_bus_t) {.packet_idx = 2, .fail_at_transaction = -1};
+    bno085_i2c_reader_init(&reader);
+    TEST_CHECK(bno085_i2c_reader_read(&reader, mock_receive, &bus, buffer, 64) == 0);
+}
+
+
+int main(int argc, char **argv) {
+    test_edge_cases();
+
+    packet_count = 0;
+    make_synthetic_stream();
+    test_stream("synthetic");
+
+    if (argc > 1) {
+        packet_count = 0;
+        TEST_CHECK(load_capture(argv[1]));
+        test_stream("capture");
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_recovery.h"
+
+/**
+ * Recovery state machine of the driver: escalation of the resets, timeouts, stall detection and statistics.
+ */
+
+#define RESET_TIMEOUT_US (BNO085_RECOVERY_RESET_TIMEOUT_MS * 1000ll)
+
+
+static bno085_recovery_t recovery;
+static bno085_recovery_stats_t stats;
+
+
+static void init(int64_t now_us) {
+    memset(&stats, 0, sizeof(stats));
+    bno085_recovery_init(&recovery, &stats, now_us);
+}
+
+
+static void test_escalation(void) {
+    init(0);
+
+    TEST_CHECK(bno085_recovery_request(&recovery, 1000));
+    TEST_CHECK(!bno085_recovery_request(&recovery, 1500));  // Already recovering
+    TEST_CHECK(stats.fault_count == 1);
+
+    // Soft resets first, then the reset pin, each given the reset timeout
+    int64_t now_us = 2000;
+    for (int attempt = 0; attempt < BNO085_RECOVERY_SOFT_RESET_ATTEMPTS; attempt += 1) {
+        TEST_CHECK(bno085_recovery_step(&recovery, now_us, true, true) == BNO085_RECOVERY_ACTION_SOFT_RESET);
+        TEST_CHECK(recovery.state == BNO085_RECOVERY_SOFT_RESET);
+        TEST_CHECK(bno085_recovery_step(&recovery, now_us + RESET_TIMEOUT_US, true, true) == BNO085_RECOVERY_ACTION_NONE);
+        now_us += RESET_TIMEOUT_US + 1;
+        TEST_CHECK(bno085_recovery_step(&recovery, now_us, true, true) == BNO085_RECOVERY_ACTION_ESCALATE);
+    }
+    TEST_CHECK(bno085_recovery_step(&recovery, now_us, true, true) == BNO085_RECOVERY_ACTION_HARD_RESET);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_HARD_RESET);
+    TEST_CHECK(stats.soft_reset_count == BNO085_RECOVERY_SOFT_RESET_ATTEMPTS);
+    TEST_CHECK(stats.hard_reset_count == 1);
+    TEST_CHECK(stats.soft_reset_us == BNO085_RECOVERY_SOFT_RESET_ATTEMPTS * (RESET_TIMEOUT_US + 1));
+
+    // The sensor comes back 300 ms after the hardware reset
+    TEST_CHECK(!bno085_recovery_on_reset(&recovery, now_us + 300000));
+    TEST_CHECK(stats.hard_reset_us == 300000);
+    TEST_CHECK(bno085_recovery_step(&recovery, now_us + 300000, true, true) == BNO085_RECOVERY_ACTION_RECONFIGURE);
+    TEST_CHECK(bno085_recovery_finish(&recovery, now_us + 310000) == now_us + 310000 - 1000);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_IDLE);
+    TEST_CHECK(stats.recovery_count == 1);
+    TEST_CHECK(stats.unexpected_reset_count == 0);
+    TEST_CHECK(stats.max_recovery_us == stats.last_recovery_us);
+}
+
+
+static void test_soft_reset_only(void) {
+    // Without a reset pin the soft reset is repeated
+    init(0);
+    TEST_CHECK(bno085_recovery_request(&recovery, 0));
+
+    int64_t now_us = 0;
+    for (int attempt = 0; attempt < BNO085_RECOVERY_SOFT_RESET_ATTEMPTS + 3; attempt += 1) {
+        TEST_CHECK(bno085_recovery_step(&recovery, now_us, true, false) == BNO085_RECOVERY_ACTION_SOFT_RESET);
+        now_us += RESET_TIMEOUT_US + 1;
+        TEST_CHECK(bno085_recovery_step(&recovery, now_us, true, false) == BNO085_RECOVERY_ACTION_ESCALATE);
+    }
+    TEST_CHECK(stats.hard_reset_count == 0);
+    TEST_CHECK(stats.soft_reset_count == BNO085_RECOVERY_SOFT_RESET_ATTEMPTS + 3);
+}
+
+
+static void test_no_reset(void) {
+    // Nothing to reset with, wait for the sensor to reset by itself
+    init(0);
+    TEST_CHECK(bno085_recovery_request(&recovery, 0));
+    TEST_CHECK(bno085_recovery_step(&recovery, 0, false, false) == BNO085_RECOVERY_ACTION_NO_RESET);
+    TEST_CHECK(bno085_recovery_step(&recovery, RESET_TIMEOUT_US + 1, false, false) == BNO085_RECOVERY_ACTION_ESCALATE);
+    TEST_CHECK(bno085_recovery_step(&recovery, RESET_TIMEOUT_US + 1, false, false) == BNO085_RECOVERY_ACTION_NO_RESET);
+    TEST_CHECK(!bno085_recovery_on_reset(&recovery, RESET_TIMEOUT_US + 5000));
+    TEST_CHECK(bno085_recovery_step(&recovery, RESET_TIMEOUT_US + 5000, false, false) == BNO085_RECOVERY_ACTION_RECONFIGURE);
+    bno085_recovery_finish(&recovery, RESET_TIMEOUT_US + 6000);
+    TEST_CHECK(stats.soft_reset_count == 0);
+    TEST_CHECK(stats.hard_reset_count == 0);
+    TEST_CHECK(stats.recovery_count == 1);
+}
+
+
+static void test_reset_failed(void) {
+    // A reset that could not be sent is retried on the next step, and counts as an attempt
+    init(0);
+    TEST_CHECK(bno085_recovery_request(&recovery, 0));
+    TEST_CHECK(bno085_recovery_step(&recovery, 0, true, true) == BNO085_RECOVERY_ACTION_SOFT_RESET);
+    bno085_recovery_reset_failed(&recovery);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_REQUESTED);
+    TEST_CHECK(bno085_recovery_step(&recovery, 50000, true, true) == BNO085_RECOVERY_ACTION_SOFT_RESET);
+    TEST_CHECK(recovery.attempt == 2);
+}
+
+
+static void test_unexpected_reset(void) {
+    init(0);
+    TEST_CHECK(bno085_recovery_on_reset(&recovery, 5000));
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_RECONFIGURE);
+    TEST_CHECK(stats.unexpected_reset_count == 1);
+    TEST_CHECK(stats.fault_count == 0);
+
+    // Faults while restoring the configs don't restart the recovery
+    TEST_CHECK(!bno085_recovery_request(&recovery, 5500));
+    TEST_CHECK(bno085_recovery_step(&recovery, 6000, true, true) == BNO085_RECOVERY_ACTION_RECONFIGURE);
+    TEST_CHECK(bno085_recovery_finish(&recovery, 7000) == 2000);
+    TEST_CHECK(stats.soft_reset_count == 0);
+    TEST_CHECK(stats.hard_reset_count == 0);
+}
+
+
+static void test_stall(void) {
+    // Timeout follows the fastest report, with a floor
+    TEST_CHECK(bno085_recovery_stall_timeout_us(2500) == BNO085_STALL_TIMEOUT_MS * 1000ll);
+    TEST_CHECK(bno085_recovery_stall_timeout_us(1000000) == 1000000ll * BNO085_STALL_INTERVAL_FACTOR);
+
+    int64_t timeout_us = bno085_recovery_stall_timeout_us(2500);
+    init(0);
+
+    // Packets keep the timer from expiring
+    for (int64_t t_us = 0; t_us < 10 * timeout_us; t_us += 2500) {
+        bno085_recovery_kick(&recovery, t_us);
+        TEST_CHECK(!bno085_recovery_check_stall(&recovery, t_us, timeout_us));
+    }
+    int64_t last_us = 10 * timeout_us - 2500;
+
+    TEST_CHECK(!bno085_recovery_check_stall(&recovery, last_us + timeout_us - 1, timeout_us));
+    TEST_CHECK(bno085_recovery_check_stall(&recovery, last_us + timeout_us, timeout_us));
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_REQUESTED);
+    TEST_CHECK(stats.stall_count == 1);
+    TEST_CHECK(stats.fault_count == 1);
+
+    // Checked only while idle
+    TEST_CHECK(!bno085_recovery_check_stall(&recovery, last_us + 3 * timeout_us, timeout_us));
+    TEST_CHECK(stats.stall_count == 1);
+
+    // The timer restarts once recovered
+    bno085_recovery_on_reset(&recovery, last_us + 3 * timeout_us);
+    bno085_recovery_finish(&recovery, last_us + 3 * timeout_us);
+    TEST_CHECK(!bno085_recovery_check_stall(&recovery, last_us + 4 * timeout_us - 1, timeout_us));
+}
+
+
+int main(void) {
+    test_escalation();
+    test_soft_reset_only();
+    test_no_reset();
+    test_reset_failed();
+    test_unexpected_reset();
+    test_stall();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_replay_hal.h"
+#include "bno085_shtp_log.h"
+
+/**
+ * Replays a capture through the replay HAL and the SH2 library, and checks every input report of the capture reaches
+ * the sensor callback decoded, in order and with the recorded timestamps.
+ *
+ *   test_bno085_replay <capture> [max_roll_deg]
+ *
+ * The checked-in capture is a roll sweep recorded from the simulator (see bno085_sim_record.c).
+ */
+
+#define SHTP_HEADER_SIZE 4
+#define SHTP_CHANNEL_INPUT 3
+#define SH2_BASE_TIMESTAMP_REPORT 0xFB
+#define SH2_BASE_TIMESTAMP_REPORT_SIZE 5
+#define MAX_REPORT_ID 0x30
+
+
+static uint32_t expected_count[MAX_REPORT_ID];
+static uint32_t received_count[MAX_REPORT_ID];
+static uint32_t reset_count;
+static uint32_t feature_response_count;
+static uint32_t decode_failures;
+static uint32_t out_of_order;
+static uint64_t last_timestamp_us[MAX_REPORT_ID];
+static float max_roll_rad;
+static float max_norm_error;
+
+
+static uint8_t report_length(uint8_t report_id) {
+    switch (report_id) {
+        case SH2_ACCELEROMETER:
+        case SH2_GYROSCOPE_CALIBRATED:
+        case SH2_LINEAR_ACCELERATION:
+            return 10;
+        case SH2_GAME_ROTATION_VECTOR:
+            return 12;
+        case SH2_ROTATION_VECTOR:
+            return 14;
+        case SH2_STABILITY_DETECTOR:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Count the input reports of the capture without SH2, as the reference.
+ */
+static bool scan_capture(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint8_t file_header[BNO085_SHTP_LOG_FILE_HEADER_SIZE];
+    bool valid = fread(file_header, 1, sizeof(file_header), file) == sizeof(file_header) && bno085_shtp_log_check_file_header(file_header);
+
+    uint8_t record_header[BNO085_SHTP_LOG_RECORD_HEADER_SIZE];
+    while (valid && fread(record_header, 1, sizeof(record_header), file) == sizeof(record_header)) {
+        uint32_t t_us;
+        uint16_t len;
+        bno085_shtp_log_decode_record_header(record_header, &t_us, &len);
+
+        uint8_t packet[1024];
+        if (len > sizeof(packet) || fread(packet, 1, len, file) != len) {
+            valid = false;
+            break;
+        }
+        if (len <= SHTP_HEADER_SIZE || packet[2] != SHTP_CHANNEL_INPUT) {
+            continue;
+        }
+
+        uint16_t offset = SHTP_HEADER_SIZE;
+        while (offset < len) {
+            uint8_t report_id = packet[offset];
+            uint8_t report_len = report_id == SH2_BASE_TIMESTAMP_REPORT ? SH2_BASE_TIMESTAMP_REPORT_SIZE : report_length(report_id);
+            if (report_len == 0) {
+                break;
+            }
+            if (report_id != SH2_BASE_TIMESTAMP_REPORT) {
+                expected_count[report_id] += 1;
+            }
+            offset += report_len;
+        }
+    }
+
+    fclose(file);
+    return valid;
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+    if (event->eventId == SH2_RESET) {
+        reset_count += 1;
+    }
+    else if (event->eventId == SH2_GET_FEATURE_RESP) {
+        feature_response_count += 1;
+    }
+}
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    if (event->reportId >= MAX_REPORT_ID) {
+        return;
+    }
+    received_count[event->reportId] += 1;
+
+    if (event->timestamp_uS < last_timestamp_us[event->reportId]) {
+        out_of_order += 1;
+    }
+    last_timestamp_us[event->reportId] = event->timestamp_uS;
+
+    sh2_SensorValue_t value;
+    if (sh2_decodeSensorEvent(&value, event) != SH2_OK) {
+        decode_failures += 1;
+        return;
+    }
+
+    if (event->reportId == SH2_GAME_ROTATION_VECTOR) {
+        const sh2_RotationVector_t *q = &value.un.gameRotationVector;
+        float norm = sqrtf(q->real * q->real + q->i * q->i + q->j * q->j + q->k * q->k);
+        max_norm_error = fabsf(norm - 1.0f) > max_norm_error ? fabsf(norm - 1.0f) : max_norm_error;
+
+        float roll = atan2f(2.0f * (q->real * q->i + q->j * q->k), 1.0f - 2.0f * (q->i * q->i + q->j * q->j));
+        max_roll_rad = fabsf(roll) > max_roll_rad ? fabsf(roll) : max_roll_rad;
+    }
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture> [max_roll_deg]\n", argv[0]);
+        return 2;
+    }
+    float expected_max_roll_deg = argc > 2 ? strtof(argv[2], NULL) : 0.0f;
+
+    TEST_CHECK(scan_capture(argv[1]));
+
+    static bno085_replay_hal_t replay;
+    TEST_CHECK(bno085_replay_hal_init(&replay, argv[1]) == 0);
+    if (test_failure_count > 0) {
+        return TEST_RESULT();
+    }
+
+    TEST_CHECK(sh2_open(&replay._HAL, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+
+    // Service until the capture is exhausted, bounded in case the replay stops making progress
+    for (uint32_t i = 0; i < 10000000 && !bno085_replay_hal_eof(&replay); i += 1) {
+        sh2_service();
+    }
+    TEST_CHECK(bno085_replay_hal_eof(&replay));
+    sh2_close();
+
+    printf("%lu packets replayed, %lu skipped, %lu resets, %lu feature responses\n", (unsigned long) replay.packet_count,
+           (unsigned long) replay.skipped_count, (unsigned long) reset_count, (unsigned long) feature_response_count);
+
+    uint32_t total = 0;
+    bool counts_match = true;
+    for (int report_id = 0; report_id < MAX_REPORT_ID; report_id += 1) {
+        if (expected_count[report_id] == 0 && received_count[report_id] == 0) {
+            continue;
+        }
+        printf("report 0x%02x: %lu in the capture, %lu received\n", report_id, (unsigned long) expected_count[report_id], (unsigned long) received_count[report_id]);
+        counts_match &= expected_count[report_id] == received_count[report_id];
+        total += received_count[report_id];
+    }
+
+    TEST_CHECK(total > 0);
+    TEST_CHECK(counts_match);
+    TEST_CHECK(replay.skipped_count == 0);
+    TEST_CHECK(reset_count >= 1);
+    TEST_CHECK(decode_failures == 0);
+    TEST_CHECK(out_of_order == 0);
+
+    if (received_count[SH2_GAME_ROTATION_VECTOR] > 0) {
+        printf("game rotation vector: max |norm - 1| %.2e, max roll %.2f deg\n", max_norm_error, max_roll_rad * 180.0f / (float) M_PI);
+        TEST_CHECK(max_norm_error < 1e-3f);
+        if (expected_max_roll_deg > 0.0f) {
+            TEST_CHECK_CLOSE(max_roll_rad * 180.0f / (float) M_PI, expected_max_roll_deg, 0.5);
+        }
+    }
+
+    bno085_replay_hal_deinit(&replay);
+    return TEST_RESULT();
+}
@@ -0,0 +1,111 @@
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_report_descriptor.h"
+
+/**
+ * Every row of BNO085_REPORT_DESCRIPTOR_TABLE: the descriptor found by its sensor ID, the set feature configuration
+ * made from it, and the typed value getter reading the union member of the row, for a sample of its report and not for
+ * any other.
+ */
+
+
+// The value type of each row must be the type of its union member, the getters would copy the wrong bytes otherwise
+#define CHECK_VALUE_TYPE(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) \
+    _Static_assert(__builtin_types_compatible_p(type, __typeof__(((sh2_SensorValue_t *) 0)->un.member)), \
+                   #name " value type does not match sh2_SensorValue_t." #member);
+BNO085_REPORT_DESCRIPTOR_TABLE(CHECK_VALUE_TYPE)
+
+
+static void test_lookup(void) {
+    int row_count = 0;
+
+#define CHECK_DESCRIPTOR(name_, sensor_id_, member_, type_, wakeup_, always_on_, change_sensitivity_) \
+    { \
+        const bno085_report_descriptor_t *descriptor = bno085_get_report_descriptor(sensor_id_); \
+        TEST_CHECK(descriptor != NULL); \
+        if (descriptor != NULL) { \
+            TEST_CHECK(strcmp(descriptor->name, #name_) == 0); \
+            TEST_CHECK(descriptor->sensor_id == (sensor_id_)); \
+            TEST_CHECK(descriptor->wakeup == (wakeup_)); \
+            TEST_CHECK(descriptor->always_on == (always_on_)); \
+            TEST_CHECK(descriptor->change_sensitivity == (change_sensitivity_)); \
+        } \
+        row_count += 1; \
+    }
+    BNO085_REPORT_DESCRIPTOR_TABLE(CHECK_DESCRIPTOR)
+#undef CHECK_DESCRIPTOR
+
+    // Only the rows of the table are found
+    int found_count = 0;
+    for (int sensor_id = 0; sensor_id <= 0xFF; sensor_id += 1) {
+        found_count += bno085_get_report_descriptor((sh2_SensorId_t) sensor_id) != NULL;
+    }
+    TEST_CHECK(found_count == row_count);
+    TEST_CHECK(bno085_get_report_descriptor(0) == NULL);
+}
+
+
+static void test_config(void) {
+#define CHECK_CONFIG(name_, sensor_id_, member_, type_, wakeup_, always_on_, change_sensitivity_) \
+    { \
+        sh2_SensorConfig_t config; \
+        memset(&config, 0xA5, sizeof(config)); \
+        bno085_report_descriptor_get_config(bno085_get_report_descriptor(sensor_id_), 10000, 200000, &config); \
+        TEST_CHECK(config.reportInterval_us == 10000); \
+        TEST_CHECK(config.batchInterval_us == 200000); \
+        TEST_CHECK(config.wakeupEnabled == (wakeup_)); \
+        TEST_CHECK(config.alwaysOnEnabled == (always_on_)); \
+        TEST_CHECK(config.changeSensitivityEnabled == (change_sensitivity_)); \
+        TEST_CHECK(!config.changeSensitivityRelative); \
+        TEST_CHECK(config.changeSensitivity == 0); \
+        TEST_CHECK(config.sensorSpecific == 0); \
+    }
+    BNO085_REPORT_DESCRIPTOR_TABLE(CHECK_CONFIG)
+#undef CHECK_CONFIG
+
+    // Disabling keeps the flags
+    sh2_SensorConfig_t config;
+    bno085_report_descriptor_get_config(bno085_get_report_descriptor(SH2_STABILITY_DETECTOR), 0, 0, &config);
+    TEST_CHECK(config.reportInterval_us == 0);
+    TEST_CHECK(config.batchInterval_us == 0);
+    TEST_CHECK(config.wakeupEnabled && config.alwaysOnEnabled && config.changeSensitivityEnabled);
+}
+
+
+static void test_value_getters(void) {
+    static const sh2_SensorId_t sensor_ids[] = {
+#define SENSOR_ID(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) sensor_id,
+        BNO085_REPORT_DESCRIPTOR_TABLE(SENSOR_ID)
+#undef SENSOR_ID
+    };
+    const size_t sensor_count = sizeof(sensor_ids) / sizeof(sensor_ids[0]);
+
+#define CHECK_GETTER(name, sensor_id, member, type, wakeup, always_on, change_sensitivity) \
+    { \
+        sh2_SensorValue_t sample_value; \
+        memset(&sample_value, 0, sizeof(sample_value)); \
+        for (size_t n = 0; n < sizeof(type); n += 1) { \
+            ((uint8_t *) &sample_value.un.member)[n] = (uint8_t) (n * 7 + 1); \
+        } \
+        for (size_t idx = 0; idx < sensor_count; idx += 1) { \
+            type value; \
+            memset(&value, 0, sizeof(value)); \
+            sample_value.sensorId = sensor_ids[idx]; \
+            bool matches = sensor_ids[idx] == (sensor_id); \
+            TEST_CHECK(bno085_get_##name##_value(&sample_value, &value) == matches); \
+            TEST_CHECK(!matches || memcmp(&value, &sample_value.un.member, sizeof(type)) == 0); \
+        } \
+    }
+    BNO085_REPORT_DESCRIPTOR_TABLE(CHECK_GETTER)
+#undef CHECK_GETTER
+}
+
+
+int main(void) {
+    test_lookup();
+    test_config();
+    test_value_getters();
+
+    return TEST_RESULT();
+}
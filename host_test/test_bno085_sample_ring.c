@@ -0,0 +1,242 @@
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_sample_ring.h"
+
+/**
+ * Load tests of the sample ring: no sample is dropped as long as the consumer drains the ring at least once per
+ * BNO085_SAMPLE_RING_DEPTH samples, overwritten samples are counted exactly, and concurrent readers never return a torn
+ * sample.
+ */
+
+#define CONSUMER_PERIOD_US 20000     // Period of the digital level view consumer
+#define REPORT_LEN 16
+
+#define STRESS_DURATION_NS 1000000000ll
+#define STRESS_PRODUCER_PERIOD_NS 500    // Paces the producer so the readers keep up and race it on the same slots
+#define STRESS_READER_COUNT 3
+
+
+static void make_event(sh2_SensorEvent_t *event, uint32_t seq) {
+    memset(event, 0, sizeof(sh2_SensorEvent_t));
+    event->reportId = 0x08;
+    event->len = REPORT_LEN;
+    event->timestamp_uS = seq;
+
+    // Every byte derives from the sequence number so a torn copy is detected
+    for (int i = 0; i < REPORT_LEN; i += 1) {
+        event->report[i] = (uint8_t) (seq * 31u + (uint32_t) i);
+    }
+}
+
+
+static bool event_matches(const sh2_SensorEvent_t *event, uint32_t seq) {
+    if (event->len != REPORT_LEN || event->timestamp_uS != seq) {
+        return false;
+    }
+    for (int i = 0; i < REPORT_LEN; i += 1) {
+        if (event->report[i] != (uint8_t) (seq * 31u + (uint32_t) i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Producer at `rate_hz`, consumer draining the ring every CONSUMER_PERIOD_US, simulated over `duration_s`.
+ */
+static void test_no_drops_at_rate(uint32_t rate_hz, uint32_t duration_s) {
+    static bno085_sample_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+
+    uint32_t cursor = 0;
+    uint32_t lost = 0;
+    uint32_t received = 0;
+    uint32_t published = 0;
+    bool contiguous = true;
+    bool payload_ok = true;
+
+    int64_t period_us = 1000000 / rate_hz;
+    int64_t end_us = (int64_t) duration_s * 1000000;
+    int64_t next_sample_us = 0;
+    for (int64_t now_us = CONSUMER_PERIOD_US; now_us <= end_us; now_us += CONSUMER_PERIOD_US) {
+        for (; next_sample_us < now_us; next_sample_us += period_us) {
+            sh2_SensorEvent_t event;
+            published += 1;
+            make_event(&event, published);
+            bno085_sample_ring_push(&ring, &event, next_sample_us, next_sample_us, true);
+        }
+
+        bno085_sample_slot_t slots[8];
+        size_t count;
+        while ((count = bno085_sample_ring_read(&ring, &cursor, slots, 8, &lost)) > 0) {
+            for (size_t i = 0; i < count; i += 1) {
+                received += 1;
+                contiguous &= slots[i].seq == received;
+                payload_ok &= event_matches(&slots[i].event, slots[i].seq);
+            }
+        }
+    }
+
+    printf("%5lu Hz: published %lu, received %lu, lost %lu\n", (unsigned long) rate_hz, (unsigned long) published, (unsigned long) received, (unsigned long) lost);
+    TEST_CHECK(lost == 0);
+    TEST_CHECK(received == published);
+    TEST_CHECK(contiguous);
+    TEST_CHECK(payload_ok);
+}
+
+
+static void test_overflow_accounting(void) {
+    static bno085_sample_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+
+    uint32_t cursor = 0;
+    uint32_t lost = 0;
+    sh2_SensorEvent_t event;
+    bno085_sample_slot_t slots[BNO085_SAMPLE_RING_DEPTH];
+
+    TEST_CHECK(bno085_sample_ring_read(&ring, &cursor, slots, BNO085_SAMPLE_RING_DEPTH, &lost) == 0);
+    TEST_CHECK(bno085_sample_ring_get_head(&ring) == 0);
+
+    // Exactly one ring of pending samples fits
+    for (uint32_t seq = 1; seq <= BNO085_SAMPLE_RING_DEPTH; seq += 1) {
+        make_event(&event, seq);
+        bno085_sample_ring_push(&ring, &event, seq, seq, true);
+    }
+    TEST_CHECK(bno085_sample_ring_read(&ring, &cursor, slots, BNO085_SAMPLE_RING_DEPTH, &lost) == BNO085_SAMPLE_RING_DEPTH);
+    TEST_CHECK(lost == 0);
+    TEST_CHECK(slots[0].seq == 1);
+    TEST_CHECK(cursor == BNO085_SAMPLE_RING_DEPTH);
+
+    // Five more than a ring, the five oldest are lost and reported
+    uint32_t first = cursor + 1;
+    for (uint32_t seq = first; seq < first + BNO085_SAMPLE_RING_DEPTH + 5; seq += 1) {
+        make_event(&event, seq);
+        bno085_sample_ring_push(&ring, &event, seq, seq, true);
+    }
+    size_t count = bno085_sample_ring_read(&ring, &cursor, slots, BNO085_SAMPLE_RING_DEPTH, &lost);
+    TEST_CHECK(count == BNO085_SAMPLE_RING_DEPTH);
+    TEST_CHECK(lost == 5);
+    TEST_CHECK(slots[0].seq == first + 5);
+    TEST_CHECK(event_matches(&slots[0].event, first + 5));
+    TEST_CHECK(cursor == bno085_sample_ring_get_head(&ring));
+}
+
+
+static void test_sequence_wraparound(void) {
+    static bno085_sample_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+
+    // Start just before the 32-bit sequence number wraps
+    ring.head = UINT32_MAX - 3;
+    uint32_t cursor = ring.head;
+    uint32_t lost = 0;
+
+    sh2_SensorEvent_t event;
+    uint32_t seq = ring.head;
+    for (int i = 0; i < 8; i += 1) {
+        seq += 1;
+        make_event(&event, seq);
+        bno085_sample_ring_push(&ring, &event, 0, 0, true);
+    }
+
+    bno085_sample_slot_t slots[8];
+    TEST_CHECK(bno085_sample_ring_read(&ring, &cursor, slots, 8, &lost) == 8);
+    TEST_CHECK(lost == 0);
+    TEST_CHECK(slots[2].seq == UINT32_MAX);
+    TEST_CHECK(slots[3].seq == 0);
+    TEST_CHECK(slots[7].seq == 4);
+    TEST_CHECK(event_matches(&slots[7].event, 4));
+}
+
+
+typedef struct {
+    bno085_sample_ring_t *ring;
+    volatile bool *done;
+    uint32_t received;
+    uint32_t lost;
+    uint32_t torn;
+    uint32_t out_of_order;
+} reader_t;
+
+
+static void * reader_thread(void *arg) {
+    reader_t *reader = arg;
+    uint32_t cursor = 0;
+    uint32_t last_seq = 0;
+    bno085_sample_slot_t slots[4];
+
+    while (true) {
+        bool done = __atomic_load_n(reader->done, __ATOMIC_ACQUIRE);
+        size_t count = bno085_sample_ring_read(reader->ring, &cursor, slots, 4, &reader->lost);
+        for (size_t i = 0; i < count; i += 1) {
+            reader->received += 1;
+            reader->torn += !event_matches(&slots[i].event, slots[i].seq) || slots[i].timestamp_us != slots[i].seq;
+            reader->out_of_order += slots[i].seq <= last_seq;
+            last_seq = slots[i].seq;
+        }
+
+        if (done && count == 0) {
+            return NULL;
+        }
+    }
+}
+
+
+/**
+ * One producer thread publishing at a high rate, several readers copying concurrently. Readers fall behind and get
+ * overwritten, which is fine, but every sample returned must be intact and each sample is either received or lost.
+ */
+static void test_concurrent_readers(void) {
+    static bno085_sample_ring_t ring;
+    memset(&ring, 0, sizeof(ring));
+    volatile bool done = false;
+
+    reader_t readers[STRESS_READER_COUNT];
+    pthread_t threads[STRESS_READER_COUNT];
+    for (int i = 0; i < STRESS_READER_COUNT; i += 1) {
+        readers[i] = (reader_t) {.ring = &ring, .done = &done};
+        pthread_create(&threads[i], NULL, reader_thread, &readers[i]);
+    }
+
+    sh2_SensorEvent_t event;
+    uint32_t published = 0;
+    int64_t next_ns = test_time_ns();
+    int64_t end_ns = next_ns + STRESS_DURATION_NS;
+    while (next_ns < end_ns) {
+        published += 1;
+        make_event(&event, published);
+        bno085_sample_ring_push(&ring, &event, published, published, true);
+
+        next_ns += STRESS_PRODUCER_PERIOD_NS;
+        while (test_time_ns() < next_ns) {
+        }
+    }
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < STRESS_READER_COUNT; i += 1) {
+        pthread_join(threads[i], NULL);
+        printf("reader %d: published %lu, received %lu, lost %lu, torn %lu\n", i, (unsigned long) published, (unsigned long) readers[i].received, (unsigned long) readers[i].lost, (unsigned long) readers[i].torn);
+        TEST_CHECK(readers[i].torn == 0);
+        TEST_CHECK(readers[i].out_of_order == 0);
+        TEST_CHECK(readers[i].received + readers[i].lost == published);
+    }
+}
+
+
+int main(void) {
+    // Game rotation vector rates used by the application, and one above to check the margin
+    test_no_drops_at_rate(200, 60);
+    test_no_drops_at_rate(500, 60);
+    test_no_drops_at_rate(1000, 60);
+    test_no_drops_at_rate(1500, 60);
+
+    test_overflow_accounting();
+    test_sequence_wraparound();
+    test_concurrent_readers();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,300 @@
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "bno085_sim_hal.h"
+#include "bno085_recovery.h"
+
+/**
+ * Injects each fault of the simulator while a report streams through SH2, and checks the recovery of the driver brings
+ * the stream back with the expected resets. The harness does what the poller task of the driver does: services SH2,
+ * reports the transport errors and resets, checks for stalls and carries out the recovery steps.
+ */
+
+#define REPORT_ID 0x08                  // Game rotation vector
+#define REPORT_INTERVAL_US 2500
+#define POLL_PERIOD_US 50000            // BNO085_RECOVERY_POLL_PERIOD_MS, the poller wakes up at least this often
+#define SETTLE_US 500000
+
+
+typedef struct {
+    bool soft_reset_available;
+    bool hard_reset_available;
+} harness_config_t;
+
+
+static bno085_sim_hal_t sim;
+static sh2_Hal_t hal;                   // Forwards to the simulator, reports the transport errors like the driver HAL
+static bno085_recovery_t recovery;
+static bno085_recovery_stats_t stats;
+static harness_config_t config;
+static uint32_t report_count;
+static uint32_t invalid_report_count;   // Received while recovering
+static uint64_t recovered_us;           // Time the last recovery completed
+static bool running;                    // The poller is started
+
+
+static int hal_open(sh2_Hal_t *self) {
+    return sim._HAL.open(&sim._HAL);
+}
+
+static void hal_close(sh2_Hal_t *self) {
+    sim._HAL.close(&sim._HAL);
+}
+
+static int hal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len, uint32_t *t_us) {
+    int packet_size = sim._HAL.read(&sim._HAL, pBuffer, len, t_us);
+    if (packet_size < 0) {
+        bno085_recovery_request(&recovery, sim.now_us);
+    }
+    else if (packet_size > 0) {
+        bno085_recovery_kick(&recovery, sim.now_us);
+    }
+    return packet_size;
+}
+
+static int hal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
+    return sim._HAL.write(&sim._HAL, pBuffer, len);
+}
+
+static uint32_t hal_get_time_us(sh2_Hal_t *self) {
+    return sim._HAL.getTimeUs(&sim._HAL);
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+    // The reset at sh2_open() happens before the poller is started, nothing to restore
+    if (event->eventId == SH2_RESET && running) {
+        bno085_recovery_on_reset(&recovery, sim.now_us);
+    }
+}
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    if (event->reportId != REPORT_ID) {
+        return;
+    }
+    if (recovery.state == BNO085_RECOVERY_IDLE) {
+        report_count += 1;
+    }
+    else {
+        invalid_report_count += 1;
+    }
+}
+
+
+static bool enable_report(void) {
+    sh2_SensorConfig_t sensor_config = {.reportInterval_us = REPORT_INTERVAL_US};
+    return sh2_setSensorConfig(REPORT_ID, &sensor_config) == SH2_OK;
+}
+
+
+static void soft_reset(void) {
+    // Same packet as the I2C transport, written to the sensor without SH2
+    uint8_t packet[] = {5, 0, 1, 0, 1};
+    sim._HAL.write(&sim._HAL, packet, sizeof(packet));
+}
+
+
+static void run_recovery(void) {
+    switch (bno085_recovery_step(&recovery, sim.now_us, config.soft_reset_available, config.hard_reset_available)) {
+        case BNO085_RECOVERY_ACTION_SOFT_RESET:
+            soft_reset();
+            break;
+        case BNO085_RECOVERY_ACTION_HARD_RESET:
+            bno085_sim_hal_hard_reset(&sim);
+            break;
+        case BNO085_RECOVERY_ACTION_RECONFIGURE:
+            if (enable_report()) {
+                bno085_recovery_finish(&recovery, sim.now_us);
+                recovered_us = sim.now_us;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+ * Run the poller for `duration_us` of simulated time.
+ */
+static void run(uint64_t duration_us) {
+    uint64_t end_us = sim.now_us + duration_us;
+    while (sim.now_us < end_us) {
+        uint64_t before_us = sim.now_us;
+        uint32_t packet_count = sim.packet_count + sim.reset_count;
+        sh2_service();
+
+        // Nothing received, the poller sleeps until the interrupt or its timeout
+        if (sim.packet_count + sim.reset_count == packet_count && sim.now_us - before_us < POLL_PERIOD_US) {
+            sim.now_us = before_us + POLL_PERIOD_US;
+        }
+
+        if (recovery.state == BNO085_RECOVERY_IDLE) {
+            bno085_recovery_check_stall(&recovery, sim.now_us, bno085_recovery_stall_timeout_us(REPORT_INTERVAL_US));
+        }
+        if (recovery.state != BNO085_RECOVERY_IDLE) {
+            run_recovery();
+        }
+    }
+}
+
+
+static void start(harness_config_t harness_config) {
+    config = harness_config;
+    memset(&stats, 0, sizeof(stats));
+    report_count = 0;
+    invalid_report_count = 0;
+
+    bno085_sim_hal_init(&sim, bno085_sim_profile_static, NULL);
+    hal.open = hal_open;
+    hal.close = hal_close;
+    hal.read = hal_read;
+    hal.write = hal_write;
+    hal.getTimeUs = hal_get_time_us;
+
+    TEST_CHECK(sh2_open(&hal, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+    bno085_recovery_init(&recovery, &stats, sim.now_us);
+    running = true;
+    TEST_CHECK(enable_report());
+
+    run(SETTLE_US);
+    TEST_CHECK(report_count > 0.9 * SETTLE_US / REPORT_INTERVAL_US);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_IDLE);
+    report_count = 0;
+}
+
+
+static void stop(void) {
+    running = false;
+    sh2_close();
+}
+
+
+/**
+ * Check the stream is back at its rate after the recovery.
+ */
+static void check_recovered(const char *name) {
+    printf("%s: %lu faults, %lu stalls, %lu unexpected resets, %lu soft and %lu hard resets, recovered in %.1f ms, %lu reports after\n",
+           name, (unsigned long) stats.fault_count, (unsigned long) stats.stall_count, (unsigned long) stats.unexpected_reset_count,
+           (unsigned long) stats.soft_reset_count, (unsigned long) stats.hard_reset_count, stats.last_recovery_us / 1000.0,
+           (unsigned long) report_count);
+
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_IDLE);
+    TEST_CHECK(stats.recovery_count == 1);
+    TEST_CHECK(sim.fault == BNO085_SIM_FAULT_NONE);
+
+    TEST_CHECK(report_count > 0.9 * (sim.now_us - recovered_us) / REPORT_INTERVAL_US);
+    TEST_CHECK(sim.now_us - recovered_us > 100000);
+}
+
+
+static void test_read_error(void) {
+    // Cleared by the first soft reset
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = true});
+    bno085_sim_hal_inject_fault(&sim, BNO085_SIM_FAULT_READ_ERROR);
+    run(3000000);
+    check_recovered("read error");
+    TEST_CHECK(sim.read_error_count > 0);
+    TEST_CHECK(stats.fault_count == 1);
+    TEST_CHECK(stats.stall_count == 0);
+    TEST_CHECK(stats.soft_reset_count == 1);
+    TEST_CHECK(stats.hard_reset_count == 0);
+    stop();
+}
+
+
+static void test_stall(void) {
+    // The sensor goes silent, only the stall detection notices
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = true});
+    bno085_sim_hal_inject_fault(&sim, BNO085_SIM_FAULT_STALL);
+    run(3000000);
+    check_recovered("stall");
+    TEST_CHECK(stats.stall_count == 1);
+    TEST_CHECK(stats.soft_reset_count == 1);
+    TEST_CHECK(stats.hard_reset_count == 0);
+    TEST_CHECK(stats.last_recovery_us < BNO085_RECOVERY_RESET_TIMEOUT_MS * 1000ll);
+    stop();
+}
+
+
+static void test_latched(void) {
+    // Soft resets are ignored, the reset pin clears it
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = true});
+    bno085_sim_hal_inject_fault(&sim, BNO085_SIM_FAULT_LATCHED);
+    run(6000000);
+    check_recovered("latched");
+    TEST_CHECK(stats.stall_count == 1);
+    TEST_CHECK(stats.soft_reset_count == BNO085_RECOVERY_SOFT_RESET_ATTEMPTS);
+    TEST_CHECK(stats.hard_reset_count == 1);
+    TEST_CHECK(stats.last_recovery_us >= BNO085_RECOVERY_SOFT_RESET_ATTEMPTS * BNO085_RECOVERY_RESET_TIMEOUT_MS * 1000ll);
+    stop();
+}
+
+
+static void test_latched_without_reset_pin(void) {
+    // Can't recover, the driver keeps trying and keeps flagging the stream
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = false});
+    bno085_sim_hal_inject_fault(&sim, BNO085_SIM_FAULT_LATCHED);
+    run(6000000);
+    printf("latched, no reset pin: %lu soft resets, state %d\n", (unsigned long) stats.soft_reset_count, recovery.state);
+    TEST_CHECK(recovery.state != BNO085_RECOVERY_IDLE);
+    TEST_CHECK(stats.recovery_count == 0);
+    TEST_CHECK(stats.soft_reset_count > BNO085_RECOVERY_SOFT_RESET_ATTEMPTS);
+    TEST_CHECK(stats.hard_reset_count == 0);
+
+    // Recovers once the sensor is power cycled
+    bno085_sim_hal_hard_reset(&sim);
+    report_count = 0;
+    run(1000000);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_IDLE);
+    TEST_CHECK(stats.recovery_count == 1);
+    TEST_CHECK(report_count > 0.9 * (1000000 - POLL_PERIOD_US) / REPORT_INTERVAL_US);
+    stop();
+}
+
+
+static void test_unexpected_reset(void) {
+    // The sensor resets by itself (e.g. brown-out), the reports are disabled and must be restored
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = true});
+    bno085_sim_hal_inject_reset(&sim);
+    run(1000000);
+    check_recovered("unexpected reset");
+    TEST_CHECK(stats.unexpected_reset_count == 1);
+    TEST_CHECK(stats.fault_count == 0);
+    TEST_CHECK(stats.soft_reset_count == 0);
+    TEST_CHECK(stats.hard_reset_count == 0);
+    stop();
+}
+
+
+static void test_reset_storm(void) {
+    // Repeated resets in the middle of the stream, each one restored
+    start((harness_config_t) {.soft_reset_available = true, .hard_reset_available = true});
+    for (int i = 0; i < 20; i += 1) {
+        bno085_sim_hal_inject_reset(&sim);
+        run(20000);
+    }
+    run(500000);
+    printf("reset storm: %lu unexpected resets, %lu recoveries\n", (unsigned long) stats.unexpected_reset_count, (unsigned long) stats.recovery_count);
+    TEST_CHECK(recovery.state == BNO085_RECOVERY_IDLE);
+    TEST_CHECK(stats.unexpected_reset_count == 20);
+    TEST_CHECK(stats.recovery_count == 20);
+    TEST_CHECK(sim.reports[REPORT_ID].interval_us == REPORT_INTERVAL_US);
+    stop();
+}
+
+
+int main(void) {
+    test_read_error();
+    test_stall();
+    test_latched();
+    test_latched_without_reset_pin();
+    test_unexpected_reset();
+    test_reset_storm();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_sim_hal.h"
+#include "bno085_sample_ring.h"
+#include "bno085_timebase.h"
+
+/**
+ * Maximum sustained throughput of the report path: sh2_service() reads a packet from the simulator, the SH2 library
+ * splits it into events, the sensor callback maps the timestamp and publishes the raw event in the sample ring of the
+ * sensor as sh2_sensor_callback() does, and the consumer reads and decodes every sample. Time is virtual in the
+ * simulator, so the reports flow as fast as the host can carry them: the wall time per report is the cost of the path.
+ *
+ * Once with the game rotation vector alone (the level), once with the mix of the recoil capture. Every generated
+ * report must reach the consumer, and the path must keep up with the simulated sensor in real time.
+ *
+ *   test_bno085_sim_throughput [simulated seconds]
+ */
+
+#define MAX_REPORT_ID 0x30
+#define READ_BATCH 8                    // Samples read per wake-up of the consumer
+#define DEFAULT_DURATION_S 20
+
+
+typedef struct {
+    uint8_t report_id;
+    uint32_t interval_us;
+} report_t;
+
+
+typedef struct {
+    bno085_sample_ring_t ring;
+    bno085_timebase_t timebase;
+    uint32_t interval_us;
+    uint32_t cursor;                    // Of the consumer
+} sensor_t;
+
+
+static bno085_sim_hal_t sim;
+static sensor_t sensors[MAX_REPORT_ID];
+static uint32_t callback_count;
+static uint32_t consumed_count;
+static uint32_t lost_count;
+static double checksum;
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+}
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    uint8_t report_id = event->reportId;
+    if (report_id >= MAX_REPORT_ID || sensors[report_id].interval_us == 0) {
+        return;
+    }
+    sensor_t *sensor = &sensors[report_id];
+    callback_count += 1;
+
+    // The arrival is the simulated time of the packet, also the interrupt time
+    int64_t arrival_us = (int64_t) sim.now_us;
+    int64_t timestamp_us = bno085_timebase_extend(arrival_us, event->timestamp_uS);
+    bno085_timebase_update(&sensor->timebase, event->report[1], sensor->interval_us, timestamp_us);
+    timestamp_us = bno085_timebase_correct(&sensor->timebase, arrival_us, timestamp_us);
+
+    bno085_sample_ring_push(&sensor->ring, event, timestamp_us, arrival_us, true);
+}
+
+
+static void consume(void) {
+    for (uint8_t report_id = 0; report_id < MAX_REPORT_ID; report_id += 1) {
+        sensor_t *sensor = &sensors[report_id];
+        if (sensor->interval_us == 0) {
+            continue;
+        }
+
+        bno085_sample_slot_t slots[READ_BATCH];
+        size_t count;
+        while ((count = bno085_sample_ring_read(&sensor->ring, &sensor->cursor, slots, READ_BATCH, &lost_count)) > 0) {
+            for (size_t i = 0; i < count; i += 1) {
+                sh2_SensorValue_t value;
+                if (sh2_decodeSensorEvent(&value, &slots[i].event) != SH2_OK) {
+                    continue;
+                }
+                consumed_count += 1;
+                checksum += value.un.gameRotationVector.real;
+            }
+        }
+    }
+}
+
+
+static void run(const char *name, const report_t *reports, size_t report_count, uint32_t duration_s) {
+    memset(sensors, 0, sizeof(sensors));
+    callback_count = 0;
+    consumed_count = 0;
+    lost_count = 0;
+
+    bno085_sim_roll_sweep_t sweep = {.amplitude_rad = 0.5f, .frequency_hz = 0.5f};
+    bno085_sim_hal_init(&sim, bno085_sim_profile_roll_sweep, &sweep);
+    TEST_CHECK(sh2_open(&sim._HAL, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+
+    uint32_t simulated_rate = 0;
+    for (size_t i = 0; i < report_count; i += 1) {
+        sh2_SensorConfig_t config = {.reportInterval_us = reports[i].interval_us};
+        TEST_CHECK(sh2_setSensorConfig(reports[i].report_id, &config) == SH2_OK);
+        sensors[reports[i].report_id].interval_us = reports[i].interval_us;
+        simulated_rate += 1000000 / reports[i].interval_us;
+    }
+
+    // The consumer starts at the head, as bno085_subscribe() does
+    for (uint8_t report_id = 0; report_id < MAX_REPORT_ID; report_id += 1) {
+        sensors[report_id].cursor = bno085_sample_ring_get_head(&sensors[report_id].ring);
+    }
+    uint32_t generated_before = sim.report_count;
+
+    // The consumer is woken up after every packet, as the subscribers are by the poller task
+    uint64_t end_us = sim.now_us + (uint64_t) duration_s * 1000000;
+    int64_t start_ns = test_time_ns();
+    while (sim.now_us < end_us) {
+        sh2_service();
+        consume();
+    }
+    int64_t elapsed_ns = test_time_ns() - start_ns;
+    sh2_close();
+
+    uint32_t generated = sim.report_count - generated_before;
+    double reports_per_s = consumed_count * 1e9 / (double) elapsed_ns;
+    printf("%s: %lu reports in %.1f ms, %.0f reports/s sustained (%.0f ns per report), %.0fx the simulated %lu reports/s, "
+           "%lu packets, %lu lost\n", name, (unsigned long) consumed_count, elapsed_ns / 1e6, reports_per_s,
+           elapsed_ns / (double) consumed_count, reports_per_s / simulated_rate, (unsigned long) simulated_rate,
+           (unsigned long) sim.packet_count, (unsigned long) lost_count);
+
+    // Every report reaches the consumer, the last packet may still be in flight
+    TEST_CHECK(callback_count >= 0.99 * simulated_rate * duration_s);
+    TEST_CHECK(generated - callback_count <= report_count);
+    TEST_CHECK(consumed_count == callback_count);
+    TEST_CHECK(lost_count == 0);
+
+    // Keeps up with the sensor
+    TEST_CHECK(reports_per_s > simulated_rate);
+}
+
+
+int main(int argc, char **argv) {
+    uint32_t duration_s = argc > 1 ? (uint32_t) atoi(argv[1]) : DEFAULT_DURATION_S;
+
+    report_t level[] = {
+        {SH2_GAME_ROTATION_VECTOR, 1000},
+    };
+    run("game rotation vector", level, sizeof(level) / sizeof(level[0]), duration_s);
+
+    report_t mix[] = {
+        {SH2_GAME_ROTATION_VECTOR, 1000},
+        {SH2_ACCELEROMETER, 2500},
+        {SH2_GYROSCOPE_CALIBRATED, 2500},
+        {SH2_LINEAR_ACCELERATION, 2500},
+    };
+    run("recoil mix", mix, sizeof(mix) / sizeof(mix[0]), duration_s);
+
+    return TEST_RESULT();
+}
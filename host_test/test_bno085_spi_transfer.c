@@ -0,0 +1,232 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "bno085_spi_transfer.h"
+#include "bno085_shtp_log.h"
+
+/**
+ * CPU time the poller task spends per packet on the queued (interrupt completed) SPI transfers against the polling
+ * ones. A fake SPI driver clocks the bytes at the bus rate of the BNO085: the polling transmit spins for the duration,
+ * the queued transaction is completed by a driver thread standing in for the DMA and the ISR, which stamps the
+ * completion as the post transaction callback does. Each packet is read the way bno085_hal_spi_read() does, the
+ * header then the packet, and accounted through bno085_spi_transfer.h. The counters are checked against the CPU time
+ * of the thread.
+ *
+ *   test_bno085_spi_transfer [capture]
+ *
+ * Without a capture, packets of the size of a game rotation vector report are read.
+ */
+
+#define SPI_CLOCK_HZ 3000000            // Maximum of the BNO085, see bno085_init_spi()
+#define SHTP_HEADER_SIZE 4
+#define DEFAULT_PACKET_SIZE 21          // Base timestamp and a game rotation vector
+#define MAX_PACKETS 4000
+#define MAX_QUEUED_BUSY_RATIO 0.5       // CPU time of the queued transfers against the polling ones
+
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool running;
+    uint32_t pending_bytes;             // Transaction queued to the driver thread, 0 for none
+    bool complete;
+    volatile int64_t transfer_complete_us;
+} fake_spi_t;
+
+
+static fake_spi_t spi;
+static uint16_t packet_sizes[MAX_PACKETS];
+static size_t packet_count;
+
+
+static int64_t now_us(void) {
+    return test_time_ns() / 1000;
+}
+
+
+static int64_t bus_time_ns(uint32_t byte_count) {
+    return (int64_t) byte_count * 8 * 1000000000ll / SPI_CLOCK_HZ;
+}
+
+
+static int64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t) ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+
+static void *driver_thread(void *arg) {
+    pthread_mutex_lock(&spi.lock);
+    while (spi.running) {
+        if (spi.pending_bytes == 0) {
+            pthread_cond_wait(&spi.cond, &spi.lock);
+            continue;
+        }
+        uint32_t byte_count = spi.pending_bytes;
+        pthread_mutex_unlock(&spi.lock);
+
+        // The bytes move without the CPU
+        struct timespec duration = {0, (long) bus_time_ns(byte_count)};
+        nanosleep(&duration, NULL);
+
+        pthread_mutex_lock(&spi.lock);
+        spi.transfer_complete_us = now_us();  // post_cb
+        spi.pending_bytes = 0;
+        spi.complete = true;
+        pthread_cond_broadcast(&spi.cond);
+    }
+    pthread_mutex_unlock(&spi.lock);
+    return NULL;
+}
+
+
+/**
+ * @brief spi_device_queue_trans(), spi_device_get_trans_result() and the accounting of spi_transfer().
+ */
+static void queued_transfer(bno085_spi_transfer_stats_t *stats, uint32_t byte_count) {
+    int64_t start_us = now_us();
+    pthread_mutex_lock(&spi.lock);
+    spi.pending_bytes = byte_count;
+    spi.complete = false;
+    pthread_cond_broadcast(&spi.cond);
+    pthread_mutex_unlock(&spi.lock);
+    int64_t queued_us = now_us();
+
+    pthread_mutex_lock(&spi.lock);
+    while (!spi.complete) {
+        pthread_cond_wait(&spi.cond, &spi.lock);
+    }
+    pthread_mutex_unlock(&spi.lock);
+    int64_t end_us = now_us();
+
+    bno085_spi_transfer_account_queued(stats, byte_count, start_us, queued_us, spi.transfer_complete_us, end_us);
+}
+
+
+/**
+ * @brief spi_device_polling_transmit() and the accounting of spi_transfer().
+ */
+static void polling_transfer(bno085_spi_transfer_stats_t *stats, uint32_t byte_count) {
+    int64_t start_us = now_us();
+    int64_t end_ns = test_time_ns() + bus_time_ns(byte_count);
+    while (test_time_ns() < end_ns) {
+    }
+    bno085_spi_transfer_account_polling(stats, byte_count, start_us, now_us());
+}
+
+
+typedef struct {
+    bno085_spi_transfer_stats_t stats;
+    int64_t cpu_ns;
+    int64_t wall_ns;
+} run_result_t;
+
+
+static void run(void (*transfer)(bno085_spi_transfer_stats_t *, uint32_t), run_result_t *result) {
+    memset(result, 0, sizeof(run_result_t));
+    int64_t start_cpu_ns = thread_cpu_ns();
+    int64_t start_ns = test_time_ns();
+
+    for (size_t idx = 0; idx < packet_count; idx += 1) {
+        transfer(&result->stats, SHTP_HEADER_SIZE);
+        transfer(&result->stats, packet_sizes[idx]);
+        result->stats.packet_count += 1;
+    }
+
+    result->cpu_ns = thread_cpu_ns() - start_cpu_ns;
+    result->wall_ns = test_time_ns() - start_ns;
+}
+
+
+static bool load_capture(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint8_t file_header[BNO085_SHTP_LOG_FILE_HEADER_SIZE];
+    bool valid = fread(file_header, 1, sizeof(file_header), file) == sizeof(file_header) && bno085_shtp_log_check_file_header(file_header);
+
+    uint8_t record_header[BNO085_SHTP_LOG_RECORD_HEADER_SIZE];
+    while (valid && packet_count < MAX_PACKETS && fread(record_header, 1, sizeof(record_header), file) == sizeof(record_header)) {
+        uint32_t t_us;
+        uint16_t len;
+        bno085_shtp_log_decode_record_header(record_header, &t_us, &len);
+        if (fseek(file, len, SEEK_CUR) != 0) {
+            valid = false;
+            break;
+        }
+        if (len > SHTP_HEADER_SIZE) {
+            packet_sizes[packet_count++] = len;
+        }
+    }
+
+    fclose(file);
+    return valid && packet_count > 0;
+}
+
+
+static void print_result(const char *name, const run_result_t *result) {
+    printf("%s: %lu packets, %lu transactions, %lu bytes, per packet: %.1f us busy, %.1f us on the bus (counters), %.1f us of thread CPU, %.1f us wall\n",
+           name, (unsigned long) result->stats.packet_count, (unsigned long) result->stats.transaction_count,
+           (unsigned long) result->stats.byte_count, (double) result->stats.busy_us / result->stats.packet_count,
+           (double) result->stats.transfer_us / result->stats.packet_count, result->cpu_ns / 1e3 / result->stats.packet_count,
+           result->wall_ns / 1e3 / result->stats.packet_count);
+}
+
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        TEST_CHECK(load_capture(argv[1]));
+    }
+    else {
+        for (; packet_count < 1000; packet_count += 1) {
+            packet_sizes[packet_count] = DEFAULT_PACKET_SIZE;
+        }
+    }
+
+    int64_t bus_ns = 0;
+    for (size_t idx = 0; idx < packet_count; idx += 1) {
+        bus_ns += bus_time_ns(SHTP_HEADER_SIZE) + bus_time_ns(packet_sizes[idx]);
+    }
+
+    pthread_mutex_init(&spi.lock, NULL);
+    pthread_cond_init(&spi.cond, NULL);
+    spi.running = true;
+    pthread_create(&spi.thread, NULL, driver_thread, NULL);
+
+    run_result_t polling, queued;
+    run(polling_transfer, &polling);
+    run(queued_transfer, &queued);
+
+    pthread_mutex_lock(&spi.lock);
+    spi.running = false;
+    pthread_cond_broadcast(&spi.cond);
+    pthread_mutex_unlock(&spi.lock);
+    pthread_join(spi.thread, NULL);
+
+    printf("%.1f us on the bus per packet at %d Hz\n", bus_ns / 1e3 / packet_count, SPI_CLOCK_HZ);
+    print_result("polling", &polling);
+    print_result("queued", &queued);
+
+    // Both read the same bytes
+    TEST_CHECK(polling.stats.transaction_count == 2 * packet_count);
+    TEST_CHECK(queued.stats.transaction_count == polling.stats.transaction_count);
+    TEST_CHECK(queued.stats.byte_count == polling.stats.byte_count);
+
+    // The polling transfers keep the CPU busy for the whole bus time, the counters say so
+    TEST_CHECK(polling.stats.busy_us >= (uint64_t) (bus_ns / 1000) * 9 / 10);
+    TEST_CHECK(polling.cpu_ns >= bus_ns * 9 / 10);
+
+    // The queued transfers leave the bus time to the driver, the counters see it on the bus and not busy
+    TEST_CHECK(queued.stats.transfer_us >= (uint64_t) (bus_ns / 1000) * 9 / 10);
+    TEST_CHECK(queued.stats.busy_us < polling.stats.busy_us);
+    TEST_CHECK(queued.cpu_ns < MAX_QUEUED_BUSY_RATIO * polling.cpu_ns);
+
+    return TEST_RESULT();
+}
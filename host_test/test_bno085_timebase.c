@@ -0,0 +1,173 @@
+#include <stdlib.h>
+
+#include "test_common.h"
+#include "bno085_timebase.h"
+
+/**
+ * Skew estimation against a simulated sensor clock running at a known rate offset from the host clock, with interrupt
+ * latency jitter, missed reports and sequence number wraparound.
+ */
+
+#define INTERVAL_US 2500            // 400 Hz game rotation vector
+#define JITTER_US 40                // Peak interrupt latency jitter on the host timestamps
+#define SIMULATED_S 60
+
+
+static uint32_t rng_state = 1;
+
+static int32_t jitter_us(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (int32_t) (rng_state >> 16) % (2 * JITTER_US + 1) - JITTER_US;
+}
+
+
+/**
+ * @return float Estimated skew after SIMULATED_S of reports.
+ */
+static float simulate(float skew_ppm, uint32_t drop_every) {
+    bno085_timebase_t timebase;
+    bno085_timebase_reset(&timebase);
+
+    double host_interval_us = INTERVAL_US * (1.0 + skew_ppm * 1e-6);
+    uint32_t count = SIMULATED_S * 1000000 / INTERVAL_US;
+    for (uint32_t n = 0; n < count; n += 1) {
+        // Reports lost on the bus still increment the sequence number
+        if (drop_every != 0 && n % drop_every == drop_every - 1) {
+            continue;
+        }
+        int64_t host_us = 1000000 + (int64_t) (n * host_interval_us) + jitter_us();
+        bno085_timebase_update(&timebase, (uint8_t) n, INTERVAL_US, host_us);
+    }
+
+    TEST_CHECK(timebase.skew_valid);
+    return timebase.skew_ppm;
+}
+
+
+static void test_skew_estimate(void) {
+    // Window of 2 s with ±40 us jitter, a single measurement is within ±40 ppm and the filter averages further
+    const float skews_ppm[] = {0.0f, 150.0f, -150.0f, 1000.0f, -2500.0f, 20000.0f};
+    for (size_t i = 0; i < sizeof(skews_ppm) / sizeof(skews_ppm[0]); i += 1) {
+        float estimate = simulate(skews_ppm[i], 0);
+        float estimate_drops = simulate(skews_ppm[i], 7);
+        printf("skew %8.1f ppm: estimate %8.2f ppm, with missed reports %8.2f ppm\n", skews_ppm[i], estimate, estimate_drops);
+        TEST_CHECK_CLOSE(estimate, skews_ppm[i], 20.0);
+        TEST_CHECK_CLOSE(estimate_drops, skews_ppm[i], 20.0);
+    }
+}
+
+
+static void test_correct(void) {
+    bno085_timebase_t timebase;
+    bno085_timebase_reset(&timebase);
+
+    // No estimate yet, timestamps pass through
+    TEST_CHECK(bno085_timebase_correct(&timebase, 1000, 900) == 900);
+
+    timebase.skew_valid = true;
+    timebase.skew_ppm = 1000.0f;
+
+    // 100 ms batch age measured by a sensor clock 1000 ppm slow is 100.1 ms of host time
+    int64_t anchor_us = 50000000;
+    TEST_CHECK(bno085_timebase_correct(&timebase, anchor_us, anchor_us - 100000) == anchor_us - 100100);
+
+    // Unknown anchor, no correction
+    TEST_CHECK(bno085_timebase_correct(&timebase, 0, 123456) == 123456);
+}
+
+
+/**
+ * Age of batched samples over a long run: the sensor-side offset scaled by the estimate stays within a few microseconds
+ * of the true host time, where the raw offset drifts by skew * offset.
+ */
+static void test_batch_drift(void) {
+    const float skew_ppm = 800.0f;
+    bno085_timebase_t timebase;
+    bno085_timebase_reset(&timebase);
+
+    double host_interval_us = INTERVAL_US * (1.0 + skew_ppm * 1e-6);
+    int64_t max_raw_error_us = 0;
+    int64_t max_corrected_error_us = 0;
+    uint32_t count = SIMULATED_S * 1000000 / INTERVAL_US;
+    for (uint32_t n = 0; n < count; n += 1) {
+        int64_t true_host_us = 1000000 + (int64_t) (n * host_interval_us);
+        bno085_timebase_update(&timebase, (uint8_t) n, INTERVAL_US, true_host_us + jitter_us());
+
+        // Once the estimate settled, flush a 100 ms batch every 40th report: the interrupt is taken now, the sample age is
+        // counted by the sensor clock
+        if (n % 40 == 0 && n * INTERVAL_US > 20000000) {
+            uint32_t age_reports = 40;
+            int64_t anchor_us = true_host_us;
+            int64_t sample_host_us = 1000000 + (int64_t) ((n - age_reports) * host_interval_us);
+            int64_t raw_us = anchor_us - (int64_t) age_reports * INTERVAL_US;
+            int64_t corrected_us = bno085_timebase_correct(&timebase, anchor_us, raw_us);
+            max_raw_error_us = llabs(raw_us - sample_host_us) > max_raw_error_us ? llabs(raw_us - sample_host_us) : max_raw_error_us;
+            max_corrected_error_us = llabs(corrected_us - sample_host_us) > max_corrected_error_us ? llabs(corrected_us - sample_host_us) : max_corrected_error_us;
+        }
+    }
+
+    printf("100 ms batch age at %.0f ppm: raw error %lld us, corrected error %lld us\n", skew_ppm, (long long) max_raw_error_us, (long long) max_corrected_error_us);
+    TEST_CHECK(max_raw_error_us >= 79);
+    TEST_CHECK(max_corrected_error_us <= 3);
+}
+
+
+static void test_discontinuity_rejected(void) {
+    bno085_timebase_t timebase;
+    bno085_timebase_reset(&timebase);
+
+    int64_t host_us = 0;
+    uint8_t sequence = 0;
+    for (int n = 0; n < 2000; n += 1) {
+        bno085_timebase_update(&timebase, sequence++, INTERVAL_US, host_us);
+        host_us += INTERVAL_US;
+    }
+    TEST_CHECK(timebase.skew_valid);
+    TEST_CHECK_CLOSE(timebase.skew_ppm, 0.0, 1.0);
+
+    // The host stalls for a second (e.g. the poller was blocked), more than 256 reports are missed and the sequence
+    // number aliases. The measurement is far out of range and must not move the estimate.
+    host_us += 1000000;
+    for (int n = 0; n < 2000; n += 1) {
+        bno085_timebase_update(&timebase, sequence++, INTERVAL_US, host_us);
+        host_us += INTERVAL_US;
+    }
+    TEST_CHECK_CLOSE(timebase.skew_ppm, 0.0, 1.0);
+}
+
+
+static void test_extend(void) {
+    int64_t reference_us = 0x1FFFFFF00ll;
+
+    // Same 32 bit epoch
+    TEST_CHECK(bno085_timebase_extend(reference_us, 0xFFFFFE00u) == 0x1FFFFFE00ll);
+
+    // Lower bits wrapped after the reference
+    TEST_CHECK(bno085_timebase_extend(reference_us, 0x00000100u) == 0x200000100ll);
+
+    // Lower bits before the reference, across the wrap
+    TEST_CHECK(bno085_timebase_extend(0x200000100ll, 0xFFFFFF00u) == 0x1FFFFFF00ll);
+}
+
+
+static void test_sample_age(void) {
+    // No sample yet, even with an uninitialized timestamp
+    TEST_CHECK(bno085_timebase_sample_age_us(5000000, 0, 0) == -1);
+    TEST_CHECK(bno085_timebase_sample_age_us(5000000, 0, 4990000) == -1);
+
+    // Age from the sensor time, not from the arrival
+    TEST_CHECK(bno085_timebase_sample_age_us(5000000, 4998000, 4995000) == 5000);
+    TEST_CHECK(bno085_timebase_sample_age_us(4998000, 4998000, 4995000) == 3000);
+}
+
+
+int main(void) {
+    test_skew_estimate();
+    test_correct();
+    test_batch_drift();
+    test_discontinuity_rejected();
+    test_extend();
+    test_sample_age();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,46 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+/**
+ * Minimal assertion helpers shared by the host tests. A failed check is reported and counted, the test keeps running so
+ * one run shows every failure. Return TEST_RESULT() from main().
+ */
+
+static int test_failure_count = 0;
+
+
+#define TEST_CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        test_failure_count += 1; \
+    } \
+} while (0)
+
+
+#define TEST_CHECK_CLOSE(actual, expected, tolerance) do { \
+    double actual_ = (actual), expected_ = (expected); \
+    if (!(fabs(actual_ - expected_) <= (tolerance))) { \
+        fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__, #actual, actual_, expected_, (double) (tolerance)); \
+        test_failure_count += 1; \
+    } \
+} while (0)
+
+
+#define TEST_RESULT() (test_failure_count == 0 ? 0 : 1)
+
+
+/**
+ * @brief Monotonic time in ns, for the benchmarks.
+ */
+static inline int64_t test_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,229 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+#include "fast_math.h"
+
+/**
+ * Error bounds of the fast_math.h approximations against double precision libm, and their speed against float libm.
+ * By default every 256th float of each input range is checked, pass --exhaustive to check every float.
+ */
+
+#define ATAN_MAX_ERROR 1.2e-5
+#define ASIN_MAX_ERROR 1.2e-5
+#define TAN_MAX_RELATIVE_ERROR 1.4e-5
+#define TAN_MAX_INPUT 1.55f
+#define WRAP_MAX_ERROR 3.5e-7
+#define WRAP_MAX_INPUT 20.0f
+#define DISPLAY_BUDGET_RAD 1.745e-4     // 0.01 deg
+
+#define BENCHMARK_COUNT 4096
+#define BENCHMARK_ROUNDS 2000
+
+
+static uint32_t float_stride = 256;
+
+
+static float next_float(float x) {
+    // Step `float_stride` representable floats up
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    if (x == 0.0f) {
+        bits = 0;
+    }
+    if ((bits & 0x80000000u) != 0) {
+        // Negative, towards zero
+        bits = (bits & 0x7FFFFFFFu) <= float_stride ? 0 : bits - float_stride;
+    }
+    else {
+        bits += float_stride;
+    }
+    memcpy(&x, &bits, sizeof(bits));
+    return x;
+}
+
+
+static double wrap_reference(double rad) {
+    double wrapped = fmod(rad + M_PI, 2.0 * M_PI);
+    if (wrapped < 0) {
+        wrapped += 2.0 * M_PI;
+    }
+    return wrapped - M_PI;
+}
+
+
+static void test_atan_unit(void) {
+    double max_error = 0;
+    for (float x = 0.0f; x <= 1.0f; x = next_float(x)) {
+        double error = fabs((double) fast_atan_unit(x) - atan((double) x));
+        max_error = error > max_error ? error : max_error;
+    }
+    printf("fast_atan_unit: max error %.3g rad\n", max_error);
+    TEST_CHECK(max_error <= ATAN_MAX_ERROR);
+}
+
+
+static void test_atan2(void) {
+    // Every direction on a fine angular grid at several magnitudes, plus the axes and the origin
+    double max_error = 0;
+    const float magnitudes[] = {1e-6f, 1.0f, 9.81f, 1e6f};
+    for (size_t m = 0; m < sizeof(magnitudes) / sizeof(magnitudes[0]); m += 1) {
+        for (int i = 0; i < 2000000; i += 1) {
+            double angle = -M_PI + 2.0 * M_PI * i / 2000000;
+            float y = magnitudes[m] * (float) sin(angle);
+            float x = magnitudes[m] * (float) cos(angle);
+            double error = fabs((double) fast_atan2f(y, x) - atan2((double) y, (double) x));
+            // Both sides of the branch cut are the same angle
+            error = fmin(error, fabs(error - 2.0 * M_PI));
+            max_error = error > max_error ? error : max_error;
+        }
+    }
+    printf("fast_atan2f: max error %.3g rad\n", max_error);
+    TEST_CHECK(max_error <= ATAN_MAX_ERROR);
+
+    TEST_CHECK(fast_atan2f(0.0f, 0.0f) == 0.0f);
+    TEST_CHECK_CLOSE(fast_atan2f(1.0f, 0.0f), M_PI_2, ATAN_MAX_ERROR);
+    TEST_CHECK_CLOSE(fast_atan2f(-1.0f, 0.0f), -M_PI_2, ATAN_MAX_ERROR);
+    TEST_CHECK_CLOSE(fast_atan2f(0.0f, -1.0f), M_PI, ATAN_MAX_ERROR);
+}
+
+
+static void test_asin(void) {
+    double max_error = 0;
+    for (float x = -1.0f; x <= 1.0f; x = next_float(x)) {
+        double error = fabs((double) fast_asinf(x) - asin((double) x));
+        max_error = error > max_error ? error : max_error;
+    }
+    printf("fast_asinf: max error %.3g rad\n", max_error);
+    TEST_CHECK(max_error <= ASIN_MAX_ERROR);
+
+    // Clamped outside of the domain, e.g. a gravity component slightly above 1 g after normalization rounding
+    TEST_CHECK_CLOSE(fast_asinf(1.0001f), M_PI_2, ASIN_MAX_ERROR);
+    TEST_CHECK_CLOSE(fast_asinf(-1.0001f), -M_PI_2, ASIN_MAX_ERROR);
+}
+
+
+static void test_tan(void) {
+    double max_error = 0;
+    for (float x = -TAN_MAX_INPUT; x <= TAN_MAX_INPUT; x = next_float(x)) {
+        double reference = tan((double) x);
+        double error = fabs((double) fast_tanf(x) - reference) / fmax(fabs(reference), 1.0);
+        max_error = error > max_error ? error : max_error;
+    }
+
+    // Periodic, the display passes angles beyond pi/2 when the screen is rotated
+    for (int i = -100000; i <= 100000; i += 1) {
+        float x = (float) i * 1e-4f;
+        double reference = tan((double) x);
+        if (fabs(reference) > tan(TAN_MAX_INPUT)) {
+            continue;
+        }
+        double error = fabs((double) fast_tanf(x) - reference) / fmax(fabs(reference), 1.0);
+        max_error = error > max_error ? error : max_error;
+    }
+    printf("fast_tanf: max relative error %.3g\n", max_error);
+    TEST_CHECK(max_error <= TAN_MAX_RELATIVE_ERROR);
+}
+
+
+static void test_wrap(void) {
+    double max_error = 0;
+    for (float x = -WRAP_MAX_INPUT; x <= WRAP_MAX_INPUT; x = next_float(x)) {
+        double wrapped = fast_wrap_angle(x);
+        double error = fabs(wrapped - wrap_reference(x));
+        // -pi and pi are the same angle
+        error = fmin(error, fabs(error - 2.0 * M_PI));
+        max_error = error > max_error ? error : max_error;
+        if (wrapped < -M_PI - 1e-6 || wrapped > M_PI + 1e-6) {
+            max_error = INFINITY;
+        }
+    }
+    printf("fast_wrap_angle: max error %.3g rad\n", max_error);
+    TEST_CHECK(max_error <= WRAP_MAX_ERROR);
+}
+
+
+static void test_display_budget(void) {
+    // The documented bounds are what the level relies on
+    TEST_CHECK(ATAN_MAX_ERROR < DISPLAY_BUDGET_RAD);
+    TEST_CHECK(ASIN_MAX_ERROR < DISPLAY_BUDGET_RAD);
+    TEST_CHECK(WRAP_MAX_ERROR < DISPLAY_BUDGET_RAD);
+}
+
+
+typedef float (*unary_t)(float);
+typedef float (*binary_t)(float, float);
+
+static float fast_atan2f_fn(float y, float x) { return fast_atan2f(y, x); }
+static float fast_asinf_fn(float x) { return fast_asinf(x); }
+static float fast_tanf_fn(float x) { return fast_tanf(x); }
+static float fast_wrap_angle_fn(float x) { return fast_wrap_angle(x); }
+static float libm_wrap_fn(float x) { return fmodf(x + FAST_MATH_PI, FAST_MATH_2_PI) - FAST_MATH_PI; }
+
+
+static double benchmark_unary(unary_t fn, const float *input) {
+    volatile float sink = 0;
+    int64_t start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        float sum = 0;
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            sum += fn(input[i]);
+        }
+        sink += sum;
+    }
+    (void) sink;
+    return (double) (test_time_ns() - start_ns) / ((double) BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+}
+
+
+static double benchmark_binary(binary_t fn, const float *input_y, const float *input_x) {
+    volatile float sink = 0;
+    int64_t start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        float sum = 0;
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            sum += fn(input_y[i], input_x[i]);
+        }
+        sink += sum;
+    }
+    (void) sink;
+    return (double) (test_time_ns() - start_ns) / ((double) BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+}
+
+
+/**
+ * Host timings only indicate the relative cost, the ESP32-S3 has a single precision FPU and no vector unit.
+ */
+static void benchmark(void) {
+    static float angles[BENCHMARK_COUNT], unit[BENCHMARK_COUNT], y[BENCHMARK_COUNT], x[BENCHMARK_COUNT], wide[BENCHMARK_COUNT];
+    srand(1);
+    for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+        angles[i] = ((float) rand() / (float) RAND_MAX * 2.0f - 1.0f) * 1.5f;
+        unit[i] = (float) rand() / (float) RAND_MAX * 2.0f - 1.0f;
+        y[i] = (float) rand() / (float) RAND_MAX * 2.0f - 1.0f;
+        x[i] = (float) rand() / (float) RAND_MAX * 2.0f - 1.0f;
+        wide[i] = ((float) rand() / (float) RAND_MAX * 2.0f - 1.0f) * WRAP_MAX_INPUT;
+    }
+
+    printf("atan2: fast %.2f ns, libm %.2f ns\n", benchmark_binary(fast_atan2f_fn, y, x), benchmark_binary(atan2f, y, x));
+    printf("asin:  fast %.2f ns, libm %.2f ns\n", benchmark_unary(fast_asinf_fn, unit), benchmark_unary(asinf, unit));
+    printf("tan:   fast %.2f ns, libm %.2f ns\n", benchmark_unary(fast_tanf_fn, angles), benchmark_unary(tanf, angles));
+    printf("wrap:  fast %.2f ns, fmodf %.2f ns\n", benchmark_unary(fast_wrap_angle_fn, wide), benchmark_unary(libm_wrap_fn, wide));
+}
+
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--exhaustive") == 0) {
+        float_stride = 1;
+    }
+
+    test_atan_unit();
+    test_atan2();
+    test_asin();
+    test_tan();
+    test_wrap();
+    test_display_budget();
+    benchmark();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "fusion_fallback.h"
+#include "rate_governor.h"
+
+/**
+ * The level's fusion fallback against the interval floor of the rate governor. The stability classifier drives the
+ * governor, whose floor slows the game rotation vector down from its requested interval while the device rests. The
+ * level wakes up on every sample and at least every fallback timeout, as unified_sensor_poller_task() does, and decides
+ * whether the game rotation vector is missing. Every start or stop of the fallback sends set feature commands (the
+ * gyroscope and accelerometer), so at rest it must not flip, while a real gap (sensor recovery) must still be caught.
+ *
+ * The fixed timeout checked before draining the samples, as the level did before, is run alongside for reference.
+ */
+
+#define STEP_US 1000
+#define CLASSIFIER_PERIOD_US 100000     // SENSOR_STABILITY_CLASSIFIER_REPORT_PERIOD_MS
+#define SETTLE_US 2000000               // SENSOR_RATE_GOVERNOR_SETTLE_MS
+#define STATIC_FLOOR_MS 100             // SENSOR_RATE_GOVERNOR_STATIC_REPORT_PERIOD_MS
+#define REQUESTED_INTERVAL_US 20000     // SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS
+#define MIN_TIMEOUT_US 100000           // DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_MS
+#define TIMEOUT_INTERVALS 3             // DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_INTERVALS
+#define WAKE_BOUND_US 110000            // Fallback timeout plus a tick, the level wakes up at least this often
+#define COMMAND_LATENCY_US 5000         // Set feature command to the first report at the new interval
+#define JITTER_US 3000                  // Peak arrival jitter of the samples
+
+#define MAX_PENDING 16
+
+
+typedef struct {
+    uint8_t classification;
+    int64_t duration_us;
+    bool dropout;                       // The sensor sends no game rotation vector (e.g. recovering)
+} segment_t;
+
+
+typedef struct {
+    bool drain_first;                   // Drain the samples before deciding, the fixed timeout checked before
+    fusion_fallback_t timeout;          // Used when drain_first
+    int64_t last_sample_us;             // Used by the fixed timeout
+    bool active;
+    int64_t last_wake_us;
+    uint32_t flip_count;                // Starts and stops, each one sends set feature commands
+    int64_t started_us;                 // Last start of the fallback, -1 if never
+    int64_t stopped_us;
+} level_t;
+
+
+typedef struct {
+    rate_governor_t governor;
+    uint32_t interval_us;               // Effective interval, as returned by bno085_get_report_interval_us()
+    int64_t next_sample_us;             // Nominal time of the next sample at the sensor
+    int64_t pending[MAX_PENDING];       // Arrival times of the samples not drained yet, sorted
+    size_t pending_count;
+    int64_t now_us;
+    level_t levels[2];
+} simulation_t;
+
+
+static uint32_t rng_state = 1;
+
+static int32_t jitter_us(void) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (int32_t) (rng_state >> 16) % (2 * JITTER_US + 1) - JITTER_US;
+}
+
+
+static void init(simulation_t *sim) {
+    memset(sim, 0, sizeof(simulation_t));
+    rate_governor_config_t governor_config = {
+        .settle_us = SETTLE_US,
+        .static_interval_floor_ms = STATIC_FLOOR_MS,
+    };
+    rate_governor_init(&sim->governor, &governor_config);
+    sim->interval_us = REQUESTED_INTERVAL_US;
+    sim->next_sample_us = REQUESTED_INTERVAL_US;
+
+    fusion_fallback_config_t fallback_config = {
+        .min_timeout_us = MIN_TIMEOUT_US,
+        .timeout_intervals = TIMEOUT_INTERVALS,
+    };
+    for (int i = 0; i < 2; i += 1) {
+        level_t *level = &sim->levels[i];
+        level->drain_first = i == 0;
+        fusion_fallback_init(&level->timeout, &fallback_config, 0);
+        level->started_us = -1;
+        level->stopped_us = -1;
+    }
+}
+
+
+static void wake(simulation_t *sim, level_t *level, size_t drained_count) {
+    level->last_wake_us = sim->now_us;
+
+    bool missing;
+    if (level->drain_first) {
+        for (size_t i = 0; i < drained_count; i += 1) {
+            fusion_fallback_kick(&level->timeout, sim->pending[i], sim->interval_us);
+        }
+        missing = fusion_fallback_is_missing(&level->timeout, sim->now_us, sim->interval_us);
+    }
+    else {
+        missing = sim->now_us - level->last_sample_us > MIN_TIMEOUT_US;
+        if (drained_count > 0) {
+            level->last_sample_us = sim->pending[drained_count - 1];
+        }
+    }
+
+    if (missing != level->active) {
+        level->active = missing;
+        level->flip_count += 1;
+        if (missing) {
+            level->started_us = sim->now_us;
+        }
+        else {
+            level->stopped_us = sim->now_us;
+        }
+    }
+}
+
+
+static void run(simulation_t *sim, const segment_t *segments, size_t count) {
+    for (size_t segment = 0; segment < count; segment += 1) {
+        int64_t end_us = sim->now_us + segments[segment].duration_us;
+        for (; sim->now_us < end_us; sim->now_us += STEP_US) {
+            // The governor task applies the floor on a classifier report, the sensor restarts at the new interval
+            if (sim->now_us % CLASSIFIER_PERIOD_US == 0 &&
+                rate_governor_update(&sim->governor, sim->now_us, segments[segment].classification)) {
+                uint32_t floor_us = rate_governor_get_interval_floor_ms(&sim->governor) * 1000;
+                sim->interval_us = floor_us > REQUESTED_INTERVAL_US ? floor_us : REQUESTED_INTERVAL_US;
+                sim->next_sample_us = sim->now_us + COMMAND_LATENCY_US + sim->interval_us;
+            }
+
+            // The sensor
+            if (sim->now_us >= sim->next_sample_us) {
+                if (!segments[segment].dropout && sim->pending_count < MAX_PENDING) {
+                    sim->pending[sim->pending_count++] = sim->next_sample_us + JITTER_US + jitter_us();
+                }
+                sim->next_sample_us += sim->interval_us;
+            }
+
+            // The level, woken up by a sample or by its wait bound
+            size_t arrived_count = 0;
+            while (arrived_count < sim->pending_count && sim->pending[arrived_count] <= sim->now_us) {
+                arrived_count += 1;
+            }
+            for (int i = 0; i < 2; i += 1) {
+                level_t *level = &sim->levels[i];
+                if (arrived_count > 0 || (!level->active && sim->now_us - level->last_wake_us >= WAKE_BOUND_US)) {
+                    wake(sim, level, arrived_count);
+                }
+            }
+            memmove(sim->pending, sim->pending + arrived_count, (sim->pending_count - arrived_count) * sizeof(int64_t));
+            sim->pending_count -= arrived_count;
+        }
+    }
+}
+
+
+static void test_rest(void) {
+    // Aiming, resting on the bench long enough for the floor, picked up, put down again
+    simulation_t sim;
+    init(&sim);
+    segment_t segments[] = {
+        {RATE_GOVERNOR_CLASSIFICATION_MOTION, 1000000, false},
+        {RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 10000000, false},
+        {RATE_GOVERNOR_CLASSIFICATION_MOTION, 1000000, false},
+        {RATE_GOVERNOR_CLASSIFICATION_STATIONARY, 5000000, false},
+    };
+    run(&sim, segments, sizeof(segments) / sizeof(segments[0]));
+
+    printf("rest: %lu governor mode changes, fallback flips: %lu with the interval timeout, %lu with the fixed timeout\n",
+           (unsigned long) sim.governor.stats.mode_change_count, (unsigned long) sim.levels[0].flip_count,
+           (unsigned long) sim.levels[1].flip_count);
+
+    TEST_CHECK(sim.governor.stats.mode_change_count == 3);
+    TEST_CHECK(sim.levels[0].flip_count == 0);
+    TEST_CHECK(!sim.levels[0].active);
+
+    // The fixed timeout at the floor interval flips on the samples at rest
+    TEST_CHECK(sim.levels[1].flip_count > 10);
+}
+
+
+static void test_gap(bool at_rest) {
+    // The sensor recovers, no game rotation vector for a second
+    simulation_t sim;
+    init(&sim);
+    uint8_t classification = at_rest ? RATE_GOVERNOR_CLASSIFICATION_ON_TABLE : RATE_GOVERNOR_CLASSIFICATION_MOTION;
+    segment_t before[] = {{classification, 4000000, false}};
+    run(&sim, before, 1);
+    TEST_CHECK(sim.interval_us == (at_rest ? STATIC_FLOOR_MS * 1000u : REQUESTED_INTERVAL_US));
+
+    int64_t gap_start_us = sim.now_us;
+    segment_t gap[] = {
+        {classification, 1000000, true},
+        {classification, 1000000, false},
+    };
+    run(&sim, gap, 2);
+
+    // The last sample came at most an interval and the jitter before the gap
+    level_t *level = &sim.levels[0];
+    int64_t detection_us = level->started_us - gap_start_us;
+    int64_t max_detection_us = fusion_fallback_get_timeout_us(&level->timeout, sim.interval_us) + WAKE_BOUND_US + 2 * JITTER_US;
+    printf("gap %s: fallback started %.1f ms into the gap (at most %.1f ms), stopped %.1f ms after it\n", at_rest ? "at rest" : "in motion",
+           detection_us / 1000.0, max_detection_us / 1000.0, (level->stopped_us - gap_start_us - 1000000) / 1000.0);
+
+    TEST_CHECK(level->flip_count == 2);
+    TEST_CHECK(level->started_us > gap_start_us);
+    TEST_CHECK(detection_us <= max_detection_us);
+    TEST_CHECK(level->stopped_us >= gap_start_us + 1000000);
+    TEST_CHECK(level->stopped_us <= gap_start_us + 1000000 + sim.interval_us + 2 * JITTER_US);
+    TEST_CHECK(!level->active);
+}
+
+
+static void test_timeout(void) {
+    fusion_fallback_config_t config = {
+        .min_timeout_us = MIN_TIMEOUT_US,
+        .timeout_intervals = TIMEOUT_INTERVALS,
+    };
+    fusion_fallback_t fallback;
+    fusion_fallback_init(&fallback, &config, 1000000);
+
+    // The minimum covers the fast reports and an unknown interval
+    TEST_CHECK(fusion_fallback_get_timeout_us(&fallback, 0) == MIN_TIMEOUT_US);
+    TEST_CHECK(fusion_fallback_get_timeout_us(&fallback, REQUESTED_INTERVAL_US) == MIN_TIMEOUT_US);
+    TEST_CHECK(fusion_fallback_get_timeout_us(&fallback, 100000) == 300000);
+    TEST_CHECK(fusion_fallback_get_timeout_us(&fallback, UINT32_MAX) == UINT32_MAX);
+    TEST_CHECK(!fusion_fallback_is_missing(&fallback, 1000000 + MIN_TIMEOUT_US, 0));
+    TEST_CHECK(fusion_fallback_is_missing(&fallback, 1000000 + MIN_TIMEOUT_US + 1, 0));
+
+    // Slowed down after the last sample: the gap of the new interval
+    fusion_fallback_kick(&fallback, 2000000, REQUESTED_INTERVAL_US);
+    TEST_CHECK(!fusion_fallback_is_missing(&fallback, 2250000, 100000));
+    TEST_CHECK(fusion_fallback_is_missing(&fallback, 2250000, REQUESTED_INTERVAL_US));
+
+    // Sped up after the last sample: the gap of the interval it came at
+    fusion_fallback_kick(&fallback, 3000000, 100000);
+    TEST_CHECK(!fusion_fallback_is_missing(&fallback, 3250000, REQUESTED_INTERVAL_US));
+    TEST_CHECK(fusion_fallback_is_missing(&fallback, 3300001, REQUESTED_INTERVAL_US));
+}
+
+
+int main(void) {
+    test_timeout();
+    test_rest();
+    test_gap(false);
+    test_gap(true);
+
+    return TEST_RESULT();
+}
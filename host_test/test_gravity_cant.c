@@ -0,0 +1,242 @@
+#include <string.h>
+
+#include "test_common.h"
+#include "gravity_cant.h"
+#include "fast_math.h"
+
+/**
+ * Cant and pitch from the gravity direction against the Euler path it replaces (roll from the quaternion, minus the
+ * screen rotation, plus the user offset, wrapped), in double precision, over the working envelope of the level and up to
+ * steep shooting angles. Also compares the cost per sample with the float Euler path of the driver.
+ */
+
+#define DEG_TO_RAD(deg) ((deg) * M_PI / 180.0)
+#define RAD_TO_DEG(rad) ((rad) * 180.0 / M_PI)
+
+#define WORKING_PITCH_DEG 60            // Level held up to this pitch
+#define STEEP_PITCH_DEG 89
+#define CANT_MAX_ERROR_RAD 3.0e-5       // display_atan2f bound plus the float rounding of the inputs
+#define STEEP_CANT_MAX_ERROR_RAD 5.0e-5
+#define PITCH_MAX_ERROR_RAD 3.0e-5
+
+#define BENCHMARK_COUNT 4096
+#define BENCHMARK_ROUNDS 1000
+
+
+typedef struct {
+    double w, x, y, z;
+} reference_quaternion_t;
+
+
+static const float user_offsets_rad[] = {0.0f, 0.05f, -0.3f, 3.0f};
+
+
+static reference_quaternion_t from_euler(double roll, double pitch, double yaw) {
+    // Z-Y-X (yaw, pitch, roll), the convention of the driver
+    double cr = cos(roll * 0.5), sr = sin(roll * 0.5);
+    double cp = cos(pitch * 0.5), sp = sin(pitch * 0.5);
+    double cy = cos(yaw * 0.5), sy = sin(yaw * 0.5);
+    reference_quaternion_t q = {
+        .w = cr * cp * cy + sr * sp * sy,
+        .x = sr * cp * cy - cr * sp * sy,
+        .y = cr * sp * cy + sr * cp * sy,
+        .z = cr * cp * sy - sr * sp * cy,
+    };
+    return q;
+}
+
+
+static double wrap_reference(double rad) {
+    double wrapped = fmod(rad + M_PI, 2.0 * M_PI);
+    if (wrapped < 0) {
+        wrapped += 2.0 * M_PI;
+    }
+    return wrapped - M_PI;
+}
+
+
+static void euler_reference(const reference_quaternion_t *q, uint32_t rotation, float user_offset_rad, double *cant, double *pitch) {
+    double roll = atan2(2.0 * (q->w * q->x + q->y * q->z), 1.0 - 2.0 * (q->x * q->x + q->y * q->y));
+    *cant = wrap_reference(roll - rotation * M_PI_2 + user_offset_rad);
+    *pitch = asin(fmax(-1.0, fmin(1.0, 2.0 * (q->w * q->y - q->z * q->x))));
+}
+
+
+static double angle_error(double actual, double expected) {
+    return fabs(wrap_reference(actual - expected));
+}
+
+
+/**
+ * Max cant and pitch error over roll in [-180, 180) deg and pitch in [-max_pitch, max_pitch] deg, for every screen
+ * rotation, user offset and a few headings.
+ */
+static void sweep(double max_pitch_deg, double pitch_step_deg, double *max_cant_error, double *max_pitch_error) {
+    static const double yaws_deg[] = {0.0, 90.0, -135.0};
+    *max_cant_error = 0;
+    *max_pitch_error = 0;
+
+    for (uint32_t rotation = 0; rotation < 4; rotation += 1) {
+        for (size_t o = 0; o < sizeof(user_offsets_rad) / sizeof(user_offsets_rad[0]); o += 1) {
+            gravity_cant_frame_t frame;
+            gravity_cant_set_frame(&frame, rotation, user_offsets_rad[o]);
+
+            for (size_t y = 0; y < sizeof(yaws_deg) / sizeof(yaws_deg[0]); y += 1) {
+                for (double pitch_deg = -max_pitch_deg; pitch_deg <= max_pitch_deg + 1e-9; pitch_deg += pitch_step_deg) {
+                    for (double roll_deg = -180.0; roll_deg < 180.0; roll_deg += 1.0) {
+                        reference_quaternion_t q = from_euler(DEG_TO_RAD(roll_deg), DEG_TO_RAD(pitch_deg), DEG_TO_RAD(yaws_deg[y]));
+                        double expected_cant, expected_pitch;
+                        euler_reference(&q, rotation, user_offsets_rad[o], &expected_cant, &expected_pitch);
+
+                        float gravity[3];
+                        gravity_from_quaternion((float) q.w, (float) q.x, (float) q.y, (float) q.z, gravity);
+                        float cant, pitch;
+                        gravity_cant_compute(&frame, gravity, &cant, &pitch);
+
+                        TEST_CHECK(cant >= -FAST_MATH_PI - 1e-6f && cant <= FAST_MATH_PI + 1e-6f);
+                        *max_cant_error = fmax(*max_cant_error, angle_error(cant, expected_cant));
+                        *max_pitch_error = fmax(*max_pitch_error, fabs(pitch - expected_pitch));
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+static void test_working_envelope(void) {
+    double max_cant_error, max_pitch_error;
+    sweep(WORKING_PITCH_DEG, 1.0, &max_cant_error, &max_pitch_error);
+    printf("pitch within %d deg: max cant error %.2e deg, max pitch error %.2e deg\n", WORKING_PITCH_DEG,
+           RAD_TO_DEG(max_cant_error), RAD_TO_DEG(max_pitch_error));
+    TEST_CHECK(max_cant_error < CANT_MAX_ERROR_RAD);
+    TEST_CHECK(max_pitch_error < PITCH_MAX_ERROR_RAD);
+}
+
+
+static void test_steep_pitch(void) {
+    // The roll is ill-conditioned towards vertical, the error follows the float rounding of the quaternion
+    double max_cant_error, max_pitch_error;
+    sweep(STEEP_PITCH_DEG, 0.5, &max_cant_error, &max_pitch_error);
+    printf("pitch within %d deg: max cant error %.2e deg, max pitch error %.2e deg\n", STEEP_PITCH_DEG,
+           RAD_TO_DEG(max_cant_error), RAD_TO_DEG(max_pitch_error));
+    TEST_CHECK(max_cant_error < STEEP_CANT_MAX_ERROR_RAD);
+    TEST_CHECK(max_pitch_error < PITCH_MAX_ERROR_RAD);
+
+    // Past the singularity of the asin the pitch of the Euler path stalls, the gravity path keeps resolving it
+    reference_quaternion_t q = from_euler(DEG_TO_RAD(10.0), DEG_TO_RAD(89.95), 0.0);
+    float gravity[3];
+    gravity_from_quaternion((float) q.w, (float) q.x, (float) q.y, (float) q.z, gravity);
+    gravity_cant_frame_t frame;
+    gravity_cant_set_frame(&frame, 0, 0.0f);
+    float cant, pitch;
+    gravity_cant_compute(&frame, gravity, &cant, &pitch);
+    float euler_pitch = asinf(fminf(1.0f, 2.0f * ((float) q.w * (float) q.y - (float) q.z * (float) q.x)));
+    printf("pitch 89.95 deg: gravity %.4f deg, float asin %.4f deg\n", RAD_TO_DEG(pitch), RAD_TO_DEG(euler_pitch));
+    TEST_CHECK_CLOSE(RAD_TO_DEG(pitch), 89.95, 0.005);
+    TEST_CHECK_CLOSE(RAD_TO_DEG(cant), 10.0, 0.05);
+}
+
+
+static void test_unnormalized(void) {
+    // Only the direction of gravity is used, the quaternion of the sensor is not renormalized
+    gravity_cant_frame_t frame;
+    gravity_cant_set_frame(&frame, 1, 0.05f);
+    reference_quaternion_t q = from_euler(DEG_TO_RAD(25.0), DEG_TO_RAD(-12.0), DEG_TO_RAD(40.0));
+
+    float gravity[3], scaled_gravity[3];
+    gravity_from_quaternion((float) q.w, (float) q.x, (float) q.y, (float) q.z, gravity);
+    gravity_from_quaternion(0.98f * (float) q.w, 0.98f * (float) q.x, 0.98f * (float) q.y, 0.98f * (float) q.z, scaled_gravity);
+
+    float cant, pitch, scaled_cant, scaled_pitch;
+    gravity_cant_compute(&frame, gravity, &cant, &pitch);
+    gravity_cant_compute(&frame, scaled_gravity, &scaled_cant, &scaled_pitch);
+    TEST_CHECK_CLOSE(scaled_cant, cant, 1e-6);
+    TEST_CHECK_CLOSE(scaled_pitch, pitch, 1e-6);
+
+    // Same for a gravity report in m/s^2
+    float report[3] = {9.80665f * gravity[0], 9.80665f * gravity[1], 9.80665f * gravity[2]};
+    float report_cant;
+    gravity_cant_compute(&frame, report, &report_cant, NULL);
+    TEST_CHECK_CLOSE(report_cant, cant, 1e-6);
+}
+
+
+static void test_frame(void) {
+    gravity_cant_frame_t frame;
+    gravity_cant_set_frame(&frame, 3, -0.25f);
+    TEST_CHECK(frame.rotation == 3);
+    TEST_CHECK(frame.user_roll_rad_offset == -0.25f);
+    TEST_CHECK_CLOSE(frame.offset_rad, -0.25 - 3 * M_PI_2, 1e-6);
+    TEST_CHECK_CLOSE(frame.cos_offset, cos(-0.25 - 3 * M_PI_2), 1e-6);
+    TEST_CHECK_CLOSE(frame.sin_offset, sin(-0.25 - 3 * M_PI_2), 1e-6);
+
+    // Level device, the cant is the frame offset
+    float gravity[3] = {0.0f, 0.0f, 1.0f};
+    float cant;
+    gravity_cant_compute(&frame, gravity, &cant, NULL);
+    TEST_CHECK(angle_error(cant, frame.offset_rad) < CANT_MAX_ERROR_RAD);
+}
+
+
+static void euler_f32(const float *q, float *roll, float *pitch) {
+    // Same as quaternion_to_euler_f32() of the driver, without the yaw the level doesn't use
+    float inv_norm = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    float w = q[0] * inv_norm, x = q[1] * inv_norm, y = q[2] * inv_norm, z = q[3] * inv_norm;
+    *roll = atan2f(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+    float t = 2.0f * (w * y - z * x);
+    t = t > 1.0f ? 1.0f : t;
+    t = t < -1.0f ? -1.0f : t;
+    *pitch = asinf(t);
+}
+
+
+static void benchmark(void) {
+    static float quaternions[BENCHMARK_COUNT][4];
+    for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+        reference_quaternion_t q = from_euler(DEG_TO_RAD((i % 360) - 180.0), DEG_TO_RAD((i % 120) - 60.0), DEG_TO_RAD(i % 90));
+        quaternions[i][0] = (float) q.w;
+        quaternions[i][1] = (float) q.x;
+        quaternions[i][2] = (float) q.y;
+        quaternions[i][3] = (float) q.z;
+    }
+    gravity_cant_frame_t frame;
+    gravity_cant_set_frame(&frame, 1, 0.05f);
+    volatile float sink = 0;
+
+    int64_t start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            float gravity[3], cant, pitch;
+            gravity_from_quaternion(quaternions[i][0], quaternions[i][1], quaternions[i][2], quaternions[i][3], gravity);
+            gravity_cant_compute(&frame, gravity, &cant, &pitch);
+            sink += cant + pitch;
+        }
+    }
+    double gravity_ns = (double) (test_time_ns() - start_ns) / (BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+
+    start_ns = test_time_ns();
+    for (int round = 0; round < BENCHMARK_ROUNDS; round += 1) {
+        for (int i = 0; i < BENCHMARK_COUNT; i += 1) {
+            float roll, pitch;
+            euler_f32(quaternions[i], &roll, &pitch);
+            float cant = roll - frame.rotation * FAST_MATH_PI_2 + frame.user_roll_rad_offset;
+            sink += fast_wrap_angle(cant) + pitch;
+        }
+    }
+    double euler_ns = (double) (test_time_ns() - start_ns) / (BENCHMARK_ROUNDS * BENCHMARK_COUNT);
+
+    printf("per sample: gravity cant %.1f ns, float Euler %.1f ns\n", gravity_ns, euler_ns);
+    (void) sink;
+}
+
+
+int main(void) {
+    test_working_envelope();
+    test_steep_pitch();
+    test_unnormalized();
+    test_frame();
+    benchmark();
+
+    return TEST_RESULT();
+}
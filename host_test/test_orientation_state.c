@@ -0,0 +1,192 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "orientation_state.h"
+
+/**
+ * Stress test of the orientation state latch: one writer publishing as fast as it can, several readers taking
+ * snapshots. Every field of a published state is derived from the same counter, so a snapshot mixing two states is
+ * detected, as is a snapshot older than one already seen by the same reader.
+ *
+ *   test_orientation_state [duration_s]
+ */
+
+#define READER_COUNT 4
+
+
+static orientation_state_latch_t latch;
+static volatile int running = 1;
+static uint64_t publish_count;
+
+
+typedef struct {
+    uint64_t read_count;
+    uint64_t torn_count;
+    uint64_t backward_count;
+} reader_result_t;
+
+
+static void make_state(uint32_t n, orientation_state_t *state) {
+    state->roll_rad = (float) n;
+    state->pitch_rad = (float) n * 0.5f;
+    state->yaw_rad = -(float) n;
+    state->orientation_timestamp_us = (int64_t) n * 2500;
+    state->x_acceleration = (float) (n & 0xFFFF);
+    state->y_acceleration = (float) (n >> 16);
+    state->z_acceleration = (float) (n ^ 0x5A5A);
+    state->acceleration_timestamp_us = (int64_t) n * 2500 + 1;
+    state->shot_timestamp_us = (int64_t) n << 20;
+    state->shot_cant_rad = (float) (n % 1000);
+    state->shot_pitch_rad = (float) (n % 977);
+}
+
+
+/**
+ * @return The counter the state is made from, or -1 if the fields disagree.
+ */
+static int64_t check_state(const orientation_state_t *state) {
+    uint32_t n = (uint32_t) (state->orientation_timestamp_us / 2500);
+    orientation_state_t expected;
+    make_state(n, &expected);
+
+    // Field by field, the padding is not copied consistently
+    bool consistent = state->roll_rad == expected.roll_rad && state->pitch_rad == expected.pitch_rad &&
+                      state->yaw_rad == expected.yaw_rad && state->orientation_timestamp_us == expected.orientation_timestamp_us &&
+                      state->x_acceleration == expected.x_acceleration && state->y_acceleration == expected.y_acceleration &&
+                      state->z_acceleration == expected.z_acceleration && state->acceleration_timestamp_us == expected.acceleration_timestamp_us &&
+                      state->shot_timestamp_us == expected.shot_timestamp_us && state->shot_cant_rad == expected.shot_cant_rad &&
+                      state->shot_pitch_rad == expected.shot_pitch_rad;
+    return consistent ? (int64_t) n : -1;
+}
+
+
+static void *writer(void *arg) {
+    int64_t end_ns = test_time_ns() + *(int64_t *) arg;
+    uint32_t n = 0;
+    while (test_time_ns() < end_ns) {
+        // The counter stays below 2^24 so every field is exact in float
+        n = (n + 1) & 0xFFFFFF;
+        if (n == 0) {
+            n = 1;
+        }
+        orientation_state_t state;
+        make_state(n, &state);
+        orientation_state_publish(&latch, &state);
+        publish_count += 1;
+    }
+    running = 0;
+    return NULL;
+}
+
+
+static void *reader(void *arg) {
+    reader_result_t *result = (reader_result_t *) arg;
+    int64_t last_n = 0;
+
+    while (running) {
+        orientation_state_t state;
+        orientation_state_read(&latch, &state);
+        result->read_count += 1;
+
+        int64_t n = check_state(&state);
+        if (n < 0) {
+            result->torn_count += 1;
+        }
+        else if (n < last_n && last_n - n < 0x800000) {
+            // Backward, not the counter wrapping around
+            result->backward_count += 1;
+        }
+        else {
+            last_n = n;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Same readers without the latch, shows the test can see torn states. Only meaningful with more than one CPU.
+ */
+static orientation_state_t unprotected_state;
+
+static void *unprotected_writer(void *arg) {
+    int64_t end_ns = test_time_ns() + *(int64_t *) arg;
+    for (uint32_t n = 1; test_time_ns() < end_ns; n = (n + 1) & 0xFFFFFF) {
+        orientation_state_t state;
+        make_state(n, &state);
+        memcpy((void *) &unprotected_state, &state, sizeof(state));
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    running = 0;
+    return NULL;
+}
+
+static void *unprotected_reader(void *arg) {
+    reader_result_t *result = (reader_result_t *) arg;
+    while (running) {
+        orientation_state_t state;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        memcpy(&state, (const void *) &unprotected_state, sizeof(state));
+        result->read_count += 1;
+        if (check_state(&state) < 0) {
+            result->torn_count += 1;
+        }
+    }
+    return NULL;
+}
+
+
+static void run(void *(*writer_fn)(void *), void *(*reader_fn)(void *), int64_t duration_ns, reader_result_t *total) {
+    pthread_t writer_thread, reader_threads[READER_COUNT];
+    reader_result_t results[READER_COUNT];
+    memset(results, 0, sizeof(results));
+    memset(total, 0, sizeof(reader_result_t));
+    running = 1;
+
+    for (int i = 0; i < READER_COUNT; i += 1) {
+        pthread_create(&reader_threads[i], NULL, reader_fn, &results[i]);
+    }
+    pthread_create(&writer_thread, NULL, writer_fn, &duration_ns);
+
+    pthread_join(writer_thread, NULL);
+    for (int i = 0; i < READER_COUNT; i += 1) {
+        pthread_join(reader_threads[i], NULL);
+        total->read_count += results[i].read_count;
+        total->torn_count += results[i].torn_count;
+        total->backward_count += results[i].backward_count;
+        TEST_CHECK(results[i].read_count > 0);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    int64_t duration_ns = (argc > 1 ? atoll(argv[1]) : 2) * 1000000000ll;
+
+    // The readers start from a valid state, the zeroed one is not made by make_state()
+    orientation_state_t initial_state;
+    make_state(0, &initial_state);
+    orientation_state_init(&latch);
+    orientation_state_publish(&latch, &initial_state);
+    memcpy(&unprotected_state, &initial_state, sizeof(initial_state));
+
+    reader_result_t total;
+    run(writer, reader, duration_ns, &total);
+    printf("latch: %llu publishes, %llu reads by %d readers, %llu torn, %llu backward\n", (unsigned long long) publish_count,
+           (unsigned long long) total.read_count, READER_COUNT, (unsigned long long) total.torn_count, (unsigned long long) total.backward_count);
+    TEST_CHECK(publish_count > 0);
+    TEST_CHECK(total.torn_count == 0);
+    TEST_CHECK(total.backward_count == 0);
+
+    // The last state is readable once the writer is done
+    orientation_state_t state;
+    orientation_state_read(&latch, &state);
+    TEST_CHECK(check_state(&state) > 0);
+
+    run(unprotected_writer, unprotected_reader, duration_ns / 4, &total);
+    printf("unprotected: %llu reads, %llu torn\n", (unsigned long long) total.read_count, (unsigned long long) total.torn_count);
+
+    return TEST_RESULT();
+}
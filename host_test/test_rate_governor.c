@@ -0,0 +1,147 @@
+#include <string.h>
+
+#include "test_common.h"
+#include "rate_governor.h"
+
+/**
+ * Rate governor against scripted stability classifier streams, at the report period of the firmware.
+ */
+
+#define REPORT_PERIOD_US 100000         // SENSOR_STABILITY_CLASSIFIER_REPORT_PERIOD_MS
+#define SETTLE_US 2000000               // SENSOR_RATE_GOVERNOR_SETTLE_MS
+#define STATIC_FLOOR_MS 100             // SENSOR_RATE_GOVERNOR_STATIC_REPORT_PERIOD_MS
+
+
+typedef struct {
+    uint8_t classification;
+    int64_t duration_us;
+} segment_t;
+
+
+static rate_governor_t governor;
+static int64_t now_us;
+static uint32_t mode_change_count;
+static int64_t last_change_us;
+
+
+static void init(void) {
+    rate_governor_config_t config = {
+        .settle_us = SETTLE_US,
+        .static_interval_floor_ms = STATIC_FLOOR_MS,
+    };
+    rate_governor_init(&governor, &config);
+    now_us = 0;
+    mode_change_count = 0;
+    last_change_us = -1;
+}
+
+
+static void replay(const segment_t *segments, size_t count) {
+    for (size_t i = 0; i < count; i += 1) {
+        int64_t end_us = now_us + segments[i].duration_us;
+        for (; now_us < end_us; now_us += REPORT_PERIOD_US) {
+            if (rate_governor_update(&governor, now_us, segments[i].classification)) {
+                mode_change_count += 1;
+                last_change_us = now_us;
+            }
+        }
+    }
+}
+
+
+static void test_settle(void) {
+    // Aiming (stable in hand) never slows the reports down, resting on the table does after the settle time
+    init();
+    segment_t segments[] = {
+        {RATE_GOVERNOR_CLASSIFICATION_MOTION, 1000000},
+        {RATE_GOVERNOR_CLASSIFICATION_STABLE, 10000000},
+    };
+    replay(segments, 2);
+    TEST_CHECK(governor.mode == RATE_GOVERNOR_MODE_ACTIVE);
+    TEST_CHECK(rate_governor_get_interval_floor_ms(&governor) == 0);
+    TEST_CHECK(mode_change_count == 0);
+
+    int64_t rest_start_us = now_us;
+    segment_t rest[] = {{RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 5000000}};
+    replay(rest, 1);
+    TEST_CHECK(governor.mode == RATE_GOVERNOR_MODE_STATIC);
+    TEST_CHECK(rate_governor_get_interval_floor_ms(&governor) == STATIC_FLOOR_MS);
+    TEST_CHECK(mode_change_count == 1);
+    TEST_CHECK(last_change_us == rest_start_us + SETTLE_US);
+    TEST_CHECK(governor.stats.interval_floor_ms == STATIC_FLOOR_MS);
+}
+
+
+static void test_motion_wakes_immediately(void) {
+    // The first report with motion restores the rates, so the delay is one classifier period at most
+    init();
+    segment_t segments[] = {
+        {RATE_GOVERNOR_CLASSIFICATION_STATIONARY, 4000000},
+        {RATE_GOVERNOR_CLASSIFICATION_MOTION, 300000},
+    };
+    replay(segments, 2);
+    TEST_CHECK(governor.mode == RATE_GOVERNOR_MODE_ACTIVE);
+    TEST_CHECK(mode_change_count == 2);
+    TEST_CHECK(last_change_us == 4000000);
+    TEST_CHECK(governor.stats.static_time_us == 4000000 - SETTLE_US);
+    TEST_CHECK(governor.stats.interval_floor_ms == 0);
+}
+
+
+static void test_flicker(void) {
+    // Short disturbances while at rest (e.g. a bump on the bench) restart the settle time
+    init();
+    segment_t segments[] = {
+        {RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 1500000},
+        {RATE_GOVERNOR_CLASSIFICATION_UNKNOWN, 100000},
+        {RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 1500000},
+        {RATE_GOVERNOR_CLASSIFICATION_STABLE, 100000},
+        {RATE_GOVERNOR_CLASSIFICATION_STATIONARY, 1500000},
+    };
+    replay(segments, 5);
+    TEST_CHECK(governor.mode == RATE_GOVERNOR_MODE_ACTIVE);
+    TEST_CHECK(mode_change_count == 0);
+
+    // Table and stationary both count as rest, switching between them doesn't restart it
+    segment_t rest[] = {
+        {RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 1000000},
+    };
+    replay(rest, 1);
+    TEST_CHECK(governor.mode == RATE_GOVERNOR_MODE_STATIC);
+    TEST_CHECK(mode_change_count == 1);
+}
+
+
+static void test_session(void) {
+    // Range session: handling, shooting strings, rests on the bench between them
+    init();
+    for (int string = 0; string < 10; string += 1) {
+        segment_t segments[] = {
+            {RATE_GOVERNOR_CLASSIFICATION_MOTION, 3000000},
+            {RATE_GOVERNOR_CLASSIFICATION_STABLE, 20000000},
+            {RATE_GOVERNOR_CLASSIFICATION_MOTION, 2000000},
+            {RATE_GOVERNOR_CLASSIFICATION_ON_TABLE, 60000000},
+        };
+        replay(segments, 4);
+    }
+    segment_t pick_up[] = {{RATE_GOVERNOR_CLASSIFICATION_MOTION, 100000}};
+    replay(pick_up, 1);
+
+    // One pair of changes per rest, the time in static is the rest minus the settle time
+    TEST_CHECK(mode_change_count == 20);
+    TEST_CHECK(governor.stats.mode_change_count == 20);
+    TEST_CHECK(governor.stats.static_time_us == 10 * (60000000ll - SETTLE_US));
+    TEST_CHECK(governor.stats.classification_count == (uint32_t) (now_us / REPORT_PERIOD_US));
+    printf("session: %lu mode changes, %.0f%% of the time in static\n", (unsigned long) governor.stats.mode_change_count,
+           100.0 * governor.stats.static_time_us / now_us);
+}
+
+
+int main(void) {
+    test_settle();
+    test_motion_wakes_immediately();
+    test_flicker();
+    test_session();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+
+#include "test_common.h"
+#include "recoil_capture.h"
+
+/**
+ * Replays synthetic linear acceleration traces through the recoil capture: handling noise, a recoil impulse (sharp rise,
+ * decaying ringing) at the linear acceleration rate, back to back shots and bursts of missed samples.
+ */
+
+#define SAMPLE_PERIOD_US 2500       // 400 Hz, the maximum linear acceleration rate
+#define TRIGGER_LEVEL 30.0f
+#define PRE_TRIGGER_US 50000
+#define POST_TRIGGER_US 200000
+#define DISPLAY_POINTS 100
+
+
+typedef struct {
+    int64_t timestamp_us;
+    float value;
+} trace_sample_t;
+
+
+static uint32_t rng_state = 7;
+
+static float noise(float amplitude) {
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return amplitude * ((float) (rng_state >> 8) / (float) (1u << 24) * 2.0f - 1.0f);
+}
+
+
+/**
+ * Handling noise with recoil impulses at the given times. The impulse reaches its peak within one sample, then rings
+ * down with alternating sign.
+ */
+static size_t make_trace(trace_sample_t *trace, size_t length, const int64_t *shots_us, size_t shot_count, float peak) {
+    for (size_t n = 0; n < length; n += 1) {
+        int64_t t_us = (int64_t) n * SAMPLE_PERIOD_US;
+        float value = noise(2.0f);
+
+        for (size_t s = 0; s < shot_count; s += 1) {
+            if (t_us >= shots_us[s]) {
+                float age_s = (float) (t_us - shots_us[s]) * 1e-6f;
+                value += peak * expf(-age_s / 0.015f) * cosf(2.0f * (float) M_PI * 90.0f * age_s);
+            }
+        }
+
+        trace[n].timestamp_us = t_us;
+        trace[n].value = value;
+    }
+    return length;
+}
+
+
+static recoil_capture_config_t make_config(recoil_capture_edge_t edge) {
+    return (recoil_capture_config_t) {
+        .trigger_level = TRIGGER_LEVEL,
+        .edge = edge,
+        .pre_trigger_us = PRE_TRIGGER_US,
+        .post_trigger_us = POST_TRIGGER_US,
+    };
+}
+
+
+static void test_single_shot(void) {
+    static trace_sample_t trace[800];
+    int64_t shot_us = 1000000;
+    make_trace(trace, 800, &shot_us, 1, 120.0f);
+
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_RISING_EDGE);
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    int trigger_count = 0;
+    int complete_count = 0;
+    int64_t complete_us = 0;
+    for (size_t n = 0; n < 800; n += 1) {
+        recoil_capture_event_t event = recoil_capture_push(&capture, trace[n].timestamp_us, trace[n].value);
+        trigger_count += event == RECOIL_CAPTURE_EVENT_TRIGGER;
+        if (event == RECOIL_CAPTURE_EVENT_COMPLETE) {
+            complete_count += 1;
+            complete_us = trace[n].timestamp_us;
+        }
+    }
+
+    TEST_CHECK(trigger_count == 1);
+    TEST_CHECK(complete_count == 1);
+    TEST_CHECK(capture.state == RECOIL_CAPTURE_COMPLETE);
+
+    // Triggered on the first sample of the impulse, completes once the post-trigger window is covered
+    TEST_CHECK(capture.trigger_timestamp_us == shot_us);
+    TEST_CHECK(complete_us == shot_us + POST_TRIGGER_US);
+    TEST_CHECK(capture.pre_trigger_count == PRE_TRIGGER_US / SAMPLE_PERIOD_US);
+    TEST_CHECK(capture.post_trigger_count == POST_TRIGGER_US / SAMPLE_PERIOD_US);
+    TEST_CHECK_CLOSE(capture.peak_value, 120.0, 2.0);
+
+    // The frozen capture is chronological and contiguous
+    size_t length = recoil_capture_get_length(&capture);
+    TEST_CHECK(length == capture.pre_trigger_count + 1 + capture.post_trigger_count);
+    TEST_CHECK(recoil_capture_get_sample(&capture, 0)->timestamp_us == shot_us - PRE_TRIGGER_US);
+    TEST_CHECK(recoil_capture_get_sample(&capture, capture.pre_trigger_count)->timestamp_us == shot_us);
+    bool contiguous = true;
+    for (size_t i = 1; i < length; i += 1) {
+        contiguous &= recoil_capture_get_sample(&capture, i)->timestamp_us - recoil_capture_get_sample(&capture, i - 1)->timestamp_us == SAMPLE_PERIOD_US;
+    }
+    TEST_CHECK(contiguous);
+    TEST_CHECK(recoil_capture_get_sample(&capture, length) == NULL);
+
+    // The decimated view keeps the peak and points at the trigger
+    float points[DISPLAY_POINTS];
+    size_t trigger_idx;
+    TEST_CHECK(recoil_capture_decimate(&capture, points, DISPLAY_POINTS, &trigger_idx) == DISPLAY_POINTS);
+    float display_peak = 0;
+    for (size_t i = 0; i < DISPLAY_POINTS; i += 1) {
+        display_peak = fabsf(points[i]) > display_peak ? fabsf(points[i]) : display_peak;
+    }
+    TEST_CHECK_CLOSE(display_peak, capture.peak_value, 1e-6);
+    TEST_CHECK(trigger_idx * length / DISPLAY_POINTS <= capture.pre_trigger_count);
+    TEST_CHECK((trigger_idx + 1) * length / DISPLAY_POINTS > capture.pre_trigger_count);
+
+    // Samples are ignored until re-armed
+    TEST_CHECK(recoil_capture_push(&capture, 10000000, 200.0f) == RECOIL_CAPTURE_EVENT_NONE);
+    TEST_CHECK(recoil_capture_get_length(&capture) == length);
+}
+
+
+static void test_noise_only(void) {
+    static trace_sample_t trace[4000];
+    make_trace(trace, 4000, NULL, 0, 0);
+
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_RISING_EDGE);
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    int events = 0;
+    for (size_t n = 0; n < 4000; n += 1) {
+        events += recoil_capture_push(&capture, trace[n].timestamp_us, trace[n].value) != RECOIL_CAPTURE_EVENT_NONE;
+    }
+    TEST_CHECK(events == 0);
+    TEST_CHECK(recoil_capture_get_length(&capture) == 0);
+}
+
+
+/**
+ * Shots 600 ms apart, the consumer re-arms on completion like the sensor poller task does. The ringing of each shot
+ * crosses the level several times, only the first crossing triggers.
+ */
+static void test_string_of_shots(void) {
+    static trace_sample_t trace[2000];
+    const int64_t shots_us[] = {500000, 1100000, 1700000, 2300000, 2900000, 3500000, 4100000};
+    const size_t shot_count = sizeof(shots_us) / sizeof(shots_us[0]);
+    make_trace(trace, 2000, shots_us, shot_count, 90.0f);
+
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_RISING_EDGE);
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    size_t triggered = 0;
+    bool aligned = true;
+    for (size_t n = 0; n < 2000; n += 1) {
+        recoil_capture_event_t event = recoil_capture_push(&capture, trace[n].timestamp_us, trace[n].value);
+        if (event == RECOIL_CAPTURE_EVENT_TRIGGER) {
+            aligned &= triggered < shot_count && capture.trigger_timestamp_us == shots_us[triggered];
+            triggered += 1;
+        }
+        else if (event == RECOIL_CAPTURE_EVENT_COMPLETE) {
+            recoil_capture_arm(&capture);
+        }
+    }
+    TEST_CHECK(triggered == shot_count);
+    TEST_CHECK(aligned);
+}
+
+
+static void test_falling_edge(void) {
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_FALLING_EDGE);
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    // Above the level when armed, e.g. armed during a shot: the first sample only sets the level
+    TEST_CHECK(recoil_capture_push(&capture, 0, 50.0f) == RECOIL_CAPTURE_EVENT_NONE);
+    TEST_CHECK(recoil_capture_push(&capture, 2500, -45.0f) == RECOIL_CAPTURE_EVENT_NONE);
+    TEST_CHECK(recoil_capture_push(&capture, 5000, 10.0f) == RECOIL_CAPTURE_EVENT_TRIGGER);
+    TEST_CHECK(capture.trigger_value == 10.0f);
+    TEST_CHECK(capture.peak_value == 10.0f);
+}
+
+
+/**
+ * Samples lost while the sensor recovers: the pre-trigger window is bounded by time, not by sample count, and the
+ * post-trigger window ends on the first sample past it.
+ */
+static void test_gap(void) {
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_RISING_EDGE);
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    int64_t t_us = 0;
+    for (int n = 0; n < 40; n += 1, t_us += SAMPLE_PERIOD_US) {
+        recoil_capture_push(&capture, t_us, 1.0f);
+    }
+
+    // 40 ms without samples, then the shot at 140 ms: only the samples from 90 ms to 97.5 ms are retained
+    t_us += 40000;
+    TEST_CHECK(recoil_capture_push(&capture, t_us, 100.0f) == RECOIL_CAPTURE_EVENT_TRIGGER);
+    TEST_CHECK(capture.pre_trigger_count == 4);
+
+    int64_t trigger_us = t_us;
+    t_us += 150000;
+    TEST_CHECK(recoil_capture_push(&capture, t_us, 5.0f) == RECOIL_CAPTURE_EVENT_NONE);
+    t_us += 100000;
+    TEST_CHECK(recoil_capture_push(&capture, t_us, 5.0f) == RECOIL_CAPTURE_EVENT_COMPLETE);
+    TEST_CHECK(recoil_capture_get_sample(&capture, recoil_capture_get_length(&capture) - 1)->timestamp_us == trigger_us + 250000);
+}
+
+
+/**
+ * A post-trigger window longer than the buffer completes early instead of overwriting the pre-trigger samples.
+ */
+static void test_buffer_bound(void) {
+    static recoil_capture_t capture;
+    recoil_capture_config_t config = make_config(RECOIL_CAPTURE_RISING_EDGE);
+    config.post_trigger_us = 10000000;
+    recoil_capture_init(&capture, &config);
+    recoil_capture_arm(&capture);
+
+    int64_t t_us = 0;
+    for (int n = 0; n < 100; n += 1, t_us += SAMPLE_PERIOD_US) {
+        recoil_capture_push(&capture, t_us, 0.0f);
+    }
+    TEST_CHECK(recoil_capture_push(&capture, t_us, 100.0f) == RECOIL_CAPTURE_EVENT_TRIGGER);
+
+    int samples = 0;
+    recoil_capture_event_t event = RECOIL_CAPTURE_EVENT_NONE;
+    while (event != RECOIL_CAPTURE_EVENT_COMPLETE && samples < 1000) {
+        t_us += SAMPLE_PERIOD_US;
+        event = recoil_capture_push(&capture, t_us, 0.0f);
+        samples += 1;
+    }
+    TEST_CHECK(recoil_capture_get_length(&capture) == RECOIL_CAPTURE_BUFFER_LENGTH);
+    TEST_CHECK(recoil_capture_get_sample(&capture, capture.pre_trigger_count)->value == 100.0f);
+}
+
+
+int main(void) {
+    test_single_shot();
+    test_noise_only();
+    test_string_of_shots();
+    test_falling_edge();
+    test_gap();
+    test_buffer_bound();
+
+    return TEST_RESULT();
+}
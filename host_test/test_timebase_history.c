@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_common.h"
+#include "timebase_history.h"
+
+#if TIMEBASE_HISTORY_TEST_REPLAY
+#include "sh2.h"
+#include "sh2_err.h"
+#include "sh2_SensorValue.h"
+#include "bno085_replay_hal.h"
+#endif  // TIMEBASE_HISTORY_TEST_REPLAY
+
+/**
+ * Timebase history: ring and lookup edge cases, then the use of the level. A game rotation vector stream is kept at the
+ * firmware rate and sampled at the times of a faster stream (the linear acceleration the recoil triggers on), against
+ * the true orientation at those times.
+ *
+ *   test_timebase_history                       synthetic roll sweep with timestamp jitter and a dropout
+ *   test_timebase_history_replay <capture>      game rotation vectors of a capture replayed through SH2, the history is
+ *                                               fed every 8th sample and checked at the others
+ */
+
+#define MAX_GAP_US 250000               // DIGITAL_LEVEL_VIEW_ORIENTATION_MAX_GAP_MS
+#define HISTORY_PERIOD_US 20000         // SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS
+#define QUERY_PERIOD_US 2500            // Linear acceleration, 400 Hz
+#define SWEEP_AMPLITUDE_RAD 0.5235988   // 30 deg
+#define SWEEP_FREQUENCY_HZ 0.5
+#define ROLL_MAX_ERROR_RAD 1.0e-3       // Interpolation error of the sweep at the firmware rate, plus the float rounding
+#define MAX_SAMPLES 65536
+
+
+static timebase_history_t history;
+
+
+static void roll_quaternion(double roll, float *q) {
+    q[0] = (float) cos(roll * 0.5);
+    q[1] = (float) sin(roll * 0.5);
+    q[2] = 0.0f;
+    q[3] = 0.0f;
+}
+
+
+static double quaternion_roll(const float *q) {
+    return atan2(2.0 * (q[0] * q[1] + q[2] * q[3]), 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]));
+}
+
+
+static double sweep_roll(int64_t t_us) {
+    return SWEEP_AMPLITUDE_RAD * sin(2.0 * M_PI * SWEEP_FREQUENCY_HZ * t_us * 1e-6);
+}
+
+
+static void test_push_lookup(void) {
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_LINEAR, 3, MAX_GAP_US);
+    float value[3];
+    TEST_CHECK(!timebase_history_lookup(&history, 0, value));
+
+    float a[3] = {1.0f, -2.0f, 4.0f};
+    float b[3] = {3.0f, 2.0f, 0.0f};
+    TEST_CHECK(timebase_history_push(&history, 1000, a));
+    TEST_CHECK(timebase_history_push(&history, 3000, b));
+
+    // Not newer than the latest sample
+    TEST_CHECK(!timebase_history_push(&history, 3000, a));
+    TEST_CHECK(!timebase_history_push(&history, 2000, a));
+    TEST_CHECK(history.count == 2);
+
+    // Exact, interpolated, outside
+    TEST_CHECK(timebase_history_lookup(&history, 1000, value) && value[0] == 1.0f && value[2] == 4.0f);
+    TEST_CHECK(timebase_history_lookup(&history, 3000, value) && value[1] == 2.0f);
+    TEST_CHECK(timebase_history_lookup(&history, 1500, value));
+    TEST_CHECK_CLOSE(value[0], 1.5, 1e-6);
+    TEST_CHECK_CLOSE(value[1], -1.0, 1e-6);
+    TEST_CHECK_CLOSE(value[2], 3.0, 1e-6);
+    TEST_CHECK(!timebase_history_lookup(&history, 999, value));
+    TEST_CHECK(!timebase_history_lookup(&history, 3001, value));
+
+    // Gap longer than the limit, e.g. a sensor reset
+    TEST_CHECK(timebase_history_push(&history, 3000 + MAX_GAP_US + 1, a));
+    TEST_CHECK(!timebase_history_lookup(&history, 4000, value));
+    TEST_CHECK(timebase_history_lookup(&history, 3000 + MAX_GAP_US + 1, value));
+
+    timebase_history_reset(&history);
+    TEST_CHECK(!timebase_history_lookup(&history, 1000, value));
+    TEST_CHECK(timebase_history_push(&history, 10, a));  // Older than before the reset
+}
+
+
+static void test_wrap_around(void) {
+    // Twice the length plus a few, only the latest TIMEBASE_HISTORY_LENGTH samples remain
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_LINEAR, 1, MAX_GAP_US);
+    int total = 2 * TIMEBASE_HISTORY_LENGTH + 5;
+    for (int i = 0; i < total; i += 1) {
+        float value = (float) i;
+        TEST_CHECK(timebase_history_push(&history, (int64_t) i * 1000, &value));
+    }
+    TEST_CHECK(history.count == TIMEBASE_HISTORY_LENGTH);
+
+    int oldest = total - TIMEBASE_HISTORY_LENGTH;
+    float value;
+    TEST_CHECK(!timebase_history_lookup(&history, (int64_t) oldest * 1000 - 1, &value));
+    for (int64_t t_us = (int64_t) oldest * 1000; t_us < (int64_t) (total - 1) * 1000; t_us += 250) {
+        TEST_CHECK(timebase_history_lookup(&history, t_us, &value));
+        TEST_CHECK_CLOSE(value, t_us / 1000.0, 1e-4);
+    }
+}
+
+
+static void test_slerp(void) {
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_SLERP, 4, MAX_GAP_US);
+    float a[4], b[4], value[4];
+
+    // Constant rate rotation, slerp is exact
+    roll_quaternion(0.0, a);
+    roll_quaternion(1.0, b);
+    timebase_history_push(&history, 0, a);
+    timebase_history_push(&history, 10000, b);
+    for (int64_t t_us = 0; t_us <= 10000; t_us += 500) {
+        TEST_CHECK(timebase_history_lookup(&history, t_us, value));
+        TEST_CHECK_CLOSE(quaternion_roll(value), t_us / 10000.0, 1e-5);
+        TEST_CHECK_CLOSE(value[0] * value[0] + value[1] * value[1] + value[2] * value[2] + value[3] * value[3], 1.0, 1e-5);
+    }
+
+    // The sensor may flip the sign of the quaternion, the same rotation, interpolate the short way
+    roll_quaternion(1.2, b);
+    for (int i = 0; i < 4; i += 1) {
+        b[i] = -b[i];
+    }
+    timebase_history_push(&history, 20000, b);
+    TEST_CHECK(timebase_history_lookup(&history, 15000, value));
+    TEST_CHECK_CLOSE(quaternion_roll(value), 1.1, 1e-4);
+
+    // Nearly equal quaternions take the linear blend
+    roll_quaternion(1.2001, a);
+    timebase_history_push(&history, 30000, a);
+    TEST_CHECK(timebase_history_lookup(&history, 25000, value));
+    TEST_CHECK_CLOSE(quaternion_roll(value), 1.20005, 1e-4);
+}
+
+
+static void test_synthetic_stream(void) {
+    // Game rotation vector at the firmware rate with +-1 ms of timestamp jitter and a 300 ms dropout (sensor reset)
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_SLERP, 4, MAX_GAP_US);
+    const int64_t duration_us = 4000000;
+    const int64_t dropout_start_us = 2000000, dropout_end_us = 2300000;
+    srand(1);
+
+    int64_t next_push_us = 0, query_us = 0;
+    uint32_t query_count = 0, covered_count = 0, dropout_covered_count = 0;
+    double max_error = 0;
+
+    for (int64_t t_us = 0; t_us < duration_us; t_us += HISTORY_PERIOD_US) {
+        int64_t timestamp_us = t_us + (rand() % 2001) - 1000;
+        if (timestamp_us >= dropout_start_us && timestamp_us < dropout_end_us) {
+            continue;
+        }
+        float q[4];
+        roll_quaternion(sweep_roll(timestamp_us), q);
+        TEST_CHECK(timebase_history_push(&history, timestamp_us, q));
+        next_push_us = timestamp_us;
+
+        // The recoil capture completes later than the trigger, query everything the history covers by now
+        for (; query_us <= next_push_us; query_us += QUERY_PERIOD_US) {
+            float value[4];
+            query_count += 1;
+            if (!timebase_history_lookup(&history, query_us, value)) {
+                continue;
+            }
+            if (query_us > dropout_start_us && query_us < dropout_end_us - 20000) {
+                dropout_covered_count += 1;
+            }
+            covered_count += 1;
+            max_error = fmax(max_error, fabs(quaternion_roll(value) - sweep_roll(query_us)));
+        }
+    }
+
+    printf("synthetic: %lu queries, %lu covered, max roll error %.4f deg\n", (unsigned long) query_count,
+           (unsigned long) covered_count, max_error * 180.0 / M_PI);
+    TEST_CHECK(dropout_covered_count == 0);
+    TEST_CHECK(covered_count > 0.85 * query_count);  // All but the dropout and the time before the first sample
+    TEST_CHECK(max_error < ROLL_MAX_ERROR_RAD);
+}
+
+
+static void benchmark(void) {
+    // A full history, the lookup is a binary search
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_SLERP, 4, MAX_GAP_US);
+    for (int i = 0; i < TIMEBASE_HISTORY_LENGTH; i += 1) {
+        float q[4];
+        roll_quaternion(sweep_roll((int64_t) i * HISTORY_PERIOD_US), q);
+        timebase_history_push(&history, (int64_t) i * HISTORY_PERIOD_US, q);
+    }
+
+    const int lookup_count = 1000000;
+    int64_t span_us = (int64_t) (TIMEBASE_HISTORY_LENGTH - 1) * HISTORY_PERIOD_US;
+    volatile float sink = 0;
+    int64_t start_ns = test_time_ns();
+    for (int i = 0; i < lookup_count; i += 1) {
+        float value[4];
+        timebase_history_lookup(&history, ((int64_t) i * 7919) % span_us, value);
+        sink += value[1];
+    }
+    printf("lookup in a history of %d: %.1f ns\n", TIMEBASE_HISTORY_LENGTH, (double) (test_time_ns() - start_ns) / lookup_count);
+    (void) sink;
+}
+
+
+#if TIMEBASE_HISTORY_TEST_REPLAY
+
+typedef struct {
+    int64_t timestamp_us;
+    float q[4];
+} replay_sample_t;
+
+static replay_sample_t replay_samples[MAX_SAMPLES];
+static size_t replay_sample_count;
+
+
+static void sensor_callback(void *cookie, sh2_SensorEvent_t *event) {
+    sh2_SensorValue_t value;
+    if (event->reportId != SH2_GAME_ROTATION_VECTOR || replay_sample_count >= MAX_SAMPLES || sh2_decodeSensorEvent(&value, event) != SH2_OK) {
+        return;
+    }
+    replay_sample_t *sample = &replay_samples[replay_sample_count++];
+    sample->timestamp_us = (int64_t) event->timestamp_uS;
+    sample->q[0] = value.un.gameRotationVector.real;
+    sample->q[1] = value.un.gameRotationVector.i;
+    sample->q[2] = value.un.gameRotationVector.j;
+    sample->q[3] = value.un.gameRotationVector.k;
+}
+
+
+static void event_callback(void *cookie, sh2_AsyncEvent_t *event) {
+}
+
+
+static void test_replay(const char *path) {
+    static bno085_replay_hal_t replay;
+    TEST_CHECK(bno085_replay_hal_init(&replay, path) == 0);
+    if (test_failure_count > 0) {
+        return;
+    }
+    TEST_CHECK(sh2_open(&replay._HAL, event_callback, NULL) == SH2_OK);
+    TEST_CHECK(sh2_setSensorCallback(sensor_callback, NULL) == SH2_OK);
+    for (uint32_t i = 0; i < 10000000 && !bno085_replay_hal_eof(&replay); i += 1) {
+        sh2_service();
+    }
+    sh2_close();
+    bno085_replay_hal_deinit(&replay);
+
+    // Every 8th sample is kept, as at the firmware rate, the ones in between are the truth
+    const size_t decimation = 8;
+    timebase_history_init(&history, TIMEBASE_INTERPOLATION_SLERP, 4, MAX_GAP_US);
+    uint32_t check_count = 0;
+    double max_error = 0;
+
+    for (size_t idx = 0; idx + decimation < replay_sample_count; idx += decimation) {
+        timebase_history_push(&history, replay_samples[idx].timestamp_us, replay_samples[idx].q);
+        timebase_history_push(&history, replay_samples[idx + decimation].timestamp_us, replay_samples[idx + decimation].q);
+
+        for (size_t between = idx + 1; between < idx + decimation; between += 1) {
+            float value[4];
+            TEST_CHECK(timebase_history_lookup(&history, replay_samples[between].timestamp_us, value));
+            max_error = fmax(max_error, fabs(quaternion_roll(value) - quaternion_roll(replay_samples[between].q)));
+            check_count += 1;
+        }
+    }
+
+    printf("replay: %lu game rotation vectors, %lu interpolated, max roll error %.4f deg\n", (unsigned long) replay_sample_count,
+           (unsigned long) check_count, max_error * 180.0 / M_PI);
+    TEST_CHECK(check_count > 0);
+    TEST_CHECK(max_error < ROLL_MAX_ERROR_RAD);
+}
+
+#endif  // TIMEBASE_HISTORY_TEST_REPLAY
+
+
+int main(int argc, char **argv) {
+    test_push_lookup();
+    test_wrap_around();
+    test_slerp();
+    test_synthetic_stream();
+    benchmark();
+
+#if TIMEBASE_HISTORY_TEST_REPLAY
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <capture>\n", argv[0]);
+        return 2;
+    }
+    test_replay(argv[1]);
+#endif  // TIMEBASE_HISTORY_TEST_REPLAY
+
+    return TEST_RESULT();
+}
@@ -4,6 +4,8 @@
 #include <lvgl.h>
 #include <stdint.h>
 
+#include "recoil_capture.h"
+
 typedef struct {
     uint32_t crc32;
     float recoil_accel_threshold;
@@ -13,4 +15,9 @@ typedef struct {
 void create_acceleration_analysis_view(lv_obj_t *parent);
 void enable_acceleration_analysis_view(bool enable);
 
+/**
+ * @brief Display a complete recoil capture. Can be called from any task.
+ */
+void update_acceleration_analysis_view_capture(const recoil_capture_t *capture);
+
 #endif // ACCELERATION_ANALYSIS_VIEW_H
\ No newline at end of file
@@ -164,8 +164,11 @@ void app_main(void)
         ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
     }
     memset(bno085_i2c_dev, 0, sizeof(bno085_i2c_ctx_t));
-    ESP_ERROR_CHECK(bno085_init_i2c(bno085_i2c_dev, i2c1_bus_handle, BNO085_INT_PIN, BNO085_RESET_PIN, BNO085_BOOT_PIN));
+    ESP_ERROR_CHECK(bno085_init_i2c(bno085_i2c_dev, i2c1_bus_handle, BNO085_INT_PIN, BNO085_RESET_PIN, BNO085_BOOT_PIN, NULL));
     bno085_dev = (bno085_ctx_t *) bno085_i2c_dev;
+
+    // Apply sensor side batching before any report is enabled
+    ESP_ERROR_CHECK(apply_sensor_report_batch_config());
 #endif  // USE_BNO085
 
     // Initialize Display
@@ -88,17 +88,30 @@
 // Other software configurations
 #define SENSOR_EVENT_POLLER_TASK_STACK 3072
 #define SENSOR_EVENT_POLLER_TASK_PRIORITY 5
-#define ACCELERATION_EVENT_POLLER_TASK_STACK 3072
-#define ACCELERATION_EVENT_POLLER_TASK_PRIORITY 4
 
 #define SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS 20
 #define SENSOR_GAME_ROTATION_VECTOR_LOW_POWER_MODE_REPORT_PERIOD_MS 0
-#define SENSOR_LINEAR_ACCELERATION_REPORT_PERIOD_MS 50
+#define SENSOR_LINEAR_ACCELERATION_REPORT_PERIOD_MS 2  // Recoil capture runs at the fastest rate, the sensor clamps to its maximum (400 Hz)
 #define SENSOR_LINEAR_ACCELERATION_LOW_POWER_MODE_REPORT_PERIOD_MS 0
 #define SENSOR_ROTATION_VECTOR_REPORT_PERIOD_MS 50
 #define SENSOR_ROTATION_VECTOR_LOW_POWER_MODE_REPORT_PERIOD_MS 0
 
 #define DIGITAL_LEVEL_VIEW_DISPLAY_UPDATE_PERIOD_MS 20
+#define DIGITAL_LEVEL_VIEW_GRAVITY_CANT 1  // Compute the cant from the gravity direction instead of the Euler angles
+#define DIGITAL_LEVEL_VIEW_LOW_POWER_SETTLE_MS 30000  // Time at rest before the level drops the fusion reports and runs from the accelerometer
+#define DIGITAL_LEVEL_VIEW_LOW_POWER_REPORT_PERIOD_MS 100  // Accelerometer report interval in the low power level mode
+#define DIGITAL_LEVEL_VIEW_LOW_POWER_FILTER_GAIN 0.3f  // Low-pass filter gain on the accelerometer, 1 disables the filter
+#define DIGITAL_LEVEL_VIEW_ORIENTATION_MAX_GAP_MS 250  // Largest game rotation vector gap interpolated across when aligning a shot
+#define DIGITAL_LEVEL_VIEW_FUSION_FALLBACK 1  // Draw the cant from bno085_fusion while no game rotation vector is drawn (report disabled, sensor recovery)
+#define DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_MS 100  // Shortest game rotation vector gap before the level falls back to bno085_fusion
+#define DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_INTERVALS 3  // Game rotation vector gap in effective report intervals (rate governor floor included) before the fallback, if longer
+#define DIGITAL_LEVEL_VIEW_FUSION_GYROSCOPE_REPORT_PERIOD_MS 5  // Gyroscope report interval while the fallback runs, drives the filter
+#define DIGITAL_LEVEL_VIEW_FUSION_ACCELEROMETER_REPORT_PERIOD_MS 10  // Accelerometer report interval while the fallback runs, corrects the drift
+#define DIGITAL_LEVEL_VIEW_REPORT_RETRY_MS 1000  // Delay before a failed level report request or mode switch is tried again
+
+#define RECOIL_CAPTURE_PRE_TRIGGER_MS 50
+#define RECOIL_CAPTURE_POST_TRIGGER_MS 150
+#define RECOIL_CAPTURE_DISPLAY_POINTS 100
 
 #define LOW_POWER_MODE_MONITOR_TASK_STACK 4096
 #define LOW_POWER_MODE_MONITOR_TASK_PRIORITY 3
@@ -108,6 +121,12 @@
 #define SENSOR_STABILITY_DETECTOR_POLLER_TASK_PRIORITY 10
 #define SENSOR_STABILITY_DETECTOR_REPORT_PERIOD_MS 100
 
+#define SENSOR_RATE_GOVERNOR_TASK_STACK 3072
+#define SENSOR_RATE_GOVERNOR_TASK_PRIORITY 4  // Below the sensor pollers (SENSOR_EVENT_POLLER_TASK_PRIORITY, BNO085_SENSOR_POLLER_TASK_PRIORITY), the floor changes are not time critical
+#define SENSOR_STABILITY_CLASSIFIER_REPORT_PERIOD_MS 100  // Bounds the delay to restore the report rates on motion
+#define SENSOR_RATE_GOVERNOR_SETTLE_MS 2000
+#define SENSOR_RATE_GOVERNOR_STATIC_REPORT_PERIOD_MS 100  // Orientation report interval while the device is at rest
+
 #define LVGL_UNLOCK_WAIT_TIME_MS 1
 
 
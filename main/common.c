@@ -2,6 +2,7 @@
 #include <string.h>
 #include "common.h"
 #include "app_cfg.h"
+#include "fast_math.h"
 
 #include "nvs.h"
 #include "esp_check.h"
@@ -22,9 +23,13 @@ uint32_t crc32_wrapper(void * data, size_t length, size_t offset) {
 
 
 float wrap_angle(float rad) {
+#if USE_FAST_DISPLAY_MATH
+    return fast_wrap_angle(rad);
+#else
     rad = fmodf(rad + M_PI, 2 * M_PI);
     if (rad < 0) rad += 2 * M_PI;
     return rad - M_PI;
+#endif  // USE_FAST_DISPLAY_MATH
 }
 
 
@@ -112,8 +112,6 @@
 
 #define SENSOR_EVENT_POLLER_TASK_STACK 3072
 #define SENSOR_EVENT_POLLER_TASK_PRIORITY 5
-#define ACCELERATION_EVENT_POLLER_TASK_STACK 3072
-#define ACCELERATION_EVENT_POLLER_TASK_PRIORITY 4
 
 #define SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS 20
 #define SENSOR_GAME_ROTATION_VECTOR_LOW_POWER_MODE_REPORT_PERIOD_MS 0
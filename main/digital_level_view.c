@@ -56,11 +56,6 @@ extern digital_level_view_t digital_level_view_type_1_context;
 extern digital_level_view_t digital_level_view_type_2_context;
 extern lv_obj_t * msg_box;
 
-// NOT threadsafe copy of roll and pitch to be shared within the module
-extern float sensor_pitch_thread_unsafe, sensor_roll_thread_unsafe;
-extern float sensor_x_acceleration_thread_unsafe;
-
-
 // Forward declaration
 esp_err_t load_digital_level_view_config();
 esp_err_t save_digital_level_view_config();
@@ -68,7 +63,9 @@ esp_err_t save_digital_level_view_config();
 
 void tilt_angle_button_short_press_cb(lv_event_t * e) {
     // Take a snapshot of current roll and use that as offset (take account of the screen rotation)
-    digital_level_view_config.user_roll_rad_offset = -1 * (sensor_roll_thread_unsafe - system_config.rotation * M_PI_2);
+    orientation_state_t state;
+    get_sensor_orientation_state(&state);
+    digital_level_view_config.user_roll_rad_offset = -1 * (state.roll_rad - system_config.rotation * M_PI_2);
 
     ESP_LOGI(TAG, "user_roll_rad_offset := %f", digital_level_view_config.user_roll_rad_offset);
 }
@@ -1,31 +1,57 @@
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 
 #include "esp_lvgl_port.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "digital_level_view_controller.h"
 #include "digital_level_view.h"
 #include "app_cfg.h"
 #include "bno085.h"
+#include "bno085_fusion.h"
 #include "system_config.h"
 #include "common.h"
 #include "sensor_config.h"
 #include "countdown_timer.h"
+#include "recoil_capture.h"
+#include "orientation_state.h"
+#include "gravity_cant.h"
+#include "fusion_fallback.h"
+#include "timebase_history.h"
+#include "low_power_mode.h"
+#include "acceleration_analysis_view.h"
 #include "esp_task_wdt.h"
-#include "bno085.h"
 
 #define TAG "DigitalLevelViewController"
 
 #define SENSOR_POLL_EVENT_RUN   (1 << 0)
+#define SENSOR_POLL_EVENT_CAPTURE (1 << 1)  // Recoil capture requested by the acceleration analysis view
+#define LINEAR_ACCELERATION_SAMPLE_BATCH_SIZE BNO085_SAMPLE_RING_DEPTH
+#define GAME_ROTATION_VECTOR_SAMPLE_BATCH_SIZE BNO085_SAMPLE_RING_DEPTH
+#define FUSION_SAMPLE_BATCH_SIZE BNO085_SAMPLE_RING_DEPTH
+
+#define GAME_ROTATION_VECTOR_NOTIFY_BIT (1 << 0)
+#define LINEAR_ACCELERATION_NOTIFY_BIT  (1 << 1)
+#define SENSOR_POLL_STOP_NOTIFY_BIT     (1 << 2)
+#define STABILITY_DETECTOR_NOTIFY_BIT   (1 << 3)
+#define ACCELEROMETER_NOTIFY_BIT        (1 << 4)
+#define GYROSCOPE_NOTIFY_BIT            (1 << 5)
+#define SENSOR_POLL_NOTIFY_BITS         (GAME_ROTATION_VECTOR_NOTIFY_BIT | LINEAR_ACCELERATION_NOTIFY_BIT | SENSOR_POLL_STOP_NOTIFY_BIT | \
+                                         STABILITY_DETECTOR_NOTIFY_BIT | ACCELEROMETER_NOTIFY_BIT | GYROSCOPE_NOTIFY_BIT)
+
+#define STABILITY_DETECTOR_EXITED       (1 << 1)  // Stability detector report bit, set when the device leaves the stable state
 
 
 static TaskHandle_t sensor_poller_task_handle;
 static EventGroupHandle_t sensor_task_control;
+static SemaphoreHandle_t level_mode_lock;  // Serializes the report requests of the view enable and the mode changes
+static bool level_enabled;                 // Protected by level_mode_lock
+static bool analysis_capture_enabled;      // Protected by level_mode_lock
 
-float sensor_pitch_thread_unsafe, sensor_roll_thread_unsafe;
-float sensor_x_acceleration_thread_unsafe, sensor_y_acceleration_thread_unsafe, sensor_z_acceleration_thread_unsafe;
 
 extern bno085_ctx_t * bno085_dev;
 extern system_config_t system_config;
@@ -33,102 +59,715 @@ extern digital_level_view_config_t digital_level_view_config;
 extern sensor_config_t sensor_config;
 extern countdown_timer_t countdown_timer;
 
+HEAPS_CAPS_ATTR static bno085_sample_t linear_acceleration_samples[LINEAR_ACCELERATION_SAMPLE_BATCH_SIZE];
+HEAPS_CAPS_ATTR static bno085_sample_t game_rotation_vector_samples[GAME_ROTATION_VECTOR_SAMPLE_BATCH_SIZE];
+HEAPS_CAPS_ATTR static timebase_history_t orientation_history;  // Game rotation vectors on the sensor timebase, to align the shots
+static bno085_subscriber_t game_rotation_vector_subscriber;
+static bno085_subscriber_t linear_acceleration_subscriber;
+static bno085_report_request_t game_rotation_vector_request;
+static bno085_report_request_t linear_acceleration_request;
+static bno085_subscriber_t accelerometer_subscriber;
+static bno085_report_request_t accelerometer_request;
+static bno085_subscriber_t stability_detector_subscriber;
+static bno085_report_request_t stability_detector_request;
+static bno085_subscriber_t gyroscope_subscriber;
+static bno085_report_request_t gyroscope_request;
+HEAPS_CAPS_ATTR static recoil_capture_t recoil_capture;  // The only recoil capture, shared with the acceleration analysis view
+
+// Time from the sample arriving at the driver to the handler, reported as percentiles when the view is disabled
+static uint32_t handler_latency_histogram[BNO085_LATENCY_HISTOGRAM_BUCKETS];
+static uint32_t handler_latency_count;
+static int64_t handler_latency_max_us;
+
+// Written by the sensor poller task only, published to the other tasks through the latch
+static orientation_state_t orientation_state;
+static orientation_state_latch_t orientation_state_latch;
+static gravity_cant_frame_t gravity_cant_frame;
+
+// Level mode, changed by the sensor poller task while the view is enabled
+static digital_level_stats_t digital_level_stats;
+static int64_t level_mode_since_us;
+static int64_t at_rest_since_us;            // 0 while the device is moving
+static float filtered_gravity[3];
+static bool filtered_gravity_valid;
+
+// Fusion of the gyroscope and accelerometer on the MCU, drawn while the game rotation vector is missing
+HEAPS_CAPS_ATTR static bno085_sample_t gyroscope_samples[FUSION_SAMPLE_BATCH_SIZE];
+HEAPS_CAPS_ATTR static bno085_sample_t accelerometer_samples[FUSION_SAMPLE_BATCH_SIZE];
+static bno085_fusion_t level_fusion;          // Updated by the sensor poller task only
+static bool fusion_fallback_active;           // Protected by level_mode_lock
+static bool level_reports_pending;            // Protected by level_mode_lock, the last request of the level reports failed
+static int64_t level_reports_retry_us;        // Protected by level_mode_lock, no report change before this time after a failure
+static fusion_fallback_t fusion_fallback_timeout;  // Since the last valid game rotation vector, updated by the sensor poller task only
+static bool recoil_capture_report_pending;    // Protected by level_mode_lock, the last request of the linear acceleration failed
+static int64_t recoil_capture_report_retry_us;  // Protected by level_mode_lock, no retry before this time after a failure
+
+
+static void update_gravity_cant_frame() {
+    // The frame changes only when the screen rotates or the user zeroes the level
+    if (gravity_cant_frame.rotation != system_config.rotation ||
+        gravity_cant_frame.user_roll_rad_offset != digital_level_view_config.user_roll_rad_offset) {
+        gravity_cant_set_frame(&gravity_cant_frame, system_config.rotation, digital_level_view_config.user_roll_rad_offset);
+    }
+}
+
+
+static esp_err_t read_accelerometer_cant(float *cant_rad) {
+    sh2_Accelerometer_t value;
+    if (bno085_read_accelerometer(bno085_dev, &accelerometer_subscriber, &value, false) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // The device is at rest, the accelerometer measures gravity. Filter the hand and bench vibrations.
+    float sample[3] = {value.x, value.y, value.z};
+    for (int i = 0; i < 3; i += 1) {
+        filtered_gravity[i] = filtered_gravity_valid ? filtered_gravity[i] + DIGITAL_LEVEL_VIEW_LOW_POWER_FILTER_GAIN * (sample[i] - filtered_gravity[i]) : sample[i];
+    }
+    filtered_gravity_valid = true;
+
+    update_gravity_cant_frame();
+    gravity_cant_compute(&gravity_cant_frame, filtered_gravity, cant_rad, &orientation_state.pitch_rad);
+    orientation_state.roll_rad = wrap_angle(*cant_rad - gravity_cant_frame.offset_rad);
+    return ESP_OK;
+}
+
+
+static const char *get_level_mode_name(digital_level_mode_t mode) {
+    return mode == DIGITAL_LEVEL_MODE_FUSION ? "fusion" : "accelerometer";
+}
+
+
+// Must be called with level_mode_lock held
+static esp_err_t request_level_reports(digital_level_mode_t mode) {
+    bool fusion = mode == DIGITAL_LEVEL_MODE_FUSION;
+    bool fallback = fusion && fusion_fallback_active;
+
+    // The fallback keeps the game rotation vector requested, the level returns to it once it resumes
+    uint32_t accelerometer_period_ms = fusion ? (fallback ? DIGITAL_LEVEL_VIEW_FUSION_ACCELEROMETER_REPORT_PERIOD_MS : 0) : DIGITAL_LEVEL_VIEW_LOW_POWER_REPORT_PERIOD_MS;
+
+    // Deferred, the updates only record the intervals and the commands are sent together
+    bno085_defer_report_requests(bno085_dev);
+    if (sensor_config.enable_game_rotation_vector_report) {
+        bno085_update_report_request(bno085_dev, &game_rotation_vector_request, fusion ? SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS : 0);
+    }
+    bno085_update_report_request(bno085_dev, &accelerometer_request, accelerometer_period_ms);
+    bno085_update_report_request(bno085_dev, &gyroscope_request, fallback ? DIGITAL_LEVEL_VIEW_FUSION_GYROSCOPE_REPORT_PERIOD_MS : 0);
+    bno085_update_report_request(bno085_dev, &stability_detector_request, SENSOR_STABILITY_DETECTOR_REPORT_PERIOD_MS);  // Motion ends the accelerometer mode
+    esp_err_t ret = bno085_apply_report_requests(bno085_dev);
+
+    if (ret != ESP_OK) {
+        // E.g. bus error or sensor recovering, retried by retry_level_reports(). The intervals SH2 did not accept are
+        // sent again by the next request.
+        level_reports_pending = true;
+        level_reports_retry_us = esp_timer_get_time() + DIGITAL_LEVEL_VIEW_REPORT_RETRY_MS * 1000;
+        ESP_LOGW(TAG, "Failed to request the %s mode reports: %s", get_level_mode_name(mode), esp_err_to_name(ret));
+        return ret;
+    }
+    level_reports_pending = false;
+
+    if (fallback) {
+        digital_level_stats.report_interval_ms = DIGITAL_LEVEL_VIEW_FUSION_GYROSCOPE_REPORT_PERIOD_MS;
+    }
+    else {
+        digital_level_stats.report_interval_ms = fusion ? SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS : DIGITAL_LEVEL_VIEW_LOW_POWER_REPORT_PERIOD_MS;
+    }
+    return ESP_OK;
+}
+
+
+// Must be called with level_mode_lock held
+static bool is_recoil_capture_needed() {
+    // Either to start the countdown timer on recoil while the level is displayed, or to feed the analysis view
+    bool auto_start = level_enabled && digital_level_view_config.auto_start_countdown_timer_on_recoil && get_countdown_timer_widget_enabled();
+    return auto_start || analysis_capture_enabled;
+}
+
+
+// Must be called with level_mode_lock held
+static esp_err_t request_recoil_capture_report() {
+    // The linear acceleration runs at the highest rate of all reports, request it only while a capture is armed
+    bool needed = sensor_config.enable_linear_acceleration_report && is_recoil_capture_needed();
+    esp_err_t ret = bno085_update_report_request(bno085_dev, &linear_acceleration_request, needed ? SENSOR_LINEAR_ACCELERATION_REPORT_PERIOD_MS : 0);
+
+    if (ret != ESP_OK) {
+        // E.g. bus error or sensor recovering, the request is recorded and sent again by retry_level_reports()
+        recoil_capture_report_pending = true;
+        recoil_capture_report_retry_us = esp_timer_get_time() + DIGITAL_LEVEL_VIEW_REPORT_RETRY_MS * 1000;
+        ESP_LOGW(TAG, "Failed to %s the recoil capture report: %s", needed ? "request" : "release", esp_err_to_name(ret));
+        return ret;
+    }
+    recoil_capture_report_pending = false;
+    return ESP_OK;
+}
+
+
+static void update_recoil_capture_arming() {
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+    bool needed = is_recoil_capture_needed();
+    xSemaphoreGive(level_mode_lock);
+
+    // A disarmed capture stays complete to keep the last shot readable
+    bool armed = recoil_capture.state == RECOIL_CAPTURE_ARMED || recoil_capture.state == RECOIL_CAPTURE_TRIGGERED;
+    if (needed && !armed) {
+        // Pick up the latest trigger configuration, skip the samples received before
+        recoil_capture_config_t recoil_capture_config;
+        get_recoil_capture_config(&recoil_capture_config);
+        recoil_capture_init(&recoil_capture, &recoil_capture_config);
+        recoil_capture_arm(&recoil_capture);
+        bno085_subscriber_flush(bno085_dev, &linear_acceleration_subscriber);
+    }
+    else if (!needed && armed) {
+        recoil_capture_disarm(&recoil_capture);
+    }
+}
+
+
+static void set_level_mode(digital_level_mode_t mode) {
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+
+    // The view may have been disabled meanwhile, its reports are already released. After a failed request the mode is
+    // kept until the retry time.
+    int64_t now_us = esp_timer_get_time();
+    if (mode != digital_level_stats.mode && (xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) && now_us >= level_reports_retry_us) {
+        digital_level_mode_t previous_mode = digital_level_stats.mode;
+        bool previous_fusion_fallback = fusion_fallback_active;
+
+        fusion_fallback_active = false;
+        if (request_level_reports(mode) == ESP_OK) {
+            if (previous_mode == DIGITAL_LEVEL_MODE_ACCELEROMETER) {
+                digital_level_stats.accelerometer_mode_time_us += now_us - level_mode_since_us;
+            }
+            level_mode_since_us = now_us;
+            digital_level_stats.mode = mode;
+            digital_level_stats.mode_change_count += 1;
+            filtered_gravity_valid = false;
+
+            // Give the game rotation vector the fallback timeout to resume
+            fusion_fallback_kick(&fusion_fallback_timeout, now_us, 0);
+
+            ESP_LOGI(TAG, "Level mode: %s, report interval %lu ms", get_level_mode_name(mode), digital_level_stats.report_interval_ms);
+        }
+        else {
+            // Stay in the previous mode with its reports, the ones already switched are requested back
+            fusion_fallback_active = previous_fusion_fallback;
+            request_level_reports(previous_mode);
+            ESP_LOGW(TAG, "Level mode: staying in the %s mode, switching to the %s mode again in %d ms", get_level_mode_name(previous_mode),
+                     get_level_mode_name(mode), DIGITAL_LEVEL_VIEW_REPORT_RETRY_MS);
+        }
+    }
+
+    xSemaphoreGive(level_mode_lock);
+}
+
+
+static void retry_level_reports() {
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+
+    // Request the reports of the current mode again, until the sensor accepts them
+    if (level_reports_pending && (xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) && esp_timer_get_time() >= level_reports_retry_us) {
+        if (request_level_reports(digital_level_stats.mode) == ESP_OK) {
+            ESP_LOGI(TAG, "Level mode: %s mode reports restored", get_level_mode_name(digital_level_stats.mode));
+        }
+    }
+
+    // Same for the recoil capture report, needed by the analysis view as well
+    if (recoil_capture_report_pending && (xEventGroupGetBits(sensor_task_control) & (SENSOR_POLL_EVENT_RUN | SENSOR_POLL_EVENT_CAPTURE)) &&
+        esp_timer_get_time() >= recoil_capture_report_retry_us) {
+        if (request_recoil_capture_report() == ESP_OK) {
+            ESP_LOGI(TAG, "Recoil capture report restored");
+        }
+    }
+
+    xSemaphoreGive(level_mode_lock);
+}
+
+
+static void update_level_mode() {
+    // Motion reported by the stability detector switches back to the fusion right away
+    sh2_StabilityDetector_t stability_detector;
+    if (bno085_read_stability_detector(bno085_dev, &stability_detector_subscriber, &stability_detector, false) == ESP_OK &&
+        (stability_detector.stability & STABILITY_DETECTOR_EXITED)) {
+        at_rest_since_us = 0;
+        set_level_mode(DIGITAL_LEVEL_MODE_FUSION);
+        return;
+    }
+
+    // At rest as classified by the rate governor
+    rate_governor_stats_t governor_stats;
+    get_sensor_rate_governor_stats(&governor_stats);
+    int64_t now_us = esp_timer_get_time();
+
+    if (governor_stats.mode != RATE_GOVERNOR_MODE_STATIC) {
+        at_rest_since_us = 0;
+        set_level_mode(DIGITAL_LEVEL_MODE_FUSION);
+    }
+    else if (at_rest_since_us == 0) {
+        at_rest_since_us = now_us;
+    }
+    else if (now_us - at_rest_since_us >= DIGITAL_LEVEL_VIEW_LOW_POWER_SETTLE_MS * 1000) {
+        set_level_mode(DIGITAL_LEVEL_MODE_ACCELEROMETER);
+    }
+}
+
+
+/**
+ * @return true while the level is drawn from bno085_fusion.
+ */
+static bool update_fusion_fallback() {
+    // No game rotation vector drawn for a while (sensor recovery, stall) or none requested at all. The gap follows the
+    // effective interval, slowed down by the rate governor while the device rests.
+    bool missing = !sensor_config.enable_game_rotation_vector_report ||
+                   fusion_fallback_is_missing(&fusion_fallback_timeout, esp_timer_get_time(), bno085_get_report_interval_us(bno085_dev, SH2_GAME_ROTATION_VECTOR));
+    bool started = false;
+
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+
+    // Only in the fusion mode, the view may have been disabled meanwhile and its reports released
+    if (digital_level_stats.mode == DIGITAL_LEVEL_MODE_FUSION && (xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) &&
+        esp_timer_get_time() >= level_reports_retry_us) {
+        bool active = DIGITAL_LEVEL_VIEW_FUSION_FALLBACK && missing;
+        if (active != fusion_fallback_active) {
+            fusion_fallback_active = active;
+            if (request_level_reports(DIGITAL_LEVEL_MODE_FUSION) == ESP_OK) {
+                if (active) {
+                    digital_level_stats.fusion_fallback_count += 1;
+                    started = true;
+                }
+                ESP_LOGI(TAG, "Level fusion fallback %s", active ? "started, no game rotation vector" : "stopped, game rotation vector resumed");
+            }
+            else {
+                // Keep the current reports, the change is tried again after the retry time
+                fusion_fallback_active = !active;
+                request_level_reports(DIGITAL_LEVEL_MODE_FUSION);
+            }
+        }
+    }
+    bool active = fusion_fallback_active;
+
+    xSemaphoreGive(level_mode_lock);
+
+    if (started) {
+        // Aligned to gravity again by the first accelerometer sample, skip the samples of a previous fallback
+        bno085_fusion_reset(&level_fusion);
+        bno085_subscriber_flush(bno085_dev, &gyroscope_subscriber);
+        bno085_subscriber_flush(bno085_dev, &accelerometer_subscriber);
+    }
+
+    return active;
+}
+
+
+void get_digital_level_view_controller_stats(digital_level_stats_t *stats) {
+    // Updated by the sensor poller task only, a torn read across the fields is acceptable for statistics
+    memcpy(stats, &digital_level_stats, sizeof(digital_level_stats_t));
+}
+
+
+static void record_handler_latency(int64_t arrival_us) {
+    int64_t latency_us = esp_timer_get_time() - arrival_us;
+
+    handler_latency_histogram[bno085_latency_histogram_bucket(latency_us)] += 1;
+    handler_latency_count += 1;
+    if (latency_us > handler_latency_max_us) {
+        handler_latency_max_us = latency_us;
+    }
+}
 
-float get_relative_roll_angle_rad_thread_unsafe() {
-    float raw_roll = sensor_roll_thread_unsafe - system_config.rotation * M_PI_2 + digital_level_view_config.user_roll_rad_offset;
+
+#if !DIGITAL_LEVEL_VIEW_GRAVITY_CANT
+static float get_relative_roll_angle_rad(float roll_rad) {
+    float raw_roll = roll_rad - system_config.rotation * M_PI_2 + digital_level_view_config.user_roll_rad_offset;
     return wrap_angle(raw_roll);
 }
+#endif  // DIGITAL_LEVEL_VIEW_GRAVITY_CANT
+
+
+// Cant in the display frame, with the sensor roll, pitch and yaw from a game rotation vector
+static void quaternion_to_cant(const quaternion_t *q, float *cant_rad, float *roll_rad, float *pitch_rad, float *yaw_rad) {
+#if DIGITAL_LEVEL_VIEW_GRAVITY_CANT
+    update_gravity_cant_frame();
+
+    float gravity[3];
+    gravity_from_quaternion(q->real, q->i, q->j, q->k, gravity);
+    gravity_cant_compute(&gravity_cant_frame, gravity, cant_rad, pitch_rad);
+
+    // Sensor roll for the shared state, undo the frame offset rather than decomposing the quaternion. Yaw is not tracked.
+    *roll_rad = wrap_angle(*cant_rad - gravity_cant_frame.offset_rad);
+#else
+    quaternion_to_euler_f32(q, roll_rad, pitch_rad, yaw_rad);
+
+    // Roll is calculated based on the base measurement - screen rotation offset + user roll offset
+    *cant_rad = get_relative_roll_angle_rad(*roll_rad);
+#endif  // DIGITAL_LEVEL_VIEW_GRAVITY_CANT
+}
+
+
+static esp_err_t read_game_rotation_vector_cant(float *cant_rad) {
+    // Drain every sample into the history so the shots are aligned against the full report rate, draw the latest one
+    size_t sample_count = bno085_subscriber_read(bno085_dev, &game_rotation_vector_subscriber, game_rotation_vector_samples, GAME_ROTATION_VECTOR_SAMPLE_BATCH_SIZE, 0);
+    const bno085_sample_t *latest = NULL;
+
+    for (size_t idx = 0; idx < sample_count; idx += 1) {
+        // Skip the samples received while the sensor is being recovered
+        if (!game_rotation_vector_samples[idx].valid) {
+            continue;
+        }
+        record_handler_latency(game_rotation_vector_samples[idx].arrival_us);
+
+        const sh2_RotationVector_t *value = &game_rotation_vector_samples[idx].value.un.gameRotationVector;
+        float q[4] = {value->real, value->i, value->j, value->k};
+        timebase_history_push(&orientation_history, game_rotation_vector_samples[idx].timestamp_us, q);
+        latest = &game_rotation_vector_samples[idx];
+    }
+
+    if (latest == NULL) {
+        return ESP_FAIL;
+    }
+    fusion_fallback_kick(&fusion_fallback_timeout, latest->arrival_us, bno085_get_report_interval_us(bno085_dev, SH2_GAME_ROTATION_VECTOR));
+
+    const sh2_RotationVector_t *value = &latest->value.un.gameRotationVector;
+    quaternion_t q = {
+        .real = value->real,
+        .i = value->i,
+        .j = value->j,
+        .k = value->k,
+    };
+    quaternion_to_cant(&q, cant_rad, &orientation_state.roll_rad, &orientation_state.pitch_rad, &orientation_state.yaw_rad);
+    orientation_state.orientation_timestamp_us = latest->timestamp_us;
+    return ESP_OK;
+}
+
+
+static void roll_pitch_to_quaternion(float roll_rad, float pitch_rad, quaternion_t *q) {
+    // Yaw is not observable by bno085_fusion, take it as zero, neither cant computation depends on it
+    float cr = cosf(roll_rad * 0.5f), sr = sinf(roll_rad * 0.5f);
+    float cp = cosf(pitch_rad * 0.5f), sp = sinf(pitch_rad * 0.5f);
+    q->real = cr * cp;
+    q->i = sr * cp;
+    q->j = cr * sp;
+    q->k = -sr * sp;
+}
+
+
+static esp_err_t read_fusion_cant(float *cant_rad) {
+    size_t gyroscope_count = bno085_subscriber_read(bno085_dev, &gyroscope_subscriber, gyroscope_samples, FUSION_SAMPLE_BATCH_SIZE, 0);
+    size_t accelerometer_count = bno085_subscriber_read(bno085_dev, &accelerometer_subscriber, accelerometer_samples, FUSION_SAMPLE_BATCH_SIZE, 0);
+    int64_t output_timestamp_us = -1;
+    quaternion_t q;
+
+    // Merge on the sensor timebase, so every gyroscope step is corrected with the accelerometer sample preceding it
+    size_t gyroscope_idx = 0, accelerometer_idx = 0;
+    while (gyroscope_idx < gyroscope_count || accelerometer_idx < accelerometer_count) {
+        bool accelerometer = accelerometer_idx < accelerometer_count &&
+            (gyroscope_idx >= gyroscope_count || accelerometer_samples[accelerometer_idx].timestamp_us <= gyroscope_samples[gyroscope_idx].timestamp_us);
+        const bno085_sample_t *sample = accelerometer ? &accelerometer_samples[accelerometer_idx++] : &gyroscope_samples[gyroscope_idx++];
+
+        // Skip the samples received while the sensor is being recovered
+        if (!sample->valid) {
+            continue;
+        }
+        record_handler_latency(sample->arrival_us);
+
+        if (accelerometer) {
+            const sh2_Accelerometer_t *value = &sample->value.un.accelerometer;
+            bno085_fusion_update_accelerometer(&level_fusion, sample->timestamp_us, value->x, value->y, value->z);
+        }
+        else {
+            const sh2_Gyroscope_t *value = &sample->value.un.gyroscope;
+            if (bno085_fusion_update_gyroscope(&level_fusion, sample->timestamp_us, value->x, value->y, value->z) && level_fusion.aligned) {
+                // Outputs at the game rotation vector rate, kept in the history so the shots are still aligned
+                float roll, pitch;
+                bno085_fusion_get_roll_pitch(&level_fusion, &roll, &pitch);
+                roll_pitch_to_quaternion(roll, pitch, &q);
+                float history_q[4] = {q.real, q.i, q.j, q.k};
+                timebase_history_push(&orientation_history, sample->timestamp_us, history_q);
+                output_timestamp_us = sample->timestamp_us;
+            }
+        }
+    }
+
+    if (output_timestamp_us < 0) {
+        return ESP_FAIL;
+    }
+
+    quaternion_to_cant(&q, cant_rad, &orientation_state.roll_rad, &orientation_state.pitch_rad, &orientation_state.yaw_rad);
+    orientation_state.orientation_timestamp_us = output_timestamp_us;
+    return ESP_OK;
+}
+
+
+static void annotate_shot(int64_t trigger_timestamp_us, float display_roll) {
+    // The game rotation vector arrives at a lower rate than the linear acceleration, the capture completes once the
+    // post-trigger window is collected, by then the samples around the trigger are in the history
+    float q[4];
+    if (timebase_history_lookup(&orientation_history, trigger_timestamp_us, q)) {
+        quaternion_t quaternion = {.real = q[0], .i = q[1], .j = q[2], .k = q[3]};
+        float roll, yaw;
+        quaternion_to_cant(&quaternion, &orientation_state.shot_cant_rad, &roll, &orientation_state.shot_pitch_rad, &yaw);
+    }
+    else {
+        // Not covered, e.g. in the accelerometer mode, use the latest orientation
+        orientation_state.shot_cant_rad = display_roll;
+        orientation_state.shot_pitch_rad = orientation_state.pitch_rad;
+        ESP_LOGW(TAG, "Shot orientation not aligned, using the latest orientation");
+    }
+    orientation_state.shot_timestamp_us = trigger_timestamp_us;
+
+    ESP_LOGI(TAG, "Shot: cant %.2f deg, pitch %.2f deg", RAD_TO_DEG(orientation_state.shot_cant_rad), RAD_TO_DEG(orientation_state.shot_pitch_rad));
+}
+
+
+void get_sensor_orientation_state(orientation_state_t *state) {
+    orientation_state_read(&orientation_state_latch, state);
+}
 
 
 void unified_sensor_poller_task(void *p) {
     // Disable the task watchdog as the task is expected to block indefinitely
     esp_task_wdt_delete(NULL);
 
-    TickType_t last_poll_tick;
-    float last_sensor_x_acceleration = 0;
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &game_rotation_vector_subscriber, SH2_GAME_ROTATION_VECTOR, NULL, GAME_ROTATION_VECTOR_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &linear_acceleration_subscriber, SH2_LINEAR_ACCELERATION, NULL, LINEAR_ACCELERATION_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &accelerometer_subscriber, SH2_ACCELEROMETER, NULL, ACCELEROMETER_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &stability_detector_subscriber, SH2_STABILITY_DETECTOR, NULL, STABILITY_DETECTOR_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &gyroscope_subscriber, SH2_GYROSCOPE_CALIBRATED, NULL, GYROSCOPE_NOTIFY_BIT));
 
     while (1) {
-        xEventGroupWaitBits(sensor_task_control, SENSOR_POLL_EVENT_RUN, pdFALSE, pdFALSE, portMAX_DELAY);
+        xEventGroupWaitBits(sensor_task_control, SENSOR_POLL_EVENT_RUN | SENSOR_POLL_EVENT_CAPTURE, pdFALSE, pdFALSE, portMAX_DELAY);
 
-        last_poll_tick = xTaskGetTickCount();
-        while (xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) {
-            // Wait for watched sensor ids
-            // Game rotation vectors
-            if (bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_dev, &sensor_roll_thread_unsafe, &sensor_pitch_thread_unsafe, NULL, false) == ESP_OK) {
-                // Roll is calculated based on the base measurement - screen rotation offset + user roll offset
-                float display_roll = get_relative_roll_angle_rad_thread_unsafe();
+        // Skip samples received while the view is inactive
+        bno085_subscriber_flush(bno085_dev, &game_rotation_vector_subscriber);
+        bno085_subscriber_flush(bno085_dev, &linear_acceleration_subscriber);
+        bno085_subscriber_flush(bno085_dev, &accelerometer_subscriber);
+        bno085_subscriber_flush(bno085_dev, &stability_detector_subscriber);
+        bno085_subscriber_flush(bno085_dev, &gyroscope_subscriber);
+        timebase_history_reset(&orientation_history);
+        at_rest_since_us = 0;
+        fusion_fallback_kick(&fusion_fallback_timeout, esp_timer_get_time(), 0);
+        bno085_fusion_reset(&level_fusion);
 
-                // Redraw the screen
-                if (lvgl_port_lock(LVGL_UNLOCK_WAIT_TIME_MS)) {  // prevent a deadlock if the LVGL event wants to continue
-                    update_digital_level_view(display_roll, sensor_pitch_thread_unsafe);
-                    // ESP_LOGI(TAG, "Screen upated");
-                    lvgl_port_unlock();
-                }
+        // Samples are handled as soon as they arrive, the screen is redrawn at most once per display period
+        bool render_pending = false;
+        int64_t last_render_us = 0;
+        float display_roll = 0;
+        bool fusion_fallback = false;
+        memset(handler_latency_histogram, 0, sizeof(handler_latency_histogram));
+        handler_latency_count = 0;
+        handler_latency_max_us = 0;
+
+        while (xEventGroupGetBits(sensor_task_control) & (SENSOR_POLL_EVENT_RUN | SENSOR_POLL_EVENT_CAPTURE)) {
+            // Block until a subscribed report publishes a sample, or the pending redraw is due. The notification bits are
+            // cleared before the rings are drained, so a sample published meanwhile wakes the task again.
+            TickType_t wait_ticks = portMAX_DELAY;
+            if (render_pending) {
+                int64_t render_due_us = last_render_us + DIGITAL_LEVEL_VIEW_DISPLAY_UPDATE_PERIOD_MS * 1000 - esp_timer_get_time();
+                // Sleep at least a tick, a zero wait would spin until the redraw is due
+                wait_ticks = render_due_us > 0 ? pdMS_TO_TICKS((render_due_us + 999) / 1000) + 1 : 0;
+            }
+            if (DIGITAL_LEVEL_VIEW_FUSION_FALLBACK && !fusion_fallback) {
+                // Wake up even if the game rotation vector stops, to fall back on the fusion
+                TickType_t fallback_ticks = pdMS_TO_TICKS(DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_MS) + 1;
+                wait_ticks = wait_ticks < fallback_ticks ? wait_ticks : fallback_ticks;
+            }
+            if (level_reports_pending || recoil_capture_report_pending) {
+                // Wake up for the retry of a failed report request, the reports may not be running at all
+                TickType_t retry_ticks = pdMS_TO_TICKS(DIGITAL_LEVEL_VIEW_REPORT_RETRY_MS) + 1;
+                wait_ticks = wait_ticks < retry_ticks ? wait_ticks : retry_ticks;
+            }
+            xTaskNotifyWait(0, SENSOR_POLL_NOTIFY_BITS, NULL, wait_ticks);
+
+            // Leave the fusion while the device rests, return on motion. A failed report request is retried first.
+            retry_level_reports();
+            update_level_mode();
+
+            // Arm the recoil capture while it has a consumer
+            update_recoil_capture_arming();
+
+            // Game rotation vectors. Every sample is kept in the history, only the latest one is drawn. Drained before the
+            // fallback decides, a sample pending since the wake-up is not a gap.
+            if (read_game_rotation_vector_cant(&display_roll) == ESP_OK) {
+                orientation_state_publish(&orientation_state_latch, &orientation_state);
+                render_pending = true;
             }
 
-            // Linear acceleration
-            if (bno085_wait_for_linear_acceleration_report(bno085_dev, &sensor_x_acceleration_thread_unsafe, &sensor_y_acceleration_thread_unsafe, &sensor_z_acceleration_thread_unsafe, false) == ESP_OK) {
-                // ESP_LOGI(TAG, "Digital Level View Controller Analysis: x=%.2f, y=%.2f, z=%.2f", sensor_x_acceleration_thread_unsafe, sensor_y_acceleration_thread_unsafe, sensor_z_acceleration_thread_unsafe);
-                float x_abs = fabsf(sensor_x_acceleration_thread_unsafe);
-                last_sensor_x_acceleration = sensor_x_acceleration_thread_unsafe;
+            // Fusion of the gyroscope and accelerometer while the game rotation vector is missing
+            fusion_fallback = update_fusion_fallback();
+            if (fusion_fallback && read_fusion_cant(&display_roll) == ESP_OK) {
+                orientation_state_publish(&orientation_state_latch, &orientation_state);
+                render_pending = true;
+            }
+
+            // Accelerometer in the low power mode
+            if (digital_level_stats.mode == DIGITAL_LEVEL_MODE_ACCELEROMETER && read_accelerometer_cant(&display_roll) == ESP_OK) {
+                record_handler_latency(accelerometer_subscriber.last_arrival_us);
+                orientation_state.orientation_timestamp_us = accelerometer_subscriber.last_timestamp_us;
+                orientation_state_publish(&orientation_state_latch, &orientation_state);
+                render_pending = true;
+            }
+
+            // Linear acceleration. Drain every sample received since the last wake-up so short recoil impulses are not missed
+            size_t sample_count = bno085_subscriber_read(bno085_dev, &linear_acceleration_subscriber, linear_acceleration_samples, LINEAR_ACCELERATION_SAMPLE_BATCH_SIZE, 0);
+            for (size_t idx = 0; idx < sample_count; idx += 1) {
+                // Skip the samples received while the sensor is being recovered
+                if (!linear_acceleration_samples[idx].valid) {
+                    continue;
+                }
+                record_handler_latency(linear_acceleration_samples[idx].arrival_us);
+
+                orientation_state.x_acceleration = linear_acceleration_samples[idx].value.un.linearAcceleration.x;
+                orientation_state.y_acceleration = linear_acceleration_samples[idx].value.un.linearAcceleration.y;
+                orientation_state.z_acceleration = linear_acceleration_samples[idx].value.un.linearAcceleration.z;
+                orientation_state.acceleration_timestamp_us = linear_acceleration_samples[idx].timestamp_us;
 
-                if (last_sensor_x_acceleration < sensor_config.recoil_acceleration_trigger_level && 
-                    x_abs >= sensor_config.recoil_acceleration_trigger_level && 
-                    sensor_config.trigger_edge == TRIGGER_RISING_EDGE
-                ) {
+                // ESP_LOGI(TAG, "Digital Level View Controller Analysis: x=%.2f, y=%.2f, z=%.2f", orientation_state.x_acceleration, orientation_state.y_acceleration, orientation_state.z_acceleration);
+                recoil_capture_event_t recoil_event = recoil_capture_push(&recoil_capture, linear_acceleration_samples[idx].timestamp_us, orientation_state.x_acceleration);
 
+                if (recoil_event == RECOIL_CAPTURE_EVENT_TRIGGER) {
                     // ESP_LOGI(TAG, "Recoil detected, auto_start_countdown_timer_on_recoil: %d, get_countdown_timer_widget_enabled: %d, get_countdown_timer_state: %d",
                     //          digital_level_view_config.auto_start_countdown_timer_on_recoil,
                     //          get_countdown_timer_widget_enabled(),
                     //          get_countdown_timer_state(&countdown_timer));
                     // Shot has fired, start the timer if not started already
-                    if (digital_level_view_config.auto_start_countdown_timer_on_recoil &&     // recoil detected
+                    if ((xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) &&  // level displayed
+                        digital_level_view_config.auto_start_countdown_timer_on_recoil &&     // recoil detected
                         get_countdown_timer_widget_enabled() &&                               // widget is enabled
                         (get_countdown_timer_state(&countdown_timer) == COUNTDOWN_TIMER_PAUSE)  // timer is ready
                     ) {
                         countdown_timer_continue(&countdown_timer);
-                        ESP_LOGI(TAG, "Countdown timer started due to recoil");
+                        ESP_LOGI(TAG, "Countdown timer started due to recoil, sample age: %lld us", esp_timer_get_time() - linear_acceleration_samples[idx].timestamp_us);
                     }
                 }
+                else if (recoil_event == RECOIL_CAPTURE_EVENT_COMPLETE) {
+                    // Hand the shot over to the acceleration analysis view, then look for the next shot
+                    annotate_shot(recoil_capture.trigger_timestamp_us, display_roll);
+                    update_acceleration_analysis_view_capture(&recoil_capture);
+                    recoil_capture_arm(&recoil_capture);
+                }
+            }
+
+            // Publish the last acceleration of the batch
+            if (sample_count > 0) {
+                orientation_state_publish(&orientation_state_latch, &orientation_state);
             }
 
-            vTaskDelayUntil(&last_poll_tick, pdMS_TO_TICKS(DIGITAL_LEVEL_VIEW_DISPLAY_UPDATE_PERIOD_MS));
+            if (render_pending && esp_timer_get_time() - last_render_us >= DIGITAL_LEVEL_VIEW_DISPLAY_UPDATE_PERIOD_MS * 1000) {
+                // Redraw the screen
+                if (lvgl_port_lock(LVGL_UNLOCK_WAIT_TIME_MS)) {  // prevent a deadlock if the LVGL event wants to continue
+                    update_digital_level_view(display_roll, orientation_state.pitch_rad);
+                    // ESP_LOGI(TAG, "Screen upated");
+                    lvgl_port_unlock();
+                }
+                render_pending = false;
+                last_render_us = esp_timer_get_time();
+            }
+        }
+
+        if (handler_latency_count > 0) {
+            // Percentiles are the upper bounds of the log2 buckets
+            ESP_LOGI(TAG, "Sample to handler latency over %lu samples: p50 <%lu us, p90 <%lu us, p99 <%lu us, max %lld us",
+                     handler_latency_count,
+                     bno085_latency_histogram_percentile_us(handler_latency_histogram, 50),
+                     bno085_latency_histogram_percentile_us(handler_latency_histogram, 90),
+                     bno085_latency_histogram_percentile_us(handler_latency_histogram, 99),
+                     handler_latency_max_us);
         }
+
+        recoil_capture_disarm(&recoil_capture);
     }
 }
 
 
 void enable_digital_level_view_controller(bool enable) {
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+
     if (enable) {
-        // Enable sensor report
-        if (sensor_config.enable_game_rotation_vector_report) {
-            ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS));
-        }
-        if (sensor_config.enable_linear_acceleration_report) {
-            ESP_ERROR_CHECK(bno085_enable_linear_acceleration_report(bno085_dev, SENSOR_LINEAR_ACCELERATION_REPORT_PERIOD_MS));
-        }
+        // Request sensor report, always start with the fusion
+        level_enabled = true;
+        digital_level_stats.mode = DIGITAL_LEVEL_MODE_FUSION;
+        fusion_fallback_active = false;
+        level_reports_retry_us = 0;
+        request_level_reports(DIGITAL_LEVEL_MODE_FUSION);  // Retried by the sensor poller task on failure
+        request_recoil_capture_report();  // Retried by the sensor poller task on failure
 
         xEventGroupSetBits(sensor_task_control, SENSOR_POLL_EVENT_RUN);
+        xSemaphoreGive(level_mode_lock);
     } else {
-        // Disable sensor report
-        if (sensor_config.enable_game_rotation_vector_report) {
-            ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, 0));
+        if (digital_level_stats.mode == DIGITAL_LEVEL_MODE_ACCELEROMETER) {
+            digital_level_stats.accelerometer_mode_time_us += esp_timer_get_time() - level_mode_since_us;
         }
-        if (sensor_config.enable_linear_acceleration_report) {
-            ESP_ERROR_CHECK(bno085_enable_linear_acceleration_report(bno085_dev, 0));
+
+        // Release sensor report, other views may still need them
+        level_enabled = false;
+        fusion_fallback_active = false;
+        level_reports_pending = false;
+        bno085_defer_report_requests(bno085_dev);
+        bno085_update_report_request(bno085_dev, &game_rotation_vector_request, 0);
+        bno085_update_report_request(bno085_dev, &accelerometer_request, 0);
+        bno085_update_report_request(bno085_dev, &gyroscope_request, 0);
+        bno085_update_report_request(bno085_dev, &stability_detector_request, 0);
+        esp_err_t ret = bno085_apply_report_requests(bno085_dev);
+        if (ret != ESP_OK) {
+            // The requests are released, the reports the sensor did not stop are stopped by the next request applied
+            ESP_LOGW(TAG, "Failed to release the level reports: %s", esp_err_to_name(ret));
         }
+        request_recoil_capture_report();  // The analysis view may still need it
         xEventGroupClearBits(sensor_task_control, SENSOR_POLL_EVENT_RUN);
+        xSemaphoreGive(level_mode_lock);
+
+        // Wake the task so it sees the stop without waiting for another sample
+        xTaskNotify(sensor_poller_task_handle, SENSOR_POLL_STOP_NOTIFY_BIT, eSetBits);
     }
 }
 
 
+void enable_recoil_capture_for_analysis(bool enable) {
+    xSemaphoreTake(level_mode_lock, portMAX_DELAY);
+
+    analysis_capture_enabled = enable;
+    request_recoil_capture_report();  // Retried by the sensor poller task on failure
+    if (enable) {
+        xEventGroupSetBits(sensor_task_control, SENSOR_POLL_EVENT_CAPTURE);
+    } else {
+        xEventGroupClearBits(sensor_task_control, SENSOR_POLL_EVENT_CAPTURE);
+    }
+
+    xSemaphoreGive(level_mode_lock);
+
+    // Wake the task so it arms or disarms the capture without waiting for another sample
+    xTaskNotify(sensor_poller_task_handle, SENSOR_POLL_STOP_NOTIFY_BIT, eSetBits);
+}
+
+
 esp_err_t digital_level_view_controller_init() {
+    orientation_state_init(&orientation_state_latch);
+    timebase_history_init(&orientation_history, TIMEBASE_INTERPOLATION_SLERP, 4, DIGITAL_LEVEL_VIEW_ORIENTATION_MAX_GAP_MS * 1000);
+    gravity_cant_set_frame(&gravity_cant_frame, system_config.rotation, digital_level_view_config.user_roll_rad_offset);
+
+    // Outputs at the game rotation vector rate it stands in for
+    bno085_fusion_config_t fusion_config = {
+        .beta = BNO085_FUSION_DEFAULT_BETA,
+        .output_interval_us = SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS * 1000,
+    };
+    bno085_fusion_init(&level_fusion, &fusion_config);
+
+    fusion_fallback_config_t fusion_fallback_config = {
+        .min_timeout_us = DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_MS * 1000,
+        .timeout_intervals = DIGITAL_LEVEL_VIEW_FUSION_FALLBACK_TIMEOUT_INTERVALS,
+    };
+    fusion_fallback_init(&fusion_fallback_timeout, &fusion_fallback_config, 0);
+
     sensor_task_control = xEventGroupCreate();
     if (sensor_task_control == NULL) {
         ESP_LOGE(TAG, "Failed to create sensor_task_control");
         return ESP_FAIL;
     }
 
+    level_mode_lock = xSemaphoreCreateMutex();
+    if (level_mode_lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create level_mode_lock");
+        return ESP_FAIL;
+    }
+
     BaseType_t rtos_return;
     // Create acceleration poller task
     rtos_return = xTaskCreate(
@@ -144,19 +783,12 @@ esp_err_t digital_level_view_controller_init() {
         ESP_ERROR_CHECK(ESP_FAIL);
     }
 
-    // Initialize sensor reports
-    if (sensor_config.enable_game_rotation_vector_report) {
-        ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS));
-    }
-    else {
-        ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, 0));
-    }
-    if (sensor_config.enable_linear_acceleration_report) {
-        ESP_ERROR_CHECK(bno085_enable_linear_acceleration_report(bno085_dev, SENSOR_LINEAR_ACCELERATION_REPORT_PERIOD_MS));
-    }
-    else {
-        ESP_ERROR_CHECK(bno085_enable_linear_acceleration_report(bno085_dev, 0));
-    }
+    // Register sensor report requests, the reports are requested when the view is enabled
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &game_rotation_vector_request, SH2_GAME_ROTATION_VECTOR));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &linear_acceleration_request, SH2_LINEAR_ACCELERATION));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &accelerometer_request, SH2_ACCELEROMETER));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &stability_detector_request, SH2_STABILITY_DETECTOR));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &gyroscope_request, SH2_GYROSCOPE_CALIBRATED));
 
     return ESP_OK;
 }
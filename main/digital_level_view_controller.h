@@ -4,6 +4,7 @@
 #include <lvgl.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "orientation_state.h"
 
 typedef lv_obj_t * (*view_constructor_t)(lv_obj_t * parent);
 typedef void (*view_destructor_t)(lv_obj_t * container);
@@ -25,7 +26,37 @@ typedef enum {
 esp_err_t digital_level_view_controller_init();
 
 void enable_digital_level_view_controller(bool enable);
-float get_relative_roll_angle_rad_thread_unsafe();
+
+/**
+ * @brief Keep the recoil capture armed for the acceleration analysis view, also while the level is not displayed. The
+ * complete captures are handed over with update_acceleration_analysis_view_capture().
+ */
+void enable_recoil_capture_for_analysis(bool enable);
+
+typedef enum {
+    DIGITAL_LEVEL_MODE_FUSION,              // Cant from the game rotation vector, gyroscope running
+    DIGITAL_LEVEL_MODE_ACCELEROMETER,       // Device at rest, cant from the low-pass filtered accelerometer at a low rate
+} digital_level_mode_t;
+
+
+typedef struct {
+    digital_level_mode_t mode;
+    uint32_t report_interval_ms;            // Interval of the report driving the level in the current mode
+    uint32_t mode_change_count;
+    int64_t accelerometer_mode_time_us;     // Time spent in the accelerometer mode, excluding the current period
+    uint32_t fusion_fallback_count;         // Times the level fell back on bno085_fusion for lack of game rotation vectors
+} digital_level_stats_t;
+
+
+/**
+ * @brief Get the level mode statistics.
+ */
+void get_digital_level_view_controller_stats(digital_level_stats_t *stats);
+
+/**
+ * @brief Get a consistent snapshot of the orientation and acceleration published by the sensor poller task.
+ */
+void get_sensor_orientation_state(orientation_state_t *state);
 
 
 #endif // DIGITAL_LEVEL_VIEW_CONTROLLER_H
\ No newline at end of file
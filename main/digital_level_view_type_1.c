@@ -5,6 +5,7 @@
 #include "system_config.h"
 #include "app_cfg.h"
 #include "bno085.h"
+#include "fast_math.h"
 
 #include "esp_check.h"
 #include "esp_log.h"
@@ -48,7 +49,7 @@ static void digital_level_view_draw_event_cb(lv_event_t * e) {
     int32_t disp_height = lv_area_get_height(&coords);
     float max_delta_vertical_shift = disp_height/ 4.0;  // maximum vertical shift for the indicator lines
     float max_delta_vertical_vertex = disp_height / 2.0f - 20;  // Maximum vertical verticies for the triangle
-    float delta_vertical_shift = -tanf(pitch_rad_local) * (disp_height / 2) * digital_level_view_config.pitch_display_gain;
+    float delta_vertical_shift = -display_tanf(pitch_rad_local) * (disp_height / 2) * digital_level_view_config.pitch_display_gain;
     float vertical_base_position = disp_height / 2 + delta_vertical_shift;
 
     float threshold_rad = DEG_TO_RAD(digital_level_view_config.delta_level_threshold);
@@ -87,7 +88,7 @@ static void digital_level_view_draw_event_cb(lv_event_t * e) {
     }
     else {
         // Calculate verticies for the triangle
-        float dy = fabsf(tanf(roll_rad_local) * (disp_width / 2));
+        float dy = fabsf(display_tanf(roll_rad_local) * (disp_width / 2));
 
         // Apply gain
         dy *= digital_level_view_config.roll_display_gain;
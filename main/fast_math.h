@@ -0,0 +1,116 @@
+#ifndef FAST_MATH_H_
+#define FAST_MATH_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Bounded-error approximations of the trigonometric functions used by the render path. The error bounds below are the
+ * largest absolute differences against the double precision libm result, measured over every float in the stated input
+ * range. All bounds are well under 0.01 deg (1.745e-4 rad).
+ *
+ * Call sites select between the approximation and libm at compile time through the `display_*` wrappers, controlled
+ * by USE_FAST_DISPLAY_MATH. Sensor-side computations that need full precision should keep calling libm directly.
+ */
+
+#ifndef USE_FAST_DISPLAY_MATH
+    #define USE_FAST_DISPLAY_MATH 1
+#endif  // USE_FAST_DISPLAY_MATH
+
+
+#define FAST_MATH_PI     3.14159265358979f
+#define FAST_MATH_PI_2   1.57079632679490f
+#define FAST_MATH_PI_4   0.78539816339745f
+#define FAST_MATH_2_PI   6.28318530717959f
+
+
+/**
+ * @brief atan(x) for x in [0, 1]. Max error 1.2e-5 rad (6.6e-4 deg).
+ */
+static inline float fast_atan_unit(float x) {
+    // Abramowitz & Stegun 4.4.49
+    float x2 = x * x;
+    return x * (0.9998660f + x2 * (-0.3302995f + x2 * (0.1801410f + x2 * (-0.0851330f + x2 * 0.0208351f))));
+}
+
+
+/**
+ * @brief atan2(y, x). Max error 1.2e-5 rad (6.6e-4 deg), inherited from the first octant. Returns 0 for (0, 0).
+ */
+static inline float fast_atan2f(float y, float x) {
+    float abs_x = fabsf(x);
+    float abs_y = fabsf(y);
+    if (abs_x == 0.0f && abs_y == 0.0f) {
+        return 0.0f;
+    }
+
+    // Reduce to the first octant
+    float angle;
+    if (abs_y <= abs_x) {
+        angle = fast_atan_unit(abs_y / abs_x);
+    }
+    else {
+        angle = FAST_MATH_PI_2 - fast_atan_unit(abs_x / abs_y);
+    }
+
+    if (x < 0.0f) {
+        angle = FAST_MATH_PI - angle;
+    }
+    return (y < 0.0f) ? -angle : angle;
+}
+
+
+/**
+ * @brief asin(x) for x in [-1, 1], clamped outside. Max error 1.2e-5 rad (6.7e-4 deg).
+ */
+static inline float fast_asinf(float x) {
+    x = x > 1.0f ? 1.0f : x;
+    x = x < -1.0f ? -1.0f : x;
+    return fast_atan2f(x, sqrtf(1.0f - x * x));
+}
+
+
+/**
+ * @brief Wrap an angle to [-pi, pi). Exact up to float rounding, max error 3.5e-7 rad for |rad| <= 20.
+ */
+static inline float fast_wrap_angle(float rad) {
+    return rad - FAST_MATH_2_PI * floorf((rad + FAST_MATH_PI) * (1.0f / FAST_MATH_2_PI));
+}
+
+
+/**
+ * @brief tan(x). Max error 1.4e-5, relative to max(|tan(x)|, 1), for |x| <= 1.55 rad (88.8 deg).
+ */
+static inline float fast_tanf(float x) {
+    // Reduce to [-pi/2, pi/2] (period of pi), then to [0, pi/4] with tan(x) = 1 / tan(pi/2 - x)
+    x = x - FAST_MATH_PI * roundf(x * (1.0f / FAST_MATH_PI));
+    float abs_x = fabsf(x);
+    bool reciprocal = abs_x > FAST_MATH_PI_4;
+    if (reciprocal) {
+        abs_x = FAST_MATH_PI_2 - abs_x;
+    }
+
+    // Taylor series up to x^15
+    float x2 = abs_x * abs_x;
+    float t = abs_x * (1.0f + x2 * (0.333333333f + x2 * (0.133333333f + x2 * (0.053968254f + x2 * (0.021869489f +
+                       x2 * (0.008863236f + x2 * (0.003592128f + x2 * 0.001455834f)))))));
+
+    if (reciprocal) {
+        t = 1.0f / t;
+    }
+    return (x < 0.0f) ? -t : t;
+}
+
+
+#if USE_FAST_DISPLAY_MATH
+    #define display_atan2f(y, x)    fast_atan2f(y, x)
+    #define display_asinf(x)        fast_asinf(x)
+    #define display_tanf(x)         fast_tanf(x)
+#else
+    #define display_atan2f(y, x)    atan2f(y, x)
+    #define display_asinf(x)        asinf(x)
+    #define display_tanf(x)         tanf(x)
+#endif  // USE_FAST_DISPLAY_MATH
+
+#endif // FAST_MATH_H_
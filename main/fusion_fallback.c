@@ -0,0 +1,36 @@
+#include "fusion_fallback.h"
+
+#include <string.h>
+
+
+void fusion_fallback_init(fusion_fallback_t *fallback, const fusion_fallback_config_t *config, int64_t now_us) {
+    memset(fallback, 0, sizeof(fusion_fallback_t));
+    memcpy(&fallback->config, config, sizeof(fusion_fallback_config_t));
+    fusion_fallback_kick(fallback, now_us, 0);
+}
+
+
+void fusion_fallback_kick(fusion_fallback_t *fallback, int64_t timestamp_us, uint32_t report_interval_us) {
+    fallback->last_sample_us = timestamp_us;
+    fallback->last_sample_timeout_us = fusion_fallback_get_timeout_us(fallback, report_interval_us);
+}
+
+
+uint32_t fusion_fallback_get_timeout_us(const fusion_fallback_t *fallback, uint32_t report_interval_us) {
+    uint64_t timeout_us = (uint64_t) report_interval_us * fallback->config.timeout_intervals;
+    if (timeout_us < fallback->config.min_timeout_us) {
+        return fallback->config.min_timeout_us;
+    }
+    return timeout_us > UINT32_MAX ? UINT32_MAX : (uint32_t) timeout_us;
+}
+
+
+bool fusion_fallback_is_missing(const fusion_fallback_t *fallback, int64_t now_us, uint32_t report_interval_us) {
+    // Slowed down: the next sample comes an interval after the last one. Sped up: it may still come at the old interval.
+    uint32_t timeout_us = fusion_fallback_get_timeout_us(fallback, report_interval_us);
+    if (fallback->last_sample_timeout_us > timeout_us) {
+        timeout_us = fallback->last_sample_timeout_us;
+    }
+
+    return now_us - fallback->last_sample_us > (int64_t) timeout_us;
+}
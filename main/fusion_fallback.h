@@ -0,0 +1,58 @@
+#ifndef FUSION_FALLBACK_H
+#define FUSION_FALLBACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The fallback timeout is free of ESP-IDF dependencies so it can be run against the rate governor on the host.
+
+
+typedef struct {
+    uint32_t min_timeout_us;            // Shortest gap tolerated, covers the scheduling jitter of the fast reports
+    uint32_t timeout_intervals;         // Gap tolerated in report intervals
+} fusion_fallback_config_t;
+
+
+/**
+ * Decides when the game rotation vector is missing, so the level falls back on bno085_fusion. The gap tolerated follows
+ * the effective report interval: the rate governor slows the report down while the device rests, a fixed timeout at or
+ * below that interval would start and stop the fallback on every sample. Across an interval change the longer of the
+ * two intervals applies, the samples of the previous interval may still be in flight.
+ */
+typedef struct {
+    fusion_fallback_config_t config;
+    int64_t last_sample_us;             // Arrival of the last sample drawn
+    uint32_t last_sample_timeout_us;    // Gap tolerated at the interval of the last sample
+} fusion_fallback_t;
+
+
+/**
+ * @brief Initialize the timeout, started at `now_us`.
+ */
+void fusion_fallback_init(fusion_fallback_t *fallback, const fusion_fallback_config_t *config, int64_t now_us);
+
+/**
+ * @brief Restart the timeout, on a sample drawn or when the report is requested again.
+ *
+ * @param fallback Pointer to the timeout.
+ * @param timestamp_us Arrival of the sample.
+ * @param report_interval_us Effective report interval, 0 if unknown.
+ */
+void fusion_fallback_kick(fusion_fallback_t *fallback, int64_t timestamp_us, uint32_t report_interval_us);
+
+/**
+ * @brief Gap tolerated after a sample of a report running at `report_interval_us`.
+ */
+uint32_t fusion_fallback_get_timeout_us(const fusion_fallback_t *fallback, uint32_t report_interval_us);
+
+/**
+ * @brief Whether the report is missing. Check it after the pending samples are drained.
+ *
+ * @param fallback Pointer to the timeout.
+ * @param now_us Current time.
+ * @param report_interval_us Effective report interval, 0 if unknown.
+ * @return true if no sample arrived within the gap tolerated.
+ */
+bool fusion_fallback_is_missing(const fusion_fallback_t *fallback, int64_t now_us, uint32_t report_interval_us);
+
+#endif // FUSION_FALLBACK_H
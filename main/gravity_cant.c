@@ -0,0 +1,37 @@
+#include <math.h>
+
+#include "gravity_cant.h"
+#include "fast_math.h"
+
+
+void gravity_cant_set_frame(gravity_cant_frame_t *frame, uint32_t rotation, float user_roll_rad_offset) {
+    frame->rotation = rotation;
+    frame->user_roll_rad_offset = user_roll_rad_offset;
+    frame->offset_rad = user_roll_rad_offset - rotation * FAST_MATH_PI_2;
+    frame->cos_offset = cosf(frame->offset_rad);
+    frame->sin_offset = sinf(frame->offset_rad);
+}
+
+
+void gravity_from_quaternion(float real, float i, float j, float k, float gravity[3]) {
+    // Third row of the rotation matrix, the earth z axis seen from the sensor
+    gravity[0] = 2.0f * (i * k - real * j);
+    gravity[1] = 2.0f * (j * k + real * i);
+    gravity[2] = real * real - i * i - j * j + k * k;
+}
+
+
+void gravity_cant_compute(const gravity_cant_frame_t *frame, const float gravity[3], float *cant_rad, float *pitch_rad) {
+    float gx = gravity[0], gy = gravity[1], gz = gravity[2];
+
+    // The roll is the angle of (gz, gy). Rotate it into the display frame rather than wrapping the angle afterwards.
+    if (cant_rad) {
+        float c = gz * frame->cos_offset - gy * frame->sin_offset;
+        float s = gy * frame->cos_offset + gz * frame->sin_offset;
+        *cant_rad = display_atan2f(s, c);
+    }
+
+    if (pitch_rad) {
+        *pitch_rad = display_atan2f(-gx, sqrtf(gy * gy + gz * gz));
+    }
+}
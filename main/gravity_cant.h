@@ -0,0 +1,48 @@
+#ifndef GRAVITY_CANT_H
+#define GRAVITY_CANT_H
+
+#include <stdint.h>
+
+// The cant logic is free of ESP-IDF dependencies so it can be compared against the Euler path on the host.
+
+
+/**
+ * Display frame of the level: the screen rotation and the user roll offset folded into one rotation about the bore
+ * axis. Rebuilt only when either changes, so the per sample cost is a 2D rotation.
+ */
+typedef struct {
+    uint32_t rotation;              // Screen rotation in quarter turns
+    float user_roll_rad_offset;
+    float cos_offset;
+    float sin_offset;
+    float offset_rad;               // Angle added to the sensor roll to get the cant
+} gravity_cant_frame_t;
+
+
+/**
+ * @brief Build the display frame.
+ *
+ * @param frame Frame.
+ * @param rotation Screen rotation in quarter turns (lv_display_rotation_t).
+ * @param user_roll_rad_offset User roll offset.
+ */
+void gravity_cant_set_frame(gravity_cant_frame_t *frame, uint32_t rotation, float user_roll_rad_offset);
+
+/**
+ * @brief Gravity direction in the sensor frame from an orientation quaternion. The quaternion doesn't need to be
+ *  normalized, only the direction is used.
+ */
+void gravity_from_quaternion(float real, float i, float j, float k, float gravity[3]);
+
+/**
+ * @brief Cant and pitch from the gravity direction. Both stay well defined up to steep pitch, where the Euler
+ *  decomposition (asin) loses precision.
+ *
+ * @param frame Display frame.
+ * @param gravity Gravity direction in the sensor frame, from gravity_from_quaternion() or the gravity report.
+ * @param cant_rad Cant in the display frame, in [-pi, pi].
+ * @param pitch_rad Pitch, in [-pi/2, pi/2].
+ */
+void gravity_cant_compute(const gravity_cant_frame_t *frame, const float gravity[3], float *cant_rad, float *pitch_rad);
+
+#endif // GRAVITY_CANT_H
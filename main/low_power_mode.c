@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -23,6 +25,8 @@
 #include "main_tileview.h"
 
 #define TAG "LowPowerMode"
+#define STABILITY_DETECTOR_NOTIFY_BIT (1 << 0)
+#define STABILITY_CLASSIFIER_NOTIFY_BIT (1 << 1)
 
 typedef enum {
     IN_IDLE_MODE = (1 << 0),
@@ -50,12 +54,18 @@ lv_obj_t * pre_low_power_mode_tile;
 
 TaskHandle_t low_power_monitor_task_handle;
 TaskHandle_t sensor_stability_detector_poller_task_handle;
+TaskHandle_t sensor_rate_governor_task_handle;
 uint32_t wakeup_cause;
 
 TickType_t last_activity_tick = 0;
 TickType_t last_idle_tick = 0;
 static EventGroupHandle_t low_power_control_event;
 static lv_indev_read_cb_t original_read_cb;  // the original touchpad read callback
+static bno085_subscriber_t stability_detector_subscriber;
+static bno085_report_request_t stability_detector_request;
+static bno085_subscriber_t stability_classifier_subscriber;
+static bno085_report_request_t stability_classifier_request;
+static rate_governor_t rate_governor;
 
 // Forward declaration of internal functions
 void enter_idle_mode(bool enter);
@@ -354,14 +364,16 @@ void low_power_monitor_task(void *p) {
 
 void sensor_stability_detector_poller_task(void *p) {
     // Initialize sensor
-    ESP_ERROR_CHECK(bno085_enable_stability_detector_report(bno085_dev, SENSOR_STABILITY_DETECTOR_REPORT_PERIOD_MS));
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &stability_detector_subscriber, SH2_STABILITY_DETECTOR, NULL, STABILITY_DETECTOR_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &stability_detector_request, SH2_STABILITY_DETECTOR));
+    ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &stability_detector_request, SENSOR_STABILITY_DETECTOR_REPORT_PERIOD_MS));
 
     // Disable the task watchdog as the task is expected to block indefinitely
     esp_task_wdt_delete(NULL);
 
     while (1) {
         uint16_t stability;
-        esp_err_t err = bno085_wait_for_stability_detector_report(bno085_dev, &stability, true);
+        esp_err_t err = bno085_wait_for_stability_detector_report(bno085_dev, &stability_detector_subscriber, &stability, true);
 
         ESP_LOGI(TAG, "Stability detector report: %d, err: %d", stability, err);
 
@@ -375,6 +387,58 @@ void sensor_stability_detector_poller_task(void *p) {
     }
 }
 
+void sensor_rate_governor_task(void *p) {
+    rate_governor_config_t config = {
+        .settle_us = SENSOR_RATE_GOVERNOR_SETTLE_MS * 1000,
+        .static_interval_floor_ms = SENSOR_RATE_GOVERNOR_STATIC_REPORT_PERIOD_MS,
+    };
+    rate_governor_init(&rate_governor, &config);
+
+    // Initialize sensor
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &stability_classifier_subscriber, SH2_STABILITY_CLASSIFIER, NULL, STABILITY_CLASSIFIER_NOTIFY_BIT));
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &stability_classifier_request, SH2_STABILITY_CLASSIFIER));
+    ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &stability_classifier_request, SENSOR_STABILITY_CLASSIFIER_REPORT_PERIOD_MS));
+
+    // Disable the task watchdog as the task is expected to block indefinitely
+    esp_task_wdt_delete(NULL);
+
+    bool interval_floor_pending = false;
+    while (1) {
+        uint8_t classification;
+        if (bno085_wait_for_stability_classification_report(bno085_dev, &stability_classifier_subscriber, &classification, true) != ESP_OK) {
+            continue;
+        }
+
+        bool mode_changed = rate_governor_update(&rate_governor, esp_timer_get_time(), classification);
+        uint32_t interval_floor_ms = rate_governor_get_interval_floor_ms(&rate_governor);
+        if (mode_changed) {
+            ESP_LOGI(TAG, "Rate governor: %s (classification %d), orientation interval floor %lu ms, mode changes %lu, static time %lld ms",
+                     rate_governor.mode == RATE_GOVERNOR_MODE_STATIC ? "static" : "active", classification, interval_floor_ms,
+                     rate_governor.stats.mode_change_count, rate_governor.stats.static_time_us / 1000);
+        }
+
+        // Slow down the orientation reports while at rest, the views keep their requests. A transient failure (e.g. bus
+        // error, sensor recovering) is retried on the next classifier report.
+        if (mode_changed || interval_floor_pending) {
+            esp_err_t game_rotation_vector_err = bno085_set_report_interval_floor(bno085_dev, SH2_GAME_ROTATION_VECTOR, interval_floor_ms);
+            esp_err_t rotation_vector_err = bno085_set_report_interval_floor(bno085_dev, SH2_ROTATION_VECTOR, interval_floor_ms);
+
+            interval_floor_pending = game_rotation_vector_err != ESP_OK || rotation_vector_err != ESP_OK;
+            if (interval_floor_pending) {
+                ESP_LOGW(TAG, "Failed to apply the orientation interval floor %lu ms (%s, %s), retrying on the next classifier report",
+                         interval_floor_ms, esp_err_to_name(game_rotation_vector_err), esp_err_to_name(rotation_vector_err));
+            }
+        }
+    }
+}
+
+
+void get_sensor_rate_governor_stats(rate_governor_stats_t *stats) {
+    // Updated by the governor task only, a torn read across the fields is acceptable for statistics
+    memcpy(stats, &rate_governor.stats, sizeof(rate_governor_stats_t));
+}
+
+
 void create_low_power_mode_view(lv_obj_t * parent) {
     low_power_control_event = xEventGroupCreate();
     if (low_power_control_event == NULL) {
@@ -421,6 +485,20 @@ void create_low_power_mode_view(lv_obj_t * parent) {
         ESP_LOGE(TAG, "Failed to allocate memory for sensor_stability_detector_poller_task");
         ESP_ERROR_CHECK(ESP_FAIL);
     }
+
+    // Create sensor report rate governor task
+    rtos_return = xTaskCreate(
+        sensor_rate_governor_task,
+        "RATEGOV",
+        SENSOR_RATE_GOVERNOR_TASK_STACK,
+        NULL,
+        SENSOR_RATE_GOVERNOR_TASK_PRIORITY,
+        &sensor_rate_governor_task_handle
+    );
+    if (rtos_return != pdPASS) {
+        ESP_LOGE(TAG, "Failed to allocate memory for sensor_rate_governor_task");
+        ESP_ERROR_CHECK(ESP_FAIL);
+    }
 #endif  // USE_BNO085
 
     // Inject the wrapper to the pointer input
@@ -3,6 +3,7 @@
 
 #include "lvgl.h"
 #include "esp_err.h"
+#include "rate_governor.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,6 +22,8 @@ void prevent_sleep_mode_enter(bool prevent);
 
 void wake_from_idle_mode();
 
+void get_sensor_rate_governor_stats(rate_governor_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
@@ -28,6 +28,8 @@ lv_obj_t * tile_low_power_mode_view = NULL;
 
 lv_obj_t * default_tile = NULL;
 
+extern bno085_ctx_t * bno085_dev;
+
 
 void tile_change_callback(lv_event_t * e) {
     // Store the previous tile to determine the switch event
@@ -40,6 +42,12 @@ void tile_change_callback(lv_event_t * e) {
     ESP_LOGI(TAG, "Active: %p", active_tile);
 
     if (active_tile != previous_tile) {
+        bno085_report_manager_stats_t stats_before;
+        bno085_get_report_manager_stats(bno085_dev, &stats_before);
+
+        // Collect the report requests of both views and only apply the net change
+        bno085_defer_report_requests(bno085_dev);
+
         // Disable the callback of the previous view
         if (previous_tile != NULL) {
             tile_update_enable_cb_t tile_update_enable_cb = lv_obj_get_user_data(previous_tile);
@@ -59,6 +67,14 @@ void tile_change_callback(lv_event_t * e) {
         else {
             ESP_LOGI(TAG, "No enable callback associated with tile %p", active_tile);
         }
+
+        ESP_ERROR_CHECK(bno085_apply_report_requests(bno085_dev));
+
+        bno085_report_manager_stats_t stats_after;
+        bno085_get_report_manager_stats(bno085_dev, &stats_after);
+        uint32_t request_count = stats_after.request_count - stats_before.request_count;
+        uint32_t command_count = stats_after.command_count - stats_before.command_count;
+        ESP_LOGI(TAG, "Report requests: %lu, set feature sent: %lu, avoided: %lu", request_count, command_count, request_count - command_count);
     }
 
 }
@@ -0,0 +1,36 @@
+#include "orientation_state.h"
+
+#include <string.h>
+
+
+void orientation_state_init(orientation_state_latch_t *latch) {
+    memset(latch, 0, sizeof(orientation_state_latch_t));
+}
+
+
+void orientation_state_publish(orientation_state_latch_t *latch, const orientation_state_t *state) {
+    // Only the writer changes the sequence, therefore it can be read without synchronization
+    uint32_t sequence = latch->sequence;
+
+    // Steer the readers to copy 1 while copy 0 is updated
+    __atomic_store_n(&latch->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memcpy(&latch->copies[0], state, sizeof(orientation_state_t));
+
+    // Then back to copy 0 while copy 1 is updated
+    __atomic_store_n(&latch->sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    memcpy(&latch->copies[1], state, sizeof(orientation_state_t));
+}
+
+
+void orientation_state_read(const orientation_state_latch_t *latch, orientation_state_t *state) {
+    uint32_t sequence_before, sequence_after;
+
+    do {
+        sequence_before = __atomic_load_n(&latch->sequence, __ATOMIC_ACQUIRE);
+        memcpy(state, &latch->copies[sequence_before & 1], sizeof(orientation_state_t));
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        sequence_after = __atomic_load_n(&latch->sequence, __ATOMIC_RELAXED);
+    } while (sequence_before != sequence_after);
+}
@@ -0,0 +1,50 @@
+#ifndef ORIENTATION_STATE_H
+#define ORIENTATION_STATE_H
+
+#include <stdint.h>
+
+// The state logic is free of ESP-IDF dependencies so it can be stress tested with threads on the host.
+
+
+typedef struct {
+    float roll_rad;
+    float pitch_rad;
+    float yaw_rad;
+    int64_t orientation_timestamp_us;       // Sample time of the rotation vector the angles are taken from
+    float x_acceleration;
+    float y_acceleration;
+    float z_acceleration;
+    int64_t acceleration_timestamp_us;      // Sample time of the linear acceleration
+    int64_t shot_timestamp_us;              // Recoil trigger time of the last shot, 0 until a shot is captured
+    float shot_cant_rad;                    // Cant in the display frame at the trigger time
+    float shot_pitch_rad;
+} orientation_state_t;
+
+
+/**
+ * Single writer, multiple reader orientation state. The state is kept twice and the sequence number selects the copy
+ * that is not being written (a latched seqlock), so readers never wait for an interrupted writer. A reader only retries
+ * when the writer published a new state during its copy.
+ */
+typedef struct {
+    uint32_t sequence;                      // Incremented before each copy is updated, the low bit selects the copy to read
+    orientation_state_t copies[2];
+} orientation_state_latch_t;
+
+
+/**
+ * @brief Initialize the latch with a zeroed state.
+ */
+void orientation_state_init(orientation_state_latch_t *latch);
+
+/**
+ * @brief Publish a new state. Must be called from one task only.
+ */
+void orientation_state_publish(orientation_state_latch_t *latch, const orientation_state_t *state);
+
+/**
+ * @brief Take a consistent snapshot of the last published state. Safe to call from any task.
+ */
+void orientation_state_read(const orientation_state_latch_t *latch, orientation_state_t *state);
+
+#endif // ORIENTATION_STATE_H
@@ -5,6 +5,8 @@
 #include "sensor_config.h"
 #include "app_cfg.h"
 #include "common.h"
+#include "fast_math.h"
+#include "orientation_state.h"
 #include "esp_lvgl_port.h"
 #include "system_config.h"
 
@@ -52,6 +54,7 @@ const float icfra_target_radius_ratio[] = {
 
 
 #define SENSOR_POLL_EVENT_RUN (1 << 0)
+#define GAME_ROTATION_VECTOR_NOTIFY_BIT (1 << 0)
 static EventGroupHandle_t sensor_task_control;
 static TaskHandle_t sensor_event_poller_task_handle;
 static lv_obj_t * chart;
@@ -62,11 +65,13 @@ extern sensor_config_t sensor_config;
 extern system_config_t system_config;
 
 const float eps = 1e-6f;
-static float sensor_rv_pitch_thread_unsafe, sensor_rv_yaw_thread_unsafe;
+static orientation_state_latch_t orientation_state_latch;   // Written by the sensor poller task, read by the chart callbacks
+static bno085_subscriber_t game_rotation_vector_subscriber;
+static bno085_report_request_t game_rotation_vector_request;
 
 IRAM_ATTR esp_err_t euler_to_xy(float pitch, float yaw, float *out_x, float *out_y) {
-    *out_x = -point_of_aim_view_config.target_distance * tanf(yaw);
-    *out_y = -point_of_aim_view_config.target_distance * tanf(pitch);
+    *out_x = -point_of_aim_view_config.target_distance * display_tanf(yaw);
+    *out_y = -point_of_aim_view_config.target_distance * display_tanf(pitch);
 
     return ESP_OK;
 }
@@ -78,18 +83,23 @@ static void sensor_event_poller_task(void *p) {
 
     TickType_t last_poll_tick = xTaskGetTickCount();
 
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &game_rotation_vector_subscriber, SH2_GAME_ROTATION_VECTOR, NULL, GAME_ROTATION_VECTOR_NOTIFY_BIT));
+
     while (1) {
         xEventGroupWaitBits(sensor_task_control, SENSOR_POLL_EVENT_RUN, pdFALSE, pdFALSE, portMAX_DELAY);
 
         // Block wait for event
         while (xEventGroupGetBits(sensor_task_control) & SENSOR_POLL_EVENT_RUN) {
             // Wait for rotation vector
-            float roll;
-            if (bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_dev, &roll, &sensor_rv_pitch_thread_unsafe, &sensor_rv_yaw_thread_unsafe, false) == ESP_OK) {
+            orientation_state_t state = {0};
+            if (bno085_wait_for_game_rotation_vector_roll_pitch_yaw(bno085_dev, &game_rotation_vector_subscriber, &state.roll_rad, &state.pitch_rad, &state.yaw_rad, false) == ESP_OK) {
+                state.orientation_timestamp_us = game_rotation_vector_subscriber.last_timestamp_us;
+                orientation_state_publish(&orientation_state_latch, &state);
+
                 // Round angle
                 float pitch, yaw;
-                pitch = wrap_angle(sensor_rv_pitch_thread_unsafe - point_of_aim_view_config.user_pitch_rad_offset);
-                yaw = wrap_angle(sensor_rv_yaw_thread_unsafe - point_of_aim_view_config.user_yaw_rad_offset);
+                pitch = wrap_angle(state.pitch_rad - point_of_aim_view_config.user_pitch_rad_offset);
+                yaw = wrap_angle(state.yaw_rad - point_of_aim_view_config.user_yaw_rad_offset);
 
                 // ESP_LOGI(TAG, "Roll: %f, Pitch: %f, Yaw: %f", roll, pitch, yaw);
                 float proj_x_m = 0, proj_y_m = 0;
@@ -116,7 +126,7 @@ void enable_point_of_aim_view(bool enable) {
     if (enable) {
         // Enable rotation vector report
         if (sensor_config.enable_rotation_vector_report) {
-            ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS));
+            ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &game_rotation_vector_request, SENSOR_GAME_ROTATION_VECTOR_REPORT_PERIOD_MS));
         }
 
         // Allow task to run
@@ -124,10 +134,8 @@ void enable_point_of_aim_view(bool enable) {
 
     }
     else {
-        // Disable rotation vector report
-        if (sensor_config.enable_rotation_vector_report) {
-            ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, 0));
-        }
+        // Release rotation vector report
+        ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &game_rotation_vector_request, 0));
 
         // Stop task
         xEventGroupClearBits(sensor_task_control, SENSOR_POLL_EVENT_RUN);
@@ -137,8 +145,10 @@ void enable_point_of_aim_view(bool enable) {
 
 static void chart_touch_event_cb(lv_event_t *e) {
     // Record current point of aim
-    point_of_aim_view_config.user_yaw_rad_offset = sensor_rv_yaw_thread_unsafe;
-    point_of_aim_view_config.user_pitch_rad_offset = sensor_rv_pitch_thread_unsafe;
+    orientation_state_t state;
+    orientation_state_read(&orientation_state_latch, &state);
+    point_of_aim_view_config.user_yaw_rad_offset = state.yaw_rad;
+    point_of_aim_view_config.user_pitch_rad_offset = state.pitch_rad;
 }
 
 
@@ -251,8 +261,10 @@ void create_point_of_aim_view(lv_obj_t * parent) {
     // Create data series
     data_series = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
 
-    // Initialize the report record
-    ESP_ERROR_CHECK(bno085_enable_rotation_vector_report(bno085_dev, 0));
+    // Register the report request
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &game_rotation_vector_request, SH2_GAME_ROTATION_VECTOR));
+
+    orientation_state_init(&orientation_state_latch);
 
     // Task controller
     sensor_task_control = xEventGroupCreate();
@@ -0,0 +1,60 @@
+#include "rate_governor.h"
+
+#include <string.h>
+
+
+static void set_mode(rate_governor_t *governor, int64_t timestamp_us, rate_governor_mode_t mode) {
+    if (governor->mode == RATE_GOVERNOR_MODE_STATIC) {
+        governor->stats.static_time_us += timestamp_us - governor->mode_since_us;
+    }
+
+    governor->mode = mode;
+    governor->mode_since_us = timestamp_us;
+    governor->stats.mode = mode;
+    governor->stats.interval_floor_ms = rate_governor_get_interval_floor_ms(governor);
+    governor->stats.mode_change_count += 1;
+}
+
+
+void rate_governor_init(rate_governor_t *governor, const rate_governor_config_t *config) {
+    memset(governor, 0, sizeof(rate_governor_t));
+    memcpy(&governor->config, config, sizeof(rate_governor_config_t));
+    governor->mode = RATE_GOVERNOR_MODE_ACTIVE;
+    governor->stats.mode = RATE_GOVERNOR_MODE_ACTIVE;
+}
+
+
+bool rate_governor_update(rate_governor_t *governor, int64_t timestamp_us, uint8_t classification) {
+    governor->stats.classification_count += 1;
+
+    // Held in hand (stable) is not at rest, the shooter is aiming. Unknown is treated as motion.
+    bool at_rest = classification == RATE_GOVERNOR_CLASSIFICATION_ON_TABLE ||
+                   classification == RATE_GOVERNOR_CLASSIFICATION_STATIONARY;
+
+    if (!at_rest) {
+        governor->at_rest = false;
+
+        if (governor->mode != RATE_GOVERNOR_MODE_ACTIVE) {
+            set_mode(governor, timestamp_us, RATE_GOVERNOR_MODE_ACTIVE);
+            return true;
+        }
+        return false;
+    }
+
+    if (!governor->at_rest) {
+        governor->at_rest = true;
+        governor->at_rest_since_us = timestamp_us;
+    }
+
+    if (governor->mode == RATE_GOVERNOR_MODE_ACTIVE && timestamp_us - governor->at_rest_since_us >= governor->config.settle_us) {
+        set_mode(governor, timestamp_us, RATE_GOVERNOR_MODE_STATIC);
+        return true;
+    }
+
+    return false;
+}
+
+
+uint32_t rate_governor_get_interval_floor_ms(const rate_governor_t *governor) {
+    return governor->mode == RATE_GOVERNOR_MODE_STATIC ? governor->config.static_interval_floor_ms : 0;
+}
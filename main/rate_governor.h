@@ -0,0 +1,72 @@
+#ifndef RATE_GOVERNOR_H
+#define RATE_GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The governor logic is free of ESP-IDF dependencies so it can be replayed against recorded classifier streams on the host.
+
+
+// Values of the BNO085 stability classifier report
+typedef enum {
+    RATE_GOVERNOR_CLASSIFICATION_UNKNOWN = 0,
+    RATE_GOVERNOR_CLASSIFICATION_ON_TABLE = 1,
+    RATE_GOVERNOR_CLASSIFICATION_STATIONARY = 2,
+    RATE_GOVERNOR_CLASSIFICATION_STABLE = 3,
+    RATE_GOVERNOR_CLASSIFICATION_MOTION = 4,
+} rate_governor_classification_t;
+
+
+typedef enum {
+    RATE_GOVERNOR_MODE_ACTIVE,      // Reports run at the rate requested by the views
+    RATE_GOVERNOR_MODE_STATIC,      // Device at rest, orientation reports are slowed down
+} rate_governor_mode_t;
+
+
+typedef struct {
+    uint32_t settle_us;                     // Time the device must stay at rest before entering the static mode
+    uint32_t static_interval_floor_ms;      // Slowest orientation report interval applied in the static mode
+} rate_governor_config_t;
+
+
+typedef struct {
+    rate_governor_mode_t mode;
+    uint32_t interval_floor_ms;             // Interval floor currently applied, 0 in the active mode
+    uint32_t classification_count;          // Number of classifier reports processed
+    uint32_t mode_change_count;
+    int64_t static_time_us;                 // Time spent in the static mode, excluding the current period
+} rate_governor_stats_t;
+
+
+typedef struct {
+    rate_governor_config_t config;
+    rate_governor_mode_t mode;
+    bool at_rest;                           // Whether the last classification is at rest
+    int64_t at_rest_since_us;
+    int64_t mode_since_us;
+    rate_governor_stats_t stats;
+} rate_governor_t;
+
+
+/**
+ * @brief Initialize the governor in the active mode.
+ */
+void rate_governor_init(rate_governor_t *governor, const rate_governor_config_t *config);
+
+/**
+ * @brief Feed one classifier report. Motion switches back to the active mode on the same report, the static mode is only
+ *  entered once the device is on the table or stationary for `settle_us`.
+ *
+ * @param governor Pointer to the governor.
+ * @param timestamp_us Time of the classifier report.
+ * @param classification Stability classification from the BNO085.
+ * @return true if the mode has changed.
+ */
+bool rate_governor_update(rate_governor_t *governor, int64_t timestamp_us, uint8_t classification);
+
+/**
+ * @brief Get the interval floor of the orientation reports, 0 when the reports run at the requested rate.
+ */
+uint32_t rate_governor_get_interval_floor_ms(const rate_governor_t *governor);
+
+#endif // RATE_GOVERNOR_H
@@ -0,0 +1,154 @@
+#include "recoil_capture.h"
+
+#include <math.h>
+#include <string.h>
+
+
+static size_t ring_index(const recoil_capture_t *capture, size_t offset_from_newest) {
+    return (capture->write_idx + RECOIL_CAPTURE_BUFFER_LENGTH - 1 - offset_from_newest) % RECOIL_CAPTURE_BUFFER_LENGTH;
+}
+
+
+void recoil_capture_init(recoil_capture_t *capture, const recoil_capture_config_t *config) {
+    memset(capture, 0, sizeof(recoil_capture_t));
+    memcpy(&capture->config, config, sizeof(recoil_capture_config_t));
+    capture->state = RECOIL_CAPTURE_IDLE;
+}
+
+
+void recoil_capture_arm(recoil_capture_t *capture) {
+    capture->write_idx = 0;
+    capture->count = 0;
+    capture->above_level = false;
+    capture->pre_trigger_count = 0;
+    capture->post_trigger_count = 0;
+    capture->peak_value = 0;
+    capture->state = RECOIL_CAPTURE_ARMED;
+}
+
+
+void recoil_capture_disarm(recoil_capture_t *capture) {
+    // Keep the complete capture readable
+    if (capture->state != RECOIL_CAPTURE_COMPLETE) {
+        capture->state = RECOIL_CAPTURE_IDLE;
+    }
+}
+
+
+recoil_capture_event_t recoil_capture_push(recoil_capture_t *capture, int64_t timestamp_us, float value) {
+    if (capture->state != RECOIL_CAPTURE_ARMED && capture->state != RECOIL_CAPTURE_TRIGGERED) {
+        return RECOIL_CAPTURE_EVENT_NONE;
+    }
+
+    bool first_sample = capture->count == 0;
+
+    capture->samples[capture->write_idx].timestamp_us = timestamp_us;
+    capture->samples[capture->write_idx].value = value;
+    capture->write_idx = (capture->write_idx + 1) % RECOIL_CAPTURE_BUFFER_LENGTH;
+    if (capture->count < RECOIL_CAPTURE_BUFFER_LENGTH) {
+        capture->count += 1;
+    }
+
+    float abs_value = fabsf(value);
+
+    if (capture->state == RECOIL_CAPTURE_ARMED) {
+        bool above_level = abs_value >= capture->config.trigger_level;
+        bool last_above_level = capture->above_level;
+        capture->above_level = above_level;
+
+        // The first sample only establishes the level, the sensor may already be above the level when armed
+        if (first_sample) {
+            return RECOIL_CAPTURE_EVENT_NONE;
+        }
+
+        bool triggered = (capture->config.edge == RECOIL_CAPTURE_RISING_EDGE) ? (!last_above_level && above_level) : (last_above_level && !above_level);
+        if (!triggered) {
+            return RECOIL_CAPTURE_EVENT_NONE;
+        }
+
+        capture->trigger_timestamp_us = timestamp_us;
+        capture->trigger_value = value;
+        capture->peak_value = abs_value;
+        capture->post_trigger_count = 0;
+
+        // Retain the samples within the pre-trigger window
+        capture->pre_trigger_count = 0;
+        while (capture->pre_trigger_count + 1 < capture->count) {
+            const recoil_capture_sample_t * sample = &capture->samples[ring_index(capture, capture->pre_trigger_count + 1)];
+            if (timestamp_us - sample->timestamp_us > capture->config.pre_trigger_us) {
+                break;
+            }
+            capture->pre_trigger_count += 1;
+        }
+
+        capture->state = RECOIL_CAPTURE_TRIGGERED;
+        return RECOIL_CAPTURE_EVENT_TRIGGER;
+    }
+
+    // Collect post-trigger samples
+    capture->post_trigger_count += 1;
+    if (abs_value > capture->peak_value) {
+        capture->peak_value = abs_value;
+    }
+
+    // Stop at the end of the window, or before the pre-trigger samples are overwritten
+    if (timestamp_us - capture->trigger_timestamp_us >= capture->config.post_trigger_us ||
+        capture->pre_trigger_count + 1 + capture->post_trigger_count >= RECOIL_CAPTURE_BUFFER_LENGTH) {
+        capture->state = RECOIL_CAPTURE_COMPLETE;
+        return RECOIL_CAPTURE_EVENT_COMPLETE;
+    }
+
+    return RECOIL_CAPTURE_EVENT_NONE;
+}
+
+
+size_t recoil_capture_get_length(const recoil_capture_t *capture) {
+    if (capture->state != RECOIL_CAPTURE_COMPLETE) {
+        return 0;
+    }
+
+    return capture->pre_trigger_count + 1 + capture->post_trigger_count;
+}
+
+
+const recoil_capture_sample_t * recoil_capture_get_sample(const recoil_capture_t *capture, size_t idx) {
+    size_t length = recoil_capture_get_length(capture);
+    if (idx >= length) {
+        return NULL;
+    }
+
+    return &capture->samples[ring_index(capture, length - 1 - idx)];
+}
+
+
+size_t recoil_capture_decimate(const recoil_capture_t *capture, float *output, size_t output_length, size_t *trigger_idx) {
+    size_t length = recoil_capture_get_length(capture);
+    if (length == 0 || output_length == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < output_length; i += 1) {
+        // Each point covers [start, end) of the capture. When the capture is shorter than the output the samples repeat.
+        size_t start = i * length / output_length;
+        size_t end = (i + 1) * length / output_length;
+        if (end <= start) {
+            end = start + 1;
+        }
+
+        float value = 0;
+        for (size_t j = start; j < end; j += 1) {
+            float sample_value = recoil_capture_get_sample(capture, j)->value;
+            if (fabsf(sample_value) >= fabsf(value)) {
+                value = sample_value;
+            }
+        }
+        output[i] = value;
+    }
+
+    if (trigger_idx) {
+        // Point whose bucket holds the trigger sample
+        *trigger_idx = ((capture->pre_trigger_count + 1) * output_length - 1) / length;
+    }
+
+    return output_length;
+}
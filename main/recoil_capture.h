@@ -0,0 +1,115 @@
+#ifndef RECOIL_CAPTURE_H
+#define RECOIL_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The capture logic is free of ESP-IDF dependencies so it can be replayed against recorded traces on the host.
+
+#ifndef RECOIL_CAPTURE_BUFFER_LENGTH
+    #define RECOIL_CAPTURE_BUFFER_LENGTH 256  // Number of samples retained around the trigger
+#endif  // RECOIL_CAPTURE_BUFFER_LENGTH
+
+
+typedef enum {
+    RECOIL_CAPTURE_RISING_EDGE,
+    RECOIL_CAPTURE_FALLING_EDGE,
+} recoil_capture_edge_t;
+
+
+typedef enum {
+    RECOIL_CAPTURE_IDLE,        // Not armed, samples are ignored
+    RECOIL_CAPTURE_ARMED,       // Filling the pre-trigger ring, looking for the trigger
+    RECOIL_CAPTURE_TRIGGERED,   // Trigger detected, collecting post-trigger samples
+    RECOIL_CAPTURE_COMPLETE,    // Capture frozen until re-armed
+} recoil_capture_state_t;
+
+
+typedef enum {
+    RECOIL_CAPTURE_EVENT_NONE,
+    RECOIL_CAPTURE_EVENT_TRIGGER,
+    RECOIL_CAPTURE_EVENT_COMPLETE,
+} recoil_capture_event_t;
+
+
+typedef struct {
+    float trigger_level;            // Absolute acceleration (m/s^2) to trigger at
+    recoil_capture_edge_t edge;
+    uint32_t pre_trigger_us;        // Time retained before the trigger
+    uint32_t post_trigger_us;       // Time collected after the trigger
+} recoil_capture_config_t;
+
+
+typedef struct {
+    int64_t timestamp_us;
+    float value;
+} recoil_capture_sample_t;
+
+
+typedef struct {
+    recoil_capture_config_t config;
+    recoil_capture_state_t state;
+
+    recoil_capture_sample_t samples[RECOIL_CAPTURE_BUFFER_LENGTH];
+    size_t write_idx;               // Next slot to write
+    size_t count;                   // Number of valid samples in the ring
+
+    bool above_level;               // Whether the last sample is at or above the trigger level
+    size_t pre_trigger_count;       // Samples retained before the trigger sample
+    size_t post_trigger_count;      // Samples collected after the trigger sample
+    int64_t trigger_timestamp_us;
+    float trigger_value;
+    float peak_value;               // Largest absolute value since the trigger
+} recoil_capture_t;
+
+
+/**
+ * @brief Initialize the capture with the configuration. The capture is left idle.
+ */
+void recoil_capture_init(recoil_capture_t *capture, const recoil_capture_config_t *config);
+
+/**
+ * @brief Discard the previous capture and start looking for the trigger.
+ */
+void recoil_capture_arm(recoil_capture_t *capture);
+
+/**
+ * @brief Stop capturing. The last complete capture remains readable.
+ */
+void recoil_capture_disarm(recoil_capture_t *capture);
+
+/**
+ * @brief Feed one sample to the capture.
+ *
+ * @param capture Pointer to the capture.
+ * @param timestamp_us Time when the sample is taken.
+ * @param value Acceleration on the recoil axis in m/s^2.
+ * @return recoil_capture_event_t RECOIL_CAPTURE_EVENT_TRIGGER on the trigger sample, RECOIL_CAPTURE_EVENT_COMPLETE
+ *  once the post-trigger window is collected, RECOIL_CAPTURE_EVENT_NONE otherwise.
+ */
+recoil_capture_event_t recoil_capture_push(recoil_capture_t *capture, int64_t timestamp_us, float value);
+
+/**
+ * @brief Get the number of samples in the frozen capture, including the pre and post trigger samples.
+ */
+size_t recoil_capture_get_length(const recoil_capture_t *capture);
+
+/**
+ * @brief Get a sample of the frozen capture in chronological order. Index `pre_trigger_count` is the trigger sample.
+ */
+const recoil_capture_sample_t * recoil_capture_get_sample(const recoil_capture_t *capture, size_t idx);
+
+/**
+ * @brief Reduce the frozen capture to `output_length` points for display. Each point is the value with the largest
+ *  magnitude within its bucket so the peak of a short impulse is preserved.
+ *
+ * @param capture Pointer to the capture.
+ * @param output Buffer to store the decimated values.
+ * @param output_length Number of points to produce.
+ * @param trigger_idx Optional pointer to store the index of the point holding the trigger sample.
+ * @return size_t Number of points written, 0 if no capture is complete.
+ */
+size_t recoil_capture_decimate(const recoil_capture_t *capture, float *output, size_t output_length, size_t *trigger_idx);
+
+#endif // RECOIL_CAPTURE_H
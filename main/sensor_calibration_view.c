@@ -24,11 +24,15 @@ typedef enum {
     RV_POLLER_RUN = (1 << 0),
 } sensor_calibration_task_control_bit_e;
 
+#define ROTATION_VECTOR_NOTIFY_BIT (1 << 0)
+
 
 extern bno085_ctx_t * bno085_dev;
 extern sensor_config_t sensor_config;
 
 static EventGroupHandle_t sensor_calibration_task_control;
+static bno085_subscriber_t rotation_vector_subscriber;
+static bno085_report_request_t rotation_vector_request;
 
 lv_obj_t * rv_measurements_label = NULL;
 lv_obj_t * rv_accuracy_label = NULL;
@@ -46,12 +50,14 @@ void rotation_vector_poller_task(void *p) {
     // Disable the task watchdog as the task is expected to block indefinitely
     esp_task_wdt_delete(NULL);
 
+    ESP_ERROR_CHECK(bno085_subscribe(bno085_dev, &rotation_vector_subscriber, SH2_ROTATION_VECTOR, NULL, ROTATION_VECTOR_NOTIFY_BIT));
+
     while (1) {
         xEventGroupWaitBits(sensor_calibration_task_control, RV_POLLER_RUN, pdFALSE, pdFALSE, portMAX_DELAY);
 
         while (xEventGroupGetBits(sensor_calibration_task_control) & RV_POLLER_RUN) {
             
-            esp_err_t ret = bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_dev, &roll, &pitch, &yaw, &accuracy, true);
+            esp_err_t ret = bno085_wait_for_rotation_vector_roll_pitch_yaw(bno085_dev, &rotation_vector_subscriber, &roll, &pitch, &yaw, &accuracy, true);
 
             if (ret == ESP_OK) {
                 // ESP_LOGI(TAG, "Received rotation vector report: roll=%f, pitch=%f, yaw=%f, accuracy=%f", roll, pitch, yaw, accuracy);
@@ -110,7 +116,7 @@ void enter_sensor_calibration_mode(bool enable) {
         prevent_idle_mode_enter(true);
         
         // Enable RV report from BNO085
-        ESP_ERROR_CHECK(bno085_enable_rotation_vector_report(bno085_dev, SENSOR_ROTATION_VECTOR_REPORT_PERIOD_MS));
+        ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &rotation_vector_request, SENSOR_ROTATION_VECTOR_REPORT_PERIOD_MS));
 
         // Enable the poller task to update the RV measurement on the screen
         xEventGroupSetBits(sensor_calibration_task_control, RV_POLLER_RUN);
@@ -122,7 +128,7 @@ void enter_sensor_calibration_mode(bool enable) {
         xEventGroupClearBits(sensor_calibration_task_control, RV_POLLER_RUN);
 
         // Set RV report back to idle mode period
-        ESP_ERROR_CHECK(bno085_enable_rotation_vector_report(bno085_dev, SENSOR_ROTATION_VECTOR_LOW_POWER_MODE_REPORT_PERIOD_MS));
+        ESP_ERROR_CHECK(bno085_update_report_request(bno085_dev, &rotation_vector_request, SENSOR_ROTATION_VECTOR_LOW_POWER_MODE_REPORT_PERIOD_MS));
     }
 }
 
@@ -154,6 +160,9 @@ void create_sensor_calibration_view(lv_obj_t * parent) {
     // Initialize the task control
     sensor_calibration_task_control = xEventGroupCreate();
 
+    // Register the report request
+    ESP_ERROR_CHECK(bno085_register_report_request(bno085_dev, &rotation_vector_request, SH2_ROTATION_VECTOR));
+
     
     // Create RV report poller
     BaseType_t rtos_return = xTaskCreate(
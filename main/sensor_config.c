@@ -19,6 +19,9 @@ const sensor_config_t sensor_config_default = {
     .enable_game_rotation_vector_report = true,
     .enable_linear_acceleration_report = true,
     .enable_rotation_vector_report = true,
+    .game_rotation_vector_batch_interval_ms = 0,
+    .linear_acceleration_batch_interval_ms = 10,  // Linear acceleration runs at the highest rate for recoil capture
+    .rotation_vector_batch_interval_ms = 0,
 };
 
 
@@ -43,6 +46,23 @@ esp_err_t load_sensor_config() {
 }
 
 
+esp_err_t apply_sensor_report_batch_config() {
+    ESP_RETURN_ON_ERROR(bno085_set_report_batch_interval(bno085_dev, SH2_GAME_ROTATION_VECTOR, sensor_config.game_rotation_vector_batch_interval_ms), TAG, "Failed to set game rotation vector batch interval");
+    ESP_RETURN_ON_ERROR(bno085_set_report_batch_interval(bno085_dev, SH2_LINEAR_ACCELERATION, sensor_config.linear_acceleration_batch_interval_ms), TAG, "Failed to set linear acceleration batch interval");
+    ESP_RETURN_ON_ERROR(bno085_set_report_batch_interval(bno085_dev, SH2_ROTATION_VECTOR, sensor_config.rotation_vector_batch_interval_ms), TAG, "Failed to set rotation vector batch interval");
+
+    return ESP_OK;
+}
+
+
+void get_recoil_capture_config(recoil_capture_config_t *config) {
+    config->trigger_level = sensor_config.recoil_acceleration_trigger_level;
+    config->edge = (sensor_config.trigger_edge == TRIGGER_FALLING_EDGE) ? RECOIL_CAPTURE_FALLING_EDGE : RECOIL_CAPTURE_RISING_EDGE;
+    config->pre_trigger_us = RECOIL_CAPTURE_PRE_TRIGGER_MS * 1000;
+    config->post_trigger_us = RECOIL_CAPTURE_POST_TRIGGER_MS * 1000;
+}
+
+
 static void on_save_button_pressed(lv_event_t * e) {
     ESP_ERROR_CHECK(save_sensor_config());
 
@@ -77,34 +97,30 @@ static void update_uint32_item(lv_event_t *e) {
 }
 
 
+static void update_batch_interval_item(lv_event_t *e) {
+    update_uint32_item(e);
+
+    ESP_ERROR_CHECK(apply_sensor_report_batch_config());
+}
+
+
+// The views only request the reports enabled here, and release them when the config view is shown
 static void toggle_linear_acceleration_report(lv_event_t *e) {
     lv_obj_t * sw = lv_event_get_target_obj(e);
     bool * state = lv_event_get_user_data(e);
     *state = lv_obj_has_state(sw, LV_STATE_CHECKED);
-
-    if (*state == false) {
-        ESP_ERROR_CHECK(bno085_enable_linear_acceleration_report(bno085_dev, 0));
-    }
 }
 
 static void toggle_game_rotation_vector_report(lv_event_t *e) {
     lv_obj_t * sw = lv_event_get_target_obj(e);
     bool * state = lv_event_get_user_data(e);
     *state = lv_obj_has_state(sw, LV_STATE_CHECKED);
-
-    if (*state == false) {
-        ESP_ERROR_CHECK(bno085_enable_game_rotation_vector_report(bno085_dev, 0));
-    }
 }
 
 static void toggle_rotation_vector_report(lv_event_t *e) {
     lv_obj_t * sw = lv_event_get_target_obj(e);
     bool * state = lv_event_get_user_data(e);
     *state = lv_obj_has_state(sw, LV_STATE_CHECKED);
-
-    if (*state == false) {
-        ESP_ERROR_CHECK(bno085_enable_rotation_vector_report(bno085_dev, 0));
-    }
 }
 
 
@@ -145,6 +161,16 @@ lv_obj_t * create_sensor_config_view_config(lv_obj_t * parent, lv_obj_t * parent
     container = create_menu_container_with_text(sub_page_config_view, NULL, "Enable Rotation Vector Report");
     config_item = create_switch(container, &sensor_config.enable_rotation_vector_report, toggle_rotation_vector_report);
 
+    // Sensor side batching. Reports are buffered in the sensor FIFO and delivered in a burst every batch interval
+    container = create_menu_container_with_text(sub_page_config_view, NULL, "Game Rotation Vector Batch (ms)");
+    config_item = create_spin_box(container, 0, 200, 10, 3, 0, sensor_config.game_rotation_vector_batch_interval_ms, update_batch_interval_item, &sensor_config.game_rotation_vector_batch_interval_ms);
+
+    container = create_menu_container_with_text(sub_page_config_view, NULL, "Linear Accel Batch (ms)");
+    config_item = create_spin_box(container, 0, 200, 10, 3, 0, sensor_config.linear_acceleration_batch_interval_ms, update_batch_interval_item, &sensor_config.linear_acceleration_batch_interval_ms);
+
+    container = create_menu_container_with_text(sub_page_config_view, NULL, "Rotation Vector Batch (ms)");
+    config_item = create_spin_box(container, 0, 200, 10, 3, 0, sensor_config.rotation_vector_batch_interval_ms, update_batch_interval_item, &sensor_config.rotation_vector_batch_interval_ms);
+
     // Save Reload
     container = create_menu_container_with_text(sub_page_config_view, NULL, "Save/Reload/Reset");
     create_save_reload_reset_buttons(container, on_save_button_pressed, on_reload_button_pressed, on_reset_button_pressed);
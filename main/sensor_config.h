@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "lvgl.h"
 #include "esp_err.h"
+#include "recoil_capture.h"
 
 typedef enum {
     TRIGGER_RISING_EDGE,
@@ -18,12 +19,17 @@ typedef struct {
     bool enable_game_rotation_vector_report;
     bool enable_linear_acceleration_report;
     bool enable_rotation_vector_report;
+    uint32_t game_rotation_vector_batch_interval_ms;  // 0 to report immediately
+    uint32_t linear_acceleration_batch_interval_ms;
+    uint32_t rotation_vector_batch_interval_ms;
 } sensor_config_t;
 
 
 lv_obj_t * create_sensor_config_view_config(lv_obj_t * parent, lv_obj_t * parent_menu_page);
 esp_err_t load_sensor_config();
 esp_err_t save_sensor_config();
+esp_err_t apply_sensor_report_batch_config();
+void get_recoil_capture_config(recoil_capture_config_t *config);
 
 
 #endif // SENSOR_CONFIG_H
\ No newline at end of file
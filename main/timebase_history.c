@@ -0,0 +1,138 @@
+#include <math.h>
+#include <string.h>
+
+#include "timebase_history.h"
+
+
+_Static_assert((TIMEBASE_HISTORY_LENGTH & (TIMEBASE_HISTORY_LENGTH - 1)) == 0, "TIMEBASE_HISTORY_LENGTH must be a power of two");
+
+
+static inline const timebase_sample_t * get_sample(const timebase_history_t *history, size_t idx) {
+    // Chronological index, 0 is the oldest sample
+    size_t slot = (history->write_idx - history->count + idx) & (TIMEBASE_HISTORY_LENGTH - 1);
+    return &history->samples[slot];
+}
+
+
+static void lerp(const float *a, const float *b, size_t dimension, float f, float *value) {
+    for (size_t i = 0; i < dimension; i += 1) {
+        value[i] = a[i] + f * (b[i] - a[i]);
+    }
+}
+
+
+static void slerp(const float *a, const float *b, float f, float *value) {
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+    // q and -q are the same rotation, take the short path
+    float sign = 1.0f;
+    if (dot < 0.0f) {
+        dot = -dot;
+        sign = -1.0f;
+    }
+
+    // Nearly parallel quaternions, the linear blend is as accurate and avoids the division by sin(theta)
+    float wa = 1.0f - f;
+    float wb = f;
+    if (dot < 0.9995f) {
+        float theta = acosf(dot);
+        float inv_sin_theta = 1.0f / sinf(theta);
+        wa = sinf(wa * theta) * inv_sin_theta;
+        wb = sinf(wb * theta) * inv_sin_theta;
+    }
+    wb *= sign;
+
+    float norm_sqr = 0.0f;
+    for (int i = 0; i < 4; i += 1) {
+        value[i] = wa * a[i] + wb * b[i];
+        norm_sqr += value[i] * value[i];
+    }
+
+    float inv_norm = 1.0f / sqrtf(norm_sqr);
+    for (int i = 0; i < 4; i += 1) {
+        value[i] *= inv_norm;
+    }
+}
+
+
+void timebase_history_init(timebase_history_t *history, timebase_interpolation_t interpolation, size_t dimension, uint32_t max_gap_us) {
+    memset(history, 0, sizeof(timebase_history_t));
+    history->interpolation = interpolation;
+    history->dimension = dimension;
+    history->max_gap_us = max_gap_us;
+}
+
+
+void timebase_history_reset(timebase_history_t *history) {
+    history->write_idx = 0;
+    history->count = 0;
+}
+
+
+bool timebase_history_push(timebase_history_t *history, int64_t timestamp_us, const float *value) {
+    // The search relies on increasing timestamps
+    if (history->count > 0 && timestamp_us <= get_sample(history, history->count - 1)->timestamp_us) {
+        return false;
+    }
+
+    timebase_sample_t *sample = &history->samples[history->write_idx];
+    sample->timestamp_us = timestamp_us;
+    memcpy(sample->value, value, history->dimension * sizeof(float));
+
+    history->write_idx = (history->write_idx + 1) & (TIMEBASE_HISTORY_LENGTH - 1);
+    if (history->count < TIMEBASE_HISTORY_LENGTH) {
+        history->count += 1;
+    }
+    return true;
+}
+
+
+bool timebase_history_lookup(const timebase_history_t *history, int64_t timestamp_us, float *value) {
+    if (history->count == 0) {
+        return false;
+    }
+
+    // First sample at or after the requested time
+    size_t low = 0;
+    size_t high = history->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (get_sample(history, mid)->timestamp_us < timestamp_us) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    // Newer than the latest sample, the value is not known yet
+    if (low == history->count) {
+        return false;
+    }
+
+    const timebase_sample_t *after = get_sample(history, low);
+    if (after->timestamp_us == timestamp_us) {
+        memcpy(value, after->value, history->dimension * sizeof(float));
+        return true;
+    }
+
+    // Older than the retained samples
+    if (low == 0) {
+        return false;
+    }
+
+    const timebase_sample_t *before = get_sample(history, low - 1);
+    int64_t gap_us = after->timestamp_us - before->timestamp_us;
+    if (gap_us > history->max_gap_us) {
+        return false;
+    }
+
+    float f = (float) (timestamp_us - before->timestamp_us) / (float) gap_us;
+    if (history->interpolation == TIMEBASE_INTERPOLATION_SLERP) {
+        slerp(before->value, after->value, f, value);
+    }
+    else {
+        lerp(before->value, after->value, history->dimension, f, value);
+    }
+    return true;
+}
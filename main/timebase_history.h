@@ -0,0 +1,81 @@
+#ifndef TIMEBASE_HISTORY_H
+#define TIMEBASE_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The history is free of ESP-IDF dependencies so it can be replayed against recorded report streams on the host.
+
+#ifndef TIMEBASE_HISTORY_LENGTH
+    #define TIMEBASE_HISTORY_LENGTH 64  // Number of samples retained per report, a power of two
+#endif  // TIMEBASE_HISTORY_LENGTH
+
+#define TIMEBASE_HISTORY_MAX_DIMENSION 4
+
+
+typedef enum {
+    TIMEBASE_INTERPOLATION_LINEAR,      // Component-wise, for vectors
+    TIMEBASE_INTERPOLATION_SLERP,       // Spherical, for unit quaternions
+} timebase_interpolation_t;
+
+
+typedef struct {
+    int64_t timestamp_us;
+    float value[TIMEBASE_HISTORY_MAX_DIMENSION];
+} timebase_sample_t;
+
+
+/**
+ * Short history of a sensor report on the sensor timebase, so reports arriving at different rates can be sampled at the
+ * same instant, e.g. the orientation at the time of a recoil trigger detected on the linear acceleration.
+ */
+typedef struct {
+    timebase_interpolation_t interpolation;
+    size_t dimension;                   // Number of components in use, 4 for quaternions
+    uint32_t max_gap_us;                // Samples further apart are not interpolated across (report disabled, sensor reset)
+
+    timebase_sample_t samples[TIMEBASE_HISTORY_LENGTH];
+    size_t write_idx;                   // Next slot to write
+    size_t count;                       // Number of valid samples in the ring
+} timebase_history_t;
+
+
+/**
+ * @brief Initialize an empty history.
+ *
+ * @param history Pointer to the history.
+ * @param interpolation Interpolation between samples, TIMEBASE_INTERPOLATION_SLERP requires a dimension of 4.
+ * @param dimension Number of components per sample, up to TIMEBASE_HISTORY_MAX_DIMENSION.
+ * @param max_gap_us Largest interval between two samples to interpolate across.
+ */
+void timebase_history_init(timebase_history_t *history, timebase_interpolation_t interpolation, size_t dimension, uint32_t max_gap_us);
+
+/**
+ * @brief Discard all samples. The configuration is kept.
+ */
+void timebase_history_reset(timebase_history_t *history);
+
+/**
+ * @brief Append a sample, overwriting the oldest one when the history is full.
+ *
+ * @param history Pointer to the history.
+ * @param timestamp_us Sample time on the sensor timebase.
+ * @param value Sample components, `dimension` values.
+ * @return true if appended, false if the sample is not newer than the latest one.
+ */
+bool timebase_history_push(timebase_history_t *history, int64_t timestamp_us, const float *value);
+
+/**
+ * @brief Get the value of the report at a given time, interpolated between the two samples around it. The lookup is a
+ *  binary search over the ring.
+ *
+ * @param history Pointer to the history.
+ * @param timestamp_us Time on the sensor timebase.
+ * @param value Buffer to store `dimension` values.
+ * @return true if the time is covered by the history, false if it is outside the retained samples or within a gap
+ *  longer than `max_gap_us`.
+ */
+bool timebase_history_lookup(const timebase_history_t *history, int64_t timestamp_us, float *value);
+
+#endif // TIMEBASE_HISTORY_H